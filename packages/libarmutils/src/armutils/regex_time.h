@@ -39,6 +39,19 @@
  */
 /*@{*/
 
+/**
+ *  Element of a fixed-format time string parser.
+ */
+typedef struct {
+
+    char         code;      /**< time format code, or '\0' for a literal */
+    char         chr;       /**< literal character to match              */
+    int          min;       /**< minimum number of digits                */
+    int          max;       /**< maximum number of digits, 0 = no limit  */
+    int          frac;      /**< allow an optional fractional part       */
+
+} RETimeElem;
+
 /**
  *  Regular Expression with Time Format Codes.
  */
@@ -51,6 +64,10 @@ typedef struct {
     regex_t      preg;      /**< compiled regular expression          */
     int          flags;     /**< reserved for control flags           */
 
+    int          nelems;    /**< number of fixed-format parser elements */
+    RETimeElem  *elems;     /**< fixed-format parser, NULL if not used  */
+    int          at_end;    /**< fixed-format match must end the string */
+
 } RETime;
 
 /**
@@ -221,6 +221,221 @@ static int __retime_parse(RETime *retime, const char *pattern)
     return(1);
 }
 
+/**
+ *  PRIVATE: Compile a fixed-format parser for a regex-time format string.
+ *
+ *  Patterns that only contain numeric time format codes and literal
+ *  characters can be matched without the regex engine. Each numeric
+ *  field is matched greedily, so a variable width field is only allowed
+ *  if it is followed by a literal non-digit character or the end of the
+ *  pattern. This guarantees the substring offsets are the same as the
+ *  ones the regex engine would find for a match that starts at the
+ *  beginning of the string.
+ *
+ *  Patterns that do not meet these requirements are left to the regex
+ *  engine and no parser will be created.
+ *
+ *  @param  retime   pointer to the RETime structure to use.
+ *  @param  pattern  the time string pattern
+ *
+ *  @retval  1  if succesful, or the pattern is not supported
+ *  @retval  0  if a memory allocation error occurred
+ */
+static int __retime_compile_fixed(RETime *retime, const char *pattern)
+{
+    RETimeElem *elems;
+    RETimeElem *elem;
+    RETimeElem *next;
+    const char *sp;
+    int         nelems;
+    int         at_end;
+    int         zero;
+    int         ei;
+
+    elems = calloc(strlen(pattern) + 1, sizeof(RETimeElem));
+    if (!elems) return(0);
+
+    sp     = pattern;
+    nelems = 0;
+    at_end = 0;
+
+    if (*sp == '^') ++sp;
+
+    while (*sp != '\0') {
+
+        elem = &elems[nelems++];
+
+        if (*sp == '%') {
+
+            ++sp;
+
+            zero = 0;
+            if (*sp == '0') {
+                zero = 1;
+                ++sp;
+            }
+
+            elem->code = *sp;
+
+            switch (*sp) {
+                case 'Y':
+                    elem->min = 4; elem->max = 4;
+                    break;
+                case 'C':
+                    elem->min = 2; elem->max = 2;
+                    break;
+                case 'd':
+                case 'e':
+                case 'H':
+                case 'm':
+                case 'M':
+                case 'y':
+                    elem->min = (zero) ? 2 : 1; elem->max = 2;
+                    break;
+                case 'S':
+                    elem->min = (zero) ? 2 : 1; elem->max = 2;
+                    elem->frac = !zero;
+                    break;
+                case 'j':
+                    elem->min = (zero) ? 3 : 1; elem->max = 3;
+                    elem->frac = !zero;
+                    break;
+                case 'h':
+                    elem->min = (zero) ? 4 : 1; elem->max = 4;
+                    break;
+                case 's':
+                    elem->min = 1; elem->max = 0;
+                    elem->frac = !zero;
+                    break;
+                case '%':
+                    elem->code = '\0';
+                    elem->chr  = '%';
+                    break;
+                default:
+                    free(elems);
+                    return(1);
+            }
+
+            ++sp;
+        }
+        else if (*sp == '\\') {
+
+            /* Escaped literal, but not a regex class or back reference */
+
+            ++sp;
+
+            if (*sp == '\0' || isalnum(*sp)) {
+                free(elems);
+                return(1);
+            }
+
+            elem->chr = *sp++;
+        }
+        else if (*sp == '$' && *(sp + 1) == '\0') {
+            --nelems;
+            at_end = 1;
+            break;
+        }
+        else if (strchr(".[]()*+?{}|^$", *sp)) {
+            free(elems);
+            return(1);
+        }
+        else {
+            elem->chr = *sp++;
+        }
+    }
+
+    /* Make sure all variable width fields have a well defined end */
+
+    for (ei = 0; ei < nelems; ++ei) {
+
+        elem = &elems[ei];
+
+        if (!elem->code || (elem->min == elem->max && !elem->frac)) {
+            continue;
+        }
+
+        if (ei == nelems - 1) break;
+
+        next = &elems[ei + 1];
+
+        if (next->code || isdigit(next->chr) ||
+            (elem->frac && next->chr == '.')) {
+
+            free(elems);
+            return(1);
+        }
+    }
+
+    retime->nelems = nelems;
+    retime->elems  = elems;
+    retime->at_end = at_end;
+
+    return(1);
+}
+
+/**
+ *  PRIVATE: Match a string using the fixed-format parser.
+ *
+ *  @param  retime  pointer to the RETime structure
+ *  @param  string  string to match
+ *  @param  pmatch  output: substring offsets of the time format codes
+ *
+ *  @retval  1  if the string matches starting at the first character
+ *  @retval  0  if not
+ */
+static int __retime_execute_fixed(
+    RETime     *retime,
+    const char *string,
+    regmatch_t *pmatch)
+{
+    RETimeElem *elem;
+    const char *sp;
+    const char *start;
+    int         ndigits;
+    int         ei, mi;
+
+    sp = string;
+    mi = 0;
+
+    for (ei = 0; ei < retime->nelems; ++ei) {
+
+        elem = &retime->elems[ei];
+
+        if (!elem->code) {
+            if (*sp != elem->chr) return(0);
+            ++sp;
+            continue;
+        }
+
+        start   = sp;
+        ndigits = 0;
+
+        while (*sp >= '0' && *sp <= '9' &&
+               (!elem->max || ndigits < elem->max)) {
+            ++sp;
+            ++ndigits;
+        }
+
+        if (ndigits < elem->min) return(0);
+
+        if (elem->frac && *sp == '.' && *(sp + 1) >= '0' && *(sp + 1) <= '9') {
+            for (sp += 2; *sp >= '0' && *sp <= '9'; ++sp);
+        }
+
+        ++mi;
+        pmatch[mi].rm_so = start - string;
+        pmatch[mi].rm_eo = sp - string;
+    }
+
+    if (retime->at_end && *sp != '\0') return(0);
+
+    pmatch[0].rm_so = 0;
+    pmatch[0].rm_eo = sp - string;
+
+    return(1);
+}
+
 /*******************************************************************************
  *  Public Functions
  */
@@ -259,6 +474,10 @@ static int __retime_parse(RETime *retime, const char *pattern)
  *
  *  See the regex(7) man page for the descriptions of the regex patterns.
  *
+ *  Patterns that only contain numeric time format codes and literal
+ *  characters are also compiled into a fixed-format parser that is tried
+ *  before the regex engine by retime_execute().
+ *
  *  The memory used by the returned RETime structure is dynamically allocated
  *  and must be freed by the calling process using the retime_free() function.
  *
@@ -306,6 +525,10 @@ RETime *retime_compile(const char *pattern, int flags)
         return((RETime *)NULL);
     }
 
+    /* Compile the fixed-format parser if the pattern supports it */
+
+    if (!__retime_compile_fixed(retime, pattern)) goto MEMORY_ERROR;
+
     /* Compile the regular expression */
 
     preg = &(retime->preg);
@@ -442,7 +665,13 @@ int retime_execute(RETime *retime, const char *string, RETimeRes *res)
 
     /* Check for match */
 
-    status = re_execute(preg, string, nmatch, pmatch, 0);
+    if (retime->elems && __retime_execute_fixed(retime, string, pmatch)) {
+        status = 1;
+    }
+    else {
+        status = re_execute(preg, string, nmatch, pmatch, 0);
+    }
+
     if (status  < 0) return(-1);
     if (status == 0) return (0);
 
@@ -693,6 +922,7 @@ void retime_free(RETime *retime)
         if (retime->tspattern) free(retime->tspattern);
         if (retime->codes)     free(retime->codes);
         if (retime->pattern)   free(retime->pattern);
+        if (retime->elems)     free(retime->elems);
         regfree(&(retime->preg));
         free(retime);
     }
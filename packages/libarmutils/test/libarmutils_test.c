@@ -0,0 +1,75 @@
+/*******************************************************************************
+*
+*  Copyright © 2014, Battelle Memorial Institute
+*  All rights reserved.
+*
+*******************************************************************************/
+
+#include <string.h>
+
+#include "libarmutils_test.h"
+
+const char *gProgramName = NULL;
+const char *gTopTestDir  = NULL;
+int         gFailCount   = 0;
+
+/*******************************************************************************
+ *  Run Test Functions
+ */
+
+/* All of these tests check their own results against reference values they
+ * compute themselves, so unlike the libcds3 tests there are no log files to
+ * compare. */
+
+int run_test(
+    const char *test_name,
+    int (*test_func)(void))
+{
+    int  status;
+    int  ndots;
+
+    status = test_func();
+
+    ndots = 51 - strlen(test_name);
+
+    fprintf(stdout, "%s", test_name);
+
+    while (--ndots) {
+        fprintf(stdout, ".");
+    }
+
+    if (status) {
+        fprintf(stdout, "pass\n");
+    }
+    else {
+        gFailCount += 1;
+        fprintf(stdout, "FAIL\n");
+    }
+
+    return(status);
+}
+
+/*******************************************************************************
+ *  Main
+ */
+
+int main(int argc, char **argv)
+{
+    gProgramName = argv[0];
+
+    if (argc == 2) {
+        gTopTestDir = argv[1];
+    }
+    else {
+        gTopTestDir = ".";
+    }
+
+    gFailCount = 0;
+
+    fprintf(stdout, "\nTesting build for libarmutils version: %s\n",
+        armutils_lib_version());
+
+    libarmutils_test_regex_time();
+
+    return(gFailCount);
+}
@@ -0,0 +1,23 @@
+/*******************************************************************************
+*
+*  Copyright © 2014, Battelle Memorial Institute
+*  All rights reserved.
+*
+*******************************************************************************/
+
+#ifndef _LIBARMUTILS_TEST_H
+#define _LIBARMUTILS_TEST_H
+
+#include "armutils.h"
+
+/* Run test function */
+
+int  run_test(
+        const char *test_name,
+        int       (*test_func)(void));
+
+/* Test functions */
+
+void libarmutils_test_regex_time(void);
+
+#endif
@@ -0,0 +1,319 @@
+/*******************************************************************************
+*
+*  Copyright © 2014, Battelle Memorial Institute
+*  All rights reserved.
+*
+*******************************************************************************/
+
+#include <time.h>
+
+#include "libarmutils_test.h"
+
+/*******************************************************************************
+ *  Test Tables
+ */
+
+/**
+ *  Regex/time pattern test case.
+ *
+ *  The expected time is formatted as "YYYY-MM-DD hh:mm:ss.uuuuuu", or NULL
+ *  if the string should not match the pattern.
+ */
+typedef struct {
+
+    const char *pattern;    /**< regex/time pattern                          */
+    int         fixed;      /**< pattern should compile a fixed-format parser */
+    const char *string;     /**< string to match                             */
+    const char *expected;   /**< expected time, or NULL for no match         */
+
+} RETimeTest;
+
+/* Patterns the fixed-format parser matches directly */
+
+static RETimeTest _FixedFormatTests[] = {
+
+    { "%Y%0m%0d\\.%0H%0M%0S",  1, "20200102.030405",
+      "2020-01-02 03:04:05.000000" },
+    { "^%Y%0m%0d\\.%0H%0M%0S$",1, "20200102.030405",
+      "2020-01-02 03:04:05.000000" },
+    { "%Y-%m-%d %H:%M:%S",     1, "2020-1-2 3:4:5.25",
+      "2020-01-02 03:04:05.250000" },
+    { "%Y-%m-%d %H:%M:%S",     1, "2020-01-02 03:04:59.9999996",
+      "2020-01-02 03:05:00.000000" },
+    { "%Y-%m-%d %H:%M:%S",     1, "2020-01-02 03:04:60",
+      "2020-01-02 03:05:00.000000" },
+    { "%Y\\-%0m\\-%0d",        1, "2020-01-02",
+      "2020-01-02 00:00:00.000000" },
+    { "%Y%0j%0H%0M",           1, "20200601234",
+      "2020-02-29 12:34:00.000000" },
+    { "%Y %j",                 1, "2020 1.5",
+      "2020-01-01 12:00:00.000000" },
+    { "%Y%0m%0d_%0h",          1, "20200102_0304",
+      "2020-01-02 03:04:00.000000" },
+    { "%0y%0m%0d",             1, "200102",
+      "2020-01-02 00:00:00.000000" },
+    { "%0y%0m%0d",             1, "690102",
+      "1969-01-02 00:00:00.000000" },
+    { "%C%0y-%0m-%0d",         1, "1999-12-31",
+      "1999-12-31 00:00:00.000000" },
+    { "%s",                    1, "1577934245.5",
+      "2020-01-02 03:04:05.500000" },
+    { "%Y-%m-%d %H:%M:%S%%",   1, "2020-01-02 03:04:05%",
+      "2020-01-02 03:04:05.000000" },
+    { NULL, 0, NULL, NULL }
+};
+
+/* Strings the fixed-format parser can not match from the first character,
+ * so retime_execute() falls back to searching with the regex engine */
+
+static RETimeTest _RegexFallbackTests[] = {
+
+    { "%Y%0m%0d\\.%0H%0M%0S",  1, "sgpmetE13.00.20200102.030405.raw",
+      "2020-01-02 03:04:05.000000" },
+    { "%Y-%0m-%0d$",           1, "x2020-01-02",
+      "2020-01-02 00:00:00.000000" },
+    { "%Y-%m-%d %H:%M",        1, "2020-01-02 12:34 2021-02-03 04:05",
+      "2020-01-02 12:34:00.000000" },
+    { "%Y-%m-%d %H:%M",        1, "2020-01-02 123:45 2021-02-03 04:05",
+      "2021-02-03 04:05:00.000000" },
+    { "%0y%0m%0d",             1, "x200102",
+      "2020-01-02 00:00:00.000000" },
+    { NULL, 0, NULL, NULL }
+};
+
+/* Patterns that can only be matched by the regex engine */
+
+static RETimeTest _UnsupportedPatternTests[] = {
+
+    { "%Y%0m%0d.%0H%0M%0S",    0, "20200102.030405",
+      "2020-01-02 03:04:05.000000" },
+    { "%Y%m%d",                0, "20200102",
+      "2020-01-02 00:00:00.000000" },
+    { "%y%0m%0d",              0, "200102",
+      "2020-01-02 00:00:00.000000" },
+    { "%b %d %Y",              0, "Jan 2 2020",
+      "2020-01-02 00:00:00.000000" },
+    { "%Y-%m-%d %H:%M %p",     0, "2020-01-02 1:04 PM",
+      "2020-01-02 13:04:00.000000" },
+    { "%s\\.raw",              0, "1577934245.raw",
+      "2020-01-02 03:04:05.000000" },
+    { "%Y %j\\.raw",           0, "2020 60.raw",
+      "2020-02-29 00:00:00.000000" },
+    { "%Y-%0m-%0d %o",         0, "2020-01-02 -1.5",
+      "2020-01-01 23:59:58.500000" },
+    { "[[:digit:]]+_%Y%0m%0d", 0, "12_20200102",
+      "2020-01-02 00:00:00.000000" },
+    { "%Y\\d%0m%0d",           0, "2020d0102",
+      "2020-01-02 00:00:00.000000" },
+    { NULL, 0, NULL, NULL }
+};
+
+/* Strings that do not match */
+
+static RETimeTest _NoMatchTests[] = {
+
+    { "%Y-%m-%d %H:%M:%S",     1, "2020-1-2 3:4",             NULL },
+    { "%Y-%m-%d",              1, "2020-13-01",               NULL },
+    { "%Y-%m-%d",              1, "2020-01-32",               NULL },
+    { "%Y-%m-%d %H:%M",        1, "2020-01-02 24:00",         NULL },
+    { "%Y %j",                 1, "2020 367",                 NULL },
+    { "%Y%0m%0d_%0h",          1, "20200102_2401",            NULL },
+    { "%Y-%0m-%0d$",           1, "2020-01-02x",              NULL },
+    { "^%Y-%0m-%0d",           1, "x2020-01-02",              NULL },
+    { "%Y-%0m-%0d",            1, "2020-1-02",                NULL },
+    { "%Y%0m%0d",              1, "2020010",                  NULL },
+    { NULL, 0, NULL, NULL }
+};
+
+/*******************************************************************************
+ *  Compare Results
+ */
+
+/**
+ *  Format the time from a pattern match.
+ */
+static void format_result(RETimeRes *res, char *buffer, size_t length)
+{
+    timeval_t tv = retime_get_timeval(res);
+    struct tm tm_time;
+
+    if (tv.tv_sec == -1 || !gmtime_r(&tv.tv_sec, &tm_time)) {
+        snprintf(buffer, length, "invalid time");
+        return;
+    }
+
+    snprintf(buffer, length, "%04d-%02d-%02d %02d:%02d:%02d.%06d",
+        tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
+        tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec,
+        (int)tv.tv_usec);
+}
+
+/**
+ *  Compare the results from the fixed-format parser and the regex engine.
+ */
+static int compare_results(
+    RETime     *retime,
+    const char *string,
+    RETimeRes  *res1,
+    RETimeRes  *res2)
+{
+    size_t mi;
+
+    if (res1->year           != res2->year           ||
+        res1->month          != res2->month          ||
+        res1->mday           != res2->mday           ||
+        res1->hour           != res2->hour           ||
+        res1->min            != res2->min            ||
+        res1->sec            != res2->sec            ||
+        res1->usec           != res2->usec           ||
+        res1->century        != res2->century        ||
+        res1->yy             != res2->yy             ||
+        res1->yday           != res2->yday           ||
+        res1->hhmm           != res2->hhmm           ||
+        res1->secs1970       != res2->secs1970       ||
+        res1->offset.tv_sec  != res2->offset.tv_sec  ||
+        res1->offset.tv_usec != res2->offset.tv_usec) {
+
+        fprintf(stderr,
+            "\n'%s' -> '%s': fixed-format and regex results differ\n",
+            retime->tspattern, string);
+
+        return(0);
+    }
+
+    for (mi = 0; mi <= retime->nsubs; ++mi) {
+
+        if (res1->pmatch[mi].rm_so != res2->pmatch[mi].rm_so ||
+            res1->pmatch[mi].rm_eo != res2->pmatch[mi].rm_eo) {
+
+            fprintf(stderr,
+                "\n'%s' -> '%s': substring %d offsets differ:"
+                " fixed-format (%d, %d) regex (%d, %d)\n",
+                retime->tspattern, string, (int)mi,
+                (int)res1->pmatch[mi].rm_so, (int)res1->pmatch[mi].rm_eo,
+                (int)res2->pmatch[mi].rm_so, (int)res2->pmatch[mi].rm_eo);
+
+            return(0);
+        }
+    }
+
+    return(1);
+}
+
+/**
+ *  Run a table of regex/time pattern tests.
+ *
+ *  Each string is matched using retime_execute() as is, and again with
+ *  the fixed-format parser disabled so only the regex engine is used.
+ *  Both must agree with each other and with the expected result.
+ */
+static int run_retime_tests(RETimeTest *tests)
+{
+    RETimeTest *test;
+    RETime     *retime;
+    RETimeElem *elems;
+    RETimeRes   res1;
+    RETimeRes   res2;
+    char        result[64];
+    int         status1;
+    int         status2;
+    int         retval;
+
+    retval = 1;
+
+    for (test = tests; test->pattern; ++test) {
+
+        retime = retime_compile(test->pattern, 0);
+        if (!retime) {
+            fprintf(stderr, "\n'%s': could not compile pattern\n",
+                test->pattern);
+            retval = 0;
+            continue;
+        }
+
+        if ((retime->elems != NULL) != test->fixed) {
+            fprintf(stderr, "\n'%s': expected %s fixed-format parser\n",
+                test->pattern, (test->fixed) ? "a" : "no");
+            retval = 0;
+        }
+
+        memset(&res1, 0, sizeof(RETimeRes));
+        memset(&res2, 0, sizeof(RETimeRes));
+
+        status1 = retime_execute(retime, test->string, &res1);
+
+        elems          = retime->elems;
+        retime->elems  = (RETimeElem *)NULL;
+        status2        = retime_execute(retime, test->string, &res2);
+        retime->elems  = elems;
+
+        if (status1 != status2) {
+            fprintf(stderr,
+                "\n'%s' -> '%s': fixed-format returned %d, regex returned %d\n",
+                test->pattern, test->string, status1, status2);
+            retval = 0;
+        }
+        else if (status1 != ((test->expected) ? 1 : 0)) {
+            fprintf(stderr, "\n'%s' -> '%s': expected %s, returned %d\n",
+                test->pattern, test->string,
+                (test->expected) ? "a match" : "no match", status1);
+            retval = 0;
+        }
+        else if (status1 == 1) {
+
+            if (!compare_results(retime, test->string, &res1, &res2)) {
+                retval = 0;
+            }
+
+            format_result(&res1, result, 64);
+
+            if (strcmp(result, test->expected) != 0) {
+                fprintf(stderr, "\n'%s' -> '%s': expected '%s', found '%s'\n",
+                    test->pattern, test->string, test->expected, result);
+                retval = 0;
+            }
+        }
+
+        retime_free(retime);
+    }
+
+    return(retval);
+}
+
+/*******************************************************************************
+ *  Regex Time Tests
+ */
+
+static int fixed_format_test(void)
+{
+    return(run_retime_tests(_FixedFormatTests));
+}
+
+static int regex_fallback_test(void)
+{
+    return(run_retime_tests(_RegexFallbackTests));
+}
+
+static int unsupported_pattern_test(void)
+{
+    return(run_retime_tests(_UnsupportedPatternTests));
+}
+
+static int no_match_test(void)
+{
+    return(run_retime_tests(_NoMatchTests));
+}
+
+/*******************************************************************************
+ *  Run Regex Time Tests
+ */
+
+void libarmutils_test_regex_time(void)
+{
+    fprintf(stdout, "\nRegex Time Tests:\n");
+
+    run_test(" - fixed_format_test",        fixed_format_test);
+    run_test(" - regex_fallback_test",      regex_fallback_test);
+    run_test(" - unsupported_pattern_test", unsupported_pattern_test);
+    run_test(" - no_match_test",            no_match_test);
+}
@@ -253,10 +253,20 @@ struct CDSGroup {
     CDSVarGroup **vargroups;    /**< array of variable group pointers */
 
     void         *transform_params; /**< transformation parameters          */
+
+    /* name indexes used by the get functions (private) */
+
+    void         *dim_index;    /**< dimension name index             */
+    void         *att_index;    /**< attribute name index             */
+    void         *var_index;    /**< variable name index              */
+    void         *group_index;  /**< group name index                 */
+
+    void         *arena;        /**< memory arena used by the subtree */
 };
 
 CDSGroup   *cds_define_group(CDSGroup *parent, const char *name);
 int         cds_delete_group(CDSGroup *group);
+int         cds_enable_arena(CDSGroup *group, size_t block_size);
 CDSGroup   *cds_get_group   (CDSGroup *parent, const char *name);
 int         cds_rename_group(CDSGroup *group, const char *name);
 
@@ -440,6 +450,10 @@ struct CDSVar {
     /* default fill value */
 
     void        *default_fill;   /**< default fill value                 */
+
+    /* name index used by cds_get_att (private) */
+
+    void        *att_index;      /**< attribute name index               */
 };
 
 CDSVar *cds_define_var(
@@ -106,21 +106,22 @@ CDSAtt *_cds_create_att(
     size_t       length,
     void        *value)
 {
-    CDSAtt *att;
+    CDSArena *arena = _cds_get_arena(parent);
+    CDSAtt   *att;
 
-    att = (CDSAtt *)calloc(1, sizeof(CDSAtt));
+    att = (CDSAtt *)_cds_arena_alloc(arena, sizeof(CDSAtt));
     if (!att) {
         return((CDSAtt *)NULL);
     }
 
     if (!_cds_init_object_members(att, CDS_ATT, parent, name)) {
-        free(att);
+        _cds_arena_free(arena, att);
         return((CDSAtt *)NULL);
     }
 
     if (!_cds_change_att_value(att, type, length, value)) {
         _cds_free_object_members(att);
-        free(att);
+        _cds_arena_free(arena, att);
         return((CDSAtt *)NULL);
     }
 
@@ -159,6 +160,7 @@ CDSAtt *_cds_define_att(
     CDSAtt   **atts;
     CDSAtt  ***attsp;
     int       *nattsp;
+    void     **indexp;
 
     /* Make sure the parent is a group or variable */
 
@@ -167,6 +169,7 @@ CDSAtt *_cds_define_att(
         group  = (CDSGroup *)parent;
         nattsp = &(group->natts);
         attsp  = &(group->atts);
+        indexp = &(group->att_index);
 
         /* Check if the group is locked */
 
@@ -185,6 +188,7 @@ CDSAtt *_cds_define_att(
         var    = (CDSVar *)parent_object;
         nattsp = &(var->natts);
         attsp  = &(var->atts);
+        indexp = &(var->att_index);
 
         /* Check if the variable is locked */
 
@@ -243,6 +247,8 @@ CDSAtt *_cds_define_att(
     (*nattsp)++;
     atts[*nattsp] = (CDSAtt *)NULL;
 
+    _cds_index_object(indexp, atts[*nattsp - 1]);
+
     return(atts[*nattsp - 1]);
 }
 
@@ -258,7 +264,7 @@ void _cds_destroy_att(CDSAtt *att)
     if (att) {
         _cds_free_att_value(att);
         _cds_free_object_members(att);
-        free(att);
+        _cds_arena_free(_cds_get_arena(att->parent), att);
     }
 }
 
@@ -993,7 +999,8 @@ int cds_delete_att(CDSAtt *att)
 
         /* Remove this attribute from the parent object */
 
-        _cds_remove_object((void **)group->atts, &(group->natts), att);
+        _cds_remove_object(
+            &(group->att_index), (void **)group->atts, &(group->natts), att);
     }
     else if (parent->obj_type == CDS_VAR) {
 
@@ -1013,7 +1020,8 @@ int cds_delete_att(CDSAtt *att)
 
         /* Remove this attribute from the parent object */
 
-        _cds_remove_object((void **)var->atts, &(var->natts), att);
+        _cds_remove_object(
+            &(var->att_index), (void **)var->atts, &(var->natts), att);
     }
     else {
 
@@ -1054,11 +1062,13 @@ CDSAtt *cds_get_att(void *parent, const char *name)
 
     if (parent_object->obj_type == CDS_GROUP) {
         group = (CDSGroup *)parent;
-        att   = _cds_get_object((void **)group->atts, group->natts, name);
+        att   = _cds_get_object(
+            &(group->att_index), (void **)group->atts, group->natts, name);
     }
     else if (parent_object->obj_type == CDS_VAR) {
         var = (CDSVar *)parent;
-        att = _cds_get_object((void **)var->atts, var->natts, name);
+        att = _cds_get_object(
+            &(var->att_index), (void **)var->atts, var->natts, name);
     }
 
     return(att);
@@ -1303,6 +1313,7 @@ int cds_rename_att(CDSAtt *att, const char *name)
     CDSObject *parent = att->parent;
     CDSGroup  *group;
     CDSVar    *var;
+    void     **indexp;
     char      *new_name;
 
     /* Check if an attribute with the new name already exists */
@@ -1333,7 +1344,8 @@ int cds_rename_att(CDSAtt *att, const char *name)
 
     if (parent->obj_type == CDS_GROUP) {
 
-        group = (CDSGroup *)att->parent;
+        group  = (CDSGroup *)att->parent;
+        indexp = &(group->att_index);
 
         /* Check if the group is locked */
 
@@ -1349,7 +1361,8 @@ int cds_rename_att(CDSAtt *att, const char *name)
     }
     else if (parent->obj_type == CDS_VAR) {
 
-        var = (CDSVar *)att->parent;
+        var    = (CDSVar *)att->parent;
+        indexp = &(var->att_index);
 
         /* Check if the variable is locked */
 
@@ -1375,7 +1388,7 @@ int cds_rename_att(CDSAtt *att, const char *name)
 
     /* Rename the attribute */
 
-    new_name = strdup(name);
+    new_name = _cds_arena_strdup(_cds_get_arena(parent), name);
     if (!new_name) {
 
         ERROR( CDS_LIB_NAME,
@@ -1386,8 +1399,7 @@ int cds_rename_att(CDSAtt *att, const char *name)
         return(0);
     }
 
-    free(att->name);
-    att->name = new_name;
+    _cds_rename_object(indexp, att, new_name);
 
     return(1);
 }
@@ -55,15 +55,16 @@ CDSDim *_cds_create_dim(
     size_t      length,
     int         is_unlimited)
 {
-    CDSDim *dim;
+    CDSArena *arena = _cds_get_arena(group);
+    CDSDim   *dim;
 
-    dim = (CDSDim *)calloc(1, sizeof(CDSDim));
+    dim = (CDSDim *)_cds_arena_alloc(arena, sizeof(CDSDim));
     if (!dim) {
         return((CDSDim *)NULL);
     }
 
     if (!_cds_init_object_members(dim, CDS_DIM, group, name)) {
-        free(dim);
+        _cds_arena_free(arena, dim);
         return((CDSDim *)NULL);
     }
 
@@ -84,7 +85,7 @@ void _cds_destroy_dim(CDSDim *dim)
 {
     if (dim) {
         _cds_free_object_members(dim);
-        free(dim);
+        _cds_arena_free(_cds_get_arena(dim->parent), dim);
     }
 }
 
@@ -150,7 +151,9 @@ void _cds_delete_dependant_vars(CDSGroup *group, CDSDim *dim)
         var = group->vars[vi];
         for (di = 0; di < var->ndims; di++) {
             if (var->dims[di] == dim) {
-                _cds_remove_object((void **)group->vars, &(group->nvars), var);
+                _cds_remove_object(
+                    &(group->var_index),
+                    (void **)group->vars, &(group->nvars), var);
                 _cds_destroy_var(var);
                 vi--;
                 break;
@@ -271,7 +274,8 @@ CDSDim *cds_define_dim(
 
     /* Check if a dimension with this name already exists */
 
-    dim = _cds_get_object((void **)group->dims, group->ndims, name);
+    dim = _cds_get_object(
+        &(group->dim_index), (void **)group->dims, group->ndims, name);
     if (dim) {
 
         if ((is_unlimited == dim->is_unlimited) &&
@@ -337,6 +341,8 @@ CDSDim *cds_define_dim(
     group->ndims++;
     group->dims[group->ndims] = (CDSDim *)NULL;
 
+    _cds_index_object(&(group->dim_index), group->dims[group->ndims - 1]);
+
     return(group->dims[group->ndims - 1]);
 }
 
@@ -391,7 +397,8 @@ int cds_delete_dim(CDSDim *dim)
 
     /* Remove this dimension from the group */
 
-    _cds_remove_object((void **)group->dims, &(group->ndims), dim);
+    _cds_remove_object(
+        &(group->dim_index), (void **)group->dims, &(group->ndims), dim);
 
     /* Destroy the dimension */
 
@@ -418,7 +425,8 @@ CDSDim *cds_get_dim(CDSGroup *group, const char *name)
 {
     CDSDim *dim;
 
-    dim = _cds_get_object((void **)group->dims, group->ndims, name);
+    dim = _cds_get_object(
+        &(group->dim_index), (void **)group->dims, group->ndims, name);
 
     if (!dim && group->parent) {
         dim = cds_get_dim((CDSGroup *)group->parent, name);
@@ -506,7 +514,7 @@ int cds_rename_dim(CDSDim *dim, const char *name)
 
     /* Create the new dimension name */
 
-    new_name = strdup(name);
+    new_name = _cds_arena_strdup(_cds_get_arena(group), name);
     if (!new_name) {
 
         ERROR( CDS_LIB_NAME,
@@ -528,8 +536,7 @@ int cds_rename_dim(CDSDim *dim, const char *name)
 
     /* Rename the dimension */
 
-    free(dim->name);
-    dim->name = new_name;
+    _cds_rename_object(&(group->dim_index), dim, new_name);
 
     return(1);
 }
@@ -49,15 +49,16 @@
  */
 CDSGroup *_cds_create_group(CDSGroup *parent, const char *name)
 {
+    CDSArena *arena = _cds_get_arena(parent);
     CDSGroup *group;
 
-    group = (CDSGroup *)calloc(1, sizeof(CDSGroup));
+    group = (CDSGroup *)_cds_arena_alloc(arena, sizeof(CDSGroup));
     if (!group) {
         return((CDSGroup *)NULL);
     }
 
     if (!_cds_init_object_members(group, CDS_GROUP, parent, name)) {
-        free(group);
+        _cds_arena_free(arena, group);
         return((CDSGroup *)NULL);
     }
 
@@ -116,9 +117,18 @@ void _cds_destroy_group(CDSGroup *group)
             _cds_free_transform_params(group->transform_params);
         }
 
+        _cds_free_name_index(&(group->dim_index));
+        _cds_free_name_index(&(group->att_index));
+        _cds_free_name_index(&(group->var_index));
+        _cds_free_name_index(&(group->group_index));
+
         _cds_free_object_members(group);
 
-        free(group);
+        if (group->arena) {
+            _cds_destroy_arena(group->arena);
+        }
+
+        _cds_arena_free(_cds_get_arena(group->parent), group);
     }
 }
 
@@ -223,6 +233,9 @@ CDSGroup *cds_define_group(CDSGroup *parent, const char *name)
     parent->ngroups++;
     parent->groups[parent->ngroups] = (CDSGroup *)NULL;
 
+    _cds_index_object(
+        &(parent->group_index), parent->groups[parent->ngroups - 1]);
+
     return(parent->groups[parent->ngroups - 1]);
 }
 
@@ -271,7 +284,9 @@ int cds_delete_group(CDSGroup *group)
     /* Remove this group from the parent */
 
     if (parent) {
-        _cds_remove_object((void **)parent->groups, &(parent->ngroups), group);
+        _cds_remove_object(
+            &(parent->group_index),
+            (void **)parent->groups, &(parent->ngroups), group);
     }
 
     /* Destroy the group */
@@ -281,6 +296,78 @@ int cds_delete_group(CDSGroup *group)
     return(1);
 }
 
+/**
+ *  Allocate the objects in a CDS Group tree from a memory arena.
+ *
+ *  After this function is called, all groups, dimensions, attributes,
+ *  and variables defined in the tree, along with their names, paths,
+ *  and variable dimension arrays, will be allocated from a memory arena
+ *  owned by the root group. This memory is released all at once when
+ *  the root group is deleted, and is not reused when objects are deleted
+ *  from the tree before then.
+ *
+ *  This should only be used for trees that are created and deleted
+ *  as a whole, like the data structures used for each processing
+ *  interval. Attribute values, variable data, and the arrays of
+ *  object pointers are still allocated separately.
+ *
+ *  Error messages from this function are sent to the message
+ *  handler (see msngr_init_log() and msngr_init_mail()).
+ *
+ *  @param  group      - pointer to the root group
+ *  @param  block_size - size of the memory blocks to allocate,
+ *                       or 0 for the default size (64 KB)
+ *
+ *  @return
+ *    - 1 if successful
+ *    - 0 if:
+ *        - the group is not a root group
+ *        - the group already contains objects
+ *        - a memory allocation error occurred
+ */
+int cds_enable_arena(CDSGroup *group, size_t block_size)
+{
+    if (group->arena) {
+        return(1);
+    }
+
+    /* Make sure this is an empty root group */
+
+    if (group->parent) {
+
+        ERROR( CDS_LIB_NAME,
+            "Could not enable memory arena for group: %s\n"
+            " -> not a root group\n",
+            cds_get_object_path(group));
+
+        return(0);
+    }
+
+    if (group->ndims || group->natts || group->nvars ||
+        group->ngroups || group->nvargroups) {
+
+        ERROR( CDS_LIB_NAME,
+            "Could not enable memory arena for group: %s\n"
+            " -> the group is not empty\n",
+            cds_get_object_path(group));
+
+        return(0);
+    }
+
+    group->arena = _cds_create_arena(block_size);
+    if (!group->arena) {
+
+        ERROR( CDS_LIB_NAME,
+            "Could not enable memory arena for group: %s\n"
+            " -> memory allocation error\n",
+            cds_get_object_path(group));
+
+        return(0);
+    }
+
+    return(1);
+}
+
 /**
  *  Get a CDS Group.
  *
@@ -298,7 +385,9 @@ CDSGroup *cds_get_group(CDSGroup *parent, const char *name)
 {
     CDSGroup *group;
 
-    group = _cds_get_object((void **)parent->groups, parent->ngroups, name);
+    group = _cds_get_object(
+        &(parent->group_index),
+        (void **)parent->groups, parent->ngroups, name);
 
     return(group);
 }
@@ -363,7 +452,7 @@ int cds_rename_group(CDSGroup *group, const char *name)
 
     /* Rename the group */
 
-    new_name = strdup(name);
+    new_name = _cds_arena_strdup(_cds_get_arena(parent), name);
     if (!new_name) {
 
         ERROR( CDS_LIB_NAME,
@@ -374,8 +463,8 @@ int cds_rename_group(CDSGroup *group, const char *name)
         return(0);
     }
 
-    free(group->name);
-    group->name = new_name;
+    _cds_rename_object(
+        (parent) ? &(parent->group_index) : NULL, group, new_name);
 
     return(1);
 }
@@ -34,6 +34,222 @@
  */
 /** @privatesection */
 
+/**
+ *  Memory arena block.
+ *
+ *  The block data starts at the first aligned address after the header.
+ */
+typedef struct CDSArenaBlock {
+    struct CDSArenaBlock *next;  /* next block in the arena          */
+    size_t                size;  /* number of bytes of block data    */
+    size_t                used;  /* number of bytes already allocated */
+} CDSArenaBlock;
+
+/**
+ *  Memory arena.
+ *
+ *  Allocations are taken from the current block until it is full, and
+ *  are only released when the whole arena is destroyed.
+ */
+struct CDSArena {
+    CDSArenaBlock *blocks;      /* list of blocks, current block first */
+    size_t         block_size;  /* size of new blocks                  */
+};
+
+#define CDS_ARENA_ALIGN      16
+#define CDS_ARENA_BLOCK_SIZE 65536
+
+#define CDS_ARENA_ROUND(n) \
+    (((n) + CDS_ARENA_ALIGN - 1) & ~((size_t)CDS_ARENA_ALIGN - 1))
+
+#define CDS_ARENA_HEADER_SIZE CDS_ARENA_ROUND(sizeof(CDSArenaBlock))
+
+/**
+ *  PRIVATE: Create a memory arena.
+ *
+ *  @param  block_size - size of the memory blocks to allocate,
+ *                       or 0 for the default size (64 KB)
+ *
+ *  @return
+ *    - pointer to the new arena
+ *    - NULL if a memory allocation error occurred
+ */
+CDSArena *_cds_create_arena(size_t block_size)
+{
+    CDSArena *arena;
+
+    arena = (CDSArena *)calloc(1, sizeof(CDSArena));
+    if (!arena) {
+        return((CDSArena *)NULL);
+    }
+
+    if (!block_size) {
+        block_size = CDS_ARENA_BLOCK_SIZE;
+    }
+
+    arena->block_size = CDS_ARENA_ROUND(block_size);
+
+    return(arena);
+}
+
+/**
+ *  PRIVATE: Destroy a memory arena.
+ *
+ *  This releases all memory allocated from the arena.
+ *
+ *  @param  arena - pointer to the arena
+ */
+void _cds_destroy_arena(CDSArena *arena)
+{
+    CDSArenaBlock *block;
+    CDSArenaBlock *next;
+
+    if (!arena) return;
+
+    for (block = arena->blocks; block; block = next) {
+        next = block->next;
+        free(block);
+    }
+
+    free(arena);
+}
+
+/**
+ *  PRIVATE: Allocate zero initialized memory from a memory arena.
+ *
+ *  Allocations larger than a quarter of the block size get a block
+ *  of their own so they do not waste the space left in the current
+ *  block.
+ *
+ *  @param  arena - pointer to the arena, or NULL to use calloc()
+ *  @param  size  - number of bytes to allocate
+ *
+ *  @return
+ *    - pointer to the allocated memory
+ *    - NULL if a memory allocation error occurred
+ */
+void *_cds_arena_alloc(CDSArena *arena, size_t size)
+{
+    CDSArenaBlock *block;
+    size_t         block_size;
+    char          *ptr;
+
+    if (!arena) {
+        return(calloc(1, size));
+    }
+
+    size  = CDS_ARENA_ROUND((size) ? size : 1);
+    block = arena->blocks;
+
+    if (!block || block->size - block->used < size) {
+
+        block_size = (size > arena->block_size / 4) ? size : arena->block_size;
+
+        block = (CDSArenaBlock *)malloc(CDS_ARENA_HEADER_SIZE + block_size);
+        if (!block) {
+            return((void *)NULL);
+        }
+
+        block->size = block_size;
+        block->used = 0;
+
+        if (block_size == arena->block_size || !arena->blocks) {
+            block->next   = arena->blocks;
+            arena->blocks = block;
+        }
+        else {
+            /* Keep filling the current block */
+            block->next          = arena->blocks->next;
+            arena->blocks->next  = block;
+        }
+    }
+
+    ptr = (char *)block + CDS_ARENA_HEADER_SIZE + block->used;
+    block->used += size;
+
+    memset(ptr, 0, size);
+
+    return((void *)ptr);
+}
+
+/**
+ *  PRIVATE: Free memory allocated by _cds_arena_alloc().
+ *
+ *  Memory allocated from an arena is not released until the
+ *  arena is destroyed, so this only frees memory allocated
+ *  when no arena was specified.
+ *
+ *  @param  arena - pointer to the arena, or NULL
+ *  @param  ptr   - pointer to the memory to free
+ */
+void _cds_arena_free(CDSArena *arena, void *ptr)
+{
+    if (!arena && ptr) {
+        free(ptr);
+    }
+}
+
+/**
+ *  PRIVATE: Copy a string into a memory arena.
+ *
+ *  @param  arena  - pointer to the arena, or NULL to use malloc()
+ *  @param  string - string to copy
+ *
+ *  @return
+ *    - pointer to the new string
+ *    - NULL if a memory allocation error occurred
+ */
+char *_cds_arena_strdup(CDSArena *arena, const char *string)
+{
+    size_t  length;
+    char   *copy;
+
+    if (!arena) {
+        return(strdup(string));
+    }
+
+    length = strlen(string) + 1;
+    copy   = (char *)_cds_arena_alloc(arena, length);
+
+    if (copy) {
+        memcpy(copy, string, length);
+    }
+
+    return(copy);
+}
+
+/**
+ *  PRIVATE: Get the memory arena used by a CDS Object tree.
+ *
+ *  Objects in a tree whose root group has an arena (see cds_enable_arena())
+ *  are allocated from that arena, along with their names and paths.
+ *  The root group itself is not.
+ *
+ *  @param  cds_object - pointer to any object in the tree, or NULL
+ *
+ *  @return
+ *    - pointer to the arena
+ *    - NULL if the tree does not use an arena
+ */
+CDSArena *_cds_get_arena(void *cds_object)
+{
+    CDSObject *object = (CDSObject *)cds_object;
+
+    if (!object) {
+        return((CDSArena *)NULL);
+    }
+
+    while (object->parent) {
+        object = object->parent;
+    }
+
+    if (object->obj_type != CDS_GROUP) {
+        return((CDSArena *)NULL);
+    }
+
+    return((CDSArena *)((CDSGroup *)object)->arena);
+}
+
 /**
  *  PRIVATE: Free the memory used by the members of a CDS Object.
  *
@@ -42,12 +258,15 @@
 void _cds_free_object_members(void *cds_object)
 {
     CDSObject *object = (CDSObject *)cds_object;
+    CDSArena  *arena;
     int        i;
 
     if (!object) return;
 
+    arena = _cds_get_arena(object->parent);
+
     if (object->obj_path) {
-        free(object->obj_path);
+        _cds_arena_free(arena, object->obj_path);
     }
 
     if (object->user_data) {
@@ -61,7 +280,7 @@ void _cds_free_object_members(void *cds_object)
         free(object->user_data);
     }
 
-    free(object->name);
+    _cds_arena_free(arena, object->name);
 }
 
 /**
@@ -88,15 +307,243 @@ int _cds_init_object_members(
         object->obj_type = obj_type;
         object->obj_path = (char *)NULL;
         object->parent   = parent;
-        object->name     = strdup(name);
+        object->name     = _cds_arena_strdup(_cds_get_arena(parent), name);
     }
 
     return(1);
 }
 
+/**
+ *  Name index used to find objects in large CDS Object arrays.
+ *
+ *  This is an open addressing hash table of object pointers with linear
+ *  probing. It only stores pointers, so the order of the objects in the
+ *  array can be changed without updating the index.
+ */
+typedef struct CDSNameIndex {
+    int    nobjects;  /* number of objects in the index     */
+    int    nslots;    /* number of slots, always a power of 2 */
+    void **slots;     /* array of object pointers            */
+} CDSNameIndex;
+
+/* Arrays with fewer objects than this are searched linearly */
+#define CDS_NAME_INDEX_MIN 16
+
+static size_t _cds_name_hash(const char *name)
+{
+    size_t      hash = 5381;
+    const char *chrp;
+
+    for (chrp = name; *chrp; ++chrp) {
+        hash = (hash * 33) ^ (unsigned char)*chrp;
+    }
+
+    return(hash);
+}
+
+/**
+ *  PRIVATE: Insert an object into a name index.
+ *
+ *  The index must have at least one free slot.
+ *
+ *  @param  index  - pointer to the name index
+ *  @param  object - pointer to the object
+ */
+static void _cds_name_index_insert(CDSNameIndex *index, CDSObject *object)
+{
+    size_t mask = (size_t)index->nslots - 1;
+    size_t si   = _cds_name_hash(object->name) & mask;
+
+    while (index->slots[si]) {
+        si = (si + 1) & mask;
+    }
+
+    index->slots[si] = object;
+    index->nobjects++;
+}
+
+/**
+ *  PRIVATE: Create a name index for an array of CDS Objects.
+ *
+ *  @param  array    - pointer to an array of CDS Object pointers
+ *  @param  nobjects - number of objects in the array
+ *
+ *  @return
+ *    - pointer to the new name index
+ *    - NULL if a memory allocation error occurred
+ */
+static CDSNameIndex *_cds_create_name_index(void **array, int nobjects)
+{
+    CDSNameIndex *index;
+    int           nslots;
+    int           oi;
+
+    /* Keep the load factor at or below one half */
+
+    for (nslots = 32; nslots < 2 * nobjects; nslots *= 2);
+
+    index = (CDSNameIndex *)calloc(1, sizeof(CDSNameIndex));
+    if (!index) {
+        return((CDSNameIndex *)NULL);
+    }
+
+    index->slots = (void **)calloc(nslots, sizeof(void *));
+    if (!index->slots) {
+        free(index);
+        return((CDSNameIndex *)NULL);
+    }
+
+    index->nslots = nslots;
+
+    for (oi = 0; oi < nobjects; ++oi) {
+        _cds_name_index_insert(index, (CDSObject *)array[oi]);
+    }
+
+    return(index);
+}
+
+/**
+ *  PRIVATE: Free a name index.
+ *
+ *  The index will be recreated by _cds_get_object() the
+ *  next time it is needed.
+ *
+ *  @param  index - pointer to the name index pointer
+ */
+void _cds_free_name_index(void **index)
+{
+    CDSNameIndex *name_index;
+
+    if (index && *index) {
+        name_index = (CDSNameIndex *)*index;
+        free(name_index->slots);
+        free(name_index);
+        *index = (void *)NULL;
+    }
+}
+
+/**
+ *  PRIVATE: Add a CDS Object to a name index.
+ *
+ *  This must be called after an object has been appended to the array
+ *  the index was created for. Nothing is done if the index has not been
+ *  created yet.
+ *
+ *  @param  index  - pointer to the name index pointer
+ *  @param  object - pointer to the new object
+ */
+void _cds_index_object(void **index, void *object)
+{
+    CDSNameIndex *name_index;
+    void        **old_slots;
+    int           old_nslots;
+    int           si;
+
+    if (!index || !*index || !object) return;
+
+    name_index = (CDSNameIndex *)*index;
+
+    if (2 * (name_index->nobjects + 1) > name_index->nslots) {
+
+        /* Double the size of the index */
+
+        old_slots  = name_index->slots;
+        old_nslots = name_index->nslots;
+
+        name_index->slots = (void **)calloc(2 * old_nslots, sizeof(void *));
+        if (!name_index->slots) {
+            name_index->slots = old_slots;
+            _cds_free_name_index(index);
+            return;
+        }
+
+        name_index->nslots   = 2 * old_nslots;
+        name_index->nobjects = 0;
+
+        for (si = 0; si < old_nslots; ++si) {
+            if (old_slots[si]) {
+                _cds_name_index_insert(name_index, (CDSObject *)old_slots[si]);
+            }
+        }
+
+        free(old_slots);
+    }
+
+    _cds_name_index_insert(name_index, (CDSObject *)object);
+}
+
+/**
+ *  PRIVATE: Remove a CDS Object from a name index.
+ *
+ *  The object name must not have been changed since it was indexed.
+ *
+ *  @param  index  - pointer to the name index pointer
+ *  @param  object - pointer to the object
+ */
+void _cds_unindex_object(void **index, void *object)
+{
+    CDSNameIndex *name_index;
+    size_t        mask;
+    size_t        si;
+    size_t        ni;
+    size_t        home;
+
+    if (!index || !*index || !object) return;
+
+    name_index = (CDSNameIndex *)*index;
+    mask       = (size_t)name_index->nslots - 1;
+    si         = _cds_name_hash(((CDSObject *)object)->name) & mask;
+
+    while (name_index->slots[si] != object) {
+        if (!name_index->slots[si]) return;
+        si = (si + 1) & mask;
+    }
+
+    /* Shift back any following entries in the probe sequence
+     * that would no longer be reachable through the empty slot */
+
+    ni = si;
+
+    for (;;) {
+
+        name_index->slots[si] = (void *)NULL;
+
+        for (;;) {
+
+            ni = (ni + 1) & mask;
+
+            if (!name_index->slots[ni]) {
+                name_index->nobjects--;
+                return;
+            }
+
+            home = _cds_name_hash(
+                ((CDSObject *)name_index->slots[ni])->name) & mask;
+
+            /* Move the entry if its home slot is not in (si, ni] */
+
+            if (si <= ni) {
+                if (home <= si || home > ni) break;
+            }
+            else {
+                if (home <= si && home > ni) break;
+            }
+        }
+
+        name_index->slots[si] = name_index->slots[ni];
+        si = ni;
+    }
+}
+
 /**
  *  PRIVATE: Get a CDS Object from an array of CDS Objects.
  *
+ *  If an index pointer is specified and the array is large enough,
+ *  a name index will be created the first time it is needed and
+ *  used for this and all subsequent lookups.
+ *
+ *  @param  index    - pointer to the name index pointer, or NULL
+ *                     to always search the array linearly
  *  @param  array    - pointer to an array of CDS Object pointers
  *  @param  nobjects - number of objects in the array
  *  @param  name     - name of the object to return
@@ -105,16 +552,54 @@ int _cds_init_object_members(
  *    - pointer to the CDS Object
  *    - NULL if not found
  */
-void *_cds_get_object(void **array, int nobjects, const char *name)
+void *_cds_get_object(void **index, void **array, int nobjects, const char *name)
 {
-    CDSObject **objects = (CDSObject **)array;
-    int         i;
+    CDSObject  **objects = (CDSObject **)array;
+    CDSNameIndex *name_index;
+    CDSObject    *object;
+    size_t        mask;
+    size_t        si;
+    int           i;
+
+    if (!objects || !nobjects || !name) {
+        return((void *)NULL);
+    }
+
+    if (index && nobjects >= CDS_NAME_INDEX_MIN) {
+
+        /* Rebuild the index if it is out of sync with the array */
+
+        name_index = (CDSNameIndex *)*index;
+
+        if (name_index && name_index->nobjects != nobjects) {
+            _cds_free_name_index(index);
+            name_index = (CDSNameIndex *)NULL;
+        }
 
-    if (objects && nobjects && name) {
-        for (i = 0; i < nobjects; i++) {
-            if (strcmp(objects[i]->name, name) == 0) {
-                return((void *)objects[i]);
+        if (!name_index) {
+            name_index = _cds_create_name_index(array, nobjects);
+            *index     = (void *)name_index;
+        }
+
+        if (name_index) {
+
+            mask = (size_t)name_index->nslots - 1;
+            si   = _cds_name_hash(name) & mask;
+
+            while ((object = (CDSObject *)name_index->slots[si])) {
+                if (strcmp(object->name, name) == 0) {
+                    return((void *)object);
+                }
+                si = (si + 1) & mask;
             }
+
+            return((void *)NULL);
+        }
+    }
+
+    for (i = 0; i < nobjects; i++) {
+        if (strcmp(objects[i]->name, name) == 0) {
+            return((void *)objects[i]);
         }
     }
 
@@ -163,16 +648,23 @@ const char *_cds_obj_type_name(CDSObjectType obj_type)
 /**
  *  PRIVATE: Remove a CDS Object from an array of CDS Objects.
  *
+ *  @param  index    - pointer to the name index pointer, or NULL
  *  @param  array    - pointer to an array of CDS Object pointers
  *  @param  nobjects - pointer to the number of objects in the array
  *  @param  object   - pointer to the object to remove
  */
-void _cds_remove_object(void **array, int *nobjects, void *object)
+void _cds_remove_object(
+    void  **index,
+    void  **array,
+    int    *nobjects,
+    void   *object)
 {
     int i;
 
     if (array && nobjects) {
 
+        _cds_unindex_object(index, object);
+
         for (i = 0; i < *nobjects; i++) {
             if (array[i] == object) break;
         }
@@ -185,6 +677,30 @@ void _cds_remove_object(void **array, int *nobjects, void *object)
     }
 }
 
+/**
+ *  PRIVATE: Change the name of a CDS Object.
+ *
+ *  This function takes ownership of the new name and
+ *  updates the name index of the parent object. The new name
+ *  must be allocated with _cds_arena_strdup() using the arena
+ *  of the object's tree.
+ *
+ *  @param  index    - pointer to the name index pointer, or NULL
+ *  @param  object   - pointer to the object
+ *  @param  new_name - the new name
+ */
+void _cds_rename_object(void **index, void *object, char *new_name)
+{
+    CDSObject *cds_object = (CDSObject *)object;
+
+    _cds_unindex_object(index, object);
+
+    _cds_arena_free(_cds_get_arena(cds_object->parent), cds_object->name);
+    cds_object->name = new_name;
+
+    _cds_index_object(index, object);
+}
+
 /*******************************************************************************
  *  Public Functions
  */
@@ -243,7 +759,9 @@ const char *cds_get_object_path(void *cds_object)
         object = object->parent;
     }
 
-    path = (char *)malloc((path_length + 1) * sizeof(char));
+    object = cds_object;
+    path   = (char *)_cds_arena_alloc(
+        _cds_get_arena(object->parent), (path_length + 1) * sizeof(char));
     if (!path) {
         return("MEM ERROR");
     }
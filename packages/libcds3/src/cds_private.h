@@ -25,6 +25,15 @@
 
 /*****  Object Functions  *****/
 
+typedef struct CDSArena CDSArena;
+
+CDSArena   *_cds_create_arena(size_t block_size);
+void        _cds_destroy_arena(CDSArena *arena);
+void       *_cds_arena_alloc(CDSArena *arena, size_t size);
+void        _cds_arena_free(CDSArena *arena, void *ptr);
+char       *_cds_arena_strdup(CDSArena *arena, const char *string);
+CDSArena   *_cds_get_arena(void *cds_object);
+
 void        _cds_free_object_members(void *cds_object);
 int         _cds_init_object_members(
                 void          *cds_object,
@@ -32,9 +41,25 @@ int         _cds_init_object_members(
                 void          *parent,
                 const char    *name);
 
-void       *_cds_get_object(void **array, int nobjects, const char *name);
+void       *_cds_get_object(
+                void      **index,
+                void      **array,
+                int         nobjects,
+                const char *name);
+
 const char *_cds_obj_type_name(CDSObjectType obj_type);
-void        _cds_remove_object(void **array, int *nobjects, void *object);
+
+void        _cds_remove_object(
+                void      **index,
+                void      **array,
+                int        *nobjects,
+                void       *object);
+
+void        _cds_rename_object(void **index, void *object, char *new_name);
+
+void        _cds_free_name_index(void **index);
+void        _cds_index_object(void **index, void *object);
+void        _cds_unindex_object(void **index, void *object);
 
 /*****  Data Type Functions  *****/
 
@@ -301,6 +326,25 @@ typedef struct _CDSConverter {
 
 } _CDSConverter;
 
+/*****  Units Functions *****/
+
+/**
+ *  CDS units converter.
+ *
+ *  Most of the unit conversions we do are affine (y = slope * x + intercept),
+ *  and for these the slope and intercept are used directly instead of
+ *  calling into UDUNITS-2 for every value.
+ */
+typedef struct _CDSUnitConverter {
+
+    void   *cv;         /* UDUNITS-2 converter (cv_converter *)          */
+    int     is_affine;  /* flag indicating slope and intercept are valid */
+    double  slope;      /* slope of an affine converter                  */
+    double  intercept;  /* intercept of an affine converter              */
+    int     nrefs;      /* number of references held to this converter   */
+
+} _CDSUnitConverter;
+
 /*****  Macros *****/
 
 /**
@@ -963,6 +1007,20 @@ else { \
     } \
 }
 
+/**
+*  Macro used to convert a value using the slope and intercept of an
+*  affine units converter, in the same order as UDUNITS-2 does it.
+*/
+#define CDS_AFFINE_CONVERT_FLOAT(uc, value) \
+    ((float)((uc)->slope * (double)(value) + (uc)->intercept))
+
+/**
+*  Macro used to convert a value using the slope and intercept of an
+*  affine units converter, in the same order as UDUNITS-2 does it.
+*/
+#define CDS_AFFINE_CONVERT_DOUBLE(uc, value) \
+    ((uc)->slope * (double)(value) + (uc)->intercept)
+
 /**
 *  Macro used to check for below min values in CDS_CONVERT_UNITS_FLOAT.
 */
@@ -983,8 +1041,11 @@ if (fval > *maxp) { \
 
 /**
 *  Macro used to convert the units of an array using single precision.
+*
+*  The cvt argument is the function or macro used to convert each value
+*  with uc, i.e. cv_convert_float or CDS_AFFINE_CONVERT_FLOAT.
 */
-#define CDS_CONVERT_UNITS_FLOAT(uc, len, inp, nmv, imvp, out_t, outp, omvp, minp, orminp, maxp, ormaxp, round) \
+#define CDS_CONVERT_UNITS_FLOAT(cvt, uc, len, inp, nmv, imvp, out_t, outp, omvp, minp, orminp, maxp, ormaxp, round) \
 len++; \
 if (orminp) { \
     float fval; \
@@ -994,7 +1055,7 @@ if (orminp) { \
             if (round) { \
                 while (--len) { \
                     CDS_MAP_VALUES(inp, nmv, imvp, outp, omvp); \
-                    fval  = cv_convert_float(uc, (float)*inp++); \
+                    fval  = cvt(uc, (float)*inp++); \
                     fval += (fval < 0) ? - 0.5 : + 0.5; \
                     CDS_CHECK_MIN_FLOAT(fval, outp, minp, orminp); \
                     CDS_CHECK_MAX_FLOAT(fval, outp, maxp, ormaxp); \
@@ -1004,7 +1065,7 @@ if (orminp) { \
             else { \
                 while (--len) { \
                     CDS_MAP_VALUES(inp, nmv, imvp, outp, omvp); \
-                    fval  = cv_convert_float(uc, (float)*inp++); \
+                    fval  = cvt(uc, (float)*inp++); \
                     CDS_CHECK_MIN_FLOAT(fval, outp, minp, orminp); \
                     CDS_CHECK_MAX_FLOAT(fval, outp, maxp, ormaxp); \
                     *outp++ = (out_t)fval; \
@@ -1013,7 +1074,7 @@ if (orminp) { \
         } \
         else if (round) { \
             while (--len) { \
-                fval  = cv_convert_float(uc, (float)*inp++); \
+                fval  = cvt(uc, (float)*inp++); \
                 fval += (fval < 0) ? - 0.5 : + 0.5; \
                 CDS_CHECK_MIN_FLOAT(fval, outp, minp, orminp); \
                 CDS_CHECK_MAX_FLOAT(fval, outp, maxp, ormaxp); \
@@ -1022,7 +1083,7 @@ if (orminp) { \
         } \
         else { \
             while (--len) { \
-                fval  = cv_convert_float(uc, (float)*inp++); \
+                fval  = cvt(uc, (float)*inp++); \
                 CDS_CHECK_MIN_FLOAT(fval, outp, minp, orminp); \
                 CDS_CHECK_MAX_FLOAT(fval, outp, maxp, ormaxp); \
                 *outp++ = (out_t)fval; \
@@ -1036,7 +1097,7 @@ if (orminp) { \
             if (round) { \
                 while (--len) { \
                     CDS_MAP_VALUES(inp, nmv, imvp, outp, omvp); \
-                    fval  = cv_convert_float(uc, (float)*inp++); \
+                    fval  = cvt(uc, (float)*inp++); \
                     fval += (fval < 0) ? - 0.5 : + 0.5; \
                     CDS_CHECK_MIN_FLOAT(fval, outp, minp, orminp); \
                     *outp++ = (out_t)fval; \
@@ -1045,7 +1106,7 @@ if (orminp) { \
             else { \
                 while (--len) { \
                     CDS_MAP_VALUES(inp, nmv, imvp, outp, omvp); \
-                    fval  = cv_convert_float(uc, (float)*inp++); \
+                    fval  = cvt(uc, (float)*inp++); \
                     CDS_CHECK_MIN_FLOAT(fval, outp, minp, orminp); \
                     *outp++ = (out_t)fval; \
                 } \
@@ -1053,7 +1114,7 @@ if (orminp) { \
         } \
         else if (round) { \
             while (--len) { \
-                fval  = cv_convert_float(uc, (float)*inp++); \
+                fval  = cvt(uc, (float)*inp++); \
                 fval += (fval < 0) ? - 0.5 : + 0.5; \
                 CDS_CHECK_MIN_FLOAT(fval, outp, minp, orminp); \
                 *outp++ = (out_t)fval; \
@@ -1061,7 +1122,7 @@ if (orminp) { \
         } \
         else { \
             while (--len) { \
-                fval  = cv_convert_float(uc, (float)*inp++); \
+                fval  = cvt(uc, (float)*inp++); \
                 CDS_CHECK_MIN_FLOAT(fval, outp, minp, orminp); \
                 *outp++ = (out_t)fval; \
             } \
@@ -1075,7 +1136,7 @@ else if (ormaxp) { \
         if (round) { \
             while (--len) { \
                 CDS_MAP_VALUES(inp, nmv, imvp, outp, omvp); \
-                fval  = cv_convert_float(uc, (float)*inp++); \
+                fval  = cvt(uc, (float)*inp++); \
                 fval += (fval < 0) ? - 0.5 : + 0.5; \
                 CDS_CHECK_MAX_FLOAT(fval, outp, maxp, ormaxp); \
                 *outp++ = (out_t)fval; \
@@ -1084,7 +1145,7 @@ else if (ormaxp) { \
         else { \
             while (--len) { \
                 CDS_MAP_VALUES(inp, nmv, imvp, outp, omvp); \
-                fval  = cv_convert_float(uc, (float)*inp++); \
+                fval  = cvt(uc, (float)*inp++); \
                 CDS_CHECK_MAX_FLOAT(fval, outp, maxp, ormaxp); \
                 *outp++ = (out_t)fval; \
             } \
@@ -1092,7 +1153,7 @@ else if (ormaxp) { \
     } \
     else if (round) { \
         while (--len) { \
-            fval  = cv_convert_float(uc, (float)*inp++); \
+            fval  = cvt(uc, (float)*inp++); \
             fval += (fval < 0) ? - 0.5 : + 0.5; \
             CDS_CHECK_MAX_FLOAT(fval, outp, maxp, ormaxp); \
             *outp++ = (out_t)fval; \
@@ -1100,7 +1161,7 @@ else if (ormaxp) { \
     } \
     else { \
         while (--len) { \
-            fval  = cv_convert_float(uc, (float)*inp++); \
+            fval  = cvt(uc, (float)*inp++); \
             CDS_CHECK_MAX_FLOAT(fval, outp, maxp, ormaxp); \
             *outp++ = (out_t)fval; \
         } \
@@ -1113,7 +1174,7 @@ else { \
             float fval; \
             while (--len) { \
                 CDS_MAP_VALUES(inp, nmv, imvp, outp, omvp); \
-                fval  = cv_convert_float(uc, (float)*inp++); \
+                fval  = cvt(uc, (float)*inp++); \
                 fval += (fval < 0) ? - 0.5 : + 0.5; \
                 *outp++ = (out_t)fval; \
             } \
@@ -1121,21 +1182,21 @@ else { \
         else { \
             while (--len) { \
                 CDS_MAP_VALUES(inp, nmv, imvp, outp, omvp); \
-                *outp++ = (out_t)cv_convert_float(uc, (float)*inp++); \
+                *outp++ = (out_t)cvt(uc, (float)*inp++); \
             } \
         } \
     } \
     else if (round) { \
         float fval; \
         while (--len) { \
-            fval  = cv_convert_float(uc, (float)*inp++); \
+            fval  = cvt(uc, (float)*inp++); \
             fval += (fval < 0) ? - 0.5 : + 0.5; \
             *outp++ = (out_t)fval; \
         } \
     } \
     else { \
         while (--len) { \
-            *outp++ = (out_t)cv_convert_float(uc, (float)*inp++); \
+            *outp++ = (out_t)cvt(uc, (float)*inp++); \
         } \
     } \
 }
@@ -1160,8 +1221,11 @@ if (dval > *maxp) { \
 
 /**
 *  Macro used to convert the units of an array using double precision.
+*
+*  The cvt argument is the function or macro used to convert each value
+*  with uc, i.e. cv_convert_double or CDS_AFFINE_CONVERT_DOUBLE.
 */
-#define CDS_CONVERT_UNITS_DOUBLE(uc, len, inp, nmv, imvp, out_t, outp, omvp, minp, orminp, maxp, ormaxp, round) \
+#define CDS_CONVERT_UNITS_DOUBLE(cvt, uc, len, inp, nmv, imvp, out_t, outp, omvp, minp, orminp, maxp, ormaxp, round) \
 len++; \
 if (orminp) { \
     double dval; \
@@ -1171,7 +1235,7 @@ if (orminp) { \
             if (round) { \
                 while (--len) { \
                     CDS_MAP_VALUES(inp, nmv, imvp, outp, omvp); \
-                    dval  = cv_convert_double(uc, (double)*inp++); \
+                    dval  = cvt(uc, (double)*inp++); \
                     dval += (dval < 0) ? - 0.5 : + 0.5; \
                     CDS_CHECK_MIN_DOUBLE(dval, outp, minp, orminp); \
                     CDS_CHECK_MAX_DOUBLE(dval, outp, maxp, ormaxp); \
@@ -1181,7 +1245,7 @@ if (orminp) { \
             else { \
                 while (--len) { \
                     CDS_MAP_VALUES(inp, nmv, imvp, outp, omvp); \
-                    dval  = cv_convert_double(uc, (double)*inp++); \
+                    dval  = cvt(uc, (double)*inp++); \
                     CDS_CHECK_MIN_DOUBLE(dval, outp, minp, orminp); \
                     CDS_CHECK_MAX_DOUBLE(dval, outp, maxp, ormaxp); \
                     *outp++ = (out_t)dval; \
@@ -1190,7 +1254,7 @@ if (orminp) { \
         } \
         else if (round) { \
             while (--len) { \
-                dval  = cv_convert_double(uc, (double)*inp++); \
+                dval  = cvt(uc, (double)*inp++); \
                 dval += (dval < 0) ? - 0.5 : + 0.5; \
                 CDS_CHECK_MIN_DOUBLE(dval, outp, minp, orminp); \
                 CDS_CHECK_MAX_DOUBLE(dval, outp, maxp, ormaxp); \
@@ -1199,7 +1263,7 @@ if (orminp) { \
         } \
         else { \
             while (--len) { \
-                dval  = cv_convert_double(uc, (double)*inp++); \
+                dval  = cvt(uc, (double)*inp++); \
                 CDS_CHECK_MIN_DOUBLE(dval, outp, minp, orminp); \
                 CDS_CHECK_MAX_DOUBLE(dval, outp, maxp, ormaxp); \
                 *outp++ = (out_t)dval; \
@@ -1213,7 +1277,7 @@ if (orminp) { \
             if (round) { \
                 while (--len) { \
                     CDS_MAP_VALUES(inp, nmv, imvp, outp, omvp); \
-                    dval  = cv_convert_double(uc, (double)*inp++); \
+                    dval  = cvt(uc, (double)*inp++); \
                     dval += (dval < 0) ? - 0.5 : + 0.5; \
                     CDS_CHECK_MIN_DOUBLE(dval, outp, minp, orminp); \
                     *outp++ = (out_t)dval; \
@@ -1222,7 +1286,7 @@ if (orminp) { \
             else { \
                 while (--len) { \
                     CDS_MAP_VALUES(inp, nmv, imvp, outp, omvp); \
-                    dval  = cv_convert_double(uc, (double)*inp++); \
+                    dval  = cvt(uc, (double)*inp++); \
                     CDS_CHECK_MIN_DOUBLE(dval, outp, minp, orminp); \
                     *outp++ = (out_t)dval; \
                 } \
@@ -1230,7 +1294,7 @@ if (orminp) { \
         } \
         else if (round) { \
             while (--len) { \
-                dval  = cv_convert_double(uc, (double)*inp++); \
+                dval  = cvt(uc, (double)*inp++); \
                 dval += (dval < 0) ? - 0.5 : + 0.5; \
                 CDS_CHECK_MIN_DOUBLE(dval, outp, minp, orminp); \
                 *outp++ = (out_t)dval; \
@@ -1238,7 +1302,7 @@ if (orminp) { \
         } \
         else { \
             while (--len) { \
-                dval  = cv_convert_double(uc, (double)*inp++); \
+                dval  = cvt(uc, (double)*inp++); \
                 CDS_CHECK_MIN_DOUBLE(dval, outp, minp, orminp); \
                 *outp++ = (out_t)dval; \
             } \
@@ -1252,7 +1316,7 @@ else if (ormaxp) { \
         if (round) { \
             while (--len) { \
                 CDS_MAP_VALUES(inp, nmv, imvp, outp, omvp); \
-                dval  = cv_convert_double(uc, (double)*inp++); \
+                dval  = cvt(uc, (double)*inp++); \
                 dval += (dval < 0) ? - 0.5 : + 0.5; \
                 CDS_CHECK_MAX_DOUBLE(dval, outp, maxp, ormaxp); \
                 *outp++ = (out_t)dval; \
@@ -1261,7 +1325,7 @@ else if (ormaxp) { \
         else { \
             while (--len) { \
                 CDS_MAP_VALUES(inp, nmv, imvp, outp, omvp); \
-                dval  = cv_convert_double(uc, (double)*inp++); \
+                dval  = cvt(uc, (double)*inp++); \
                 CDS_CHECK_MAX_DOUBLE(dval, outp, maxp, ormaxp); \
                 *outp++ = (out_t)dval; \
             } \
@@ -1269,7 +1333,7 @@ else if (ormaxp) { \
     } \
     else if (round) { \
         while (--len) { \
-            dval  = cv_convert_double(uc, (double)*inp++); \
+            dval  = cvt(uc, (double)*inp++); \
             dval += (dval < 0) ? - 0.5 : + 0.5; \
             CDS_CHECK_MAX_DOUBLE(dval, outp, maxp, ormaxp); \
             *outp++ = (out_t)dval; \
@@ -1277,7 +1341,7 @@ else if (ormaxp) { \
     } \
     else { \
         while (--len) { \
-            dval  = cv_convert_double(uc, (double)*inp++); \
+            dval  = cvt(uc, (double)*inp++); \
             CDS_CHECK_MAX_DOUBLE(dval, outp, maxp, ormaxp); \
             *outp++ = (out_t)dval; \
         } \
@@ -1290,7 +1354,7 @@ else { \
             double dval; \
             while (--len) { \
                 CDS_MAP_VALUES(inp, nmv, imvp, outp, omvp); \
-                dval  = cv_convert_double(uc, (double)*inp++); \
+                dval  = cvt(uc, (double)*inp++); \
                 dval += (dval < 0) ? - 0.5 : + 0.5; \
                 *outp++ = (out_t)dval; \
             } \
@@ -1298,21 +1362,21 @@ else { \
         else { \
             while (--len) { \
                 CDS_MAP_VALUES(inp, nmv, imvp, outp, omvp); \
-                *outp++ = (out_t)cv_convert_double(uc, (double)*inp++); \
+                *outp++ = (out_t)cvt(uc, (double)*inp++); \
             } \
         } \
     } \
     else if (round) { \
         double dval; \
         while (--len) { \
-            dval  = cv_convert_double(uc, (double)*inp++); \
+            dval  = cvt(uc, (double)*inp++); \
             dval += (dval < 0) ? - 0.5 : + 0.5; \
             *outp++ = (out_t)dval; \
         } \
     } \
     else { \
         while (--len) { \
-            *outp++ = (out_t)cv_convert_double(uc, (double)*inp++); \
+            *outp++ = (out_t)cvt(uc, (double)*inp++); \
         } \
     } \
 }
@@ -46,6 +46,132 @@ typedef struct {
 static size_t     _NumMapSymbols = 0;
 static SymbolMap *_MapSymbols    = (SymbolMap *)NULL;
 
+/**
+ *  Units cache entry.
+ *
+ *  Parsing units strings is expensive, and the same few pairs of units are
+ *  compared and converted over and over again, so we keep the results
+ *  for each pair until the unit system changes.
+ */
+typedef struct UnitsCacheEntry {
+    char              *from_units;  /* units to convert from               */
+    char              *to_units;    /* units to convert to                 */
+    int                compare;     /* cds_compare_units result, or -2     */
+    int                status;      /* cds_get_unit_converter result, or -2 */
+    _CDSUnitConverter *converter;   /* units converter if status is 1      */
+    struct UnitsCacheEntry *next;   /* next entry in the hash bucket       */
+} UnitsCacheEntry;
+
+#define UNITS_CACHE_SIZE 256
+
+static UnitsCacheEntry *_UnitsCache[UNITS_CACHE_SIZE];
+
+static size_t _cds_units_cache_hash(const char *from_units, const char *to_units)
+{
+    size_t      hash = 5381;
+    const char *chrp;
+
+    for (chrp = from_units; *chrp; ++chrp) {
+        hash = (hash * 33) ^ (unsigned char)*chrp;
+    }
+
+    hash = (hash * 33);
+
+    for (chrp = to_units; *chrp; ++chrp) {
+        hash = (hash * 33) ^ (unsigned char)*chrp;
+    }
+
+    return(hash % UNITS_CACHE_SIZE);
+}
+
+/**
+ *  Get the units cache entry for a pair of units.
+ *
+ *  @param  from_units - units to convert from
+ *  @param  to_units   - units to convert to
+ *  @param  create     - create the entry if it does not exist
+ *
+ *  @return
+ *    - pointer to the cache entry
+ *    - NULL if not found and create is 0, or a memory allocation error occurred
+ */
+static UnitsCacheEntry *_cds_get_units_cache_entry(
+    const char *from_units,
+    const char *to_units,
+    int         create)
+{
+    size_t           hash  = _cds_units_cache_hash(from_units, to_units);
+    UnitsCacheEntry *entry;
+
+    for (entry = _UnitsCache[hash]; entry; entry = entry->next) {
+
+        if (strcmp(entry->from_units, from_units) == 0 &&
+            strcmp(entry->to_units,   to_units)   == 0) {
+
+            return(entry);
+        }
+    }
+
+    if (!create) {
+        return((UnitsCacheEntry *)NULL);
+    }
+
+    entry = (UnitsCacheEntry *)calloc(1, sizeof(UnitsCacheEntry));
+    if (!entry) {
+        return((UnitsCacheEntry *)NULL);
+    }
+
+    entry->from_units = strdup(from_units);
+    entry->to_units   = strdup(to_units);
+
+    if (!entry->from_units || !entry->to_units) {
+        if (entry->from_units) free(entry->from_units);
+        if (entry->to_units)   free(entry->to_units);
+        free(entry);
+        return((UnitsCacheEntry *)NULL);
+    }
+
+    entry->compare = -2;
+    entry->status  = -2;
+    entry->next    = _UnitsCache[hash];
+
+    _UnitsCache[hash] = entry;
+
+    return(entry);
+}
+
+/**
+ *  Free the units cache.
+ *
+ *  This must be called whenever the unit system changes. Converters that
+ *  are still being used by the calling process are not freed until they
+ *  are released with cds_free_unit_converter().
+ */
+static void _cds_free_units_cache(void)
+{
+    UnitsCacheEntry *entry;
+    UnitsCacheEntry *next;
+    int              hi;
+
+    for (hi = 0; hi < UNITS_CACHE_SIZE; ++hi) {
+
+        for (entry = _UnitsCache[hi]; entry; entry = next) {
+
+            next = entry->next;
+
+            if (entry->converter) {
+                cds_free_unit_converter((CDSUnitConverter)entry->converter);
+            }
+
+            free(entry->from_units);
+            free(entry->to_units);
+            free(entry);
+        }
+
+        _UnitsCache[hi] = (UnitsCacheEntry *)NULL;
+    }
+}
+
 /**
  *  Get the error message string for a UDUNITS-2 status value.
  *
@@ -315,6 +441,303 @@ static ut_unit *_cds_ut_parse_from_units(const char *from_units)
     return((ut_unit *)NULL);
 }
 
+/**
+ *  Check if a UDUNITS-2 converter is affine.
+ *
+ *  UDUNITS-2 does not give us access to the slope and intercept of its
+ *  converters, so we work them out from the converted values of a few
+ *  points and then check that using them gives exactly the same results
+ *  as the converter does, in both single and double precision. Anything
+ *  that does not match exactly (logarithmic units, etc.) is left to the
+ *  UDUNITS-2 converter.
+ *
+ *  @param  uc - pointer to the units converter
+ *
+ *  @return
+ *    - 1 if the converter is affine (uc->slope and uc->intercept are set)
+ *    - 0 if it is not
+ */
+static int _cds_set_affine_converter(_CDSUnitConverter *uc)
+{
+    static const double probes[] = {
+        0.0, 1.0, -1.0, 0.5, 2.0, 10.0, -40.0, 100.0, 273.15, 1013.25,
+        0.001, 12345.678, -9999.0, 1.0e6
+    };
+    int     nprobes = sizeof(probes) / sizeof(probes[0]);
+    cv_converter *cv = (cv_converter *)uc->cv;
+    double  candidates[10];
+    int     ncandidates;
+    double  intercept;
+    double  slope;
+    double  down, up;
+    char    string[32];
+    int     ci, pi;
+
+    uc->is_affine = 0;
+
+    intercept = cv_convert_double(cv, 0.0);
+    slope     = (cv_convert_double(cv, 1048576.0) - intercept) / 1048576.0;
+
+    if (!isfinite(intercept) || !isfinite(slope) || slope == 0.0) {
+        return(0);
+    }
+
+    /* The slope we calculated may be off by an ulp or two, and UDUNITS-2
+     * slopes are often "nice" decimal numbers, so try those first. */
+
+    ncandidates = 0;
+
+    snprintf(string, 32, "%.15g", slope);
+    candidates[ncandidates++] = atof(string);
+    candidates[ncandidates++] = slope;
+
+    down = up = slope;
+
+    for (ci = 0; ci < 4; ci++) {
+        down = nextafter(down, -HUGE_VAL);
+        up   = nextafter(up,    HUGE_VAL);
+        candidates[ncandidates++] = down;
+        candidates[ncandidates++] = up;
+    }
+
+    for (ci = 0; ci < ncandidates; ci++) {
+
+        uc->slope     = candidates[ci];
+        uc->intercept = intercept;
+
+        for (pi = 0; pi < nprobes; pi++) {
+
+            if (cv_convert_double(cv, probes[pi]) !=
+                CDS_AFFINE_CONVERT_DOUBLE(uc, probes[pi])) {
+                break;
+            }
+
+            if (cv_convert_float(cv, (float)probes[pi]) !=
+                CDS_AFFINE_CONVERT_FLOAT(uc, (float)probes[pi])) {
+                break;
+            }
+        }
+
+        if (pi == nprobes) {
+            uc->is_affine = 1;
+            return(1);
+        }
+    }
+
+    return(0);
+}
+
+/**
+ *  Macro used to do the unit conversion for all combinations of data types
+ *  in cds_convert_units().  This is expanded once for the UDUNITS-2
+ *  converter functions and once for the affine converter macros.
+ */
+#define CDS_CONVERT_UNITS_SWITCH(cvt_float, cvt_double, uc) \
+switch (in_type) { \
+  case CDS_BYTE: \
+    switch (out_type) { \
+      case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.bp, nmap, imap.bp, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break; \
+      case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.bp, nmap, imap.bp, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break; \
+      case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.bp, nmap, imap.bp, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break; \
+      case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.bp, nmap, imap.bp, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break; \
+      case CDS_FLOAT:  CDS_CONVERT_UNITS_FLOAT (cvt_float,  uc, length, in.bp, nmap, imap.bp, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break; \
+      case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.bp, nmap, imap.bp, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break; \
+      /* NetCDF4 extended data types */ \
+      case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.bp, nmap, imap.bp, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break; \
+      case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.bp, nmap, imap.bp, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break; \
+      case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.bp, nmap, imap.bp, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break; \
+      case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.bp, nmap, imap.bp, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break; \
+      case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.bp, nmap, imap.bp, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break; \
+      default: \
+        break; \
+    } \
+    break; \
+  case CDS_CHAR: \
+    switch (out_type) { \
+      case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.cp, nmap, imap.cp, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break; \
+      case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.cp, nmap, imap.cp, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break; \
+      case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.cp, nmap, imap.cp, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break; \
+      case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.cp, nmap, imap.cp, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break; \
+      case CDS_FLOAT:  CDS_CONVERT_UNITS_FLOAT (cvt_float,  uc, length, in.cp, nmap, imap.cp, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break; \
+      case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.cp, nmap, imap.cp, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break; \
+      /* NetCDF4 extended data types */ \
+      case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.cp, nmap, imap.cp, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break; \
+      case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.cp, nmap, imap.cp, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break; \
+      case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.cp, nmap, imap.cp, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break; \
+      case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.cp, nmap, imap.cp, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break; \
+      case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.cp, nmap, imap.cp, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break; \
+      default: \
+        break; \
+    } \
+    break; \
+  case CDS_SHORT: \
+    switch (out_type) { \
+      case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.sp, nmap, imap.sp, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break; \
+      case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.sp, nmap, imap.sp, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break; \
+      case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.sp, nmap, imap.sp, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break; \
+      case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.sp, nmap, imap.sp, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break; \
+      case CDS_FLOAT:  CDS_CONVERT_UNITS_FLOAT (cvt_float,  uc, length, in.sp, nmap, imap.sp, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break; \
+      case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.sp, nmap, imap.sp, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break; \
+      /* NetCDF4 extended data types */ \
+      case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.sp, nmap, imap.sp, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break; \
+      case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.sp, nmap, imap.sp, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break; \
+      case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.sp, nmap, imap.sp, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break; \
+      case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.sp, nmap, imap.sp, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break; \
+      case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.sp, nmap, imap.sp, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break; \
+      default: \
+        break; \
+    } \
+    break; \
+  case CDS_INT: \
+    switch (out_type) { \
+      case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ip, nmap, imap.ip, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break; \
+      case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ip, nmap, imap.ip, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break; \
+      case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ip, nmap, imap.ip, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break; \
+      case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ip, nmap, imap.ip, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break; \
+      case CDS_FLOAT:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ip, nmap, imap.ip, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break; \
+      case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ip, nmap, imap.ip, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break; \
+      /* NetCDF4 extended data types */ \
+      case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ip, nmap, imap.ip, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break; \
+      case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ip, nmap, imap.ip, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break; \
+      case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ip, nmap, imap.ip, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break; \
+      case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ip, nmap, imap.ip, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break; \
+      case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ip, nmap, imap.ip, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break; \
+      default: \
+        break; \
+    } \
+    break; \
+  case CDS_FLOAT: \
+    switch (out_type) { \
+      case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.fp, nmap, imap.fp, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break; \
+      case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.fp, nmap, imap.fp, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break; \
+      case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.fp, nmap, imap.fp, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break; \
+      case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.fp, nmap, imap.fp, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break; \
+      case CDS_FLOAT:  CDS_CONVERT_UNITS_FLOAT (cvt_float,  uc, length, in.fp, nmap, imap.fp, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break; \
+      case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.fp, nmap, imap.fp, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break; \
+      /* NetCDF4 extended data types */ \
+      case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.fp, nmap, imap.fp, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break; \
+      case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.fp, nmap, imap.fp, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break; \
+      case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.fp, nmap, imap.fp, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break; \
+      case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.fp, nmap, imap.fp, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break; \
+      case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.fp, nmap, imap.fp, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break; \
+      default: \
+        break; \
+    } \
+    break; \
+  case CDS_DOUBLE: \
+    switch (out_type) { \
+      case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.dp, nmap, imap.dp, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break; \
+      case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.dp, nmap, imap.dp, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break; \
+      case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.dp, nmap, imap.dp, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break; \
+      case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.dp, nmap, imap.dp, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break; \
+      case CDS_FLOAT:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.dp, nmap, imap.dp, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break; \
+      case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.dp, nmap, imap.dp, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break; \
+      /* NetCDF4 extended data types */ \
+      case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.dp, nmap, imap.dp, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break; \
+      case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.dp, nmap, imap.dp, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break; \
+      case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.dp, nmap, imap.dp, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break; \
+      case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.dp, nmap, imap.dp, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break; \
+      case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.dp, nmap, imap.dp, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break; \
+      default: \
+        break; \
+    } \
+    break; \
+  /* NetCDF4 extended data types */ \
+  case CDS_INT64: \
+    switch (out_type) { \
+      case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.i64p, nmap, imap.i64p, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break; \
+      case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.i64p, nmap, imap.i64p, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break; \
+      case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.i64p, nmap, imap.i64p, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break; \
+      case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.i64p, nmap, imap.i64p, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break; \
+      case CDS_FLOAT:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.i64p, nmap, imap.i64p, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break; \
+      case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.i64p, nmap, imap.i64p, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break; \
+      /* NetCDF4 extended data types */ \
+      case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.i64p, nmap, imap.i64p, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break; \
+      case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.i64p, nmap, imap.i64p, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break; \
+      case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.i64p, nmap, imap.i64p, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break; \
+      case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.i64p, nmap, imap.i64p, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break; \
+      case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.i64p, nmap, imap.i64p, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break; \
+      default: \
+        break; \
+    } \
+    break; \
+  case CDS_UBYTE: \
+    switch (out_type) { \
+      case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ubp, nmap, imap.ubp, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break; \
+      case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ubp, nmap, imap.ubp, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break; \
+      case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ubp, nmap, imap.ubp, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break; \
+      case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ubp, nmap, imap.ubp, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break; \
+      case CDS_FLOAT:  CDS_CONVERT_UNITS_FLOAT (cvt_float,  uc, length, in.ubp, nmap, imap.ubp, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break; \
+      case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ubp, nmap, imap.ubp, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break; \
+      /* NetCDF4 extended data types */ \
+      case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ubp, nmap, imap.ubp, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break; \
+      case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ubp, nmap, imap.ubp, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break; \
+      case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ubp, nmap, imap.ubp, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break; \
+      case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ubp, nmap, imap.ubp, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break; \
+      case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ubp, nmap, imap.ubp, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break; \
+      default: \
+        break; \
+    } \
+    break; \
+  case CDS_USHORT: \
+    switch (out_type) { \
+      case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.usp, nmap, imap.usp, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break; \
+      case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.usp, nmap, imap.usp, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break; \
+      case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.usp, nmap, imap.usp, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break; \
+      case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.usp, nmap, imap.usp, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break; \
+      case CDS_FLOAT:  CDS_CONVERT_UNITS_FLOAT (cvt_float,  uc, length, in.usp, nmap, imap.usp, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break; \
+      case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.usp, nmap, imap.usp, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break; \
+      /* NetCDF4 extended data types */ \
+      case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.usp, nmap, imap.usp, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break; \
+      case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.usp, nmap, imap.usp, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break; \
+      case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.usp, nmap, imap.usp, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break; \
+      case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.usp, nmap, imap.usp, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break; \
+      case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.usp, nmap, imap.usp, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break; \
+      default: \
+        break; \
+    } \
+    break; \
+  case CDS_UINT: \
+    switch (out_type) { \
+      case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.uip, nmap, imap.uip, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break; \
+      case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.uip, nmap, imap.uip, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break; \
+      case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.uip, nmap, imap.uip, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break; \
+      case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.uip, nmap, imap.uip, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break; \
+      case CDS_FLOAT:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.uip, nmap, imap.uip, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break; \
+      case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.uip, nmap, imap.uip, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break; \
+      /* NetCDF4 extended data types */ \
+      case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.uip, nmap, imap.uip, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break; \
+      case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.uip, nmap, imap.uip, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break; \
+      case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.uip, nmap, imap.uip, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break; \
+      case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.uip, nmap, imap.uip, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break; \
+      case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.uip, nmap, imap.uip, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break; \
+      default: \
+        break; \
+    } \
+    break; \
+  case CDS_UINT64: \
+    switch (out_type) { \
+      case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ui64p, nmap, imap.ui64p, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break; \
+      case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ui64p, nmap, imap.ui64p, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break; \
+      case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ui64p, nmap, imap.ui64p, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break; \
+      case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ui64p, nmap, imap.ui64p, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break; \
+      case CDS_FLOAT:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ui64p, nmap, imap.ui64p, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break; \
+      case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ui64p, nmap, imap.ui64p, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break; \
+      /* NetCDF4 extended data types */ \
+      case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ui64p, nmap, imap.ui64p, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break; \
+      case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ui64p, nmap, imap.ui64p, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break; \
+      case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ui64p, nmap, imap.ui64p, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break; \
+      case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ui64p, nmap, imap.ui64p, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break; \
+      case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(cvt_double, uc, length, in.ui64p, nmap, imap.ui64p, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break; \
+      default: \
+        break; \
+    } \
+    break; \
+ \
+  default: \
+    break; \
+}
+
 /*******************************************************************************
  *  Public Functions
  */
@@ -344,9 +767,11 @@ int cds_compare_units(
     const char *from_units,
     const char *to_units)
 {
-    ut_unit    *from;
-    ut_unit    *to;
-    ut_status   status;
+    UnitsCacheEntry *entry;
+    ut_unit         *from;
+    ut_unit         *to;
+    ut_status        status;
+    int              retval;
 
     /* Check if the unit strings are equal */
 
@@ -362,6 +787,13 @@ int cds_compare_units(
         }
     }
 
+    /* Check if we have already compared these units */
+
+    entry = _cds_get_units_cache_entry(from_units, to_units, 0);
+    if (entry && entry->compare != -2) {
+        return(entry->compare);
+    }
+
     /* Parse from_units string */
 
     from = _cds_ut_parse_from_units(from_units);
@@ -392,11 +824,16 @@ int cds_compare_units(
     ut_free(from);
     ut_free(to);
 
-    if (status == 0) {
-        return(0);
+    retval = (status == 0) ? 0 : 1;
+
+    /* Remember the result for next time */
+
+    entry = _cds_get_units_cache_entry(from_units, to_units, 1);
+    if (entry) {
+        entry->compare = retval;
     }
 
-    return(1);
+    return(retval);
 }
 
 /**
@@ -470,7 +907,7 @@ void *cds_convert_units(
     void             *out_max,
     void             *orv_max)
 {
-    cv_converter *uc = (cv_converter *)converter;
+    _CDSUnitConverter *uc = (_CDSUnitConverter *)converter;
     CDSData       in;
     CDSData       out;
     CDSData       imap;
@@ -547,209 +984,13 @@ void *cds_convert_units(
 
     /* Do the unit conversion */
 
-    switch (in_type) {
-      case CDS_BYTE:
-        switch (out_type) {
-          case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.bp, nmap, imap.bp, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break;
-          case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.bp, nmap, imap.bp, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break;
-          case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.bp, nmap, imap.bp, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break;
-          case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(uc, length, in.bp, nmap, imap.bp, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break;
-          case CDS_FLOAT:  CDS_CONVERT_UNITS_FLOAT (uc, length, in.bp, nmap, imap.bp, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break;
-          case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.bp, nmap, imap.bp, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break;
-          /* NetCDF4 extended data types */
-          case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.bp, nmap, imap.bp, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break;
-          case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.bp, nmap, imap.bp, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break;
-          case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.bp, nmap, imap.bp, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break;
-          case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.bp, nmap, imap.bp, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break;
-          case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.bp, nmap, imap.bp, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break;
-          default:
-            break;
-        }
-        break;
-      case CDS_CHAR:
-        switch (out_type) {
-          case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.cp, nmap, imap.cp, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break;
-          case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.cp, nmap, imap.cp, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break;
-          case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.cp, nmap, imap.cp, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break;
-          case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(uc, length, in.cp, nmap, imap.cp, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break;
-          case CDS_FLOAT:  CDS_CONVERT_UNITS_FLOAT (uc, length, in.cp, nmap, imap.cp, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break;
-          case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.cp, nmap, imap.cp, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break;
-          /* NetCDF4 extended data types */
-          case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.cp, nmap, imap.cp, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break;
-          case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.cp, nmap, imap.cp, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break;
-          case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.cp, nmap, imap.cp, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break;
-          case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.cp, nmap, imap.cp, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break;
-          case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.cp, nmap, imap.cp, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break;
-          default:
-            break;
-        }
-        break;
-      case CDS_SHORT:
-        switch (out_type) {
-          case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.sp, nmap, imap.sp, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break;
-          case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.sp, nmap, imap.sp, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break;
-          case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.sp, nmap, imap.sp, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break;
-          case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(uc, length, in.sp, nmap, imap.sp, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break;
-          case CDS_FLOAT:  CDS_CONVERT_UNITS_FLOAT (uc, length, in.sp, nmap, imap.sp, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break;
-          case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.sp, nmap, imap.sp, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break;
-          /* NetCDF4 extended data types */
-          case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.sp, nmap, imap.sp, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break;
-          case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.sp, nmap, imap.sp, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break;
-          case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.sp, nmap, imap.sp, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break;
-          case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.sp, nmap, imap.sp, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break;
-          case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.sp, nmap, imap.sp, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break;
-          default:
-            break;
-        }
-        break;
-      case CDS_INT:
-        switch (out_type) {
-          case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ip, nmap, imap.ip, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break;
-          case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ip, nmap, imap.ip, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break;
-          case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ip, nmap, imap.ip, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break;
-          case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ip, nmap, imap.ip, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break;
-          case CDS_FLOAT:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ip, nmap, imap.ip, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break;
-          case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ip, nmap, imap.ip, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break;
-          /* NetCDF4 extended data types */
-          case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ip, nmap, imap.ip, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break;
-          case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ip, nmap, imap.ip, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break;
-          case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ip, nmap, imap.ip, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break;
-          case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ip, nmap, imap.ip, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break;
-          case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ip, nmap, imap.ip, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break;
-          default:
-            break;
-        }
-        break;
-      case CDS_FLOAT:
-        switch (out_type) {
-          case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.fp, nmap, imap.fp, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break;
-          case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.fp, nmap, imap.fp, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break;
-          case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.fp, nmap, imap.fp, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break;
-          case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(uc, length, in.fp, nmap, imap.fp, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break;
-          case CDS_FLOAT:  CDS_CONVERT_UNITS_FLOAT (uc, length, in.fp, nmap, imap.fp, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break;
-          case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.fp, nmap, imap.fp, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break;
-          /* NetCDF4 extended data types */
-          case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.fp, nmap, imap.fp, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break;
-          case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.fp, nmap, imap.fp, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break;
-          case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.fp, nmap, imap.fp, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break;
-          case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.fp, nmap, imap.fp, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break;
-          case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.fp, nmap, imap.fp, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break;
-          default:
-            break;
-        }
-        break;
-      case CDS_DOUBLE:
-        switch (out_type) {
-          case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.dp, nmap, imap.dp, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break;
-          case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.dp, nmap, imap.dp, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break;
-          case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.dp, nmap, imap.dp, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break;
-          case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(uc, length, in.dp, nmap, imap.dp, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break;
-          case CDS_FLOAT:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.dp, nmap, imap.dp, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break;
-          case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.dp, nmap, imap.dp, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break;
-          /* NetCDF4 extended data types */
-          case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.dp, nmap, imap.dp, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break;
-          case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.dp, nmap, imap.dp, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break;
-          case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.dp, nmap, imap.dp, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break;
-          case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.dp, nmap, imap.dp, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break;
-          case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.dp, nmap, imap.dp, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break;
-          default:
-            break;
-        }
-        break;
-      /* NetCDF4 extended data types */
-      case CDS_INT64:
-        switch (out_type) {
-          case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.i64p, nmap, imap.i64p, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break;
-          case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.i64p, nmap, imap.i64p, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break;
-          case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.i64p, nmap, imap.i64p, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break;
-          case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(uc, length, in.i64p, nmap, imap.i64p, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break;
-          case CDS_FLOAT:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.i64p, nmap, imap.i64p, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break;
-          case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.i64p, nmap, imap.i64p, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break;
-          /* NetCDF4 extended data types */
-          case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.i64p, nmap, imap.i64p, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break;
-          case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.i64p, nmap, imap.i64p, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break;
-          case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.i64p, nmap, imap.i64p, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break;
-          case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.i64p, nmap, imap.i64p, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break;
-          case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.i64p, nmap, imap.i64p, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break;
-          default:
-            break;
-        }
-        break;
-      case CDS_UBYTE:
-        switch (out_type) {
-          case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ubp, nmap, imap.ubp, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break;
-          case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ubp, nmap, imap.ubp, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break;
-          case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ubp, nmap, imap.ubp, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break;
-          case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ubp, nmap, imap.ubp, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break;
-          case CDS_FLOAT:  CDS_CONVERT_UNITS_FLOAT (uc, length, in.ubp, nmap, imap.ubp, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break;
-          case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ubp, nmap, imap.ubp, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break;
-          /* NetCDF4 extended data types */
-          case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ubp, nmap, imap.ubp, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break;
-          case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ubp, nmap, imap.ubp, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break;
-          case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ubp, nmap, imap.ubp, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break;
-          case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ubp, nmap, imap.ubp, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break;
-          case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ubp, nmap, imap.ubp, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break;
-          default:
-            break;
-        }
-        break;
-      case CDS_USHORT:
-        switch (out_type) {
-          case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.usp, nmap, imap.usp, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break;
-          case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.usp, nmap, imap.usp, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break;
-          case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.usp, nmap, imap.usp, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break;
-          case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(uc, length, in.usp, nmap, imap.usp, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break;
-          case CDS_FLOAT:  CDS_CONVERT_UNITS_FLOAT (uc, length, in.usp, nmap, imap.usp, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break;
-          case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.usp, nmap, imap.usp, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break;
-          /* NetCDF4 extended data types */
-          case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.usp, nmap, imap.usp, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break;
-          case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.usp, nmap, imap.usp, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break;
-          case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.usp, nmap, imap.usp, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break;
-          case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.usp, nmap, imap.usp, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break;
-          case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.usp, nmap, imap.usp, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break;
-          default:
-            break;
-        }
-        break;
-      case CDS_UINT:
-        switch (out_type) {
-          case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.uip, nmap, imap.uip, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break;
-          case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.uip, nmap, imap.uip, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break;
-          case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.uip, nmap, imap.uip, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break;
-          case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(uc, length, in.uip, nmap, imap.uip, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break;
-          case CDS_FLOAT:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.uip, nmap, imap.uip, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break;
-          case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.uip, nmap, imap.uip, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break;
-          /* NetCDF4 extended data types */
-          case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.uip, nmap, imap.uip, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break;
-          case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.uip, nmap, imap.uip, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break;
-          case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.uip, nmap, imap.uip, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break;
-          case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.uip, nmap, imap.uip, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break;
-          case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.uip, nmap, imap.uip, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break;
-          default:
-            break;
-        }
-        break;
-      case CDS_UINT64:
-        switch (out_type) {
-          case CDS_BYTE:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ui64p, nmap, imap.ui64p, signed char, out.bp, omap.bp, min.bp, ormin.bp, max.bp, ormax.bp, 1); break;
-          case CDS_CHAR:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ui64p, nmap, imap.ui64p, char,        out.cp, omap.cp, min.cp, ormin.cp, max.cp, ormax.cp, 1); break;
-          case CDS_SHORT:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ui64p, nmap, imap.ui64p, short,       out.sp, omap.sp, min.sp, ormin.sp, max.sp, ormax.sp, 1); break;
-          case CDS_INT:    CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ui64p, nmap, imap.ui64p, int,         out.ip, omap.ip, min.ip, ormin.ip, max.ip, ormax.ip, 1); break;
-          case CDS_FLOAT:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ui64p, nmap, imap.ui64p, float,       out.fp, omap.fp, min.fp, ormin.fp, max.fp, ormax.fp, 0); break;
-          case CDS_DOUBLE: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ui64p, nmap, imap.ui64p, double,      out.dp, omap.dp, min.dp, ormin.dp, max.dp, ormax.dp, 0); break;
-          /* NetCDF4 extended data types */
-          case CDS_INT64:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ui64p, nmap, imap.ui64p, long long,   out.i64p, omap.i64p, min.i64p, ormin.i64p, max.i64p, ormax.i64p, 1); break;
-          case CDS_UBYTE:  CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ui64p, nmap, imap.ui64p, unsigned char,  out.ubp, omap.ubp, min.ubp, ormin.ubp, max.ubp, ormax.ubp, 1); break;
-          case CDS_USHORT: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ui64p, nmap, imap.ui64p, unsigned short, out.usp, omap.usp, min.usp, ormin.usp, max.usp, ormax.usp, 1); break;
-          case CDS_UINT:   CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ui64p, nmap, imap.ui64p, unsigned int,   out.uip, omap.uip, min.uip, ormin.uip, max.uip, ormax.uip, 1); break;
-          case CDS_UINT64: CDS_CONVERT_UNITS_DOUBLE(uc, length, in.ui64p, nmap, imap.ui64p, unsigned long long, out.ui64p, omap.ui64p, min.ui64p, ormin.ui64p, max.ui64p, ormax.ui64p, 1); break;
-          default:
-            break;
-        }
-        break;
-
-      default:
-        break;
+    if (uc->is_affine) {
+        CDS_CONVERT_UNITS_SWITCH(
+            CDS_AFFINE_CONVERT_FLOAT, CDS_AFFINE_CONVERT_DOUBLE, uc);
+    }
+    else {
+        CDS_CONVERT_UNITS_SWITCH(
+            cv_convert_float, cv_convert_double, (cv_converter *)uc->cv);
     }
 
     return(out_data);
@@ -807,7 +1048,9 @@ void *cds_convert_unit_deltas(
     void             *in_map,
     void             *out_map)
 {
-    cv_converter *uc = (cv_converter *)converter;
+    cv_converter *uc = (converter)
+                     ? (cv_converter *)((_CDSUnitConverter *)converter)->cv
+                     : (cv_converter *)NULL;
     CDSData in;
     CDSData out;
     CDSData imap;
@@ -1075,8 +1318,11 @@ void *cds_convert_unit_deltas(
  */
 void cds_free_unit_converter(CDSUnitConverter unit_converter)
 {
-    if (unit_converter) {
-        cv_free((cv_converter *)unit_converter);
+    _CDSUnitConverter *uc = (_CDSUnitConverter *)unit_converter;
+
+    if (uc && --uc->nrefs <= 0) {
+        if (uc->cv) cv_free((cv_converter *)uc->cv);
+        free(uc);
     }
 }
 
@@ -1087,6 +1333,7 @@ void cds_free_unit_converter(CDSUnitConverter unit_converter)
  */
 void cds_free_unit_system(void)
 {
+    _cds_free_units_cache();
     _cds_free_symbols_map();
 
     if (_UnitSystem) {
@@ -1108,6 +1355,10 @@ void cds_free_unit_system(void)
  *  The memory used by the returned unit converter must also be freed
  *  by calling cds_free_unit_converter().
  *
+ *  The results are cached by the unit system, so getting the converter
+ *  for the same units again does not parse the units strings again. The
+ *  cache is cleared by cds_map_symbol_to_unit() and cds_free_unit_system().
+ *
  *  Error messages from this function are sent to the message handler
  *  (see msngr_init_log() and msngr_init_mail()).
  *
@@ -1125,10 +1376,12 @@ int cds_get_unit_converter(
     const char       *to_units,
     CDSUnitConverter *unit_converter)
 {
-    cv_converter *converter;
-    ut_unit      *from;
-    ut_unit      *to;
-    ut_status     status;
+    UnitsCacheEntry   *entry;
+    _CDSUnitConverter *uc;
+    cv_converter      *converter;
+    ut_unit           *from;
+    ut_unit           *to;
+    ut_status          status;
 
     *unit_converter = (CDSUnitConverter)NULL;
 
@@ -1146,6 +1399,19 @@ int cds_get_unit_converter(
         }
     }
 
+    /* Check if we already have a converter for these units */
+
+    entry = _cds_get_units_cache_entry(from_units, to_units, 0);
+    if (entry && entry->status != -2) {
+
+        if (entry->status == 1) {
+            entry->converter->nrefs++;
+            *unit_converter = (CDSUnitConverter)entry->converter;
+        }
+
+        return(entry->status);
+    }
+
     /* Parse from_units string */
 
     from = _cds_ut_parse_from_units(from_units);
@@ -1176,6 +1442,11 @@ int cds_get_unit_converter(
         ut_free(from);
         ut_free(to);
 
+        entry = _cds_get_units_cache_entry(from_units, to_units, 1);
+        if (entry) {
+            entry->status = 0;
+        }
+
         return(0);
     }
 
@@ -1197,11 +1468,37 @@ int cds_get_unit_converter(
         return(-1);
     }
 
-    *unit_converter = (CDSUnitConverter)converter;
-
     ut_free(from);
     ut_free(to);
 
+    uc = (_CDSUnitConverter *)calloc(1, sizeof(_CDSUnitConverter));
+    if (!uc) {
+
+        ERROR( CDS_LIB_NAME,
+            "Memory allocation error creating units converter for: '%s' to '%s'\n",
+            from_units, to_units);
+
+        cv_free(converter);
+
+        return(-1);
+    }
+
+    uc->cv    = (void *)converter;
+    uc->nrefs = 1;
+
+    _cds_set_affine_converter(uc);
+
+    /* Keep a reference to the converter in the cache */
+
+    entry = _cds_get_units_cache_entry(from_units, to_units, 1);
+    if (entry) {
+        entry->status    = 1;
+        entry->converter = uc;
+        uc->nrefs++;
+    }
+
+    *unit_converter = (CDSUnitConverter)uc;
+
     return(1);
 }
 
@@ -1281,6 +1578,10 @@ int cds_map_symbol_to_unit(const char *symbol, const char *name)
     ut_status  status;
     ut_unit   *unit;
 
+    /* Anything we have cached may have used the old mapping */
+
+    _cds_free_units_cache();
+
     if (!_UnitSystem) {
         if (!_cds_add_symbol_to_map(symbol, name)) {
             return(0);
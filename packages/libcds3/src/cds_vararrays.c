@@ -338,7 +338,7 @@ int cds_delete_vararray(CDSVarArray *vararray)
 
     /* Remove this vararray from the parent */
 
-    _cds_remove_object(
+    _cds_remove_object(NULL,
         (void **)vargroup->arrays, &(vargroup->narrays), vararray);
 
     /* Destroy the variable array */
@@ -365,7 +365,7 @@ CDSVarArray *cds_get_vararray(CDSVarGroup *vargroup, const char *name)
 {
     CDSVarArray *vararray;
 
-    vararray = _cds_get_object(
+    vararray = _cds_get_object(NULL,
         (void **)vargroup->arrays, vargroup->narrays, name);
 
     return(vararray);
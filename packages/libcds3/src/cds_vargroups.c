@@ -232,7 +232,7 @@ int cds_delete_vargroup(CDSVarGroup *vargroup)
 
     /* Remove this vargroup from the parent */
 
-    _cds_remove_object(
+    _cds_remove_object(NULL,
         (void **)group->vargroups, &(group->nvargroups), vargroup);
 
     /* Destroy the variable group */
@@ -259,7 +259,7 @@ CDSVarGroup *cds_get_vargroup(CDSGroup *group, const char *name)
 {
     CDSVarGroup *vargroup;
 
-    vargroup = _cds_get_object(
+    vargroup = _cds_get_object(NULL,
         (void **)group->vargroups, group->nvargroups, name);
 
     return(vargroup);
@@ -56,15 +56,16 @@ CDSVar *_cds_create_var(
     int           ndims,
     CDSDim      **dims)
 {
-    CDSVar *var;
+    CDSArena *arena = _cds_get_arena(group);
+    CDSVar   *var;
 
-    var = (CDSVar *)calloc(1, sizeof(CDSVar));
+    var = (CDSVar *)_cds_arena_alloc(arena, sizeof(CDSVar));
     if (!var) {
         return((CDSVar *)NULL);
     }
 
     if (!_cds_init_object_members(var, CDS_VAR, group, name)) {
-        free(var);
+        _cds_arena_free(arena, var);
         return((CDSVar *)NULL);
     }
 
@@ -84,10 +85,13 @@ CDSVar *_cds_create_var(
  */
 void _cds_destroy_var(CDSVar *var)
 {
-    int ai;
+    CDSArena *arena;
+    int       ai;
 
     if (var) {
 
+        arena = _cds_get_arena(var->parent);
+
         cds_delete_var_data(var);
 
         if (var->atts) {
@@ -97,12 +101,14 @@ void _cds_destroy_var(CDSVar *var)
             free(var->atts);
         }
 
-        if (var->dims)           free(var->dims);
+        if (var->dims)           _cds_arena_free(arena, var->dims);
         if (var->default_fill)   free(var->default_fill);
 
+        _cds_free_name_index(&(var->att_index));
+
         _cds_free_object_members(var);
 
-        free(var);
+        _cds_arena_free(arena, var);
     }
 }
 
@@ -144,10 +150,11 @@ CDSVar *cds_define_var(
     int          ndims,
     const char **dim_names)
 {
-    CDSVar  *var;
-    CDSVar **vars;
-    CDSDim **dims;
-    int      di;
+    CDSArena *arena;
+    CDSVar   *var;
+    CDSVar  **vars;
+    CDSDim  **dims;
+    int       di;
 
     /* Check if a variable with this name already exists */
 
@@ -193,7 +200,8 @@ CDSVar *cds_define_var(
 
     /* Create the array of dimension pointers */
 
-    dims = (CDSDim **)calloc(ndims+1, sizeof(CDSDim *));
+    arena = _cds_get_arena(group);
+    dims  = (CDSDim **)_cds_arena_alloc(arena, (ndims+1) * sizeof(CDSDim *));
 
     if (!dims) {
 
@@ -216,7 +224,7 @@ CDSVar *cds_define_var(
                 " -> dimension not defined: %s\n",
                 cds_get_object_path(group), name, dim_names[di]);
 
-            free(dims);
+            _cds_arena_free(arena, dims);
             return((CDSVar *)NULL);
         }
 
@@ -227,7 +235,7 @@ CDSVar *cds_define_var(
                 " -> unlimited dimension must be first: %s\n",
                 cds_get_object_path(group), name, dim_names[di]);
 
-            free(dims);
+            _cds_arena_free(arena, dims);
             return((CDSVar *)NULL);
         }
     }
@@ -267,6 +275,8 @@ CDSVar *cds_define_var(
     group->nvars++;
     group->vars[group->nvars] = (CDSVar *)NULL;
 
+    _cds_index_object(&(group->var_index), group->vars[group->nvars - 1]);
+
     return(group->vars[group->nvars - 1]);
 }
 
@@ -314,7 +324,8 @@ int cds_delete_var(CDSVar *var)
 
     /* Remove this variable from the group */
 
-    _cds_remove_object((void **)group->vars, &(group->nvars), var);
+    _cds_remove_object(
+        &(group->var_index), (void **)group->vars, &(group->nvars), var);
 
     /* Destroy the variable */
 
@@ -445,7 +456,8 @@ CDSVar *cds_get_var(CDSGroup *group, const char *name)
 {
     CDSVar *var;
 
-    var = _cds_get_object((void **)group->vars, group->nvars, name);
+    var = _cds_get_object(
+        &(group->var_index), (void **)group->vars, group->nvars, name);
 
     return(var);
 }
@@ -510,7 +522,7 @@ int cds_rename_var(CDSVar *var, const char *name)
 
     /* Rename the variable */
 
-    new_name = strdup(name);
+    new_name = _cds_arena_strdup(_cds_get_arena(group), name);
     if (!new_name) {
 
         ERROR( CDS_LIB_NAME,
@@ -521,8 +533,7 @@ int cds_rename_var(CDSVar *var, const char *name)
         return(0);
     }
 
-    free(var->name);
-    var->name = new_name;
+    _cds_rename_object(&(group->var_index), var, new_name);
 
     return(1);
 }
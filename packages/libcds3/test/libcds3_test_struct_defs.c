@@ -1442,6 +1442,483 @@ static int delete_tests(void)
     return(1);
 }
 
+/*******************************************************************************
+ *  Name Index Tests
+ */
+
+/* Arrays with CDS_NAME_INDEX_MIN (16) or more objects are searched using a
+ * hash table that is grown as objects are added. These tests define enough
+ * objects to cross several resizes, and check every lookup against the
+ * objects that should exist after each define, delete, and rename. */
+
+#define NAME_INDEX_NOBJECTS 100
+
+typedef struct {
+    const char *type;
+    void     *(*define)(void *parent, const char *name);
+    void     *(*get)(void *parent, const char *name);
+    int       (*delete)(void *object);
+    int       (*rename)(void *object, const char *name);
+} NameIndexOps;
+
+static void *_ni_define_dim(void *parent, const char *name)
+{
+    return(cds_define_dim((CDSGroup *)parent, name, 1, 0));
+}
+
+static void *_ni_get_dim(void *parent, const char *name)
+{
+    return(cds_get_dim((CDSGroup *)parent, name));
+}
+
+static int _ni_delete_dim(void *object)
+{
+    return(cds_delete_dim((CDSDim *)object));
+}
+
+static int _ni_rename_dim(void *object, const char *name)
+{
+    return(cds_rename_dim((CDSDim *)object, name));
+}
+
+static void *_ni_define_att(void *parent, const char *name)
+{
+    return(cds_define_att(parent, name, CDS_INT, 1, IntData));
+}
+
+static void *_ni_get_att(void *parent, const char *name)
+{
+    return(cds_get_att(parent, name));
+}
+
+static int _ni_delete_att(void *object)
+{
+    return(cds_delete_att((CDSAtt *)object));
+}
+
+static int _ni_rename_att(void *object, const char *name)
+{
+    return(cds_rename_att((CDSAtt *)object, name));
+}
+
+static void *_ni_define_var(void *parent, const char *name)
+{
+    return(cds_define_var((CDSGroup *)parent, name, CDS_INT, 0, NULL));
+}
+
+static void *_ni_get_var(void *parent, const char *name)
+{
+    return(cds_get_var((CDSGroup *)parent, name));
+}
+
+static int _ni_delete_var(void *object)
+{
+    return(cds_delete_var((CDSVar *)object));
+}
+
+static int _ni_rename_var(void *object, const char *name)
+{
+    return(cds_rename_var((CDSVar *)object, name));
+}
+
+static void *_ni_define_group(void *parent, const char *name)
+{
+    return(cds_define_group((CDSGroup *)parent, name));
+}
+
+static void *_ni_get_group(void *parent, const char *name)
+{
+    return(cds_get_group((CDSGroup *)parent, name));
+}
+
+static int _ni_delete_group(void *object)
+{
+    return(cds_delete_group((CDSGroup *)object));
+}
+
+static int _ni_rename_group(void *object, const char *name)
+{
+    return(cds_rename_group((CDSGroup *)object, name));
+}
+
+static NameIndexOps NameIndexDims = {
+    "dim", _ni_define_dim, _ni_get_dim, _ni_delete_dim, _ni_rename_dim
+};
+
+static NameIndexOps NameIndexAtts = {
+    "att", _ni_define_att, _ni_get_att, _ni_delete_att, _ni_rename_att
+};
+
+static NameIndexOps NameIndexVars = {
+    "var", _ni_define_var, _ni_get_var, _ni_delete_var, _ni_rename_var
+};
+
+static NameIndexOps NameIndexGroups = {
+    "group", _ni_define_group, _ni_get_group, _ni_delete_group, _ni_rename_group
+};
+
+/**
+ *  Check that every object is found by name and deleted names are not.
+ */
+static int check_name_index(
+    NameIndexOps *ops,
+    void         *parent,
+    int           nobjects,
+    void        **objects,
+    char        (*names)[32],
+    const char   *step)
+{
+    void *found;
+    int   oi;
+
+    for (oi = 0; oi < nobjects; oi++) {
+
+        found = ops->get(parent, names[oi]);
+
+        if (found != objects[oi]) {
+            fprintf(stderr,
+                "\n%s: %s: lookup of '%s' returned %p, expected %p\n",
+                step, ops->type, names[oi], found, objects[oi]);
+            return(0);
+        }
+    }
+
+    if (ops->get(parent, "not_defined")) {
+        fprintf(stderr, "\n%s: %s: found object that was never defined\n",
+            step, ops->type);
+        return(0);
+    }
+
+    return(1);
+}
+
+/**
+ *  Run the name index tests for one type of object.
+ *
+ *  Deleted objects are kept in the check arrays with a NULL object
+ *  pointer so their names are checked to no longer be found.
+ */
+static int name_index_test(NameIndexOps *ops, void *parent)
+{
+    void *objects[2 * NAME_INDEX_NOBJECTS];
+    char  names[2 * NAME_INDEX_NOBJECTS][32];
+    char  old_name[32];
+    int   nobjects;
+    int   oi;
+
+    /* Define objects, checking all lookups after each one so the index
+     * is checked before, at, and after each resize */
+
+    for (nobjects = 0; nobjects < NAME_INDEX_NOBJECTS; nobjects++) {
+
+        sprintf(names[nobjects], "%s_%03d", ops->type, nobjects);
+
+        objects[nobjects] = ops->define(parent, names[nobjects]);
+        if (!objects[nobjects]) {
+            fprintf(stderr, "\ncould not define %s '%s'\n",
+                ops->type, names[nobjects]);
+            return(0);
+        }
+
+        if (!check_name_index(
+            ops, parent, nobjects + 1, objects, names, "define")) {
+            return(0);
+        }
+    }
+
+    /* Delete every third object, this moves entries in the probe
+     * sequences back to fill the empty slots */
+
+    for (oi = 0; oi < nobjects; oi += 3) {
+
+        if (!ops->delete(objects[oi])) {
+            fprintf(stderr, "\ncould not delete %s '%s'\n",
+                ops->type, names[oi]);
+            return(0);
+        }
+
+        objects[oi] = NULL;
+
+        if (!check_name_index(
+            ops, parent, nobjects, objects, names, "delete")) {
+            return(0);
+        }
+    }
+
+    /* Rename every fifth remaining object */
+
+    for (oi = 1; oi < nobjects; oi += 5) {
+
+        if (!objects[oi]) continue;
+
+        strcpy(old_name, names[oi]);
+        sprintf(names[oi], "renamed_%s_%03d", ops->type, oi);
+
+        if (!ops->rename(objects[oi], names[oi])) {
+            fprintf(stderr, "\ncould not rename %s '%s'\n",
+                ops->type, old_name);
+            return(0);
+        }
+
+        if (ops->get(parent, old_name)) {
+            fprintf(stderr, "\nrename: %s: found old name '%s'\n",
+                ops->type, old_name);
+            return(0);
+        }
+
+        if (!check_name_index(
+            ops, parent, nobjects, objects, names, "rename")) {
+            return(0);
+        }
+    }
+
+    /* Define more objects, reusing some of the deleted names,
+     * to resize the index again after the deletes and renames */
+
+    for (oi = 0; oi < NAME_INDEX_NOBJECTS; oi++, nobjects++) {
+
+        if (oi % 3 == 0 && !objects[oi]) {
+            strcpy(names[nobjects], names[oi]);
+            names[oi][0] = '\0';
+        }
+        else {
+            sprintf(names[nobjects], "%s_%03d", ops->type, nobjects);
+        }
+
+        objects[nobjects] = ops->define(parent, names[nobjects]);
+        if (!objects[nobjects]) {
+            fprintf(stderr, "\ncould not define %s '%s'\n",
+                ops->type, names[nobjects]);
+            return(0);
+        }
+
+        if (!check_name_index(
+            ops, parent, nobjects + 1, objects, names, "redefine")) {
+            return(0);
+        }
+    }
+
+    return(1);
+}
+
+static int name_index_tests(void)
+{
+    CDSGroup *group;
+    CDSVar   *var;
+    int       status;
+
+    group = cds_define_group(NULL, "name_index_tests");
+    if (!group) {
+        return(0);
+    }
+
+    status = 0;
+
+    var = cds_define_var(group, "atts_var", CDS_INT, 0, NULL);
+    if (!var) {
+        goto EXIT;
+    }
+
+    if (!name_index_test(&NameIndexDims,   group) ||
+        !name_index_test(&NameIndexAtts,   group) ||
+        !name_index_test(&NameIndexAtts,   var)   ||
+        !name_index_test(&NameIndexVars,   group) ||
+        !name_index_test(&NameIndexGroups, group)) {
+
+        goto EXIT;
+    }
+
+    status = 1;
+
+EXIT:
+    cds_delete_group(group);
+    return(status);
+}
+
+/*******************************************************************************
+ *  Memory Arena Tests
+ */
+
+#define ARENA_ALIGNED(ptr) (((size_t)(ptr) & 15) == 0)
+
+/**
+ *  Define objects with names of different lengths in an arena group, and
+ *  check that all objects and names are 16 byte aligned and can be found.
+ */
+static int define_arena_objects(CDSGroup *root, const char *prefix, int count)
+{
+    const char *dim_names[1];
+    CDSGroup   *group;
+    CDSDim     *dim;
+    CDSAtt     *att;
+    CDSVar     *var;
+    char        name[64];
+    int         oi;
+
+    for (oi = 0; oi < count; oi++) {
+
+        /* Names from 1 to 40 characters long */
+
+        sprintf(name, "%s%d_", prefix, oi);
+        memset(name + strlen(name), 'x', oi % 40);
+        name[strlen(prefix) + 2 + oi % 40] = '\0';
+
+        group = cds_define_group(root, name);
+        dim   = cds_define_dim(root, name, oi + 1, 0);
+        att   = cds_define_att(root, name, CDS_INT, 1, IntData);
+
+        dim_names[0] = name;
+        var   = cds_define_var(root, name, CDS_INT, 1, dim_names);
+
+        if (!group || !dim || !att || !var) {
+            fprintf(stderr, "\ncould not define objects named '%s'\n", name);
+            return(0);
+        }
+
+        if (!ARENA_ALIGNED(group) || !ARENA_ALIGNED(group->name) ||
+            !ARENA_ALIGNED(dim)   || !ARENA_ALIGNED(dim->name)   ||
+            !ARENA_ALIGNED(att)   || !ARENA_ALIGNED(att->name)   ||
+            !ARENA_ALIGNED(var)   || !ARENA_ALIGNED(var->name)   ||
+            !ARENA_ALIGNED(var->dims)) {
+
+            fprintf(stderr, "\nobjects named '%s' are not 16 byte aligned\n",
+                name);
+            return(0);
+        }
+
+        if (strcmp(group->name, name) != 0 || strcmp(var->name, name) != 0 ||
+            var->dims[0] != dim || dim->length != (size_t)(oi + 1)) {
+
+            fprintf(stderr, "\nobjects named '%s' were not defined correctly\n",
+                name);
+            return(0);
+        }
+    }
+
+    return(1);
+}
+
+static int arena_tests(void)
+{
+    CDSGroup *root;
+    CDSGroup *group;
+    CDSVar   *var;
+    char     *long_name;
+    size_t    long_length = 100000;
+    int       status;
+
+    status = 0;
+    root   = (CDSGroup *)NULL;
+
+    /* The arena can only be enabled for empty root groups */
+
+    group = cds_define_group(NULL, "not_empty");
+    if (!group || !cds_define_att(group, "att", CDS_INT, 1, IntData)) {
+        return(0);
+    }
+
+    if (cds_enable_arena(group, 0) || group->arena) {
+        fprintf(stderr, "\nmemory arena enabled for a group with attributes\n");
+        cds_delete_group(group);
+        return(0);
+    }
+
+    cds_delete_group(group);
+
+    root = cds_define_group(NULL, "arena_tests");
+    if (!root) {
+        return(0);
+    }
+
+    group = cds_define_group(root, "subgroup");
+    if (!group || cds_enable_arena(root, 0)) {
+        fprintf(stderr, "\nmemory arena enabled for a group with subgroups\n");
+        goto EXIT;
+    }
+
+    if (cds_enable_arena(group, 0) || group->arena) {
+        fprintf(stderr, "\nmemory arena enabled for a group that is not a root group\n");
+        goto EXIT;
+    }
+
+    cds_delete_group(root);
+
+    /* Objects and names allocated from the arena must be 16 byte aligned */
+
+    root = cds_define_group(NULL, "arena_tests");
+    if (!root) {
+        return(0);
+    }
+
+    if (!cds_enable_arena(root, 0) || !root->arena ||
+        !cds_enable_arena(root, 0)) {
+
+        fprintf(stderr, "\ncould not enable memory arena\n");
+        goto EXIT;
+    }
+
+    if (!define_arena_objects(root, "a", 200)) {
+        goto EXIT;
+    }
+
+    /* Allocations larger than the 64 KB block size */
+
+    long_name = (char *)malloc(long_length + 1);
+    if (!long_name) {
+        goto EXIT;
+    }
+
+    memset(long_name, 'n', long_length);
+    long_name[long_length] = '\0';
+
+    var = cds_define_var(root, long_name, CDS_INT, 0, NULL);
+
+    if (!var || !ARENA_ALIGNED(var->name) ||
+        strcmp(var->name, long_name) != 0 ||
+        cds_get_var(root, long_name) != var) {
+
+        fprintf(stderr, "\ncould not define variable with a %d character name\n",
+            (int)long_length);
+        free(long_name);
+        goto EXIT;
+    }
+
+    free(long_name);
+
+    /* Objects defined after the large allocation, and the objects deleted
+     * before the arena is destroyed */
+
+    if (!define_arena_objects(root, "b", 50) ||
+        !cds_delete_var(var) ||
+        !cds_delete_group(cds_get_group(root, "a0_"))) {
+
+        goto EXIT;
+    }
+
+    /* All objects in the arena are released when the root group is deleted */
+
+    cds_delete_group(root);
+
+    /* Every object is larger than the block size */
+
+    root = cds_define_group(NULL, "arena_tests");
+    if (!root) {
+        return(0);
+    }
+
+    if (!cds_enable_arena(root, 16) ||
+        !define_arena_objects(root, "c", 50)) {
+
+        goto EXIT;
+    }
+
+    status = 1;
+
+EXIT:
+    if (root) cds_delete_group(root);
+    return(status);
+}
+
 /*******************************************************************************
  *  Run Definition Tests
  */
@@ -1453,5 +1930,7 @@ void libcds3_test_defines(void)
     run_test(" - define_tests", "define_tests", define_tests);
     run_test(" - delete_tests", "delete_tests", delete_tests);
     run_test(" - error_tests",  "error_tests",  error_tests);
+    run_test(" - name_index_tests", NULL,       name_index_tests);
+    run_test(" - arena_tests",      NULL,       arena_tests);
 
 }
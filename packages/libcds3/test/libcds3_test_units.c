@@ -20,6 +20,9 @@
 *******************************************************************************/
 
 #include "libcds3_test.h"
+#include "../config.h"
+
+#include UDUNITS_INCLUDE
 
 extern const char *gProgramName;
 extern FILE       *gLogFP;
@@ -303,6 +306,277 @@ static int units_conversion_tests(void)
     return(1);
 }
 
+/*******************************************************************************
+ *  Affine Converter Tests
+ */
+
+/* Units pairs with affine converters, including offsets */
+
+static const char *affine_units[][2] = {
+    { "degC",    "K"       },
+    { "K",       "degC"    },
+    { "degC",    "degF"    },
+    { "degF",    "degC"    },
+    { "degF",    "K"       },
+    { "K",       "degF"    },
+    { "km",      "m"       },
+    { "m",       "km"      },
+    { "hPa",     "Pa"      },
+    { "mm/hr",   "m/s"     },
+    { "hours since 2012-06-09 00:00:00",
+      "seconds since 1970-01-01 00:00:00" },
+    { NULL, NULL }
+};
+
+/**
+ *  Compare cds_convert_units() with the UDUNITS-2 converter.
+ *
+ *  The UDUNITS-2 converter is created from a separate unit system, so this
+ *  compares the slope and intercept used by cds_convert_units() with
+ *  calling UDUNITS-2 for every value. The results must be identical.
+ */
+static int affine_converter_test(
+    ut_system  *system,
+    const char *in_units,
+    const char *out_units)
+{
+    double            in_ddata[64];
+    double            out_ddata[64];
+    float             in_fdata[64];
+    float             out_fdata[64];
+    int               in_idata[64];
+    double            out_idata[64];
+    CDSUnitConverter  converter;
+    ut_unit          *from;
+    ut_unit          *to;
+    cv_converter     *cv;
+    int               length;
+    int               status;
+    int               retval;
+    int               i;
+
+    /* Values covering the range of typical measurements */
+
+    length = 0;
+    for (i = -300; i <= 1000; i += 43) {
+        in_ddata[length] = i + i * 0.0123456789;
+        in_fdata[length] = (float)in_ddata[length];
+        in_idata[length] = i;
+        length++;
+    }
+
+    in_ddata[length] = 1.0e30;
+    in_fdata[length] = 1.0e30;
+    in_idata[length] = 2147483647;
+    length++;
+
+    /* Get the UDUNITS-2 converter */
+
+    from = ut_parse(system, in_units,  UT_ASCII);
+    to   = ut_parse(system, out_units, UT_ASCII);
+    cv   = (from && to) ? ut_get_converter(from, to) : (cv_converter *)NULL;
+
+    if (from) ut_free(from);
+    if (to)   ut_free(to);
+
+    if (!cv) {
+        fprintf(stderr, "\n%s -> %s: could not get UDUNITS-2 converter\n",
+            in_units, out_units);
+        return(0);
+    }
+
+    /* Get the CDS converter */
+
+    status = cds_get_unit_converter(in_units, out_units, &converter);
+    if (status != 1) {
+        fprintf(stderr, "\n%s -> %s: cds_get_unit_converter returned %d\n",
+            in_units, out_units, status);
+        cv_free(cv);
+        return(0);
+    }
+
+    cds_convert_units(converter,
+        CDS_DOUBLE, length, in_ddata, CDS_DOUBLE, out_ddata,
+        0, NULL, NULL, NULL, NULL, NULL, NULL);
+
+    cds_convert_units(converter,
+        CDS_FLOAT, length, in_fdata, CDS_FLOAT, out_fdata,
+        0, NULL, NULL, NULL, NULL, NULL, NULL);
+
+    cds_convert_units(converter,
+        CDS_INT, length, in_idata, CDS_DOUBLE, out_idata,
+        0, NULL, NULL, NULL, NULL, NULL, NULL);
+
+    cds_free_unit_converter(converter);
+
+    retval = 1;
+
+    for (i = 0; i < length; i++) {
+
+        if (out_ddata[i] != cv_convert_double(cv, in_ddata[i])) {
+            fprintf(stderr, "\n%s -> %s: double %.17g -> %.17g != %.17g\n",
+                in_units, out_units, in_ddata[i], out_ddata[i],
+                cv_convert_double(cv, in_ddata[i]));
+            retval = 0;
+        }
+
+        if (out_fdata[i] != cv_convert_float(cv, in_fdata[i])) {
+            fprintf(stderr, "\n%s -> %s: float %.9g -> %.9g != %.9g\n",
+                in_units, out_units, in_fdata[i], out_fdata[i],
+                cv_convert_float(cv, in_fdata[i]));
+            retval = 0;
+        }
+
+        if (out_idata[i] != cv_convert_double(cv, (double)in_idata[i])) {
+            fprintf(stderr, "\n%s -> %s: int %d -> %.17g != %.17g\n",
+                in_units, out_units, in_idata[i], out_idata[i],
+                cv_convert_double(cv, (double)in_idata[i]));
+            retval = 0;
+        }
+    }
+
+    cv_free(cv);
+
+    return(retval);
+}
+
+static int affine_converter_tests(void)
+{
+    ut_system *system;
+    int        retval;
+    int        i;
+
+    ut_set_error_message_handler(ut_ignore);
+
+    system = ut_read_xml(NULL);
+    if (!system) {
+        fprintf(stderr, "\nCould not read UDUNITS-2 database\n");
+        return(0);
+    }
+
+    retval = 1;
+
+    for (i = 0; affine_units[i][0]; i++) {
+        if (!affine_converter_test(
+            system, affine_units[i][0], affine_units[i][1])) {
+
+            retval = 0;
+        }
+    }
+
+    ut_free_system(system);
+    cds_free_unit_system();
+
+    return(retval);
+}
+
+/*******************************************************************************
+ *  Units Cache Tests
+ */
+
+static int units_cache_tests(void)
+{
+    CDSUnitConverter  converter1;
+    CDSUnitConverter  converter2;
+    CDSUnitConverter  converter3;
+    float             in_data[] = { -40, 0, 37, 100 };
+    float             out_data1[4];
+    float             out_data3[4];
+    int               retval;
+    int               i;
+
+    /* Getting the converter for the same units again must return the
+     * cached converter */
+
+    if (cds_get_unit_converter("degC", "degF", &converter1) != 1) {
+        return(0);
+    }
+
+    if (cds_get_unit_converter("degC", "degF", &converter2) != 1) {
+        cds_free_unit_converter(converter1);
+        return(0);
+    }
+
+    retval = 1;
+
+    if (converter1 != converter2) {
+        fprintf(stderr, "\ndegC -> degF: converter was not cached\n");
+        retval = 0;
+    }
+
+    cds_free_unit_converter(converter2);
+
+    /* Cached comparisons must give the same results */
+
+    for (i = 0; i < 2; i++) {
+        if (cds_compare_units("degC", "degree_Celsius") != 0 ||
+            cds_compare_units("degC", "degF")           != 1) {
+
+            fprintf(stderr, "\ncds_compare_units: pass %d: wrong result\n", i);
+            retval = 0;
+        }
+    }
+
+    /* Mapping a symbol clears the cache, but converters that are still
+     * held by the caller must remain valid */
+
+    if (!cds_map_symbol_to_unit("C", "degree_Celsius")) {
+        cds_free_unit_converter(converter1);
+        return(0);
+    }
+
+    if (cds_get_unit_converter("degC", "degF", &converter3) != 1) {
+        cds_free_unit_converter(converter1);
+        return(0);
+    }
+
+    if (converter3 == converter1) {
+        fprintf(stderr, "\ndegC -> degF: cache was not cleared\n");
+        retval = 0;
+    }
+
+    cds_convert_units(converter1,
+        CDS_FLOAT, 4, in_data, CDS_FLOAT, out_data1,
+        0, NULL, NULL, NULL, NULL, NULL, NULL);
+
+    cds_convert_units(converter3,
+        CDS_FLOAT, 4, in_data, CDS_FLOAT, out_data3,
+        0, NULL, NULL, NULL, NULL, NULL, NULL);
+
+    for (i = 0; i < 4; i++) {
+        if (out_data1[i] != out_data3[i]) {
+            fprintf(stderr, "\ndegC -> degF: %g -> %g != %g\n",
+                in_data[i], out_data1[i], out_data3[i]);
+            retval = 0;
+        }
+    }
+
+    if (out_data1[0] != -40 || out_data1[2] != (float)98.6) {
+        fprintf(stderr, "\ndegC -> degF: -40 -> %g, 37 -> %g\n",
+            out_data1[0], out_data1[2]);
+        retval = 0;
+    }
+
+    cds_free_unit_converter(converter1);
+
+    /* The cached converter must survive freeing the unit system */
+
+    cds_free_unit_system();
+
+    cds_convert_units(converter3,
+        CDS_FLOAT, 4, in_data, CDS_FLOAT, out_data1,
+        0, NULL, NULL, NULL, NULL, NULL, NULL);
+
+    if (memcmp(out_data1, out_data3, 4 * sizeof(float)) != 0) {
+        fprintf(stderr, "\ndegC -> degF: converter changed\n");
+        retval = 0;
+    }
+
+    cds_free_unit_converter(converter3);
+
+    return(retval);
+}
+
 /*******************************************************************************
  *  Validate Time Units Tests
  */
@@ -417,6 +691,12 @@ void libcds3_test_units(void)
     run_test(" - units_conversion_tests",
         "units_conversion_tests", units_conversion_tests);
 
+    run_test(" - affine_converter_tests",
+        NULL, affine_converter_tests);
+
+    run_test(" - units_cache_tests",
+        NULL, units_cache_tests);
+
     run_test(" - validate_time_units_tests",
         "validate_time_units_tests", validate_time_units_tests);
 }
@@ -895,6 +895,19 @@ int dsproc_solar_positions(
         double **azimuth,
         double **distance);
 
+int dsproc_solar_positions_from_offsets(
+        time_t        base_time,
+        size_t        ntimes,
+        const double *offsets,
+        double        latitude,
+        double        longitude,
+        double       *ap_ra,
+        double       *ap_dec,
+        double       *altitude,
+        double       *refraction,
+        double       *azimuth,
+        double       *distance);
+
 /*@}*/
 
 /******************************************************************************/
@@ -903,6 +916,33 @@ int dsproc_solar_positions(
  */
 /*@{*/
 
+/**
+ *  Outlier Detection Methods.
+ */
+typedef enum {
+
+    DSPROC_OUTLIERS_IQD        = 1, /**< median and interquartile deviation */
+    DSPROC_OUTLIERS_MEAN_DEV   = 2, /**< absolute deviation from the mean   */
+    DSPROC_OUTLIERS_MEAN_MAD   = 3, /**< mean and mean absolute deviation   */
+    DSPROC_OUTLIERS_MEDIAN_MAD = 4, /**< median and median absolute deviation */
+    DSPROC_OUTLIERS_STD        = 5  /**< mean and standard deviation        */
+
+} DSOutlierMethod;
+
+int dsproc_flag_outliers(
+        CDSGroup        *dataset,
+        int              nvars,
+        const char     **var_names,
+        DSOutlierMethod  method,
+        double           window_width,
+        int              min_npoints,
+        unsigned int     skipped_flag,
+        double           bad_threshold,
+        unsigned int     bad_flag,
+        double           ind_threshold,
+        unsigned int     ind_flag,
+        int              nthreads);
+
 int dsproc_flag_outliers_iqd(
         CDSGroup     *dataset,
         const char   *var_name,
@@ -963,6 +1003,36 @@ int dsproc_flag_outliers_std(
         unsigned int  ind_flag,
         unsigned int  analyze);
 
+/**
+ *  Sliding window order statistics (see dsproc_create_order_stats()).
+ */
+typedef struct DSOrderStats DSOrderStats;
+
+DSOrderStats *dsproc_create_order_stats(size_t nvalues, const double *values);
+void          dsproc_free_order_stats(DSOrderStats *os);
+
+void    dsproc_order_stats_set_values(DSOrderStats *os, const double *values);
+
+void    dsproc_order_stats_add(DSOrderStats *os, size_t index);
+void    dsproc_order_stats_remove(DSOrderStats *os, size_t index);
+void    dsproc_order_stats_clear(DSOrderStats *os);
+int     dsproc_order_stats_count(DSOrderStats *os);
+double  dsproc_order_stats_kth(DSOrderStats *os, int k);
+double  dsproc_order_stats_median(DSOrderStats *os);
+
+int     dsproc_order_stats_median_mad(
+            DSOrderStats *os,
+            double       *median,
+            double       *mad);
+
+double  dsproc_order_stats_mean_abs_dev(DSOrderStats *os, double center);
+
+int     dsproc_order_stats_quartiles(
+            DSOrderStats *os,
+            double       *q1,
+            double       *q2,
+            double       *q3);
+
 /*@}*/
 
 /******************************************************************************/
@@ -1487,6 +1557,10 @@ typedef struct
     int          tro_threshold;   /**< threshold used to detect time rollovers */
     time_t       tro_offset;      /**< offset used to track time rollovers     */
 
+    FILE        *chunk_fp;        /**< open file when loading in chunks        */
+    size_t       chunk_tail;      /**< offset of the partial line in file_data */
+    size_t       chunk_ntail;     /**< length of the partial line              */
+
 } CSVParser;
 
 void        dsproc_free_csv_parser(CSVParser *csv);
@@ -1505,6 +1579,12 @@ char       *dsproc_get_next_csv_line(CSVParser *csv);
 CSVParser  *dsproc_init_csv_parser(CSVParser *csv);
 int         dsproc_load_csv_file(CSVParser *csv, const char *path, const char *name);
 
+int         dsproc_load_csv_chunk(
+                CSVParser  *csv,
+                const char *path,
+                const char *name,
+                size_t      chunk_size);
+
 int         dsproc_parse_csv_header(CSVParser *csv, const char *linep);
 int         dsproc_parse_csv_record(CSVParser *csv, char *linep, int flags);
 
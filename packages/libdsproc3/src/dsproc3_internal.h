@@ -170,6 +170,7 @@ void dsproc_enable_legacy_time_vars(int flag);
 int  dsproc_get_asynchrounous_mode(void);
 int  dsproc_get_dynamic_dods_mode(void);
 int  dsproc_get_force_mode(void);
+int  dsproc_get_prefetch_mode(void);
 int  dsproc_get_real_time_mode(void);
 int  dsproc_get_reprocessing_mode(void);
 
@@ -179,9 +180,20 @@ int  dsproc_set_log_dir(const char *log_dir);
 int  dsproc_set_log_file(const char *log_file);
 int  dsproc_set_log_id(const char *log_id);
 void dsproc_set_max_runtime(int max_runtime);
+void dsproc_set_prefetch_mode(int mode);
 void dsproc_set_processing_interval(time_t begin_time, time_t end_time);
 void dsproc_set_real_time_mode(int mode, float max_wait);
 void dsproc_set_reprocessing_mode(int mode);
+int  dsproc_set_retriever_dim_range(
+        int         ds_id,
+        const char *dim_name,
+        double      min_value,
+        double      max_value);
+int  dsproc_set_retriever_dim_subset(
+        int         ds_id,
+        const char *dim_name,
+        size_t      start,
+        size_t      count);
 void dsproc_set_retriever_time_offsets(
         int    ds_id,
         time_t begin_offset,
@@ -260,6 +272,9 @@ void        dsproc_set_status(const char *status);
 /** Check for files with .v# extension and filter out lower versions. */
 #define DS_FILTER_VERSIONED_FILES  0x200
 
+/** Keep a persistent index of file times in the datastream directory. */
+#define DS_FILE_TIME_INDEX  0x400
+
 /**
  *  DataStream File Formats.
  */
@@ -318,6 +333,7 @@ void    dsproc_close_untouched_files(void);
 int     dsproc_get_nfs_time(const char *dir_path, timeval_t *nfs_time);
 
 void    dsproc_set_max_open_files(int ds_id, int max_open);
+void    dsproc_set_open_file_pool_size(int max_open);
 
 /*@}*/
 
@@ -493,6 +493,122 @@ static int _csv_realloc_data(CSVParser *csv, int nfields, int nrecs)
     return(1);
 }
 
+/**
+ *  Private: Set the line pointers for the data loaded into a CSVParser.
+ *
+ *  The line boundaries are found in a single pass over the data using
+ *  memchr(). The slower quote aware search is only used if the data
+ *  contains quote characters that could hide an embedded newline.
+ *
+ *  If the last line is not terminated by a newline it will only be added
+ *  to the lines array if is_last is true. Otherwise it is left untouched
+ *  so it can be completed by the next chunk read from the file.
+ *
+ *  If an error occurs in this function it will be appended to the log and
+ *  error mail messages, and the process status will be set appropriately.
+ *
+ *  @param  csv      pointer to the CSVParser structure
+ *  @param  nbytes   number of bytes in csv->file_data
+ *  @param  is_last  specifies if this is the last data in the file
+ *
+ *  @retval  nused  number of bytes used by the lines that were found
+ *  @retval  -1     if a memory allocation error occurs
+ */
+static ssize_t _csv_set_line_pointers(
+    CSVParser *csv,
+    size_t     nbytes,
+    int        is_last)
+{
+    char   *data = csv->file_data;
+    char   *endp = data + nbytes;
+    char   *linep;
+    char   *eol;
+    char    newline_char;
+    int     has_quotes;
+    size_t  nscanned;
+    int     nlines;
+    int     li;
+
+    /* Check if this is a format that only uses
+     * carriage returns instead of newline characters. */
+
+    newline_char = '\n';
+
+    if (!memchr(data, '\n', nbytes) && memchr(data, '\r', nbytes)) {
+        newline_char = '\r';
+    }
+
+    has_quotes = (memchr(data, '"', nbytes) || memchr(data, '\'', nbytes));
+
+    li = 0;
+
+    for (linep = data; linep < endp; linep = eol + 1) {
+
+        if (has_quotes) {
+            eol = dsproc_find_csv_delim(linep, newline_char);
+        }
+        else {
+            eol = (char *)memchr(linep, newline_char, endp - linep);
+        }
+
+        if (!eol) {
+            if (!is_last) break;
+            eol = endp;
+        }
+        else if (eol != data && *(eol - 1) == '\r') {
+
+            /* Handle carriage return before newline */
+
+            *(eol - 1) = '\0';
+        }
+
+        *eol = '\0';
+
+        if (li >= csv->nlines_alloced) {
+
+            /* Estimate the total number of lines we will need:
+             *
+             *  = (sizeof_data / nbytes_scanned) * nlines_found
+             *
+             * An unterminated last line ends at endp, so the number of
+             * bytes scanned can not be more than the size of the data.
+             */
+
+            nscanned = eol + 1 - data;
+            if (nscanned > nbytes) nscanned = nbytes;
+
+            nlines = (nbytes / nscanned) * li
+                   + csv->nlines_guess;
+
+            if (nlines <= li) nlines = li + 1;
+
+            csv->lines = (char **)realloc(csv->lines, nlines * sizeof(char *));
+
+            if (!csv->lines) {
+
+                ERROR( DSPROC_LIB_NAME,
+                    "Memory allocation error loading CSV file: %s\n",
+                    csv->file_name);
+
+                dsproc_set_status(DSPROC_ENOMEM);
+
+                csv->nlines_alloced = 0;
+                return(-1);
+            }
+
+            csv->nlines_alloced = nlines;
+        }
+
+        csv->lines[li++] = linep;
+    }
+
+    csv->nlines = li;
+
+    if (linep > endp) linep = endp;
+
+    return((ssize_t)(linep - data));
+}
+
 /*******************************************************************************
  *  Public Functions
  */
@@ -559,6 +675,8 @@ void dsproc_free_csv_parser(CSVParser *csv)
 
         if (csv->tvs) free(csv->tvs);
 
+        if (csv->chunk_fp) fclose(csv->chunk_fp);
+
         free(csv);
     }
 }
@@ -776,6 +894,14 @@ CSVParser *dsproc_init_csv_parser(CSVParser *csv)
         }
 
         csv->tro_offset = 0;
+
+        if (csv->chunk_fp) {
+            fclose(csv->chunk_fp);
+            csv->chunk_fp = (FILE *)NULL;
+        }
+
+        csv->chunk_tail  = 0;
+        csv->chunk_ntail = 0;
     }
     else {
 
@@ -820,42 +946,15 @@ int dsproc_load_csv_file(CSVParser *csv, const char *path, const char *name)
     size_t   nread;
     size_t   nbytes;
     FILE    *fp;
-    char    *chrp;
-    int      nlines;
-    int      li;
-
-    char     newline_char;
 
     /* Initialize the CSVParser structure if necessary */
 
-    if (csv->nlines != 0) {
+    if (csv->nlines != 0 || csv->chunk_fp) {
         if (!dsproc_init_csv_parser(csv)) {
             return(-1);
         }
     }
 
-    /* Initialize the array of CSVParser line pointers if necessary */
-
-    if (csv->nlines_alloced == 0) {
-
-        nlines = csv->nlines_guess;
-
-        csv->lines = (char **)malloc(nlines * sizeof(char *));
-
-        if (!csv->lines) {
-
-            ERROR( DSPROC_LIB_NAME,
-                "Memory allocation error loading CSV file: %s\n",
-                csv->file_name);
-
-            dsproc_set_status(DSPROC_ENOMEM);
-
-            return(-1);
-        }
-
-        csv->nlines_alloced = nlines;
-    }
-
     /* Set the file name and path in the CSVParser structure */
 
     if (!(csv->file_path = strdup(path)) ||
@@ -942,46 +1041,153 @@ int dsproc_load_csv_file(CSVParser *csv, const char *path, const char *name)
 
     /* Set the line pointers */
 
-    chrp = csv->file_data;
-    csv->lines[0] = chrp;
-
-    /* Check if this is a format that only uses
-     * carriage returns instead of newline characters. */
+    if (_csv_set_line_pointers(csv, nbytes, 1) < 0) {
+        return(-1);
+    }
 
-    newline_char = '\n';
+    return(csv->nlines);
+}
 
-    if (!strchr(chrp, '\n') && strchr(chrp, '\r')) {
-        newline_char = '\r';
-    }
+/**
+ *  Load the next chunk of a CSV data file into a CSVParser structure.
+ *
+ *  This function can be used in place of dsproc_load_csv_file() to ingest
+ *  files that are too large to be loaded into memory all at once. Each call
+ *  reads approximately chunk_size bytes from the file and sets the line
+ *  pointers for all complete lines that were read. A partial line at the
+ *  end of a chunk is carried over to the next call, and the buffer will be
+ *  expanded if a single line is longer than the chunk size.
+ *
+ *  The file is opened on the first call, and the path and name arguments
+ *  are ignored on subsequent calls until this function returns 0 to
+ *  indicate the end of the file was reached. The header fields, time
+ *  patterns and time rollover offset are preserved between chunks, but
+ *  the lines and record values from the previous chunk are reset and must
+ *  be processed before this function is called again.
+ *
+ *  Typical usage:
+ *
+ *      while ((nlines = dsproc_load_csv_chunk(csv, path, name, 0)) > 0) {
+ *          if (!csv->nfields) dsproc_parse_csv_header(csv, NULL);
+ *          while (dsproc_get_next_csv_line(csv)) ...
+ *      }
+ *
+ *  If an error occurs in this function it will be appended to the log and
+ *  error mail messages, and the process status will be set appropriately.
+ *
+ *  @param  csv         pointer to the CSVParser structure created by dsproc_init_csv_parser()
+ *  @param  path        path to the location of the file
+ *  @param  name        the name of the file
+ *  @param  chunk_size  number of bytes to read per chunk,
+ *                      or 0 to use the default of 16 MB
+ *
+ *  @retval  nlines  number of lines loaded from the file
+ *  @retval  0       if the end of the file was reached
+ *  @retval  -1      if an error occurred
+ */
+int dsproc_load_csv_chunk(
+    CSVParser  *csv,
+    const char *path,
+    const char *name,
+    size_t      chunk_size)
+{
+    char     full_path[PATH_MAX];
+    size_t   nread;
+    size_t   nbytes;
+    size_t   nalloc;
+    ssize_t  nused;
+    int      is_last;
 
-    li = 1;
-    while ((chrp = dsproc_find_csv_delim(chrp, newline_char))) {
+    if (!chunk_size) chunk_size = 16 * 1024 * 1024;
 
-        if (chrp != csv->file_data) {
+    if (!csv->chunk_fp) {
 
-            /* Handle carriage return before newline */
+        /* Open a new file */
 
-            if (*(chrp - 1) == '\r') {
-                *(chrp - 1) = '\0';
+        if (csv->nlines != 0) {
+            if (!dsproc_init_csv_parser(csv)) {
+                return(-1);
             }
         }
 
-        *chrp++ = '\0';
-        if (*chrp == '\0') break; // end of file
+        if (!(csv->file_path = strdup(path)) ||
+            !(csv->file_name = strdup(name))) {
 
-        if (li >= csv->nlines_alloced) {
+            ERROR( DSPROC_LIB_NAME,
+                "Memory allocation error loading CSV file: %s\n",
+                name);
 
-            /* Estimate the total number of lines we will need:
-             *
-             *  = (sizeof_file / nbytes_read) * nlines_read
-             */
+            dsproc_set_status(DSPROC_ENOMEM);
 
-            nlines = (nbytes / (chrp - csv->file_data)) * li
-                   + csv->nlines_guess;
+            return(-1);
+        }
 
-            csv->lines   = (char **)realloc(csv->lines, nlines * sizeof(char *));
+        snprintf(full_path, PATH_MAX, "%s/%s", path, name);
 
-            if (!csv->lines) {
+        if (csv->ft_result) {
+            free(csv->ft_result);
+            csv->ft_result = (RETimeRes *)NULL;
+        }
+
+        if (stat(full_path, &csv->file_stats) < 0) {
+
+            ERROR( DSPROC_LIB_NAME,
+                "Could not get file status for: %s\n"
+                " -> %s\n", full_path, strerror(errno));
+
+            dsproc_set_status(DSPROC_EFILESTATS);
+
+            return(-1);
+        }
+
+        csv->chunk_fp = fopen(full_path, "r");
+        if (!csv->chunk_fp) {
+
+            ERROR( DSPROC_LIB_NAME,
+                "Could not open file: %s\n"
+                " -> %s\n", csv->file_name, strerror(errno));
+
+            dsproc_set_status(DSPROC_EFILEOPEN);
+
+            return(-1);
+        }
+
+        csv->chunk_tail  = 0;
+        csv->chunk_ntail = 0;
+    }
+    else {
+
+        /* Reset the lines and records from the previous chunk */
+
+        csv->nlines  = 0;
+        csv->linep   = (char *)NULL;
+        csv->linenum = 0;
+        csv->nrecs   = 0;
+
+        if (feof(csv->chunk_fp) && csv->chunk_ntail == 0) {
+            fclose(csv->chunk_fp);
+            csv->chunk_fp = (FILE *)NULL;
+            return(0);
+        }
+    }
+
+    /* Move the partial line from the previous chunk to the
+     * start of the buffer and append the next chunk to it. */
+
+    nbytes = csv->chunk_ntail;
+
+    if (nbytes && csv->chunk_tail) {
+        memmove(csv->file_data, csv->file_data + csv->chunk_tail, nbytes);
+    }
+
+    for (;;) {
+
+        nalloc = nbytes + chunk_size;
+
+        if (nalloc > (size_t)csv->nbytes_alloced) {
+
+            csv->file_data = (char *)realloc(csv->file_data, (nalloc + 1) * sizeof(char));
+            if (!csv->file_data) {
 
                 ERROR( DSPROC_LIB_NAME,
                     "Memory allocation error loading CSV file: %s\n",
@@ -989,16 +1195,48 @@ int dsproc_load_csv_file(CSVParser *csv, const char *path, const char *name)
 
                 dsproc_set_status(DSPROC_ENOMEM);
 
+                csv->nbytes_alloced = 0;
                 return(-1);
             }
 
-            csv->nlines_alloced = nlines;
+            csv->nbytes_alloced = nalloc;
+        }
+
+        nread = fread(csv->file_data + nbytes, 1, chunk_size, csv->chunk_fp);
+
+        if (ferror(csv->chunk_fp)) {
+
+            ERROR( DSPROC_LIB_NAME,
+                "Could not read CSV file: %s\n"
+                " -> %s\n", csv->file_name, strerror(errno));
+
+            dsproc_set_status(DSPROC_EFILEREAD);
+
+            return(-1);
         }
 
-        csv->lines[li++] = chrp;
+        nbytes += nread;
+        is_last = feof(csv->chunk_fp);
+
+        csv->file_data[nbytes] = '\0';
+
+        if (nbytes == 0) {
+            fclose(csv->chunk_fp);
+            csv->chunk_fp    = (FILE *)NULL;
+            csv->chunk_ntail = 0;
+            return(0);
+        }
+
+        nused = _csv_set_line_pointers(csv, nbytes, is_last);
+        if (nused < 0) return(-1);
+
+        /* Keep reading if a single line is longer than the chunk size */
+
+        if (csv->nlines || is_last) break;
     }
 
-    csv->nlines = li;
+    csv->chunk_tail  = (size_t)nused;
+    csv->chunk_ntail = nbytes - (size_t)nused;
 
     return(csv->nlines);
 }
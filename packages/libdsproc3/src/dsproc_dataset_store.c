@@ -622,6 +622,7 @@ int dsproc_store_dataset(
     size_t      nc_start;
     size_t      count;
     int         si, ei;
+    timeval_t   file_begin;
 
     int         last_errno;
     int         status;
@@ -1178,6 +1179,17 @@ int dsproc_store_dataset(
                 goto ERROR_EXIT;
             }
 
+            /* Update the file time index */
+
+            file_begin = (nc_start) ? dsfile->timevals[0] : out_times[si];
+
+            if (!_dsproc_update_dsdir_index(ds->dir, dsfile->name,
+                (int)(nc_start + count), &file_begin, &out_times[ei],
+                dsproc_get_dataset_version(out_dataset, NULL, NULL, NULL))) {
+
+                goto ERROR_EXIT;
+            }
+
             /* Make sure the file times get reloaded
              * if this file is accessed again */
 
@@ -1199,10 +1211,20 @@ int dsproc_store_dataset(
                 goto ERROR_EXIT;
             }
 
-            /* Make sure the directory listing gets reloaded
-             * if this directory is accessed again */
+            /* Update the file time index */
+
+            if (!_dsproc_update_dsdir_index(ds->dir, file_name,
+                (int)count, &out_times[si], &out_times[ei],
+                dsproc_get_dataset_version(out_dataset, NULL, NULL, NULL))) {
 
-            ds->dir->stats.st_mtime = 0;
+                goto ERROR_EXIT;
+            }
+
+            /* Add new files to the cached directory listing */
+
+            if (!_dsproc_add_dsdir_file(ds->dir, file_name)) {
+                goto ERROR_EXIT;
+            }
         }
 
         /************************************************************
@@ -16,6 +16,13 @@
  *  Datastream Files Functions.
  */
 
+#include <sys/resource.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/vfs.h>
+#endif
+
 #include "dsproc3.h"
 #include "dsproc_private.h"
 
@@ -47,6 +54,17 @@ typedef struct QsortData {
  *  a file name time pattern or function. */
 static QsortData _QsortData;
 
+/** Open file pool shared by all datastream directories. The most recently
+ *  used file is at the head of the list, and files are closed from the tail
+ *  when the pool is full. */
+static DSFile *_OpenFilesHead     = (DSFile *)NULL;
+static DSFile *_OpenFilesTail     = (DSFile *)NULL; /**< least recently used */
+static int     _NumOpenFiles      = 0;  /**< number of files in the pool     */
+static int     _MaxOpenFiles      = 0;  /**< pool size, 0 = not initialized  */
+static int     _OpenFileHits      = 0;  /**< opens of files already open     */
+static int     _OpenFileMisses    = 0;  /**< opens that had to open the file */
+static int     _OpenFileEvictions = 0;  /**< files closed to make room       */
+
 /**
  *  Qsort compare function used to sort files in chronological order.
  *
@@ -83,7 +101,40 @@ static int _dsproc_file_name_compare(
 }
 
 /**
- *  Static: Close all datastream files.
+ *  Static: Remove a file from the open file pool.
+ *
+ *  @param  file - pointer to the DSFile structure.
+ */
+static void _dsproc_unlink_open_dsfile(DSFile *file)
+{
+    if (file->lru_prev) file->lru_prev->lru_next = file->lru_next;
+    else                _OpenFilesHead           = file->lru_next;
+
+    if (file->lru_next) file->lru_next->lru_prev = file->lru_prev;
+    else                _OpenFilesTail           = file->lru_prev;
+
+    file->lru_prev = (DSFile *)NULL;
+    file->lru_next = (DSFile *)NULL;
+}
+
+/**
+ *  Static: Add a file to the head of the open file pool.
+ *
+ *  @param  file - pointer to the DSFile structure.
+ */
+static void _dsproc_push_open_dsfile(DSFile *file)
+{
+    file->lru_prev = (DSFile *)NULL;
+    file->lru_next = _OpenFilesHead;
+
+    if (_OpenFilesHead) _OpenFilesHead->lru_prev = file;
+    else                _OpenFilesTail           = file;
+
+    _OpenFilesHead = file;
+}
+
+/**
+ *  Static: Close a datastream file.
  *
  *  @param  file - pointer to the DSFile structure.
  */
@@ -99,7 +150,34 @@ static void _dsproc_close_dsfile(DSFile *file)
         ncds_close(file->ncid);
         file->ncid  = 0;
         dir->nopen -= 1;
+        _NumOpenFiles -= 1;
+        _dsproc_unlink_open_dsfile(file);
+    }
+}
+
+/**
+ *  Static: Get the default size of the open file pool.
+ *
+ *  This is half of the soft limit on open file descriptors, up to a
+ *  maximum of 256 files.
+ *
+ *  @return  default size of the open file pool
+ */
+static int _dsproc_get_default_max_open_files(void)
+{
+    struct rlimit limit;
+    int           max_open = 256;
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 &&
+        limit.rlim_cur != RLIM_INFINITY &&
+        limit.rlim_cur / 2 < (rlim_t)max_open) {
+
+        max_open = (int)(limit.rlim_cur / 2);
     }
+
+    if (max_open < 8) max_open = 8;
+
+    return(max_open);
 }
 
 /**
@@ -298,6 +376,60 @@ static int _dsproc_find_file_index(
     }
 }
 
+/**
+ *  Static: Find the files in a sorted file list for a specified time range.
+ *
+ *  See _dsproc_find_dsdir_files() for a description of the files returned.
+ *
+ *  @param  dir        - pointer to the DSDir
+ *  @param  nfiles     - number of files in the file list
+ *  @param  files      - sorted file list
+ *  @param  begin_time - beginning of the time range to search
+ *  @param  end_time   - end of the time range to search
+ *  @param  file_list  - output: pointer to the first file in the range
+ *
+ *  @return  the number of files found
+ */
+static int _dsproc_find_files_in_range(
+    DSDir    *dir,
+    int       nfiles,
+    char    **files,
+    time_t    begin_time,
+    time_t    end_time,
+    char   ***file_list)
+{
+    int bi, ei;
+
+    if      (!begin_time) begin_time = end_time;
+    else if (!end_time)   end_time   = begin_time;
+
+    /* Find the indexes of the begin and end files */
+
+    bi = _dsproc_find_file_index(
+        begin_time, 0, nfiles, files, dir->file_name_time);
+
+    ei = _dsproc_find_file_index(
+        end_time,   1, nfiles, files, dir->file_name_time);
+
+    if (bi < 0) bi = 0;
+    if (ei < 0) ei = nfiles - 1;
+
+    /* Return an extra file on both sides to prevent newly created files
+     * containing only header information from hiding existing data in
+     * forward and/or backward searches.
+     */
+
+    if (bi > 0) bi -= 1;
+    if (ei < nfiles - 1) ei += 1;
+
+    /* Output the pointer to the first file and
+     * return the number of files */
+
+    *file_list = &(files[bi]);
+
+    return(ei - bi + 1);
+}
+
 /**
  *  Static: Get the timestamp from an ARM datastream file name.
  *
@@ -370,6 +502,8 @@ static int _dsproc_refresh_dsfile_info(DSFile *dsfile)
     struct stat file_stats;
     int         status;
     int         sync;
+    char       *dod_version;
+    size_t      length;
 
     /* Get file stats */
 
@@ -454,6 +588,35 @@ static int _dsproc_refresh_dsfile_info(DSFile *dsfile)
             dsproc_set_status(DSPROC_ENCREAD);
             return(0);
         }
+
+        /* Update the file time index */
+
+        if (dsfile->dir->use_file_index) {
+
+            dod_version = (char *)NULL;
+
+            length = ncds_get_att_text(
+                dsfile->ncid, NC_GLOBAL, "dod_version", &dod_version);
+
+            if (length == (size_t)-1) {
+                dod_version = (char *)NULL;
+            }
+
+            if (dsfile->ntimes > 0) {
+                status = _dsproc_update_dsdir_index(
+                    dsfile->dir, dsfile->name, dsfile->ntimes,
+                    &(dsfile->timevals[0]),
+                    &(dsfile->timevals[dsfile->ntimes - 1]),
+                    dod_version);
+            }
+            else {
+                status = _dsproc_update_dsdir_index(
+                    dsfile->dir, dsfile->name, 0, NULL, NULL, dod_version);
+            }
+
+            if (dod_version) free(dod_version);
+            if (!status) return(0);
+        }
     }
 
     dsfile->stats = file_stats;
@@ -565,187 +728,1375 @@ static int _dsproc_filter_versioned_files(int nfiles, char **file_list)
     return(i1+1);
 }
 
-/*******************************************************************************
- *  Private Functions Visible Only To This Library
- */
-
 /**
- *  Private: Add new datastream directory file patterns.
- *
- *  This function adds file patterns to look for when creating the list of
- *  files in the datastream directory. By default all files in the directory
- *  will be listed.
- *
- *  If an error occurs in this function it will be appended to the log and
- *  error mail messages, and the process status will be set appropriately.
- *
- *  @param  dir         - pointer to the DSDir structure.
- *  @param  npatterns   - number of file patterns
- *  @param  patterns    - list of extended regex file patterns (man regcomp)
- *  @param  ignore_case - ingnore case in file patterns
+ *  Static: Free all memory used by the file time index of a DSDir.
  *
- *  @return
- *    - 1 if successful
- *    - 0 if an error occurred
+ *  @param  dir - pointer to the DSDir structure.
  */
-int _dsproc_add_dsdir_patterns(
-    DSDir       *dir,
-    int          npatterns,
-    const char **patterns,
-    int          ignore_case)
+static void _dsproc_free_dsdir_index(DSDir *dir)
 {
-    int     cflags = REG_EXTENDED | REG_NOSUB;
-    REList *new_list;
-
-    if (ignore_case) cflags |= REG_ICASE;
+    int ii;
 
-    new_list = relist_compile(dir->patterns, npatterns, patterns, cflags);
-    if (!new_list) {
+    if (dir->index) {
 
-        ERROR( DSPROC_LIB_NAME,
-            "Could not add file pattern(s) for directory: %s\n"
-            " -> regular expression error\n",
-            dir->path);
+        for (ii = 0; ii < dir->nindex; ++ii) {
+            if (dir->index[ii].name)        free(dir->index[ii].name);
+            if (dir->index[ii].dod_version) free(dir->index[ii].dod_version);
+        }
 
-        dsproc_set_status(DSPROC_EREGEX);
-        return(0);
+        free(dir->index);
     }
 
-    dir->patterns       = new_list;
-    dir->stats.st_mtime = 0;
-
-    return(1);
+    dir->index         = (DSFileIndexEntry *)NULL;
+    dir->nindex        = 0;
+    dir->max_index     = 0;
+    dir->index_loaded  = 0;
+    dir->index_changed = 0;
 }
 
 /**
- *  Private: Create a dynamically allocated copy of a file list.
+ *  Static: Find the position of a file in the file time index.
  *
- *  The memory used by the returned file list is dynamically allocated and
- *  and must be freed using the dsproc_free_file_list() function.
- *
- *  @param  nfiles    - number of files
- *  @param  file_list - list of file names
+ *  @param  dir   - pointer to the DSDir structure.
+ *  @param  name  - name of the file
+ *  @param  found - output: 1 if the file is in the index, 0 if it is not.
  *
  *  @return
- *    - dynamically allocated and NULL terminated copy of the file list
- *    - NULL if a memory allocation error occurred
+ *    - index of the entry if found, otherwise the index
+ *      the entry would need to be inserted at
  */
-char **_dsproc_clone_file_list(int nfiles, char **file_list)
+static int _dsproc_search_dsdir_index(DSDir *dir, const char *name, int *found)
 {
-    char **clone;
-    int    fi;
+    int lo = 0;
+    int hi = dir->nindex;
+    int mid;
+    int cmp;
 
-    clone = (char **)calloc(nfiles + 1, sizeof(char *));
-    if (!clone) {
-        return((char **)NULL);
-    }
+    *found = 0;
 
-    for (fi = 0; fi < nfiles; ++fi) {
-        if (!(clone[fi] = strdup(file_list[fi]))) {
-            dsproc_free_file_list(clone);
-            return((char **)NULL);
+    while (lo < hi) {
+
+        mid = (lo + hi) / 2;
+        cmp = strcmp(dir->index[mid].name, name);
+
+        if (cmp == 0) {
+            *found = 1;
+            return(mid);
         }
+
+        if (cmp < 0) lo = mid + 1;
+        else         hi = mid;
     }
 
-    return(clone);
+    return(lo);
 }
 
 /**
- *  Private: Create a new datastream directory structure.
+ *  Static: Add or replace an entry in the file time index.
  *
  *  If an error occurs in this function it will be appended to the log and
  *  error mail messages, and the process status will be set appropriately.
  *
- *  @param  path  - full path to the directory
+ *  @param  dir         - pointer to the DSDir structure.
+ *  @param  name        - name of the file
+ *  @param  stats       - stats of the file
+ *  @param  ntimes      - number of times in the file
+ *  @param  begin       - first time in the file
+ *  @param  end         - last time in the file
+ *  @param  dod_version - DOD version of the file, or NULL
  *
  *  @return
- *    - pointer to the new DSDir structure
- *    - NULL if an error occurred
+ *    - 1 if successful
+ *    - 0 if a memory allocation error occurred
  */
-DSDir *_dsproc_create_dsdir(const char *path)
+static int _dsproc_set_dsdir_index_entry(
+    DSDir       *dir,
+    const char  *name,
+    struct stat *stats,
+    int          ntimes,
+    timeval_t   *begin,
+    timeval_t   *end,
+    const char  *dod_version)
 {
-    DSDir *dir;
+    DSFileIndexEntry *entry;
+    DSFileIndexEntry *new_index;
+    int               new_max;
+    char             *new_version;
+    int               found;
+    int               ii;
+
+    new_version = (char *)NULL;
+
+    if (dod_version && *dod_version) {
+        if (!(new_version = strdup(dod_version))) {
+            goto MEMORY_ERROR;
+        }
+    }
 
-    /* Create the new DSDir */
+    ii = _dsproc_search_dsdir_index(dir, name, &found);
 
-    dir = (DSDir *)calloc(1, sizeof(DSDir));
-    if (!dir) {
-        goto MEMORY_ERROR;
+    if (found) {
+        entry = &(dir->index[ii]);
+        if (entry->dod_version) free(entry->dod_version);
     }
+    else {
 
-    dir->path = strdup(path);
-    if (!dir->path) {
-        goto MEMORY_ERROR;
-    }
+        if (dir->nindex == dir->max_index) {
 
-    /* Initialize the files list */
+            new_max   = (dir->max_index) ? dir->max_index * 2 : 256;
+            new_index = (DSFileIndexEntry *)realloc(
+                dir->index, new_max * sizeof(DSFileIndexEntry));
 
-    dir->max_files = 128;
-    dir->nfiles    = 0;
+            if (!new_index) {
+                goto MEMORY_ERROR;
+            }
 
-    dir->files = (char **)calloc(dir->max_files, sizeof(char *));
-    if (!dir->files) {
-        goto MEMORY_ERROR;
+            dir->index     = new_index;
+            dir->max_index = new_max;
+        }
+
+        if (ii < dir->nindex) {
+            memmove(&(dir->index[ii+1]), &(dir->index[ii]),
+                (dir->nindex - ii) * sizeof(DSFileIndexEntry));
+        }
+
+        entry = &(dir->index[ii]);
+        memset(entry, 0, sizeof(DSFileIndexEntry));
+
+        if (!(entry->name = strdup(name))) {
+
+            memmove(&(dir->index[ii]), &(dir->index[ii+1]),
+                (dir->nindex - ii) * sizeof(DSFileIndexEntry));
+
+            goto MEMORY_ERROR;
+        }
+
+        dir->nindex += 1;
     }
 
-    dir->nopen    = 0;
-    dir->max_open = 64;
+    entry->size       = stats->st_size;
+#ifdef __APPLE__
+    entry->mtime_sec  = stats->st_mtimespec.tv_sec;
+    entry->mtime_nsec = stats->st_mtimespec.tv_nsec;
+#else
+    entry->mtime_sec  = stats->st_mtim.tv_sec;
+    entry->mtime_nsec = stats->st_mtim.tv_nsec;
+#endif
+    entry->ntimes      = ntimes;
+    entry->dod_version = new_version;
 
-    return(dir);
+    if (ntimes > 0) {
+        entry->begin = *begin;
+        entry->end   = *end;
+    }
+    else {
+        memset(&(entry->begin), 0, sizeof(timeval_t));
+        memset(&(entry->end),   0, sizeof(timeval_t));
+    }
+
+    dir->index_changed = 1;
+
+    return(1);
 
 MEMORY_ERROR:
 
-    if (dir) _dsproc_free_dsdir(dir);
+    if (new_version) free(new_version);
 
     ERROR( DSPROC_LIB_NAME,
-        "Could not create DSDir structure for: %s\n"
-        " -> memory allocation error\n", path);
+        "Could not update file time index for: %s/%s\n"
+        " -> memory allocation error\n", dir->path, name);
 
     dsproc_set_status(DSPROC_ENOMEM);
-    return((DSDir *)NULL);
+    return(0);
 }
 
 /**
- *  Private: Free all memory used by a datastream directory structure.
+ *  Static: Load the file time index from the datastream directory.
+ *
+ *  The index file is only read the first time this function is called
+ *  for a DSDir. A missing or unreadable index file is not an error, the
+ *  index will simply be rebuilt as files are opened.
+ *
+ *  If an error occurs in this function it will be appended to the log and
+ *  error mail messages, and the process status will be set appropriately.
  *
  *  @param  dir - pointer to the DSDir structure.
+ *
+ *  @return
+ *    - 1 if successful
+ *    - 0 if a memory allocation error occurred
  */
-void _dsproc_free_dsdir(DSDir *dir)
+static int _dsproc_load_dsdir_index(DSDir *dir)
 {
-    int fi;
+    char        index_file[PATH_MAX];
+    char        line[4096 + 512];
+    char        name[4096];
+    char        version[128];
+    FILE       *fp;
+    struct stat stats;
+    long long   size, mtime_sec, begin_sec, end_sec;
+    long        mtime_nsec, begin_usec, end_usec;
+    int         ntimes;
+    timeval_t   begin, end;
+    int         nscanned;
 
-    if (dir) {
+    if (dir->index_loaded) return(1);
 
-        while (dir->dsf_list) {
-            _dsproc_delete_dsfile(NULL, dir->dsf_list);
-        }
+    dir->index_loaded = 1;
 
-        if (dir->files) {
+    snprintf(index_file, PATH_MAX, "%s/%s", dir->path, DSDIR_INDEX_FILE);
 
-            for (fi = 0; fi < dir->nfiles; fi++) {
-                if (dir->files[fi]) free(dir->files[fi]);
-            }
+    if (!(fp = fopen(index_file, "r"))) {
+        return(1);
+    }
 
-            free(dir->files);
-        }
+    memset(&stats, 0, sizeof(struct stat));
 
-        if (dir->path)     free(dir->path);
-        if (dir->patterns) relist_free(dir->patterns);
+    while (fgets(line, sizeof(line), fp)) {
 
-        if (dir->file_name_time_patterns) {
-            retime_list_free(dir->file_name_time_patterns);
-        }
+        if (line[0] == '#') continue;
 
-        free(dir);
+        nscanned = sscanf(line, "%4095s %lld %lld %ld %d %lld %ld %lld %ld %127s",
+            name, &size, &mtime_sec, &mtime_nsec, &ntimes,
+            &begin_sec, &begin_usec, &end_sec, &end_usec, version);
+
+        if (nscanned != 10 || ntimes < 0) continue;
+
+        stats.st_size  = (off_t)size;
+#ifdef __APPLE__
+        stats.st_mtimespec.tv_sec  = (time_t)mtime_sec;
+        stats.st_mtimespec.tv_nsec = mtime_nsec;
+#else
+        stats.st_mtim.tv_sec  = (time_t)mtime_sec;
+        stats.st_mtim.tv_nsec = mtime_nsec;
+#endif
+        begin.tv_sec  = (time_t)begin_sec;
+        begin.tv_usec = begin_usec;
+        end.tv_sec    = (time_t)end_sec;
+        end.tv_usec   = end_usec;
+
+        if (!_dsproc_set_dsdir_index_entry(dir, name, &stats, ntimes,
+            &begin, &end, (strcmp(version, "-") == 0) ? NULL : version)) {
+
+            fclose(fp);
+            return(0);
+        }
     }
+
+    fclose(fp);
+
+    dir->index_changed = 0;
+
+    DEBUG_LV1( DSPROC_LIB_NAME,
+        "%s: Loaded %d entries from file time index\n",
+        dir->path, dir->nindex);
+
+    return(1);
 }
 
 /**
- *  Private: Find files in a datastream directory for a specified time range.
+ *  Static: Get the file time index entry for a file.
  *
- *  The returned file list will bracket the file with a timestamp just prior
- *  to the begin time, and the file with a timestamp just after the end time.
- *  That is it will return an extra file on either side of the search range.
+ *  The entry is only returned if the size and modification time of the
+ *  file still match the values recorded in the index.
+ *
+ *  @param  dir   - pointer to the DSDir structure.
+ *  @param  name  - name of the file
+ *
+ *  @return
+ *    - pointer to the index entry
+ *    - NULL if the file is not indexed, the entry is out of date,
+ *      or the index is not enabled
+ */
+static DSFileIndexEntry *_dsproc_get_dsdir_index_entry(
+    DSDir      *dir,
+    const char *name)
+{
+    DSFileIndexEntry *entry;
+    struct stat       stats;
+    char              full_path[PATH_MAX];
+    int               found;
+    int               ii;
+
+    if (!dir->use_file_index || !dir->nindex) {
+        return((DSFileIndexEntry *)NULL);
+    }
+
+    ii = _dsproc_search_dsdir_index(dir, name, &found);
+    if (!found) {
+        return((DSFileIndexEntry *)NULL);
+    }
+
+    entry = &(dir->index[ii]);
+
+    snprintf(full_path, PATH_MAX, "%s/%s", dir->path, name);
+
+    if (stat(full_path, &stats) != 0 ||
+        stats.st_size != entry->size ||
+#ifdef __APPLE__
+        stats.st_mtimespec.tv_sec  != entry->mtime_sec ||
+        stats.st_mtimespec.tv_nsec != entry->mtime_nsec) {
+#else
+        stats.st_mtim.tv_sec  != entry->mtime_sec ||
+        stats.st_mtim.tv_nsec != entry->mtime_nsec) {
+#endif
+        return((DSFileIndexEntry *)NULL);
+    }
+
+    return(entry);
+}
+
+/**
+ *  Static: Get the times of a file from the index or the DSFile cache.
+ *
+ *  If the file has a current entry in the file time index the times will
+ *  be taken from the index and the file will not be opened. Otherwise the
+ *  file will be opened using _dsproc_get_dsfile(), which will also add it
+ *  to the index.
+ *
+ *  If an error occurs in this function it will be appended to the log and
+ *  error mail messages, and the process status will be set appropriately.
+ *
+ *  @param  dir    - pointer to the DSDir structure.
+ *  @param  name   - name of the file
+ *  @param  dsfile - output: pointer to the DSFile structure,
+ *                   or NULL if the times were taken from the index.
+ *  @param  begin  - output: first time in the file
+ *  @param  end    - output: last time in the file
+ *
+ *  @return
+ *    -  number of times in the file
+ *    - -1 if an error occurred
+ */
+static int _dsproc_get_dsfile_times(
+    DSDir      *dir,
+    const char *name,
+    DSFile    **dsfile,
+    timeval_t  *begin,
+    timeval_t  *end)
+{
+    DSFileIndexEntry *entry;
+
+    *dsfile = (DSFile *)NULL;
+
+    entry = _dsproc_get_dsdir_index_entry(dir, name);
+    if (entry) {
+        *begin = entry->begin;
+        *end   = entry->end;
+        return(entry->ntimes);
+    }
+
+    *dsfile = _dsproc_get_dsfile(dir, name);
+    if (!*dsfile) {
+        return(-1);
+    }
+
+    if ((*dsfile)->ntimes > 0) {
+        *begin = (*dsfile)->timevals[0];
+        *end   = (*dsfile)->timevals[(*dsfile)->ntimes - 1];
+    }
+
+    return((*dsfile)->ntimes);
+}
+
+/**
+ *  Static: Check if a file name belongs in the file list of a DSDir.
+ *
+ *  @param  dir        - pointer to the DSDir structure.
+ *  @param  name       - name of the file
+ *  @param  versioned  - output: set to 1 if the file has a .v# extension
+ *                       and versioned files are being filtered.
+ *
+ *  @retval  1  if the file matches one of the directory patterns
+ *  @retval  0  if the file does not match
+ *  @retval -1  if a regular expression error occurred
+ */
+static int _dsproc_match_dsdir_file(DSDir *dir, char *name, int *versioned)
+{
+    char *extp;
+    int   status;
+
+    /* Skip dot files and the . and .. directories */
+
+    if (name[0] == '.') {
+        return(0);
+    }
+
+    if (!dir->patterns) {
+        return(1);
+    }
+
+    extp = (char *)NULL;
+
+    if (dir->filter_versioned_files) {
+
+        /* Check for .v# version extension and remove it from the file
+         * name before checking the if the file matches the patterns. */
+        if (_dsproc_get_file_version(name, &extp) >= 0) {
+            *extp = '\0';
+            *versioned = 1;
+        }
+    }
+
+    status = relist_execute(
+        dir->patterns, name, 0, NULL, NULL, NULL, NULL);
+
+    if (extp) {
+        *extp = '.';
+    }
+
+    return(status);
+}
+
+/**
+ *  Static: Get the function used to sort the file list of a DSDir.
+ *
+ *  @param  dir - pointer to the DSDir structure.
+ *
+ *  @return  qsort compare function
+ */
+static int (*_dsproc_get_dsdir_file_compare(DSDir *dir))(const void *, const void *)
+{
+    if (dir->file_name_compare) {
+        /* User specified file_name_compare function */
+        return(dir->file_name_compare);
+    }
+    else if (dir->file_name_time_patterns) {
+        /* User specified file_name_time_patterns */
+        return(_dsproc_file_name_compare);
+    }
+    else if (dir->file_name_time) {
+
+        if (dir->file_name_time == _dsproc_get_ARM_file_name_time) {
+            /* Default for files with standard arm names */
+            return(qsort_strcmp);
+        }
+        else {
+            /* User specified file_name_time function */
+            return(_dsproc_file_name_compare);
+        }
+    }
+    else {
+
+        if ((dir->ds->role == DSR_INPUT) &&
+            (dir->ds->dsc_level[0] == '0')) {
+
+            /* Default for 0-level input raw files */
+            return(qsort_numeric_strcmp);
+        }
+        else {
+            /* Default for files with standard arm names.
+             * We should never get here because in this case the
+             * dir->file_name_time function should have already
+             * been set to _dsproc_get_ARM_file_name_time(). */
+            return(qsort_strcmp);
+        }
+    }
+}
+
+/**
+ *  Static: Find the position of a file in the sorted file list of a DSDir.
+ *
+ *  @param  dir     - pointer to the DSDir structure.
+ *  @param  compare - function used to sort the file list
+ *  @param  name    - name of the file
+ *  @param  found   - output: 1 if the file is in the list, 0 if it is not.
+ *
+ *  @return
+ *    - index of the file if found, otherwise the index
+ *      the file would need to be inserted at
+ */
+static int _dsproc_search_dsdir_files(
+    DSDir       *dir,
+    int        (*compare)(const void *, const void *),
+    const char  *name,
+    int         *found)
+{
+    int lo = 0;
+    int hi = dir->nfiles;
+    int mid;
+    int fi;
+
+    *found = 0;
+
+    _QsortData.dir = dir;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (compare(&(dir->files[mid]), &name) < 0) lo = mid + 1;
+        else                                          hi = mid;
+    }
+
+    for (fi = lo; fi < dir->nfiles; ++fi) {
+
+        if (compare(&(dir->files[fi]), &name) != 0) break;
+
+        if (strcmp(dir->files[fi], name) == 0) {
+            *found = 1;
+            lo = fi;
+            break;
+        }
+    }
+
+    _QsortData.dir = (DSDir *)NULL;
+
+    return(lo);
+}
+
+/**
+ *  Static: Insert a file into the sorted file list of a DSDir.
+ *
+ *  If an error occurs in this function it will be appended to the log and
+ *  error mail messages, and the process status will be set appropriately.
+ *
+ *  @param  dir     - pointer to the DSDir structure.
+ *  @param  compare - function used to sort the file list
+ *  @param  name    - name of the file
+ *
+ *  @return
+ *    - 1 if successful or the file was already in the list
+ *    - 0 if a memory allocation error occurred
+ */
+static int _dsproc_insert_dsdir_file(
+    DSDir       *dir,
+    int        (*compare)(const void *, const void *),
+    const char  *name)
+{
+    char  **new_list;
+    size_t  new_size;
+    char   *new_name;
+    int     found;
+    int     fi;
+
+    fi = _dsproc_search_dsdir_files(dir, compare, name, &found);
+    if (found) {
+        return(1);
+    }
+
+    /* Check if we need to increase the length of the file list */
+
+    if (dir->nfiles == dir->max_files - 1) {
+
+        new_size = dir->max_files * 2;
+        new_list = (char **)realloc(
+            dir->files, new_size * sizeof(char *));
+
+        if (!new_list) {
+            goto MEMORY_ERROR;
+        }
+
+        memset(&(new_list[dir->max_files]), 0,
+            (new_size - dir->max_files) * sizeof(char *));
+
+        dir->max_files = new_size;
+        dir->files     = new_list;
+    }
+
+    if (!(new_name = strdup(name))) {
+        goto MEMORY_ERROR;
+    }
+
+    /* The unused slot at the end of the list may still hold a name */
+
+    if (dir->files[dir->nfiles]) {
+        free(dir->files[dir->nfiles]);
+    }
+
+    memmove(&(dir->files[fi+1]), &(dir->files[fi]),
+        (dir->nfiles - fi) * sizeof(char *));
+
+    dir->files[fi] = new_name;
+    dir->nfiles++;
+
+    return(1);
+
+MEMORY_ERROR:
+
+    ERROR( DSPROC_LIB_NAME,
+        "Could not get directory listing for: %s\n"
+        " -> memory allocation error\n",
+        dir->path);
+
+    dsproc_set_status(DSPROC_ENOMEM);
+    return(0);
+}
+
+/**
+ *  Static: Remove a file from the sorted file list of a DSDir.
+ *
+ *  @param  dir     - pointer to the DSDir structure.
+ *  @param  compare - function used to sort the file list
+ *  @param  name    - name of the file
+ */
+static void _dsproc_remove_dsdir_file(
+    DSDir       *dir,
+    int        (*compare)(const void *, const void *),
+    const char  *name)
+{
+    int   found;
+    int   fi;
+
+    fi = _dsproc_search_dsdir_files(dir, compare, name, &found);
+    if (!found) {
+        return;
+    }
+
+    free(dir->files[fi]);
+
+    memmove(&(dir->files[fi]), &(dir->files[fi+1]),
+        (dir->nfiles - fi - 1) * sizeof(char *));
+
+    dir->nfiles--;
+    dir->files[dir->nfiles] = (char *)NULL;
+}
+
+/**
+ *  Static: Clear the cached file list of a DSDir.
+ *
+ *  The list itself is kept allocated, but all the names are freed so the
+ *  next listing will evaluate every file in the directory again.
+ *
+ *  @param  dir - pointer to the DSDir structure.
+ */
+static void _dsproc_clear_dsdir_files(DSDir *dir)
+{
+    int fi;
+
+    for (fi = 0; fi < dir->max_files; ++fi) {
+        if (dir->files[fi]) {
+            free(dir->files[fi]);
+            dir->files[fi] = (char *)NULL;
+        }
+    }
+
+    dir->nfiles         = 0;
+    dir->found_versions = 0;
+    dir->stats.st_mtime = 0;
+}
+
+/**
+ *  Static: Hash a file name for the cached file list lookup table.
+ *
+ *  @param  name - name of the file
+ *
+ *  @return  hash value
+ */
+static unsigned int _dsproc_hash_file_name(const char *name)
+{
+    unsigned int hash = 5381;
+
+    while (*name) {
+        hash = ((hash << 5) + hash) + (unsigned char)*name++;
+    }
+
+    return(hash);
+}
+
+/**
+ *  Static: Create a lookup table for the names in the cached file list.
+ *
+ *  The table uses open addressing with linear probing and stores the
+ *  index of each name in the file list, or -1 for empty slots.
+ *
+ *  @param  dir    - pointer to the DSDir structure.
+ *  @param  nslots - output: number of slots in the table (a power of 2)
+ *
+ *  @return
+ *    - pointer to the lookup table
+ *    - NULL if the file list is empty or a memory allocation error occurred
+ */
+static int *_dsproc_create_dsdir_lookup(DSDir *dir, int *nslots)
+{
+    int          *slots;
+    unsigned int  mask;
+    unsigned int  si;
+    int           fi;
+
+    *nslots = 0;
+
+    if (dir->nfiles == 0) {
+        return((int *)NULL);
+    }
+
+    for (*nslots = 16; *nslots < dir->nfiles * 2; *nslots *= 2);
+
+    slots = (int *)malloc(*nslots * sizeof(int));
+    if (!slots) {
+        *nslots = 0;
+        return((int *)NULL);
+    }
+
+    memset(slots, 0xff, *nslots * sizeof(int));
+
+    mask = (unsigned int)*nslots - 1;
+
+    for (fi = 0; fi < dir->nfiles; ++fi) {
+
+        si = _dsproc_hash_file_name(dir->files[fi]) & mask;
+        while (slots[si] >= 0) si = (si + 1) & mask;
+
+        slots[si] = fi;
+    }
+
+    return(slots);
+}
+
+/**
+ *  Static: Merge newly found files into the cached file list.
+ *
+ *  Files in the cached list that were not seen in the directory are
+ *  removed, and the new files are sorted and merged into the list.
+ *
+ *  If an error occurs in this function it will be appended to the log and
+ *  error mail messages, and the process status will be set appropriately.
+ *
+ *  @param  dir      - pointer to the DSDir structure.
+ *  @param  seen     - flags indicating the cached files that still exist
+ *  @param  nadded   - number of new files
+ *  @param  added    - list of new files, ownership of the names
+ *                     is transferred to the DSDir file list
+ *  @param  presort  - sort the new files before merging them into the list,
+ *                     if 0 they will simply be appended to the list
+ *
+ *  @return
+ *    - 1 if successful
+ *    - 0 if an error occurred
+ */
+static int _dsproc_merge_dsdir_files(
+    DSDir  *dir,
+    char   *seen,
+    int     nadded,
+    char  **added,
+    int     presort)
+{
+    int    (*compare)(const void *, const void *);
+    char   **new_list;
+    size_t   new_size;
+    int      nkept;
+    int      ntotal;
+    int      fi, ai, wi;
+    int      err_count;
+
+    /* Remove files that no longer exist */
+
+    nkept = 0;
+
+    for (fi = 0; fi < dir->nfiles; ++fi) {
+        if (seen[fi]) {
+            dir->files[nkept++] = dir->files[fi];
+        }
+        else {
+            free(dir->files[fi]);
+        }
+    }
+
+    for (fi = nkept; fi < dir->nfiles; ++fi) {
+        dir->files[fi] = (char *)NULL;
+    }
+
+    dir->nfiles = nkept;
+
+    /* Make sure the list is long enough for the new files */
+
+    ntotal = nkept + nadded;
+
+    if (ntotal >= dir->max_files) {
+
+        for (new_size = dir->max_files * 2;
+             (int)new_size <= ntotal;
+             new_size *= 2);
+
+        new_list = (char **)realloc(dir->files, new_size * sizeof(char *));
+        if (!new_list) {
+
+            for (ai = 0; ai < nadded; ++ai) {
+                free(added[ai]);
+            }
+
+            ERROR( DSPROC_LIB_NAME,
+                "Could not get directory listing for: %s\n"
+                " -> memory allocation error\n",
+                dir->path);
+
+            dsproc_set_status(DSPROC_ENOMEM);
+            return(0);
+        }
+
+        for (fi = dir->max_files; fi < (int)new_size; ++fi) {
+            new_list[fi] = (char *)NULL;
+        }
+
+        dir->max_files = new_size;
+        dir->files     = new_list;
+    }
+
+    for (fi = nkept; fi < ntotal; ++fi) {
+        if (dir->files[fi]) {
+            free(dir->files[fi]);
+            dir->files[fi] = (char *)NULL;
+        }
+    }
+
+    if (!presort) {
+
+        for (ai = 0; ai < nadded; ++ai) {
+            dir->files[nkept + ai] = added[ai];
+        }
+
+        dir->nfiles = ntotal;
+        return(1);
+    }
+
+    /* Sort the new files and merge them in from the end of the list */
+
+    compare = _dsproc_get_dsdir_file_compare(dir);
+
+    _QsortData.dir = dir;
+    _QsortData.err_count = 0;
+
+    qsort(added, nadded, sizeof(char *), compare);
+
+    fi = nkept  - 1;
+    ai = nadded - 1;
+
+    for (wi = ntotal - 1; ai >= 0; --wi) {
+
+        if (fi >= 0 && compare(&(dir->files[fi]), &(added[ai])) > 0) {
+            dir->files[wi] = dir->files[fi--];
+        }
+        else {
+            dir->files[wi] = added[ai--];
+        }
+    }
+
+    err_count = _QsortData.err_count;
+
+    _QsortData.dir = (DSDir *)NULL;
+    _QsortData.err_count = 0;
+
+    dir->nfiles = ntotal;
+
+    if (err_count) {
+
+        ERROR( DSPROC_LIB_NAME,
+            "Could not sort file list for %s datastream '%s'\n"
+            " -> could not get time for one or more file names\n",
+            _dsproc_dsrole_to_name(dir->ds->role), dir->ds->name);
+
+        dsproc_set_status("Could Not Sort File List");
+
+        return(0);
+    }
+
+    return(1);
+}
+
+#ifdef __linux__
+
+/**
+ *  Static: Check if a file system can be modified by other hosts.
+ *
+ *  @param  fs - file system stats returned by statfs()
+ *
+ *  @return
+ *    - 1 if this is a network or cluster file system
+ *    - 0 otherwise
+ */
+static int _dsproc_is_network_fs(const struct statfs *fs)
+{
+    switch ((unsigned int)fs->f_type) {
+        case 0x00006969: /* NFS    */
+        case 0x0000517B: /* SMB    */
+        case 0xFF534D42: /* CIFS   */
+        case 0xFE534D42: /* SMB2   */
+        case 0x0BD00BD0: /* Lustre */
+        case 0x47504653: /* GPFS   */
+        case 0x01021997: /* 9P     */
+        case 0x6B414653: /* AFS    */
+        case 0x00C36400: /* Ceph   */
+            return(1);
+        default:
+            break;
+    }
+
+    return(0);
+}
+
+/**
+ *  Static: Start watching a datastream directory for new files.
+ *
+ *  In real time mode an inotify watch is used to keep the file list of
+ *  the DSDir up to date, instead of rereading the entire directory every
+ *  time it is modified. Failing to create the watch is not an error, the
+ *  directory will just be rescanned when its modification time changes.
+ *
+ *  Directories on network file systems are not watched because changes
+ *  made by other hosts do not generate any events.
+ *
+ *  @param  dir - pointer to the DSDir structure.
+ */
+static void _dsproc_watch_dsdir(DSDir *dir)
+{
+    struct statfs fs;
+
+    if (dir->watch_fd >= 0 || dir->watch_failed ||
+        !dsproc_get_real_time_mode()) {
+
+        return;
+    }
+
+    if (statfs(dir->path, &fs) == 0 && _dsproc_is_network_fs(&fs)) {
+
+        DEBUG_LV1( DSPROC_LIB_NAME,
+            "%s: Not watching directory on network file system\n",
+            dir->path);
+
+        dir->watch_failed = 1;
+        return;
+    }
+
+    dir->watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (dir->watch_fd < 0) {
+        goto WATCH_ERROR;
+    }
+
+    if (inotify_add_watch(dir->watch_fd, dir->path,
+        IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+        IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR) < 0) {
+
+        goto WATCH_ERROR;
+    }
+
+    DEBUG_LV1( DSPROC_LIB_NAME,
+        "%s: Watching directory for new files\n", dir->path);
+
+    return;
+
+WATCH_ERROR:
+
+    DEBUG_LV1( DSPROC_LIB_NAME,
+        "%s: Could not watch directory for new files\n"
+        " -> %s\n", dir->path, strerror(errno));
+
+    if (dir->watch_fd >= 0) {
+        close(dir->watch_fd);
+        dir->watch_fd = -1;
+    }
+
+    dir->watch_failed = 1;
+}
+
+/**
+ *  Static: Apply pending inotify events to the file list of a DSDir.
+ *
+ *  Files that were created, written, linked, or moved into the directory
+ *  are inserted into the sorted file list, and files that were removed
+ *  are deleted from it. Events for files that do not match the file
+ *  patterns are ignored. If an event can not be applied incrementally
+ *  (queue overflow, the directory itself was moved or deleted, or a
+ *  versioned file needs to be filtered) the directory stats are reset so
+ *  the next listing will rescan the directory.
+ *
+ *  If nfs_time is set, new files with mod times greater than or equal to
+ *  it are left for the directory scan, which skips them the same way.
+ *
+ *  If an error occurs in this function it will be appended to the log and
+ *  error mail messages, and the process status will be set appropriately.
+ *
+ *  @param  dir      - pointer to the DSDir structure.
+ *  @param  nfs_time - file system time to skip new files at,
+ *                     or 0 to not check the file mod times
+ *
+ *  @retval  1  if the file list was updated
+ *  @retval  0  if there were no matching events, or the directory needs
+ *              to be rescanned
+ *  @retval -1  if an error occurred
+ */
+static int _dsproc_read_dsdir_events(DSDir *dir, const timeval_t *nfs_time)
+{
+    char buffer[4096]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+    const struct inotify_event *event;
+    int    (*compare)(const void *, const void *);
+    ssize_t  length;
+    char    *bp;
+    int      rescan;
+    int      deferred;
+    int      napplied;
+    int      versioned;
+    int      status;
+    timeval_t mod_time;
+    char     full_path[PATH_MAX];
+
+    compare  = _dsproc_get_dsdir_file_compare(dir);
+    rescan   = 0;
+    deferred = 0;
+    napplied = 0;
+
+    for (;;) {
+
+        length = read(dir->watch_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+
+            if (length < 0 && errno != EAGAIN && errno != EINTR) {
+                rescan = 1;
+            }
+
+            break;
+        }
+
+        for (bp = buffer; bp < buffer + length;
+             bp += sizeof(struct inotify_event) + event->len) {
+
+            event = (const struct inotify_event *)bp;
+
+            if (event->mask & (IN_Q_OVERFLOW | IN_IGNORED |
+                               IN_DELETE_SELF | IN_MOVE_SELF)) {
+                rescan = 1;
+                continue;
+            }
+
+            if (rescan || !event->len || (event->mask & IN_ISDIR)) {
+                continue;
+            }
+
+            versioned = 0;
+            status = _dsproc_match_dsdir_file(
+                dir, (char *)event->name, &versioned);
+
+            if (status == 0) {
+                continue;
+            }
+
+            if (status < 0) {
+
+                ERROR( DSPROC_LIB_NAME,
+                    "Could not get directory listing for: %s\n"
+                    " -> regular expression error\n",
+                    dir->path);
+
+                dsproc_set_status(DSPROC_EDIRLIST);
+                return(-1);
+            }
+
+            /* Versioned files need to be filtered against the full list */
+
+            if (versioned || dir->found_versions) {
+                rescan = 1;
+                continue;
+            }
+
+            /* Files hard linked into the directory
+             * only generate an IN_CREATE event */
+
+            if (event->mask & (IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO)) {
+
+                if (nfs_time->tv_sec) {
+
+                    snprintf(full_path, PATH_MAX, "%s/%s",
+                        dir->path, event->name);
+
+                    if (!file_mod_time(full_path, &mod_time)) {
+                        dsproc_set_status(DSPROC_EFILESTATS);
+                        return(-1);
+                    }
+
+                    if (TV_GTEQ(mod_time, *nfs_time)) {
+                        deferred = 1;
+                        continue;
+                    }
+                }
+
+                if (!_dsproc_insert_dsdir_file(dir, compare, event->name)) {
+                    return(-1);
+                }
+            }
+            else {
+                _dsproc_remove_dsdir_file(dir, compare, event->name);
+            }
+
+            napplied++;
+        }
+    }
+
+    if (rescan) {
+
+        close(dir->watch_fd);
+        dir->watch_fd       = -1;
+        dir->stats.st_mtime = 0;
+
+        return(0);
+    }
+
+    /* Leave deferred files to the mod time check and directory scan */
+
+    if (deferred) {
+        return(0);
+    }
+
+    return((napplied) ? 1 : 0);
+}
+
+#endif /* __linux__ */
+
+/*******************************************************************************
+ *  Private Functions Visible Only To This Library
+ */
+
+/**
+ *  Private: Add a file created by the current process to a DSDir file list.
+ *
+ *  This keeps the cached file list current without forcing the directory
+ *  to be read again, and without closing the directory watch. The file is
+ *  not added if the file list has not been loaded yet, or if it does not
+ *  match the directory patterns. If versioned files need to be filtered
+ *  the next listing will read the directory again.
+ *
+ *  If an error occurs in this function it will be appended to the log and
+ *  error mail messages, and the process status will be set appropriately.
+ *
+ *  @param  dir  - pointer to the DSDir structure.
+ *  @param  name - name of the file
+ *
+ *  @return
+ *    - 1 if successful
+ *    - 0 if an error occurred
+ */
+int _dsproc_add_dsdir_file(DSDir *dir, const char *name)
+{
+    char  file_name[PATH_MAX];
+    int   versioned;
+    int   status;
+
+    if (!dir->stats.st_mtime || dir->resort) {
+        return(1);
+    }
+
+    strncpy(file_name, name, PATH_MAX - 1);
+    file_name[PATH_MAX - 1] = '\0';
+
+    versioned = 0;
+    status    = _dsproc_match_dsdir_file(dir, file_name, &versioned);
+
+    if (status == 0) {
+        return(1);
+    }
+
+    if (status < 0) {
+
+        ERROR( DSPROC_LIB_NAME,
+            "Could not get directory listing for: %s\n"
+            " -> regular expression error\n",
+            dir->path);
+
+        dsproc_set_status(DSPROC_EDIRLIST);
+        return(0);
+    }
+
+    /* Versioned files need to be filtered against the full list */
+
+    if (versioned || dir->found_versions) {
+        dir->stats.st_mtime = 0;
+        return(1);
+    }
+
+    return(_dsproc_insert_dsdir_file(
+        dir, _dsproc_get_dsdir_file_compare(dir), file_name));
+}
+
+/**
+ *  Private: Add new datastream directory file patterns.
+ *
+ *  This function adds file patterns to look for when creating the list of
+ *  files in the datastream directory. By default all files in the directory
+ *  will be listed.
+ *
+ *  If an error occurs in this function it will be appended to the log and
+ *  error mail messages, and the process status will be set appropriately.
+ *
+ *  @param  dir         - pointer to the DSDir structure.
+ *  @param  npatterns   - number of file patterns
+ *  @param  patterns    - list of extended regex file patterns (man regcomp)
+ *  @param  ignore_case - ingnore case in file patterns
+ *
+ *  @return
+ *    - 1 if successful
+ *    - 0 if an error occurred
+ */
+int _dsproc_add_dsdir_patterns(
+    DSDir       *dir,
+    int          npatterns,
+    const char **patterns,
+    int          ignore_case)
+{
+    int     cflags = REG_EXTENDED | REG_NOSUB;
+    REList *new_list;
+
+    if (ignore_case) cflags |= REG_ICASE;
+
+    new_list = relist_compile(dir->patterns, npatterns, patterns, cflags);
+    if (!new_list) {
+
+        ERROR( DSPROC_LIB_NAME,
+            "Could not add file pattern(s) for directory: %s\n"
+            " -> regular expression error\n",
+            dir->path);
+
+        dsproc_set_status(DSPROC_EREGEX);
+        return(0);
+    }
+
+    dir->patterns = new_list;
+
+    /* Names already in the cached file list were only matched against the
+     * old patterns, so the whole list has to be rebuilt */
+
+    _dsproc_clear_dsdir_files(dir);
+
+    return(1);
+}
+
+/**
+ *  Private: Create a dynamically allocated copy of a file list.
+ *
+ *  The memory used by the returned file list is dynamically allocated and
+ *  and must be freed using the dsproc_free_file_list() function.
+ *
+ *  @param  nfiles    - number of files
+ *  @param  file_list - list of file names
+ *
+ *  @return
+ *    - dynamically allocated and NULL terminated copy of the file list
+ *    - NULL if a memory allocation error occurred
+ */
+char **_dsproc_clone_file_list(int nfiles, char **file_list)
+{
+    char **clone;
+    int    fi;
+
+    clone = (char **)calloc(nfiles + 1, sizeof(char *));
+    if (!clone) {
+        return((char **)NULL);
+    }
+
+    for (fi = 0; fi < nfiles; ++fi) {
+        if (!(clone[fi] = strdup(file_list[fi]))) {
+            dsproc_free_file_list(clone);
+            return((char **)NULL);
+        }
+    }
+
+    return(clone);
+}
+
+/**
+ *  Private: Create a new datastream directory structure.
+ *
+ *  If an error occurs in this function it will be appended to the log and
+ *  error mail messages, and the process status will be set appropriately.
+ *
+ *  @param  path  - full path to the directory
+ *
+ *  @return
+ *    - pointer to the new DSDir structure
+ *    - NULL if an error occurred
+ */
+DSDir *_dsproc_create_dsdir(const char *path)
+{
+    DSDir *dir;
+
+    /* Create the new DSDir */
+
+    dir = (DSDir *)calloc(1, sizeof(DSDir));
+    if (!dir) {
+        goto MEMORY_ERROR;
+    }
+
+    dir->path = strdup(path);
+    if (!dir->path) {
+        goto MEMORY_ERROR;
+    }
+
+    /* Initialize the files list */
+
+    dir->max_files = 128;
+    dir->nfiles    = 0;
+
+    dir->files = (char **)calloc(dir->max_files, sizeof(char *));
+    if (!dir->files) {
+        goto MEMORY_ERROR;
+    }
+
+    dir->nopen    = 0;
+    dir->max_open = 0;
+
+    dir->watch_fd = -1;
+
+    return(dir);
+
+MEMORY_ERROR:
+
+    if (dir) _dsproc_free_dsdir(dir);
+
+    ERROR( DSPROC_LIB_NAME,
+        "Could not create DSDir structure for: %s\n"
+        " -> memory allocation error\n", path);
+
+    dsproc_set_status(DSPROC_ENOMEM);
+    return((DSDir *)NULL);
+}
+
+/**
+ *  Private: Free all memory used by a datastream directory structure.
+ *
+ *  @param  dir - pointer to the DSDir structure.
+ */
+void _dsproc_free_dsdir(DSDir *dir)
+{
+    int fi;
+
+    if (dir) {
+
+        while (dir->dsf_list) {
+            _dsproc_delete_dsfile(NULL, dir->dsf_list);
+        }
+
+        if (dir->files) {
+
+            for (fi = 0; fi < dir->nfiles; fi++) {
+                if (dir->files[fi]) free(dir->files[fi]);
+            }
+
+            free(dir->files);
+        }
+
+        if (dir->index) {
+            _dsproc_save_dsdir_index(dir);
+            _dsproc_free_dsdir_index(dir);
+        }
+
+        if (dir->watch_fd >= 0) {
+            close(dir->watch_fd);
+        }
+
+        if (dir->path)     free(dir->path);
+        if (dir->patterns) relist_free(dir->patterns);
+
+        if (dir->file_name_time_patterns) {
+            retime_list_free(dir->file_name_time_patterns);
+        }
+
+        free(dir);
+    }
+}
+
+/**
+ *  Private: Find files in a datastream directory for a specified time range.
+ *
+ *  The returned file list will bracket the file with a timestamp just prior
+ *  to the begin time, and the file with a timestamp just after the end time.
+ *  That is it will return an extra file on either side of the search range.
  *  This is done to prevent newly created files containing only header
  *  information from hiding existing data in forward and/or backward searches.
  *
@@ -769,7 +2120,6 @@ int _dsproc_find_dsdir_files(
 {
     int      nfiles;
     char   **files;
-    int      bi, ei;
 
     /* Initialize variables */
 
@@ -777,38 +2127,47 @@ int _dsproc_find_dsdir_files(
 
     if (!begin_time && !end_time) return(0);
 
-    if      (!begin_time) begin_time = end_time;
-    else if (!end_time)   end_time   = begin_time;
-
-    /* Get the file list and find the indexes of the begin and end files */
+    /* Get the file list */
 
     nfiles = _dsproc_get_dsdir_files(dir, &files);
 
-    if (!nfiles) return(0);
-
-    bi = _dsproc_find_file_index(
-        begin_time, 0, nfiles, files, dir->file_name_time);
-
-    ei = _dsproc_find_file_index(
-        end_time,   1, nfiles, files, dir->file_name_time);
-
-    if (bi < 0) bi = 0;
-    if (ei < 0) ei = nfiles - 1;
+    if (nfiles <= 0) return(nfiles);
 
-    /* Return an extra file on both sides to prevent newly created files
-     * containing only header information from hiding existing data in
-     * forward and/or backward searches.
-     */
+    return(_dsproc_find_files_in_range(
+        dir, nfiles, files, begin_time, end_time, file_list));
+}
 
-    if (bi > 0) bi -= 1;
-    if (ei < nfiles - 1) ei += 1;
+/**
+ *  Private: Find files in the cached file list of a datastream directory.
+ *
+ *  This function is the same as _dsproc_find_dsdir_files() except that it
+ *  only searches the file list from the last time the directory was read.
+ *  It never reads the directory, so it can not fail and does not log any
+ *  messages, but files created since the last listing will not be found.
+ *
+ *  @param  dir        - pointer to the DSDir
+ *  @param  begin_time - beginning of the time range to search
+ *  @param  end_time   - end of the time range to search
+ *  @param  file_list  - output: pointer to the first file in the internal
+ *                       file list maintained by the DSDir structure.
+ *
+ *  @retval nfiles  the number of files found, or 0 if the directory
+ *                  has not been read or the file list needs to be sorted
+ */
+int _dsproc_find_cached_dsdir_files(
+    DSDir    *dir,
+    time_t    begin_time,
+    time_t    end_time,
+    char   ***file_list)
+{
+    *file_list = ((char **)NULL);
 
-    /* Output the pointer to the first file and
-     * return the number of files */
+    if (!begin_time && !end_time) return(0);
 
-    *file_list = &(files[bi]);
+    if (!dir->stats.st_mtime || dir->resort || !dir->nfiles) return(0);
 
-    return(ei - bi + 1);
+    return(_dsproc_find_files_in_range(
+        dir, dir->nfiles, dir->files, begin_time, end_time, file_list));
 }
 
 /**
@@ -856,6 +2215,8 @@ int _dsproc_find_dsfiles(
     DSFile    *dsfile;
     timeval_t  file_begin;
     timeval_t  file_end;
+    int        ntimes;
+    int        last_fi;
     int        fi;
 
     /* Initialize variables */
@@ -895,60 +2256,93 @@ int _dsproc_find_dsfiles(
         return(-1);
     }
 
-    /* Loop over all files and return the ones in the requested range */
+    /* Loop over all files and return the ones in the requested range.
+     * When the file time index is enabled the file times are taken from
+     * the index and only the files that are selected get opened. */
+
+    if (dir->use_file_index && !_dsproc_load_dsdir_index(dir)) {
+        free(dsfiles);
+        return(-1);
+    }
 
     ndsfiles = 0;
+    last_fi  = -1;
 
     for (fi = 0; fi < nfiles; fi++) {
 
-        dsfile = _dsproc_get_dsfile(dir, files[fi]);
-        if (!dsfile) {
+        ntimes = _dsproc_get_dsfile_times(
+            dir, files[fi], &dsfile, &file_begin, &file_end);
+
+        if (ntimes < 0) {
             free(dsfiles);
             return(-1);
         }
 
-        if (dsfile->ntimes == 0) {
+        if (ntimes == 0) {
             continue;
         }
 
-        file_begin = dsfile->timevals[0];
-        file_end   = dsfile->timevals[dsfile->ntimes - 1];
-
         if (!begin_timeval || !begin_timeval->tv_sec) {
 
             /* We want the last file containing data prior to the end_timeval */
 
             if (TV_LT(file_begin, *end_timeval)) {
-                dsfiles[0] = dsfile;
-                ndsfiles   = 1;
+                last_fi = fi;
             }
             else {
                 break;
             }
+
+            continue;
+        }
+
+        if (!end_timeval || !end_timeval->tv_sec) {
+
+            /* We want the first file containing data after the begin_timeval */
+
+            if (!TV_GT(file_end, *begin_timeval)) {
+                continue;
+            }
+        }
+        else {
+
+            /* We want all files that contain data for the specified range */
+
+            if (TV_GT(file_begin, *end_timeval) ||
+                TV_LT(file_end,   *begin_timeval)) {
+
+                continue;
+            }
+        }
+
+        if (!dsfile) {
+            dsfile = _dsproc_get_dsfile(dir, files[fi]);
+            if (!dsfile) {
+                free(dsfiles);
+                return(-1);
+            }
         }
-        else if (!end_timeval || !end_timeval->tv_sec) {
 
-            /* We want the first file containing data after the begin_timeval */
+        dsfiles[ndsfiles] = dsfile;
+        ndsfiles++;
 
-            if (TV_GT(file_end, *begin_timeval)) {
-                dsfiles[0] = dsfile;
-                ndsfiles   = 1;
-                break;
-            }
+        if (!end_timeval || !end_timeval->tv_sec) {
+            break;
         }
-        else {
 
-            /* We want all files that contain data for the specified range */
+    } /* end loop over file names */
 
-            if (!TV_GT(file_begin, *end_timeval) &&
-                !TV_LT(file_end,   *begin_timeval)) {
+    if (last_fi >= 0) {
 
-                dsfiles[ndsfiles] = dsfile;
-                ndsfiles++;
-            }
+        dsfile = _dsproc_get_dsfile(dir, files[last_fi]);
+        if (!dsfile) {
+            free(dsfiles);
+            return(-1);
         }
 
-    } /* end loop over file names */
+        dsfiles[0] = dsfile;
+        ndsfiles   = 1;
+    }
 
     if (ndsfiles) {
         *dsfile_list = dsfiles;
@@ -983,6 +2377,8 @@ int _dsproc_find_next_dsfile(
     int        nfiles;
     char     **files;
     timeval_t  file_begin;
+    timeval_t  file_end;
+    int        ntimes;
     int        fi;
 
     /* Initialize variables */
@@ -1008,24 +2404,36 @@ int _dsproc_find_next_dsfile(
     /* Loop over all files and return the one that starts after
      * the specified start time. */
 
+    if (dir->use_file_index && !_dsproc_load_dsdir_index(dir)) {
+        return(-1);
+    }
+
     for (fi = 0; fi < nfiles; fi++) {
 
-        *dsfile = _dsproc_get_dsfile(dir, files[fi]);
-        if (!*dsfile) {
+        ntimes = _dsproc_get_dsfile_times(
+            dir, files[fi], dsfile, &file_begin, &file_end);
+
+        if (ntimes < 0) {
             return(-1);
         }
 
-        if ((*dsfile)->ntimes == 0) {
+        if (ntimes == 0) {
             *dsfile = (DSFile  *)NULL;
             continue;
         }
 
-        file_begin = (*dsfile)->timevals[0];
-
         /* We want the first file with a start time
         *  on or after the search start time */
 
         if (TV_GTEQ(file_begin, *search_start)) {
+
+            if (!*dsfile) {
+                *dsfile = _dsproc_get_dsfile(dir, files[fi]);
+                if (!*dsfile) {
+                    return(-1);
+                }
+            }
+
             return(1);
         }
 
@@ -1054,16 +2462,26 @@ int _dsproc_find_next_dsfile(
 int _dsproc_get_dsdir_files(DSDir *dir, char ***files)
 {
     struct stat     dir_stats;
-    DIR            *dirp;
+    DIR            *dirp      = (DIR *)NULL;
     struct dirent  *direntp;
     char          **new_list;
     size_t          new_size;
     int             status;
-    char           *extp;
     int             found_version;
     int             fi;
     int             err_count;
 
+    int            *slots     = (int *)NULL;
+    int             nslots;
+    unsigned int    mask;
+    unsigned int    si;
+    char           *seen      = (char *)NULL;
+    char          **added     = (char **)NULL;
+    int             nadded    = 0;
+    int             max_added = 0;
+    int             nlisted;
+    int             nevaluated;
+
     DataStream     *ds = dir->ds;
     timeval_t       nfs_time = { 0, 0 };
     timeval_t       mod_time;
@@ -1105,6 +2523,51 @@ int _dsproc_get_dsdir_files(DSDir *dir, char ***files)
         return(-1);
     }
 
+#ifdef __linux__
+
+    /* Apply any changes reported by the directory watch. Directories on
+     * network file systems are never watched, so everything that changed
+     * a watched directory has generated an event. The mod time check below
+     * is still done when no matching events were received.
+     *
+     * If the cached file list was invalidated (file patterns or sort order
+     * changed) it is rebuilt by the directory scan below, which also
+     * restarts the watch. */
+
+    if (dir->watch_fd >= 0) {
+
+        if (dir->stats.st_mtime == 0 || dir->resort) {
+
+            close(dir->watch_fd);
+            dir->watch_fd = -1;
+        }
+        else {
+
+            /* The local time is the file system time for a watched
+             * directory (see the comment below where nfs_time is set) */
+
+            if (ds->dsc_level[0] == '0' && ds->role == DSR_INPUT) {
+                gettimeofday(&nfs_time, NULL);
+            }
+
+            status = _dsproc_read_dsdir_events(dir, &nfs_time);
+            if (status < 0) {
+                return(-1);
+            }
+
+            if (status > 0) {
+                dir->stats = dir_stats;
+                *files     = dir->files;
+                return(dir->nfiles);
+            }
+
+            nfs_time.tv_sec  = 0;
+            nfs_time.tv_usec = 0;
+        }
+    }
+
+#endif
+
     if (dir->stats.st_mtime        == dir_stats.st_mtime       &&
 #ifdef __APPLE__
         dir->stats.st_mtimespec.tv_sec  == dir_stats.st_mtimespec.tv_sec &&
@@ -1138,6 +2601,15 @@ int _dsproc_get_dsdir_files(DSDir *dir, char ***files)
         }
     }
 
+#ifdef __linux__
+
+    /* Start the directory watch before reading the directory so files
+     * created while the directory is being read are not missed. */
+
+    _dsproc_watch_dsdir(dir);
+
+#endif
+
     /* Open the directory */
 
     dirp = opendir(dir->path);
@@ -1151,9 +2623,23 @@ int _dsproc_get_dsdir_files(DSDir *dir, char ***files)
         return(-1);
     }
 
-    /* Loop over directory entries */
+    /* Loop over directory entries. Names that are already in the cached
+     * file list are only marked as seen, so only new names need to be
+     * matched against the file patterns and sorted into the list. */
+
+    slots = _dsproc_create_dsdir_lookup(dir, &nslots);
+    if (dir->nfiles && !slots) {
+        goto MEMORY_ERROR;
+    }
+
+    if (dir->nfiles) {
+        seen = (char *)calloc(dir->nfiles, sizeof(char));
+        if (!seen) goto MEMORY_ERROR;
+    }
 
-    dir->nfiles   = 0;
+    mask          = (unsigned int)nslots - 1;
+    nlisted       = 0;
+    nevaluated    = 0;
     found_version = 0;
 
     for (;;) {
@@ -1170,59 +2656,56 @@ int _dsproc_get_dsdir_files(DSDir *dir, char ***files)
                     " -> %s\n", dir->path, strerror(errno));
 
                 dsproc_set_status(DSPROC_EDIRLIST);
-
-                closedir(dirp);
-                return(-1);
+                goto ERROR_EXIT;
             }
 
             break;
         }
 
-        /* Skip dot files and the . and .. directories */
-
         if (direntp->d_name[0] == '.') {
             continue;
         }
 
-        /* Check if this file matches one of the specified patterns */
-
-        if (dir->patterns) {
+        nlisted++;
 
-            extp = (char *)NULL;
+        /* Check if this file is already in the cached file list */
 
-            if (dir->filter_versioned_files) {
+        if (slots) {
 
-                /* Check for .v# version extension and remove it from the file
-                 * name before checking the if the file matches the patterns. */
-                if (_dsproc_get_file_version(direntp->d_name, &extp) >= 0) {
-                    *extp = '\0';
-                    found_version = 1;
-                }
-            }
+            si = _dsproc_hash_file_name(direntp->d_name) & mask;
 
-            status = relist_execute(
-                dir->patterns, direntp->d_name, 0, NULL, NULL, NULL, NULL);
+            while (slots[si] >= 0 &&
+                   strcmp(dir->files[slots[si]], direntp->d_name) != 0) {
 
-            if (extp) {
-                *extp = '.';
+                si = (si + 1) & mask;
             }
 
-            if (status == 0) {
+            if (slots[si] >= 0) {
+                seen[slots[si]] = 1;
                 continue;
             }
+        }
 
-            if (status < 0) {
+        nevaluated++;
 
-                ERROR( DSPROC_LIB_NAME,
-                    "Could not get directory listing for: %s\n"
-                    " -> regular expression error\n",
-                    dir->path);
+        /* Check if this file matches one of the specified patterns */
 
-                dsproc_set_status(DSPROC_EDIRLIST);
+        status = _dsproc_match_dsdir_file(
+            dir, direntp->d_name, &found_version);
 
-                closedir(dirp);
-                return(-1);
-            }
+        if (status == 0) {
+            continue;
+        }
+
+        if (status < 0) {
+
+            ERROR( DSPROC_LIB_NAME,
+                "Could not get directory listing for: %s\n"
+                " -> regular expression error\n",
+                dir->path);
+
+            dsproc_set_status(DSPROC_EDIRLIST);
+            goto ERROR_EXIT;
         }
 
         /* Check if this is a 0-level input datastream
@@ -1237,8 +2720,7 @@ int _dsproc_get_dsdir_files(DSDir *dir, char ***files)
 
             if (!file_mod_time(full_path, &mod_time)) {
                 dsproc_set_status(DSPROC_EFILESTATS);
-                closedir(dirp);
-                return(-1);
+                goto ERROR_EXIT;
             }
 
             if (TV_GTEQ(mod_time, nfs_time)) {
@@ -1246,62 +2728,63 @@ int _dsproc_get_dsdir_files(DSDir *dir, char ***files)
             }
         }
 
-        /* Check if we need to increase the length of the file list */
+        /* Check if we need to increase the length of the new files list */
 
-        if (dir->nfiles == dir->max_files - 1) {
+        if (nadded == max_added) {
 
-            new_size = dir->max_files * 2;
-            new_list = (char **)realloc(
-                dir->files, new_size * sizeof(char *));
+            new_size = (max_added) ? max_added * 2 : 128;
+            new_list = (char **)realloc(added, new_size * sizeof(char *));
 
-            if (!new_list) {
+            if (!new_list) goto MEMORY_ERROR;
 
-                ERROR( DSPROC_LIB_NAME,
-                    "Could not get directory listing for: %s\n"
-                    " -> memory allocation error\n",
-                    dir->path);
+            max_added = new_size;
+            added     = new_list;
+        }
 
-                dsproc_set_status(DSPROC_ENOMEM);
+        /* Add the file name */
 
-                closedir(dirp);
-                return(-1);
-            }
+        added[nadded] = strdup(direntp->d_name);
+        if (!added[nadded]) goto MEMORY_ERROR;
 
-            dir->max_files = new_size;
-            dir->files     = new_list;
+        nadded++;
+    }
 
-            for (fi = dir->nfiles; fi < dir->max_files; fi++) {
-                dir->files[fi] = (char *)NULL;
-            }
-        }
+    closedir(dirp);
+    dirp = (DIR *)NULL;
 
-        /* Set the file name */
+    /* Update the cached file list. If new versioned files were found, or
+     * the sort order has changed, the whole list is sorted below. */
 
-        if (dir->files[dir->nfiles]) {
-            free(dir->files[dir->nfiles]);
-        }
+    if (!_dsproc_merge_dsdir_files(dir, seen, nadded, added,
+        (!found_version && !dir->resort))) {
 
-        dir->files[dir->nfiles] = strdup(direntp->d_name);
-        if (!dir->files[dir->nfiles]) {
+        nadded = 0;
+        goto ERROR_EXIT;
+    }
 
-            ERROR( DSPROC_LIB_NAME,
-                "Could not get directory listing for: %s\n"
-                " -> memory allocation error\n",
-                dir->path);
+    if (slots) free(slots);
+    if (seen)  free(seen);
+    if (added) free(added);
 
-            dsproc_set_status(DSPROC_EDIRLIST);
+    dir->nlisted    += nlisted;
+    dir->nevaluated += nevaluated;
 
-            closedir(dirp);
-            return(-1);
-        }
+    DEBUG_LV1( DSPROC_LIB_NAME,
+        "%s: Updated file list: %d files, %d of %d names evaluated\n",
+        dir->path, dir->nfiles, nevaluated, nlisted);
 
-        dir->nfiles++;
+    dir->stats = dir_stats;
+    *files     = dir->files;
+
+    if (found_version) {
+        dir->found_versions = 1;
     }
 
-    closedir(dirp);
+    if (!found_version && !dir->resort) {
+        return(dir->nfiles);
+    }
 
-    dir->stats = dir_stats;
-    *files     = dir->files;
+    dir->resort = 0;
 
     if (dir->nfiles < 2) {
         return(dir->nfiles);
@@ -1320,41 +2803,7 @@ int _dsproc_get_dsdir_files(DSDir *dir, char ***files)
 
     /* Determine the file_name_compare function to use to sort the file list */
 
-    if (dir->file_name_compare) {
-        /* User specified file_name_compare function */
-        file_name_compare = dir->file_name_compare;
-    }
-    else if (dir->file_name_time_patterns) {
-        /* User specified file_name_time_patterns */
-        file_name_compare = _dsproc_file_name_compare;
-    }
-    else if (dir->file_name_time) {
-
-        if (dir->file_name_time == _dsproc_get_ARM_file_name_time) {
-            /* Default for files with standard arm names */
-            file_name_compare = qsort_strcmp;
-        }
-        else {
-            /* User specified file_name_time function */
-            file_name_compare = _dsproc_file_name_compare;
-        }
-    }
-    else {
-
-        if ((dir->ds->role == DSR_INPUT) &&
-            (dir->ds->dsc_level[0] == '0')) {
-
-            /* Default for 0-level input raw files */
-            file_name_compare = qsort_numeric_strcmp;
-        }
-        else {
-            /* Default for files with standard arm names.
-             * We should never get here because in this case the
-             * dir->file_name_time function should have already
-             * been set to _dsproc_get_ARM_file_name_time(). */
-            file_name_compare = qsort_strcmp;
-        }
-    }
+    file_name_compare = _dsproc_get_dsdir_file_compare(dir);
 
     /* Sort the file list if necessary */
 
@@ -1387,6 +2836,28 @@ int _dsproc_get_dsdir_files(DSDir *dir, char ***files)
     }
 
     return(dir->nfiles);
+
+MEMORY_ERROR:
+
+    ERROR( DSPROC_LIB_NAME,
+        "Could not get directory listing for: %s\n"
+        " -> memory allocation error\n",
+        dir->path);
+
+    dsproc_set_status(DSPROC_ENOMEM);
+
+ERROR_EXIT:
+
+    if (dirp)  closedir(dirp);
+    if (slots) free(slots);
+    if (seen)  free(seen);
+
+    if (added) {
+        for (fi = 0; fi < nadded; ++fi) free(added[fi]);
+        free(added);
+    }
+
+    return(-1);
 }
 
 /**
@@ -1540,6 +3011,7 @@ int _dsproc_open_dsfile(DSFile *file, int mode)
 {
     DSDir  *dir = file->dir;
     DSFile *dsf_node;
+    DSFile *lru_prev;
 
     /* Check if the file is already open. */
 
@@ -1550,22 +3022,47 @@ int _dsproc_open_dsfile(DSFile *file, int mode)
         if ((mode & NC_WRITE) && !(file->mode & NC_WRITE)) {
             _dsproc_close_dsfile(file);
         }
+        else {
+            _OpenFileHits += 1;
+
+            if (_OpenFilesHead != file) {
+                _dsproc_unlink_open_dsfile(file);
+                _dsproc_push_open_dsfile(file);
+            }
+        }
     }
 
     /* Check if we need to open the file. */
 
     if (!file->ncid) {
 
-        /* Start closing cached files if too many are open */
+        _OpenFileMisses += 1;
 
-        dsf_node = dir->dsf_list;
-        while (dsf_node && (dir->nopen >= dir->max_open)) {
+        /* Close the least recently used files if too many are open */
 
-            if (dsf_node->ncid) {
-                _dsproc_close_dsfile(dsf_node);
-            }
+        if (!_MaxOpenFiles) {
+            _MaxOpenFiles = _dsproc_get_default_max_open_files();
+        }
 
-            dsf_node = dsf_node->next;
+        while (_OpenFilesTail && _NumOpenFiles >= _MaxOpenFiles) {
+            _dsproc_close_dsfile(_OpenFilesTail);
+            _OpenFileEvictions += 1;
+        }
+
+        if (dir->max_open > 0) {
+
+            dsf_node = _OpenFilesTail;
+            while (dsf_node && (dir->nopen >= dir->max_open)) {
+
+                lru_prev = dsf_node->lru_prev;
+
+                if (dsf_node->dir == dir) {
+                    _dsproc_close_dsfile(dsf_node);
+                    _OpenFileEvictions += 1;
+                }
+
+                dsf_node = lru_prev;
+            }
         }
 
         /* Open the file */
@@ -1582,6 +3079,8 @@ int _dsproc_open_dsfile(DSFile *file, int mode)
 
         file->mode  = mode;
         dir->nopen += 1;
+        _NumOpenFiles += 1;
+        _dsproc_push_open_dsfile(file);
     }
 
     file->touched = 1;
@@ -1670,6 +3169,135 @@ int _dsproc_read_input_file_list(const char *list_file)
     return(1);
 }
 
+/**
+ *  Private: Save the file time index to the datastream directory.
+ *
+ *  The index is written to a temporary file that is then renamed to
+ *  DSDIR_INDEX_FILE, so concurrent readers will never see a partial index.
+ *  Failing to write the index is not treated as an error because the
+ *  directory may not be writable by the current process, the index will
+ *  simply be rebuilt in memory from the files that are opened.
+ *
+ *  Changes to the index only mark it as changed, it is written once when
+ *  the DSDir structure is freed by _dsproc_free_dsdir().
+ *
+ *  @param  dir - pointer to the DSDir structure.
+ *
+ *  @return
+ *    - 1 if successful or the index did not need to be saved
+ *    - 0 if the index could not be written
+ */
+int _dsproc_save_dsdir_index(DSDir *dir)
+{
+    char              index_file[PATH_MAX];
+    char              tmp_file[PATH_MAX];
+    DSFileIndexEntry *entry;
+    FILE             *fp;
+    int               ii;
+
+    if (!dir->use_file_index || !dir->index_changed) {
+        return(1);
+    }
+
+    snprintf(index_file, PATH_MAX, "%s/%s", dir->path, DSDIR_INDEX_FILE);
+    snprintf(tmp_file, PATH_MAX, "%s.%d", index_file, (int)getpid());
+
+    if (!(fp = fopen(tmp_file, "w"))) {
+
+        DEBUG_LV1( DSPROC_LIB_NAME,
+            "Could not create file time index: %s\n"
+            " -> %s\n", tmp_file, strerror(errno));
+
+        return(0);
+    }
+
+    fprintf(fp,
+        "# name size mtime_sec mtime_nsec ntimes"
+        " begin_sec begin_usec end_sec end_usec dod_version\n");
+
+    for (ii = 0; ii < dir->nindex; ++ii) {
+
+        entry = &(dir->index[ii]);
+
+        /* The index file is whitespace delimited */
+
+        if (strpbrk(entry->name, " \t\r\n")) continue;
+
+        fprintf(fp, "%s %lld %lld %ld %d %lld %ld %lld %ld %s\n",
+            entry->name,
+            (long long)entry->size,
+            (long long)entry->mtime_sec, entry->mtime_nsec,
+            entry->ntimes,
+            (long long)entry->begin.tv_sec, (long)entry->begin.tv_usec,
+            (long long)entry->end.tv_sec,   (long)entry->end.tv_usec,
+            (entry->dod_version) ? entry->dod_version : "-");
+    }
+
+    if (fclose(fp) != 0 || rename(tmp_file, index_file) != 0) {
+
+        DEBUG_LV1( DSPROC_LIB_NAME,
+            "Could not write file time index: %s\n"
+            " -> %s\n", index_file, strerror(errno));
+
+        unlink(tmp_file);
+        return(0);
+    }
+
+    dir->index_changed = 0;
+
+    return(1);
+}
+
+/**
+ *  Private: Update the file time index entry for a file.
+ *
+ *  This function does nothing if the file time index has not been enabled
+ *  for the datastream using the DS_FILE_TIME_INDEX flag. The size and
+ *  modification time of the file are taken from its current stats.
+ *
+ *  If an error occurs in this function it will be appended to the log and
+ *  error mail messages, and the process status will be set appropriately.
+ *
+ *  @param  dir         - pointer to the DSDir structure.
+ *  @param  name        - name of the file
+ *  @param  ntimes      - number of times in the file
+ *  @param  begin       - first time in the file
+ *  @param  end         - last time in the file
+ *  @param  dod_version - DOD version of the file, or NULL
+ *
+ *  @return
+ *    - 1 if successful
+ *    - 0 if a memory allocation error occurred
+ */
+int _dsproc_update_dsdir_index(
+    DSDir      *dir,
+    const char *name,
+    int         ntimes,
+    timeval_t  *begin,
+    timeval_t  *end,
+    const char *dod_version)
+{
+    struct stat stats;
+    char        full_path[PATH_MAX];
+
+    if (!dir->use_file_index) {
+        return(1);
+    }
+
+    if (!_dsproc_load_dsdir_index(dir)) {
+        return(0);
+    }
+
+    snprintf(full_path, PATH_MAX, "%s/%s", dir->path, name);
+
+    if (stat(full_path, &stats) != 0) {
+        return(1);
+    }
+
+    return(_dsproc_set_dsdir_index_entry(
+        dir, name, &stats, ntimes, begin, end, dod_version));
+}
+
 /**
  *  Private: Set input file list for Ingests from command line.
  *
@@ -1737,8 +3365,12 @@ void _dsproc_free_input_file_list(void)
  */
 
 /**
- *  Close all open datastream files that haven't been touched
+ *  Free the cached datastream files that haven't been touched
  *  since the last time this function was called.
+ *
+ *  Untouched files that are still held open in the open file pool are kept
+ *  so they can be reused in the next processing interval, they will be
+ *  closed by the pool when it needs room for other files.
  */
 void dsproc_close_untouched_files(void)
 {
@@ -1763,7 +3395,7 @@ void dsproc_close_untouched_files(void)
 
                 next = dsf_node->next;
 
-                if (!dsf_node->touched) {
+                if (!dsf_node->touched && !dsf_node->ncid) {
                     _dsproc_delete_dsfile(prev, dsf_node);
                 }
                 else {
@@ -1775,6 +3407,11 @@ void dsproc_close_untouched_files(void)
             }
         }
     }
+
+    DEBUG_LV1( DSPROC_LIB_NAME,
+        "Open file pool: %d of %d open, %d hits, %d misses, %d evictions\n",
+        _NumOpenFiles, _MaxOpenFiles,
+        _OpenFileHits, _OpenFileMisses, _OpenFileEvictions);
 }
 
 /**
@@ -1833,13 +3470,14 @@ int dsproc_get_nfs_time(const char *dir_path, timeval_t *nfs_time)
 }
 
 /**
- *  Set the maximum number of files that can be held open.
+ *  Set the maximum number of files that can be held open for a datastream.
  *
- *  The default is to only allow a maximum of 64 files to be open at the same
- *  time per datastream. This function and be used to change this default.
+ *  By default the number of open files is only limited by the size of the
+ *  open file pool shared by all datastreams (see dsproc_set_open_file_pool_size).
+ *  This function can be used to set an additional limit for one datastream.
  *
  *  @param  ds_id    - datastream ID
- *  @param  max_open - the maximum number of open files
+ *  @param  max_open - the maximum number of open files, or 0 for no limit
  */
 void dsproc_set_max_open_files(int ds_id, int max_open)
 {
@@ -1849,6 +3487,31 @@ void dsproc_set_max_open_files(int ds_id, int max_open)
     dir->max_open = max_open;
 }
 
+/**
+ *  Set the size of the open file pool.
+ *
+ *  Datastream files are kept open after they are read so they do not need to
+ *  be reopened in the next processing interval. All datastreams share one
+ *  pool of open files, and when it is full the least recently used file is
+ *  closed. The default size is half the soft limit on open file descriptors,
+ *  up to a maximum of 256 files.
+ *
+ *  @param  max_open - the maximum number of open files, or 0 for the default
+ */
+void dsproc_set_open_file_pool_size(int max_open)
+{
+    _MaxOpenFiles = (max_open > 0)
+        ? max_open : _dsproc_get_default_max_open_files();
+
+    DEBUG_LV1( DSPROC_LIB_NAME,
+        "Setting open file pool size to: %d\n", _MaxOpenFiles);
+
+    while (_OpenFilesTail && _NumOpenFiles > _MaxOpenFiles) {
+        _dsproc_close_dsfile(_OpenFilesTail);
+        _OpenFileEvictions += 1;
+    }
+}
+
 /*******************************************************************************
  *  Public Functions
  */
@@ -2447,6 +4110,10 @@ int dsproc_set_datastream_path(int ds_id, const char *path)
         ds->dir->filter_versioned_files = 1;
     }
 
+    if (ds->flags & DS_FILE_TIME_INDEX) {
+        ds->dir->use_file_index = 1;
+    }
+
     if ((ds->role == DSR_INPUT) &&
         (ds->dsc_level[0] == '0')) {
 
@@ -2508,6 +4175,7 @@ void dsproc_set_file_name_compare_function(
 
     dir->file_name_compare = function;
     dir->stats.st_mtime = 0;
+    dir->resort = 1;
 }
 
 /**
@@ -2536,6 +4204,8 @@ void dsproc_set_file_name_time_function(
     DSDir      *dir = ds->dir;
 
     dir->file_name_time = function;
+    dir->stats.st_mtime = 0;
+    dir->resort = 1;
 }
 
 /**
@@ -2603,6 +4273,8 @@ int dsproc_set_file_name_time_patterns(
     DSDir      *dir = ds->dir;
 
     dir->file_name_time_patterns = retime_list_compile(npatterns, patterns, 0);
+    dir->stats.st_mtime = 0;
+    dir->resort = 1;
 
     if (!dir->file_name_time_patterns) {
 
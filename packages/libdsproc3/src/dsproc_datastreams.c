@@ -1119,6 +1119,11 @@ int dsproc_init_datastream(
  *    - DS_FILTER_VERSIONED_FILES = Check for files with .v# version extensions
  *                                  and filter out lower versioned files. Files
  *                                  without a version extension take precedence.
+ *
+ *    - DS_FILE_TIME_INDEX = Keep an index of the times in each file in the
+ *                           datastream directory (.dsproc_file_index) so the
+ *                           files do not need to be opened to find the ones
+ *                           containing data for a requested time range.
  * 
  *  @param  ds_id - datastream ID
  *  @param  flags - flags to set
@@ -1165,6 +1170,12 @@ void dsproc_set_datastream_flags(int ds_id, int flags)
         }
     }
 
+    if (flags & DS_FILE_TIME_INDEX) {
+        if (ds->dir) {
+            ds->dir->use_file_index = 1;
+        }
+    }
+
     if (msngr_debug_level || msngr_provenance_level) {
 
         DEBUG_LV1( DSPROC_LIB_NAME,
@@ -1210,6 +1221,10 @@ void dsproc_set_datastream_flags(int ds_id, int flags)
         if (flags & DS_FILTER_VERSIONED_FILES) {
             DEBUG_LV1( DSPROC_LIB_NAME, " - DS_FILTER_VERSIONED_FILES\n");
         }
+
+        if (flags & DS_FILE_TIME_INDEX) {
+            DEBUG_LV1( DSPROC_LIB_NAME, " - DS_FILE_TIME_INDEX\n");
+        }
     }
 
     ds->flags |= flags;
@@ -1350,6 +1365,14 @@ void dsproc_unset_datastream_flags(int ds_id, int flags)
         if (flags & DS_PRESERVE_OBS) {
             DEBUG_LV1( DSPROC_LIB_NAME, " - DS_PRESERVE_OBS\n");
         }
+
+        if (flags & DS_FILE_TIME_INDEX) {
+            DEBUG_LV1( DSPROC_LIB_NAME, " - DS_FILE_TIME_INDEX\n");
+        }
+    }
+
+    if ((flags & DS_FILE_TIME_INDEX) && ds->dir) {
+        ds->dir->use_file_index = 0;
     }
 
     ds->flags &= (0xffff ^ flags);
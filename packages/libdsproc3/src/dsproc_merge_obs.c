@@ -27,6 +27,373 @@ extern DSProc *_DSProc; /**< Internal DSProc structure */
  *  Static Functions Visible Only To This Module
  */
 
+/**
+ *  Static: Check if two observations can be merged.
+ *
+ *  A warning message is generated if the observations can not be merged.
+ *
+ *  @param  g1  - pointer to the CDSGroup of the first observation
+ *  @param  g2  - pointer to the CDSGroup of the second observation
+ *
+ *  @return
+ *    -  1 if the observations can be merged
+ *    -  0 if the observations can not be merged
+ */
+static int _dsproc_can_merge_obs(CDSGroup *g1, CDSGroup *g2)
+{
+    CDSDim    *d1, *d2;
+    CDSVar    *v1, *v2;
+    int        di;
+    int        vi;
+    size_t     length;
+    int        is_base_time;
+
+    /* Make sure the number of dimensions and variables match */
+
+    if (g1->ndims != g2->ndims) {
+
+        WARNING( DSPROC_LIB_NAME,
+            "Could not merge observations: %s and %s\n"
+            " -> number of dimensions do not match: %d != %d\n",
+            cds_get_object_path(g1), cds_get_object_path(g2),
+            (int)g1->ndims, (int)g2->ndims);
+
+        return(0);
+    }
+
+    if (g1->nvars != g2->nvars) {
+
+        WARNING( DSPROC_LIB_NAME,
+            "Could not merge observations: %s and %s\n"
+            " -> number of variables do not match: %d != %d\n",
+            cds_get_object_path(g1), cds_get_object_path(g2),
+            (int)g1->nvars, (int)g2->nvars);
+
+        return(0);
+    }
+
+    /* Make sure the dimensionality of the two observations is the same */
+
+    for (di = 0; di < g1->ndims; di++) {
+
+        d1 = g1->dims[di];
+        d2 = cds_get_dim(g2, d1->name);
+
+        if (!d2) {
+
+            WARNING( DSPROC_LIB_NAME,
+                "Could not merge observations: %s and %s\n"
+                " -> dimension '%s' not found in the second observation\n",
+                cds_get_object_path(g1), cds_get_object_path(g2),
+                d1->name);
+
+            break;
+        }
+
+        if (d1->is_unlimited != d2->is_unlimited) {
+
+            WARNING( DSPROC_LIB_NAME,
+                "Could not merge observations: %s and %s\n"
+                " -> dimension '%s' is unlimited in one but not the other\n",
+                cds_get_object_path(g1), cds_get_object_path(g2),
+                d1->name);
+
+            break;
+        }
+
+        if ((d1->is_unlimited == 0) &&
+            (d1->length != d2->length)) {
+
+            WARNING( DSPROC_LIB_NAME,
+                "Could not merge observations: %s and %s\n"
+                " -> dimension lengths for '%s' do not match: %d != %d\n",
+                cds_get_object_path(g1), cds_get_object_path(g2),
+                d1->name, (int)d1->length, (int)d2->length);
+
+            break;
+        }
+    }
+
+    if (di != g1->ndims) {
+        return(0);
+    }
+
+    /* Make sure the variables in the two observations have
+     * the same dimensionality and static data */
+
+    for (vi = 0; vi < g1->nvars; vi++) {
+
+        v1 = g1->vars[vi];
+        v2 = cds_get_var(g2, v1->name);
+
+        /* Check dimensionality */
+
+        if (v1->ndims != v2->ndims) {
+
+            WARNING( DSPROC_LIB_NAME,
+                "Could not merge observations: %s and %s\n"
+                " -> number of dimensions for variable '%s' do not match: %d != %d\n",
+                cds_get_object_path(g1), cds_get_object_path(g2),
+                v1->name, (int)v1->ndims, (int)v2->ndims);
+
+            break;
+        }
+
+        for (di = 0; di < v1->ndims; di++) {
+            if (strcmp(v1->dims[di]->name, v2->dims[di]->name) != 0) {
+
+                WARNING( DSPROC_LIB_NAME,
+                    "Could not merge observations: %s and %s\n"
+                    " -> dimension names for variable '%s' do not match: %s != %s\n",
+                    cds_get_object_path(g1), cds_get_object_path(g2),
+                    v1->name, v1->dims[di]->name, v2->dims[di]->name);
+
+                break;
+            }
+        }
+
+        if (di != v1->ndims) {
+            break;
+        }
+
+        /* Check static data */
+
+        if (v1->ndims > 0 &&
+            v1->dims[0]->is_unlimited) {
+
+            continue;
+        }
+
+        if (cds_is_time_var(v1, &is_base_time)) {
+            continue;
+        }
+
+        if (v1->type != v2->type) {
+
+            WARNING( DSPROC_LIB_NAME,
+                "Could not merge observations: %s and %s\n"
+                " -> data types for variable '%s' do not match: %s != %s\n",
+                cds_get_object_path(g1), cds_get_object_path(g2),
+                v1->name,
+                cds_data_type_name(v1->type), cds_data_type_name(v2->type));
+
+            break;
+        }
+
+        if (v1->sample_count != v2->sample_count) {
+
+            WARNING( DSPROC_LIB_NAME,
+                "Could not merge observations: %s and %s\n"
+                " -> sample counts for variable '%s' do not match: %d != %d\n",
+                cds_get_object_path(g1), cds_get_object_path(g2),
+                v1->name, v1->sample_count, v2->sample_count);
+
+            break;
+        }
+
+        length = v1->sample_count
+               * cds_var_sample_size(v1)
+               * cds_data_type_size(v1->type);
+
+        if (memcmp(v1->data.vp, v2->data.vp, length) != 0) {
+
+            WARNING( DSPROC_LIB_NAME,
+                "Could not merge observations: %s and %s\n"
+                " -> static data for variable '%s' does not match\n",
+                cds_get_object_path(g1), cds_get_object_path(g2),
+                v1->name);
+
+            break;
+        }
+    }
+
+    if (vi != g1->nvars) {
+        return(0);
+    }
+
+    return(1);
+}
+
+/**
+ *  Static: Merge a run of consecutive observations into the first one.
+ *
+ *  All observations in the run must have already been checked using
+ *  _dsproc_can_merge_obs(). The total number of samples is computed for
+ *  each variable dimensioned by time so the memory for the merged data
+ *  only needs to be allocated once, and the data from each observation
+ *  is then copied directly into place. The merged observations are
+ *  deleted from the parent group.
+ *
+ *  If an error occurs in this function it will be appended to the log and
+ *  error mail messages, and the process status will be set appropriately.
+ *
+ *  @param  parent  - pointer to the parent CDSGroup
+ *  @param  first   - index of the first observation in the run
+ *  @param  nobs    - number of observations in the run
+ *
+ *  @return
+ *    -  1 if successful
+ *    -  0 if an error occurred
+ */
+static int _dsproc_merge_obs_run(CDSGroup *parent, int first, int nobs)
+{
+    CDSGroup  *g1 = parent->groups[first];
+    CDSGroup  *g2;
+    CDSVar    *v1, *v2;
+    size_t    *starts;
+    size_t     total;
+    CDSVar    *time_var;
+    timeval_t *sample_times;
+    size_t     ntimes;
+    size_t     time_start;
+    int        is_base_time;
+    int        oi, vi;
+
+    DEBUG_LV1( DSPROC_LIB_NAME,
+        " - merging %d observations into: %s\n",
+        nobs, g1->name);
+
+    starts = (size_t *)calloc(g1->nvars + 1, sizeof(size_t));
+    if (!starts) {
+
+        ERROR( DSPROC_LIB_NAME,
+            "Could not merge observations into: %s\n"
+            " -> memory allocation error\n",
+            cds_get_object_path(g1));
+
+        dsproc_set_status(DSPROC_ENOMEM);
+        return(0);
+    }
+
+    time_var   = cds_find_time_var(g1);
+    time_start = (time_var) ? time_var->sample_count : 0;
+
+    /* Allocate memory for the merged data of all variables
+     * dimensioned by time, including the time variables */
+
+    for (vi = 0; vi < g1->nvars; vi++) {
+
+        v1 = g1->vars[vi];
+        starts[vi] = v1->sample_count;
+
+        if ((v1->ndims                 == 0) ||
+            (v1->dims[0]->is_unlimited == 0)) {
+
+            continue;
+        }
+
+        total = 0;
+
+        for (oi = first + 1; oi < first + nobs; oi++) {
+            v2     = cds_get_var(parent->groups[oi], v1->name);
+            total += v2->sample_count;
+        }
+
+        if (total == 0) continue;
+
+        if (!cds_alloc_var_data(v1, v1->sample_count, total)) {
+
+            ERROR( DSPROC_LIB_NAME,
+                "Could not merge observations into: %s\n"
+                " -> CDS Error allocating data for variable: %s\n",
+                cds_get_object_path(g1), v1->name);
+
+            dsproc_set_status(DSPROC_ECDSALLOCVAR);
+            free(starts);
+            return(0);
+        }
+    }
+
+    /* Copy the data from each observation */
+
+    for (oi = first + 1; oi < first + nobs; oi++) {
+
+        g2 = parent->groups[oi];
+
+        /* Merge time variable data */
+
+        ntimes = 0;
+        sample_times = cds_get_sample_timevals(g2, 0, &ntimes, NULL);
+
+        if (ntimes == (size_t)-1) {
+
+            ERROR( DSPROC_LIB_NAME,
+                "Could not merge observations: %s and %s\n"
+                " -> CDS Error getting sample times\n",
+                cds_get_object_path(g1), cds_get_object_path(g2));
+
+            dsproc_set_status(DSPROC_ECDSGETTIME);
+            free(starts);
+            return(0);
+        }
+
+        if (ntimes > 0) {
+
+            if (!cds_set_sample_timevals(
+                g1, time_start, ntimes, sample_times)) {
+
+                ERROR( DSPROC_LIB_NAME,
+                    "Could not merge observations: %s and %s\n"
+                    " -> CDS Error setting sample times\n",
+                    cds_get_object_path(g1), cds_get_object_path(g2));
+
+                dsproc_set_status(DSPROC_ECDSSETTIME);
+                free(sample_times);
+                free(starts);
+                return(0);
+            }
+
+            free(sample_times);
+            time_start += ntimes;
+        }
+
+        /* Merge variable data */
+
+        for (vi = 0; vi < g1->nvars; vi++) {
+
+            v1 = g1->vars[vi];
+
+            if ((v1->ndims                 == 0) ||
+                (v1->dims[0]->is_unlimited == 0) ||
+                (cds_is_time_var(v1, &is_base_time))) {
+
+                continue;
+            }
+
+            v2 = cds_get_var(g2, v1->name);
+
+            if (v2->sample_count == 0) continue;
+
+            if (!cds_set_var_data(v1,
+                v2->type, starts[vi], v2->sample_count,
+                NULL, v2->data.vp)) {
+
+                ERROR( DSPROC_LIB_NAME,
+                    "Could not merge observations: %s and %s\n"
+                    " -> CDS Error setting data for variable: %s\n",
+                    cds_get_object_path(g1), cds_get_object_path(g2),
+                    v1->name);
+
+                dsproc_set_status(DSPROC_ECDSSETDATA);
+                free(starts);
+                return(0);
+            }
+
+            starts[vi] += v2->sample_count;
+        }
+    }
+
+    free(starts);
+
+    /* Delete the merged observations */
+
+    for (oi = first + nobs - 1; oi > first; oi--) {
+        cds_delete_group(parent->groups[oi]);
+    }
+
+    return(1);
+}
+
 /*******************************************************************************
  *  Private Functions Visible Only To This Library
  */
@@ -288,6 +655,10 @@ int _dsproc_check_for_overlapping_obs(CDSGroup *parent)
 /**
  *  Private: Merge all the observations in the specified CDSGroup.
  *
+ *  Each run of consecutive observations that can be merged is found first,
+ *  and all observations in the run are then merged into the first one in
+ *  a single pass.
+ *
  *  If an error occurs in this function it will be appended to the log and
  *  error mail messages, and the process status will be set appropriately.
  *
@@ -299,20 +670,8 @@ int _dsproc_check_for_overlapping_obs(CDSGroup *parent)
  */
 int _dsproc_merge_obs(CDSGroup *parent)
 {
-    int        o1,  o2;
-    CDSGroup  *g1, *g2;
-    CDSDim    *d1, *d2;
-    CDSVar    *v1, *v2;
-    int        di;
-    int        vi;
-    size_t     length;
-    CDSVar    *time_var;
-    timeval_t *sample_times;
-    size_t     ntimes;
-    int        is_base_time;
-
-    o1 = 0;
-    o2 = 1;
+    int        o1, o2;
+    int        nobs;
 
     if (parent->ngroups < 2) {
         return(parent->ngroups);
@@ -328,248 +687,31 @@ int _dsproc_merge_obs(CDSGroup *parent)
         return(-1);
     }
 
-    /* Merge observations */
-
-    while (o2 < parent->ngroups) {
-
-        g1 = parent->groups[o1];
-        g2 = parent->groups[o2];
-
-        /* Make sure the number of dimensions and variables match */
-
-        if (g1->ndims != g2->ndims) {
-
-            WARNING( DSPROC_LIB_NAME,
-                "Could not merge observations: %s and %s\n"
-                " -> number of dimensions do not match: %d != %d\n",
-                cds_get_object_path(g1), cds_get_object_path(g2),
-                (int)g1->ndims, (int)g2->ndims);
-
-            o1++; o2++;
-            continue;
-        }
-
-        if (g1->nvars != g2->nvars) {
-
-            WARNING( DSPROC_LIB_NAME,
-                "Could not merge observations: %s and %s\n"
-                " -> number of variables do not match: %d != %d\n",
-                cds_get_object_path(g1), cds_get_object_path(g2),
-                (int)g1->nvars, (int)g2->nvars);
-
-            o1++; o2++;
-            continue;
-        }
-
-        /* Make sure the dimensionality of the two observations is the same */
-
-        for (di = 0; di < g1->ndims; di++) {
-
-            d1 = g1->dims[di];
-            d2 = cds_get_dim(g2, d1->name);
-
-            if (!d2) {
-
-                WARNING( DSPROC_LIB_NAME,
-                    "Could not merge observations: %s and %s\n"
-                    " -> dimension '%s' not found in the second observation\n",
-                    cds_get_object_path(g1), cds_get_object_path(g2),
-                    d1->name);
-
-                break;
-            }
-
-            if (d1->is_unlimited != d2->is_unlimited) {
-
-                WARNING( DSPROC_LIB_NAME,
-                    "Could not merge observations: %s and %s\n"
-                    " -> dimension '%s' is unlimited in one but not the other\n",
-                    cds_get_object_path(g1), cds_get_object_path(g2),
-                    d1->name);
-
-                break;
-            }
-
-            if ((d1->is_unlimited == 0) &&
-                (d1->length != d2->length)) {
+    nobs = parent->ngroups;
 
-                WARNING( DSPROC_LIB_NAME,
-                    "Could not merge observations: %s and %s\n"
-                    " -> dimension lengths for '%s' do not match: %d != %d\n",
-                    cds_get_object_path(g1), cds_get_object_path(g2),
-                    d1->name, (int)d1->length, (int)d2->length);
-
-                break;
-            }
-        }
-
-        if (di != g1->ndims) {
-            o1++; o2++;
-            continue;
-        }
-
-        /* Make sure the variables in the two observations have
-         * the same dimensionality and static data */
-
-        for (vi = 0; vi < g1->nvars; vi++) {
-
-            v1 = g1->vars[vi];
-            v2 = cds_get_var(g2, v1->name);
-
-            /* Check dimensionality */
-
-            if (v1->ndims != v2->ndims) {
-
-                WARNING( DSPROC_LIB_NAME,
-                    "Could not merge observations: %s and %s\n"
-                    " -> number of dimensions for variable '%s' do not match: %d != %d\n",
-                    cds_get_object_path(g1), cds_get_object_path(g2),
-                    v1->name, (int)v1->ndims, (int)v2->ndims);
-
-                break;
-            }
-
-            for (di = 0; di < v1->ndims; di++) {
-                if (strcmp(v1->dims[di]->name, v2->dims[di]->name) != 0) {
-
-                    WARNING( DSPROC_LIB_NAME,
-                        "Could not merge observations: %s and %s\n"
-                        " -> dimension names for variable '%s' do not match: %s != %s\n",
-                        cds_get_object_path(g1), cds_get_object_path(g2),
-                        v1->name, v1->dims[di]->name, v2->dims[di]->name);
-
-                    break;
-                }
-            }
-
-            if (di != v1->ndims) {
-                break;
-            }
-
-            /* Check static data */
-
-            if (v1->ndims > 0 &&
-                v1->dims[0]->is_unlimited) {
-
-                continue;
-            }
-
-            if (cds_is_time_var(v1, &is_base_time)) {
-                continue;
-            }
-
-            if (v1->type != v2->type) {
-
-                WARNING( DSPROC_LIB_NAME,
-                    "Could not merge observations: %s and %s\n"
-                    " -> data types for variable '%s' do not match: %s != %s\n",
-                    cds_get_object_path(g1), cds_get_object_path(g2),
-                    v1->name,
-                    cds_data_type_name(v1->type), cds_data_type_name(v2->type));
-
-                break;
-            }
-
-            if (v1->sample_count != v2->sample_count) {
-
-                WARNING( DSPROC_LIB_NAME,
-                    "Could not merge observations: %s and %s\n"
-                    " -> sample counts for variable '%s' do not match: %d != %d\n",
-                    cds_get_object_path(g1), cds_get_object_path(g2),
-                    v1->name, v1->sample_count, v2->sample_count);
-
-                break;
-            }
+    /* Merge observations */
 
-            length = v1->sample_count
-                   * cds_var_sample_size(v1)
-                   * cds_data_type_size(v1->type);
+    for (o1 = 0; o1 < parent->ngroups; o1++) {
 
-            if (memcmp(v1->data.vp, v2->data.vp, length) != 0) {
-
-                WARNING( DSPROC_LIB_NAME,
-                    "Could not merge observations: %s and %s\n"
-                    " -> static data for variable '%s' does not match\n",
-                    cds_get_object_path(g1), cds_get_object_path(g2),
-                    v1->name);
+        /* Find the observations that can be merged into this one */
 
+        for (o2 = o1 + 1; o2 < parent->ngroups; o2++) {
+            if (!_dsproc_can_merge_obs(parent->groups[o1], parent->groups[o2])) {
                 break;
             }
         }
 
-        if (vi != g1->nvars) {
-            o1++; o2++;
-            continue;
-        }
-
-        /* Merge time variable data */
-
-        ntimes = 0;
-        sample_times = cds_get_sample_timevals(g2, 0, &ntimes, NULL);
-
-        if (ntimes == (size_t)-1) {
-
-            ERROR( DSPROC_LIB_NAME,
-                "Could not merge observations: %s and %s\n"
-                " -> CDS Error getting sample times\n",
-                cds_get_object_path(g1), cds_get_object_path(g2));
-
-            dsproc_set_status(DSPROC_ECDSGETTIME);
-            return(-1);
-        }
-
-        if (ntimes > 0) {
-
-            time_var = cds_find_time_var(g1);
-
-            if (!cds_set_sample_timevals(
-                g1, time_var->sample_count, ntimes, sample_times)) {
-
-                ERROR( DSPROC_LIB_NAME,
-                    "Could not merge observations: %s and %s\n"
-                    " -> CDS Error setting sample times\n",
-                    cds_get_object_path(g1), cds_get_object_path(g2));
-
-                dsproc_set_status(DSPROC_ECDSSETTIME);
-                return(-1);
-            }
-
-            free(sample_times);
-        }
-
-        /* Merge variable data */
-
-        for (vi = 0; vi < g1->nvars; vi++) {
-
-            v1 = g1->vars[vi];
-
-            if ((v1->ndims                 == 0) ||
-                (v1->dims[0]->is_unlimited == 0) ||
-                (cds_is_time_var(v1, &is_base_time))) {
-
-                continue;
-            }
-
-            v2 = cds_get_var(g2, v1->name);
-
-            if (!cds_set_var_data(v1,
-                v2->type, v1->sample_count, v2->sample_count,
-                NULL, v2->data.vp)) {
-
-                ERROR( DSPROC_LIB_NAME,
-                    "Could not merge observations: %s and %s\n"
-                    " -> CDS Error setting data for variable: %s\n",
-                    cds_get_object_path(g1), cds_get_object_path(g2),
-                    v1->name);
-
-                dsproc_set_status(DSPROC_ECDSSETDATA);
+        if (o2 - o1 > 1) {
+            if (!_dsproc_merge_obs_run(parent, o1, o2 - o1)) {
                 return(-1);
             }
         }
-
-        cds_delete_group(g2);
     }
 
+    DEBUG_LV1( DSPROC_LIB_NAME,
+        " - merged %d observations into %d\n",
+        nobs, parent->ngroups);
+
     return(parent->ngroups);
 }
 
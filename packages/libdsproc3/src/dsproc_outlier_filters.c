@@ -17,6 +17,7 @@
 */
 
 #include <math.h>
+#include <pthread.h>
 
 #include "dsproc3.h"
 #include "dsproc_private.h"
@@ -47,29 +48,120 @@ This method is somewhat susceptible to influence from extreme outliers, but less
 
 /** @privatesection */
 
+/** Maximum number of threads used by dsproc_flag_outliers(). */
+#define MAX_OUTLIER_THREADS 32
+
+/** Number of bins used by the outlier analysis histograms. */
+#define OUTLIER_NBINS 60
+
+/** Relative tolerance used to recheck values that are close to a threshold. */
+#define OUTLIER_RECHECK_EPSILON 1.0e-9
+
 /**
- *  qsort function to compare two doubles.
+ *  Outlier method names used in debug and analysis output.
  */
-static int _dbl_compare(const void *dp1, const void *dp2)
-{
-    double diff = *((double *)dp1) - *((double *)dp2);
-    return((diff < 0.0) ? -1 : (diff > 0.0));
-}
+static struct {
+    const char *name;   /**< name of the method                   */
+    const char *center; /**< name of the window center statistic  */
+    const char *spread; /**< name of the window spread statistic  */
+    const char *units;  /**< label used for the analysis bins     */
+} _OutlierMethods[] = {
+    { NULL, NULL, NULL, NULL },
+    { "Median and Interquartile Deviation Method (IQD)",
+      "median", "iqd", "# of IQDs" },
+    { "Absolute Deviation from the Mean Method",
+      "mean",   NULL,  "dist from mean" },
+    { "Mean and Mean Absolute Deviation Method (MAD)",
+      "mean",   "mad", "# of MADs" },
+    { "Median and Median Absolute Deviation Method (MAD)",
+      "median", "mad", "# of MADs" },
+    { "Mean and Standard Deviation Method",
+      "mean",   "std", "# of STDs" }
+};
+
+/**
+ *  Outlier filter settings and the time data shared by all variables.
+ */
+typedef struct {
+
+    DSOutlierMethod method;        /**< outlier detection method            */
+    double          window_width;  /**< width of window centered on points  */
+    int             min_npoints;   /**< minimum number of points in window  */
+    unsigned int    skipped_flag;  /**< QC flag for skipped values          */
+    double          bad_threshold; /**< threshold used to flag bad values   */
+    unsigned int    bad_flag;      /**< QC flag for bad outliers            */
+    double          ind_threshold; /**< threshold used to flag ind values   */
+    unsigned int    ind_flag;      /**< QC flag for indeterminate outliers  */
+    unsigned int    analyze;       /**< analysis option                     */
+
+    size_t          nsamples;      /**< number of samples in the dataset    */
+    double         *times;         /**< sample times                        */
+    size_t         *win_start;     /**< window start index for each sample  */
+    size_t         *win_end;       /**< window end index for each sample    */
+
+    int             bins[OUTLIER_NBINS]; /**< analysis histogram            */
+    int             nbad;          /**< number of bad values in analysis    */
+    int             nskipped;      /**< number of skipped values in analysis */
+
+} OutlierFilter;
+
+/**
+ *  Variable data used by an outlier filter.
+ */
+typedef struct {
+
+    const char   *name;        /**< name of the variable                  */
+    size_t        ncols;       /**< number of values per sample           */
+    double       *datap;       /**< variable data cast to double          */
+    double        missing;     /**< missing value used in variable data   */
+    unsigned int *qcp;         /**< pointer to the QC variable's data     */
+    unsigned int  qc_bad_mask; /**< QC mask used to check for bad values  */
+
+} OutlierVar;
+
+typedef struct OutlierWork OutlierWork;
+
+/**
+ *  Outlier filter thread and the buffers used to filter one column.
+ */
+typedef struct {
+
+    OutlierWork  *work;    /**< work shared by all threads          */
+    pthread_t     thread;  /**< thread ID                           */
+    double       *values;  /**< column values                       */
+    unsigned int *qc;      /**< column QC values                    */
+    unsigned int *new_qc;  /**< new QC flags for the column         */
+    DSOrderStats *window;  /**< window order statistics             */
+
+} OutlierThread;
+
+/**
+ *  Work shared by the outlier filter threads.
+ */
+struct OutlierWork {
+
+    OutlierFilter   *filter;   /**< outlier filter settings             */
+    OutlierVar      *vars;     /**< variables to filter                 */
+    size_t           njobs;    /**< total number of columns to filter   */
+    size_t           next_job; /**< next column to filter               */
+    pthread_mutex_t  mutex;    /**< mutex used to claim the next column */
+};
 
 /**
 *  Validate input and get data and pointers for an outlier filter.
 *
-*  The memory used by bar_datap is dynamically allocated and must be freed
+*  The variable must be dimensioned by time, and each value of the inner
+*  dimensions is filtered independently. The time data and sample count
+*  are set in the OutlierFilter structure by the first variable, and the
+*  sample counts of all other variables must match it.
+*
+*  The memory used by ov->datap is dynamically allocated and must be freed
 *  by the calling process when it is no longer needed.
 *
-*  @param   dataset      pointer to the dataset
-*  @param   var_name     name of the variable
-*  @param   nsamples     output: number of samples
-*  @param   times        output: pointer to time variable's data array
-*  @param   datap        output: pointer to the variable's data cast to double
-*  @param   missing      output: missing value used in variable data
-*  @param   qcp          output: pointer to the QC variable's data array
-*  @param   qc_bad_mask  output: QC mask used to check for bad values
+*  @param   dataset   pointer to the dataset
+*  @param   var_name  name of the variable
+*  @param   filter    pointer to the OutlierFilter structure
+*  @param   ov        output: variable data and pointers
 *
 *  @retval   1  successful
 *  @retval   0  if the outlier test can not be run
@@ -77,17 +169,14 @@ static int _dbl_compare(const void *dp1, const void *dp2)
 static int _init_outlier_filter(
     CDSGroup      *dataset,
     const char    *var_name,
-    size_t        *nsamples,
-    double       **times,
-    double       **datap,
-    double        *missing,
-    unsigned int **qcp,
-    unsigned int  *qc_bad_mask)
+    OutlierFilter *filter,
+    OutlierVar    *ov)
 {
     const char *errmsg;
     CDSVar     *var;
     CDSVar     *time_var;
     CDSVar     *qc_var;
+    size_t      nsamples;
 
     /* Get variable and check shape */
 
@@ -97,35 +186,36 @@ static int _init_outlier_filter(
         goto INVALID_INPUT;
     }
 
-    if (var->ndims != 1) {
-        errmsg = "variable has more than one dimesnion";
-        goto INVALID_INPUT;
-    }
-
-    if (strcmp(var->dims[0]->name, "time") != 0) {
+    if (var->ndims == 0 || strcmp(var->dims[0]->name, "time") != 0) {
         errmsg = "variable is not dimensioned by time";
         goto INVALID_INPUT;
     }
 
     /* Get time variable and check type and sample counts */
 
-    time_var = cds_get_var(dataset, "time");
-    if (!time_var) {
-        errmsg = "time variable not found in dataset";
-        goto INVALID_INPUT;
-    }
+    if (!filter->times) {
 
-    if (time_var->type != CDS_DOUBLE) {
-        errmsg = "invalid time variable data type (expected double)";
-        goto INVALID_INPUT;
-    }
+        time_var = cds_get_var(dataset, "time");
+        if (!time_var) {
+            errmsg = "time variable not found in dataset";
+            goto INVALID_INPUT;
+        }
 
-    if (time_var->sample_count == 0) {
-        errmsg = "no sample times have been stored in dataset";
-        goto INVALID_INPUT;
+        if (time_var->type != CDS_DOUBLE) {
+            errmsg = "invalid time variable data type (expected double)";
+            goto INVALID_INPUT;
+        }
+
+        if (time_var->sample_count == 0) {
+            errmsg = "no sample times have been stored in dataset";
+            goto INVALID_INPUT;
+        }
+
+        filter->nsamples = time_var->sample_count;
+        filter->times    = time_var->data.dp;
     }
 
-    if (time_var->sample_count != var->sample_count) {
+    if (filter->nsamples != var->sample_count) {
         errmsg = "number of sample times does not match number of data values";
         goto INVALID_INPUT;
     }
@@ -143,6 +233,11 @@ static int _init_outlier_filter(
         goto INVALID_INPUT;
     }
 
+    if (cds_var_sample_size(qc_var) != cds_var_sample_size(var)) {
+        errmsg = "QC variable shape does not match variable shape";
+        goto INVALID_INPUT;
+    }
+
     if (qc_var->sample_count == 0) {
         if (!dsproc_init_var_data(qc_var, 0, var->sample_count, 0)) {
             return(0);
@@ -155,18 +250,19 @@ static int _init_outlier_filter(
 
     /* Get variable data cast to double */
 
-    *datap = dsproc_get_var_data(var,
-        CDS_DOUBLE, 0, nsamples, missing, NULL);
+    ov->datap = dsproc_get_var_data(var,
+        CDS_DOUBLE, 0, &nsamples, &ov->missing, NULL);
 
-    if (!(*datap)) {
+    if (!ov->datap) {
         return(0);
     }
 
     /* Set outputs */
 
-    *times       = time_var->data.dp;
-    *qcp         = (unsigned int *)qc_var->data.ip;
-    *qc_bad_mask = dsproc_get_bad_qc_mask(qc_var);
+    ov->name        = var_name;
+    ov->ncols       = cds_var_sample_size(var);
+    ov->qcp         = (unsigned int *)qc_var->data.ip;
+    ov->qc_bad_mask = dsproc_get_bad_qc_mask(qc_var);
 
     return(1);
 
@@ -182,880 +278,1122 @@ INVALID_INPUT:
     return(0);
 }
 
-/** @publicsection */
-
-/*******************************************************************************
- *  Functions Visible To The Public
- */
-
 /**
-*  Flag outliers using the Median and Interquartile Deviation Method (IQD).
+*  Set the window boundaries for all sample times.
 *
-*  For this outlier detection method, the median of the residuals is
-*  calculated, along with the 25th percentile and the 75th percentile. The
-*  difference between the 25th and 75th percentile is the interquartile
-*  deviation (IQD). Then, the difference is calculated between each
-*  value and the residual median. If the value is a certain number of IQD
-*  away from the median of the residuals, that value is classified as an
-*  outlier. A typical default value for the threshold is 3.
+*  The window boundaries only depend on the sample times, so they are
+*  computed once and shared by all variables and columns.
 *
-*  The 'analyze' option can be used to analyze the outlier detection results
-*  during development and help determine the best window width and threshold
-*  to use.  Remember to set this value to 0 before creating a production
-*  release.  Available options are:
+*  @param   filter  pointer to the OutlierFilter structure
 *
-*    - 1 = prints ranges of interquartile deviations from the median,
-*          and the number of points that fall within each range.
+*  @retval   1  successful
+*  @retval   0  if a memory allocation error occurred
+*/
+static int _init_outlier_windows(OutlierFilter *filter)
+{
+    double  half_width = filter->window_width / 2;
+    size_t  nsamples   = filter->nsamples;
+    double *times      = filter->times;
+    size_t  si, ei, ti;
+
+    filter->win_start = malloc(nsamples * sizeof(size_t));
+    filter->win_end   = malloc(nsamples * sizeof(size_t));
+
+    if (!filter->win_start || !filter->win_end) {
+        return(0);
+    }
+
+    si = ei = 0;
+
+    for (ti = 0; ti < nsamples; ++ti) {
+
+        /* Find start of window */
+
+        while (times[ti] - times[si] > half_width) ++si;
+
+        /* Find end of window */
+
+        while ((ei < nsamples) && (times[ei] - times[ti]) <= half_width) ++ei;
+
+        filter->win_start[ti] = si;
+        filter->win_end[ti]   = ei;
+    }
+
+    return(1);
+}
+
+/**
+*  Running mean and sum of squared deviations of the values in a window.
+*/
+typedef struct {
+
+    int    count; /**< number of values in the window                  */
+    double mean;  /**< mean of the values in the window                */
+    double m2;    /**< sum of squared deviations from the mean         */
+
+} OutlierMoments;
+
+/**
+*  Add a value to the window moments.
 *
-*    - 2 = for each point prints time offset, data value, window median,
-*          deviation from the median, interquartile deviation, and number
-*          of interquartile deviations the value is from the median.
+*  @param   m  pointer to the OutlierMoments structure
+*  @param   x  value to add
+*/
+static void _outlier_moments_add(OutlierMoments *m, double x)
+{
+    double delta = x - m->mean;
+
+    m->count += 1;
+    m->mean  += delta / m->count;
+    m->m2    += delta * (x - m->mean);
+}
+
+/**
+*  Remove a value from the window moments.
 *
-*  If an error occurs in this function it will be appended to the log and
-*  error mail messages, and the process status will be set appropriately.
+*  Removing a value that accounts for most of the squared deviations in
+*  the window (i.e. an outlier leaving the window) cancels most of the
+*  significant digits of the running sums. In this case the moments are
+*  left unchanged and zero is returned so the caller can recompute them
+*  from the values remaining in the window.
 *
-*  @param   dataset        pointer to the dataset
-*  @param   var_name       name of the variable
-*  @param   window_width   width of window centered on data point (in seconds)
-*  @param   min_npoints    minimum number of values within window required
-*                          to perform the test (default is 2).
-*  @param   skipped_flag   QC flag value to use for values that do not have
-*                          enough points in window to perform the test.
-*  @param   bad_threshold  IQD factor used to flag outliers as bad
-*  @param   bad_flag       QC flag value to use for bad outliers
-*  @param   ind_threshold  IQD factor used to flag outliers as indeterminate
-*  @param   ind_flag       QC flag value to use for indeterminate outliers
-*  @param   analyze        Print statistics that may be helpfull during
-*                          development (see above).
+*  @param   m  pointer to the OutlierMoments structure
+*  @param   x  value to remove
 *
 *  @retval   1  successful
-*  @retval   0  a fatal error occurred
+*  @retval   0  if the moments must be recomputed
 */
-int dsproc_flag_outliers_iqd(
-    CDSGroup     *dataset,
-    const char   *var_name,
-    double        window_width,
-    int           min_npoints,
-    unsigned int  skipped_flag,
-    double        bad_threshold,
-    unsigned int  bad_flag,
-    double        ind_threshold,
-    unsigned int  ind_flag,
-    unsigned int  analyze)
+static int _outlier_moments_remove(OutlierMoments *m, double x)
 {
-    double        half_width = window_width / 2;
-    size_t        nsamples;
-    double       *times;
-    double       *datap;
-    double        missing;
-    unsigned int *qcp;
-    unsigned int  qc_bad_mask;
-    unsigned int *new_qc;
-    double       *buffer;
-    int           bn, qi, qn;
-    double        Q1, Q2, Q3, median, iqd, dev;
-    size_t        ei, si, ti, wi;
-    int           status;
-
-    const char *method = "Median and Interquartile Deviation Method (IQD)";
-    int         nanalyze_bins = 60;
-    int         analyze_bins[nanalyze_bins];
-    int         abi, nbad, nskipped;
-    double      niqds;
-
-    DEBUG_LV1( DSPROC_LIB_NAME,
-        "%s:%s: Flagging Outliers using %s\n",
-        dataset->name, var_name, method);
-
-    if (analyze) {
-
-        memset(analyze_bins, 0, nanalyze_bins * sizeof(int));
+    double mean, delta, m2;
 
-        printf(
-            "\n"
-            "Analyzing Outlier Detection using %s\n"
-            "\n"
-            " - dataset:       %s\n"
-            " - variable:      %s\n"
-            " - window width:  %g\n",
-            method, dataset->name, var_name, window_width);
-
-        if (analyze >= 2) {
-            printf(
-            " - bad threshold: %g\t\n"
-            " - ind threshold: %g\t\n"
-            "\n"
-            "%15s\t%15s\t%15s\t%15s\t%15s\t%15s\n",
-            bad_threshold,
-            ind_threshold,
-            "time_offset", "value", "median", "dev", "iqd", "dev/iqd");
-        }
+    if (m->count <= 1) {
+        m->count = 0;
+        m->mean  = 0;
+        m->m2    = 0;
+        return(1);
     }
 
-    if (min_npoints < 2) {
-        min_npoints = 2;
+    delta = x - m->mean;
+    mean  = m->mean - delta / (m->count - 1);
+    m2    = m->m2 - delta * (x - mean);
+
+    if (m2 < 0.5 * m->m2) {
+        return(0);
     }
 
-    status = _init_outlier_filter(
-        dataset,    var_name,
-        &nsamples, &times,
-        &datap,    &missing,
-        &qcp,      &qc_bad_mask);
+    m->count -= 1;
+    m->mean   = mean;
+    m->m2     = m2;
 
-    if (status <= 0) return(0);
+    return(1);
+}
+
+/**
+*  Recompute the window moments from the values in the window.
+*
+*  @param   m            pointer to the OutlierMoments structure
+*  @param   values       column values
+*  @param   qc           column QC values
+*  @param   qc_bad_mask  QC mask used to check for bad values
+*  @param   missing      missing value
+*  @param   si           index of the first value in the window
+*  @param   ei           index after the last value in the window
+*/
+static void _outlier_moments_reset(
+    OutlierMoments     *m,
+    const double       *values,
+    const unsigned int *qc,
+    unsigned int        qc_bad_mask,
+    double              missing,
+    size_t              si,
+    size_t              ei)
+{
+    double sum, diff;
+    size_t wi;
 
-    if (nsamples < (size_t)min_npoints) {
+    /* Using two pass method for numerical stability */
 
-        for (ti = 0; ti < nsamples; ++ti) {
-            qcp[ti] |= skipped_flag;
+    m->count = 0;
+    sum      = 0;
+
+    for (wi = si; wi < ei; ++wi) {
+        if (!(qc[wi] & qc_bad_mask) && (values[wi] != missing)) {
+            sum      += values[wi];
+            m->count += 1;
         }
-        
-        free(datap);
-        return(1);
     }
 
-    if (!(buffer = malloc(nsamples * sizeof(double))) ||
-        !(new_qc = calloc(nsamples, sizeof(unsigned int)))) {
-
-        ERROR( DSPROC_LIB_NAME,
-            "Could not run outlier test for variable: %s:%s\n"
-            " -> memory allocation error\n",
-            dataset->name, var_name);
-            
-        dsproc_set_status(DSPROC_ENOMEM);
+    m->mean = (m->count) ? sum / m->count : 0;
+    m->m2   = 0;
 
-        free(datap);
-        return(0);
+    for (wi = si; wi < ei; ++wi) {
+        if (!(qc[wi] & qc_bad_mask) && (values[wi] != missing)) {
+            diff   = values[wi] - m->mean;
+            m->m2 += diff * diff;
+        }
     }
+}
 
-    nbad = nskipped = 0;
-    si = ei = 0;
+/**
+*  Compute the mean absolute deviation of the values in a window.
+*
+*  @param   values       column values
+*  @param   qc           column QC values
+*  @param   qc_bad_mask  QC mask used to check for bad values
+*  @param   missing      missing value
+*  @param   si           index of the first value in the window
+*  @param   ei           index after the last value in the window
+*  @param   mean         mean of the values in the window
+*
+*  @return  mean absolute deviation from the mean
+*/
+static double _outlier_mean_abs_dev(
+    const double       *values,
+    const unsigned int *qc,
+    unsigned int        qc_bad_mask,
+    double              missing,
+    size_t              si,
+    size_t              ei,
+    double              mean)
+{
+    double sum = 0;
+    int    n   = 0;
+    size_t wi;
+
+    for (wi = si; wi < ei; ++wi) {
+        if (!(qc[wi] & qc_bad_mask) && (values[wi] != missing)) {
+            sum += fabs(values[wi] - mean);
+            n   += 1;
+        }
+    }
 
-    for (ti = 0; ti < nsamples; ++ti) {
+    return((n) ? sum / n : 0);
+}
 
-        /* Skip bad and missing values */
+/**
+*  Check if a deviation is within rounding error of a threshold.
+*
+*  The tolerance is relative to the magnitude of the values because that
+*  is what limits the accuracy of the running window statistics.
+*
+*  @param   dev     deviation of the value from the window center
+*  @param   limit   threshold multiplied by the window spread
+*  @param   value   data value
+*  @param   center  window center
+*
+*  @retval   1  if the deviation is within rounding error of the threshold
+*  @retval   0  if it is not
+*/
+static int _outlier_near_threshold(
+    double dev,
+    double limit,
+    double value,
+    double center)
+{
+    double tolerance = OUTLIER_RECHECK_EPSILON
+                     * (fabs(value) + fabs(center) + fabs(limit));
 
-        if (qcp[ti] & qc_bad_mask || datap[ti] == missing) {
-            if (analyze) {
-                nbad += 1;
-                if (analyze >= 2) {
-                    printf("%15.6f\t%15.6f\tbad\n",
-                        times[ti], datap[ti]);
-                }
-            }
-            continue;
-        }
+    return(fabs(dev - limit) <= tolerance);
+}
 
-        /* Find start of window */
+/**
+*  Print the header for the outlier analysis output.
+*
+*  @param   filter    pointer to the OutlierFilter structure
+*  @param   dataset   pointer to the dataset
+*  @param   var_name  name of the variable
+*/
+static void _print_outlier_analysis_header(
+    OutlierFilter *filter,
+    CDSGroup      *dataset,
+    const char    *var_name)
+{
+    DSOutlierMethod method = filter->method;
 
-        while (times[ti] - times[si] > half_width) ++si;
+    memset(filter->bins, 0, OUTLIER_NBINS * sizeof(int));
+    filter->nbad     = 0;
+    filter->nskipped = 0;
 
-        /* Find end of window */
+    printf(
+        "\n"
+        "Analyzing Outlier Detection using %s\n"
+        "\n"
+        " - dataset:       %s\n"
+        " - variable:      %s\n"
+        " - window width:  %g\n",
+        _OutlierMethods[method].name,
+        dataset->name, var_name, filter->window_width);
 
-        while ((ei < nsamples) && (times[ei] - times[ti]) <= half_width) ++ei;
+    if (filter->analyze < 2) return;
 
-        /* Find median of window */
+    if (!_OutlierMethods[method].spread) {
+        printf(
+        " - bad threshold: %g\t\n"
+        " - ind threshold: %g\t\n"
+        "\n"
+        "%15s\t%15s\t%15s\t%15s\n",
+        filter->bad_threshold,
+        filter->ind_threshold,
+        "time_offset", "value", _OutlierMethods[method].center, "dev");
+    }
+    else {
+        char ratio[16];
 
-        bn = 0;
+        snprintf(ratio, 16, "dev/%s", _OutlierMethods[method].spread);
 
-        for (wi = si; wi < ei; ++wi) {
-            if (!(qcp[wi] & qc_bad_mask) && (datap[wi] != missing)) {
-                buffer[bn++] = datap[wi];
-            }
-        }
+        printf(
+        " - bad threshold: %g\t\n"
+        " - ind threshold: %g\t\n"
+        "\n"
+        "%15s\t%15s\t%15s\t%15s\t%15s\t%15s\n",
+        filter->bad_threshold,
+        filter->ind_threshold,
+        "time_offset", "value", _OutlierMethods[method].center, "dev",
+        _OutlierMethods[method].spread, ratio);
+    }
+}
 
-        if (bn < min_npoints) {
-            new_qc[ti] |= skipped_flag;
-            if (analyze) {
-                nskipped += 1;
-                if (analyze >= 2) {
-                    printf("%15.6f\t%15.6f\tnot enough points (%d < %d)\n",
-                        times[ti], datap[ti], bn, min_npoints);
-                }
-            }
-            continue;
-        }
+/**
+*  Add a value to the outlier analysis results.
+*
+*  @param   filter  pointer to the OutlierFilter structure
+*  @param   time    sample time
+*  @param   value   data value
+*  @param   center  window mean or median
+*  @param   dev     absolute deviation of the value from the center
+*  @param   spread  window spread (IQD, MAD, or STD)
+*  @param   flags   QC flags set for the value
+*/
+static void _add_outlier_analysis_value(
+    OutlierFilter *filter,
+    double         time,
+    double         value,
+    double         center,
+    double         dev,
+    double         spread,
+    unsigned int   flags)
+{
+    double ratio;
+    int    abi;
 
-        qsort(buffer, bn, sizeof(double), _dbl_compare);
+    if (filter->method == DSPROC_OUTLIERS_MEAN_DEV) {
 
-        if (bn & 0x1) {
-            /* odd number of points */
-            qn = (bn-1)/2;
-            Q2 = buffer[qn];
+        if (dev < 10) {
+            abi = (int)dev;
+        }
+        else if (dev < 100) {
+            abi = 10 + (int)((dev-10) / 5);
         }
         else {
-            /* even number of points */
-            qn = bn/2;
-            Q2 = (buffer[qn-1] + buffer[qn])/2;
+            abi = 28 + (int)((dev-100) / 10);
         }
 
-        median = Q2;
+        if (abi >= OUTLIER_NBINS) {
+            abi  = OUTLIER_NBINS - 1;
+        }
 
-        /* Find the first and third quartiles */
+        filter->bins[abi] += 1;
 
-        if (qn & 0x1) {
-            /* odd number of points */
-            qi = (qn-1)/2;
-            Q1 = buffer[qi];
-            Q3 = buffer[bn - qi - 1];
+        if (filter->analyze >= 2) {
+            printf("%15.6f\t%15.6f\t%15.6f\t%15.8f",
+                time, value, center, dev);
         }
-        else {
-            /* even number of points */
-            qi = qn/2;
-            Q1 = (buffer[qi-1] + buffer[qi])/2;
-            Q3 = (buffer[bn - qi - 1] + buffer[bn - qi])/2;
+    }
+    else {
+
+        if (dev == 0) {
+            abi   = 0;
+            ratio = 0;
+        }
+        else if (spread == 0) {
+            abi   = OUTLIER_NBINS - 1;
+            ratio = 1.0 / 0.0;
         }
+        else {
 
-        iqd = Q3 - Q1;
-        
-        /* Check for outlier */
+            ratio = dev/spread;
+            abi   = (int)(ratio * 2);
 
-        dev = fabs(datap[ti] - median);
+            if ((ratio * 2) - abi == 0) abi -= 1;
 
-        if (dev > bad_threshold * iqd) {
-            new_qc[ti] |= bad_flag;
+            if (abi >= OUTLIER_NBINS) {
+                abi = OUTLIER_NBINS - 1;
+            }
         }
 
-        if (dev > ind_threshold * iqd) {
-            new_qc[ti] |= ind_flag;
+        filter->bins[abi] += 1;
+
+        if (filter->analyze >= 2) {
+            printf("%15.6f\t%15.6f\t%15.6f\t%15.8f\t%15.8f\t%15.2f",
+                time, value, center, dev, spread, ratio);
         }
+    }
 
-        if (analyze) {
+    if (filter->analyze >= 2) {
 
-            if (dev == 0) {
-                abi   = 0;
-                niqds = 0;
-            }
-            else if (iqd == 0) {
-                abi   = nanalyze_bins - 1;
-                niqds = 1.0 / 0.0;
-            }
-            else {
+        if      (flags & filter->bad_flag) printf("\tBAD");
+        else if (flags & filter->ind_flag) printf("\tind");
 
-                niqds = dev/iqd;
-                abi   = (int)(niqds * 2);
+        printf("\n");
+    }
+}
 
-                if ((niqds * 2) - abi == 0) abi -= 1;
+/**
+*  Print the summary of the outlier analysis results.
+*
+*  @param   filter  pointer to the OutlierFilter structure
+*/
+static void _print_outlier_analysis_summary(OutlierFilter *filter)
+{
+    int abi;
 
-                if (abi >= nanalyze_bins) {
-                    abi = nanalyze_bins - 1;
-                }
-            }
+    printf(
+        "\n"
+        " - skipped %d bad points\n"
+        " - skipped %d points that had less than %d points in window\n"
+        "\n",
+        filter->nbad, filter->nskipped, filter->min_npoints);
 
-            analyze_bins[abi] += 1;
+    if (filter->method == DSPROC_OUTLIERS_MEAN_DEV) {
 
-            if (analyze >= 2) {
+        printf("%-15s\t%s\n", "dist from mean", "# of points\n");
 
-                printf("%15.6f\t%15.6f\t%15.6f\t%15.8f\t%15.8f\t%15.2f",
-                    times[ti], datap[ti], median, dev, iqd, niqds);
+        for (abi = 0; abi < OUTLIER_NBINS; ++abi) {
 
-                if      (new_qc[ti] & bad_flag) printf("\tBAD");
-                else if (new_qc[ti] & ind_flag) printf("\tind");
+            if (abi < 10) {
+                printf("%4d to %4d", abi, abi+1);
+            }
+            else if (abi < 28) {
 
-                printf("\n");
+                printf("%4d to %4d",
+                    ((abi-10) * 5) + 10,
+                    ((abi- 9) * 5) + 10);
+            }
+            else if (abi < OUTLIER_NBINS-1) {
+                printf("%4d to %4d",
+                    ((abi-28) * 10) + 100,
+                    ((abi-27) * 10) + 100);
+            }
+            else {
+                printf("     >= %4d",
+                    ((abi-28) * 10) + 100);
             }
+
+            printf("\t%8d\n", filter->bins[abi]);
         }
     }
+    else {
 
-    for (ti = 0; ti < nsamples; ++ti) {
-        qcp[ti] |= new_qc[ti];
-    }
+        printf("%-12s\t%s\n",
+            _OutlierMethods[filter->method].units, "# of points\n");
 
-    if (analyze) {
+        for (abi = 0; abi < OUTLIER_NBINS; ++abi) {
 
-        printf(
-            "\n"
-            " - skipped %d bad points\n"
-            " - skipped %d points that had less than %d points in window\n"
-            "\n"
-            "%-12s\t%s\n",
-            nbad, nskipped, min_npoints,
-            "# of IQDs", "# of points\n");
-
-        for (abi = 0; abi < nanalyze_bins; ++abi) {
-
-            if (abi == nanalyze_bins-1) {
-                printf("     >= %4.1f", (double)nanalyze_bins/2);
+            if (abi == OUTLIER_NBINS-1) {
+                printf("     >= %4.1f", (double)OUTLIER_NBINS/2);
             }
             else {
                 printf("%4.1f to %4.1f", (float)abi/2, (float)abi/2 + 0.5);
             }
 
-            printf("\t%8d\n", analyze_bins[abi]);
-
+            printf("\t%8d\n", filter->bins[abi]);
         }
     }
-
-    free(buffer);
-    free(new_qc);
-    free(datap);
-    return(1);
 }
 
 /**
-*  Flag outliers using the Absolute Deviation from the Mean Method.
+*  Flag the outliers in one column of data.
 *
-*  For this outlier detection method values are flagged based on their
-*  absolute deviation from the mean of the surrounding values.
+*  This function does not allocate memory or report errors so it can be
+*  run concurrently for different columns. The analysis output can only
+*  be used when it is run by a single thread.
 *
-*  The 'analyze' option can be used to analyze the outlier detection results
-*  during development and help determine the best window width and threshold
-*  to use.  Remember to set this value to 0 before creating a production
-*  release.  Available options are:
+*  The mean based methods update the window moments as values enter and
+*  leave the window, and the mean and mean absolute deviation method gets
+*  the mean absolute deviation from the order statistics. These can differ
+*  from the statistics computed directly from the window values in the last
+*  few digits, so when the deviation of a value is within rounding error of
+*  a threshold the statistics are recomputed directly from the window before
+*  it is flagged. In analysis mode they are recomputed for every point.
+*  Either way the flags are the same as computing the statistics directly
+*  for every point.
 *
-*    - 1 = prints ranges of absolute deviations from the mean,
-*          and the number of points that fall within each range.
-*
-*    - 2 = for each point prints time offset, data value, window mean,
-*          and absolute deviation from the mean.
-*
-*  If an error occurs in this function it will be appended to the log and
-*  error mail messages, and the process status will be set appropriately.
-*
-*  @param   dataset        pointer to the dataset
-*  @param   var_name       name of the variable
-*  @param   window_width   width of window centered on data point (in seconds)
-*  @param   min_npoints    minimum number of values within window required
-*                          to perform the test (default is 2).
-*  @param   skipped_flag   QC flag value to use for values that do not have
-*                          enough points in window to perform the test.
-*  @param   bad_threshold  delta from mean used to flag outliers as bad
-*  @param   bad_flag       QC flag value to use for bad outliers
-*  @param   ind_threshold  delta from mean used to flag outliers as indeterminate
-*  @param   ind_flag       QC flag value to use for indeterminate outliers
-*  @param   analyze        Print statistics that may be helpfull during
-*                          development (see above).
-*
-*  @retval   1  successful
-*  @retval   0  a fatal error occurred
+*  @param   filter  pointer to the OutlierFilter structure
+*  @param   ov      pointer to the OutlierVar structure
+*  @param   values  column values
+*  @param   qc      column QC values
+*  @param   new_qc  output: new QC flags for the column
+*  @param   window  order statistics structure used by the median and
+*                   mean absolute deviation methods, or NULL
 */
-int dsproc_flag_outliers_mean_dev(
-    CDSGroup     *dataset,
-    const char   *var_name,
-    double        window_width,
-    int           min_npoints,
-    unsigned int  skipped_flag,
-    double        bad_threshold,
-    unsigned int  bad_flag,
-    double        ind_threshold,
-    unsigned int  ind_flag,
-    unsigned int  analyze)
+static void _flag_outliers_column(
+    OutlierFilter      *filter,
+    OutlierVar         *ov,
+    const double       *values,
+    const unsigned int *qc,
+    unsigned int       *new_qc,
+    DSOrderStats       *window)
 {
-    double        half_width = window_width / 2;
-    size_t        nsamples;
-    double       *times;
-    double       *datap;
-    double        missing;
-    unsigned int *qcp;
-    unsigned int  qc_bad_mask;
-    unsigned int *new_qc;
-    double        sum, mean, delta;
-    size_t        ei, si, ti, wi;
-    int           n, status;
-
-    const char *method = "Absolute Deviation from the Mean Method";
-    int         nanalyze_bins = 60;
-    int         analyze_bins[nanalyze_bins];
-    int         abi, nbad, nskipped;
-
-    DEBUG_LV1( DSPROC_LIB_NAME,
-        "%s:%s: Flagging Outliers using %s\n",
-        dataset->name, var_name, method);
-
-    if (analyze) {
-
-        memset(analyze_bins, 0, nanalyze_bins * sizeof(int));
-
-        printf(
-            "\n"
-            "Analyzing Outlier Detection using %s\n"
-            "\n"
-            " - dataset:       %s\n"
-            " - variable:      %s\n"
-            " - window width:  %g\n",
-            method, dataset->name, var_name, window_width);
-
-        if (analyze >= 2) {
-            printf(
-            " - bad threshold: %g\t\n"
-            " - ind threshold: %g\t\n"
-            "\n"
-            "%15s\t%15s\t%15s\t%15s\n",
-            bad_threshold,
-            ind_threshold,
-            "time_offset", "value", "mean", "dev");
-        }
-    }
-
-    if (min_npoints < 2) {
-        min_npoints = 2;
-    }
-
-    status = _init_outlier_filter(
-        dataset,    var_name,
-        &nsamples, &times,
-        &datap,    &missing,
-        &qcp,      &qc_bad_mask);
-
-    if (status <= 0) return(0);
-
-    if (nsamples < (size_t)min_npoints) {
-
-        for (ti = 0; ti < nsamples; ++ti) {
-            qcp[ti] |= skipped_flag;
-        }
-
-        free(datap);
-        return(1);
+    DSOutlierMethod method      = filter->method;
+    unsigned int    analyze     = filter->analyze;
+    size_t          nsamples    = filter->nsamples;
+    double         *times       = filter->times;
+    double          missing     = ov->missing;
+    unsigned int    qc_bad_mask = ov->qc_bad_mask;
+    OutlierMoments  moments     = { 0, 0, 0 };
+    int             use_moments;
+    int             reset;
+    double          Q1, Q3;
+    double          center, spread, scale, dev;
+    size_t          ws, we, si, ei, ti;
+    int             n;
+
+    use_moments = (method == DSPROC_OUTLIERS_MEAN_DEV ||
+                   method == DSPROC_OUTLIERS_MEAN_MAD ||
+                   method == DSPROC_OUTLIERS_STD);
+
+    if (window) {
+        dsproc_order_stats_set_values(window, values);
     }
 
-    new_qc = calloc(nsamples, sizeof(unsigned int));
-    if (!new_qc) {
-
-        ERROR( DSPROC_LIB_NAME,
-            "Could not run outlier test for variable: %s:%s\n"
-            " -> memory allocation error\n",
-            dataset->name, var_name);
-            
-        dsproc_set_status(DSPROC_ENOMEM);
-
-        free(datap);
-        return(0);
-    }
+    memset(new_qc, 0, nsamples * sizeof(unsigned int));
 
-    nbad = nskipped = 0;
-    si = ei = 0;
+    ws = we = 0;
+    n  = 0;
 
     for (ti = 0; ti < nsamples; ++ti) {
 
         /* Skip bad and missing values */
 
-        if (qcp[ti] & qc_bad_mask || datap[ti] == missing) {
+        if (qc[ti] & qc_bad_mask || values[ti] == missing) {
             if (analyze) {
-                nbad += 1;
+                filter->nbad += 1;
                 if (analyze >= 2) {
                     printf("%15.6f\t%15.6f\tbad\n",
-                        times[ti], datap[ti]);
+                        times[ti], values[ti]);
                 }
             }
             continue;
         }
 
-        /* Find start of window */
-
-        while (times[ti] - times[si] > half_width) ++si;
-
-        /* Find end of window */
+        si = filter->win_start[ti];
+        ei = filter->win_end[ti];
 
-        while ((ei < nsamples) && (times[ei] - times[ti]) <= half_width) ++ei;
+        /* Slide the window forward */
 
-        /* Compute mean */
+        for (; we < ei; ++we) {
+            if (!(qc[we] & qc_bad_mask) && (values[we] != missing)) {
+                if (window)      dsproc_order_stats_add(window, we);
+                if (use_moments) _outlier_moments_add(&moments, values[we]);
+            }
+        }
 
-        n = sum = 0;
+        reset = 0;
 
-        for (wi = si; wi < ei; ++wi) {
-            if (!(qcp[wi] & qc_bad_mask) && (datap[wi] != missing)) {
-                sum += datap[wi];
-                n   += 1;
+        for (; ws < si; ++ws) {
+            if (!(qc[ws] & qc_bad_mask) && (values[ws] != missing)) {
+                if (window) dsproc_order_stats_remove(window, ws);
+                if (use_moments && !reset) {
+                    reset = !_outlier_moments_remove(&moments, values[ws]);
+                }
             }
         }
 
-        if (n < min_npoints) {
-            new_qc[ti] |= skipped_flag;
+        if (reset || (use_moments && analyze)) {
+            _outlier_moments_reset(&moments,
+                values, qc, qc_bad_mask, missing, si, ei);
+        }
+
+        n = (use_moments) ? moments.count : dsproc_order_stats_count(window);
+
+        if (n < filter->min_npoints) {
+            new_qc[ti] |= filter->skipped_flag;
             if (analyze) {
-                nskipped += 1;
+                filter->nskipped += 1;
                 if (analyze >= 2) {
                     printf("%15.6f\t%15.6f\tnot enough points (%d < %d)\n",
-                        times[ti], datap[ti], n, min_npoints);
+                        times[ti], values[ti], n, filter->min_npoints);
                 }
             }
             continue;
         }
 
-        mean = sum/n;
+        /* Compute the window statistics */
 
-        /* Check for outlier */
+        switch (method) {
 
-        delta = fabs(datap[ti] - mean);
+            case DSPROC_OUTLIERS_IQD:
 
-        if (delta > bad_threshold) {
-            new_qc[ti] |= bad_flag;
-        }
+                dsproc_order_stats_quartiles(window, &Q1, &center, &Q3);
+                spread = Q3 - Q1;
+                break;
+
+            case DSPROC_OUTLIERS_MEDIAN_MAD:
+
+                dsproc_order_stats_median_mad(window, &center, &spread);
+                break;
+
+            case DSPROC_OUTLIERS_MEAN_MAD:
+
+                center = moments.mean;
+
+                if (analyze) {
+                    spread = _outlier_mean_abs_dev(
+                        values, qc, qc_bad_mask, missing, si, ei, center);
+                }
+                else {
+                    spread = dsproc_order_stats_mean_abs_dev(window, center);
+                }
+                break;
+
+            case DSPROC_OUTLIERS_STD:
+
+                center = moments.mean;
+                spread = sqrt(moments.m2 / n);
+                break;
 
-        if (delta > ind_threshold) {
-            new_qc[ti] |= ind_flag;
+            default: /* DSPROC_OUTLIERS_MEAN_DEV */
+
+                center = moments.mean;
+                spread = 0;
+                break;
         }
 
-        if (analyze) {
+        /* Check for outlier */
 
-            if (delta < 10) {
-                abi = (int)delta;
-            }
-            else if (delta < 100) {
-                abi = 10 + (int)((delta-10) / 5);
+        dev   = fabs(values[ti] - center);
+        scale = (method == DSPROC_OUTLIERS_MEAN_DEV) ? 1.0 : spread;
+
+        if (use_moments && !analyze &&
+            (_outlier_near_threshold(
+                dev, filter->bad_threshold * scale, values[ti], center) ||
+             _outlier_near_threshold(
+                dev, filter->ind_threshold * scale, values[ti], center))) {
+
+            _outlier_moments_reset(&moments,
+                values, qc, qc_bad_mask, missing, si, ei);
+
+            center = moments.mean;
+
+            if (method == DSPROC_OUTLIERS_MEAN_MAD) {
+                spread = _outlier_mean_abs_dev(
+                    values, qc, qc_bad_mask, missing, si, ei, center);
             }
-            else {
-                abi = 28 + (int)((delta-100) / 10);
+            else if (method == DSPROC_OUTLIERS_STD) {
+                spread = sqrt(moments.m2 / n);
             }
 
-            if (abi >= nanalyze_bins) {
-                abi  = nanalyze_bins - 1;
-            }
+            dev   = fabs(values[ti] - center);
+            scale = (method == DSPROC_OUTLIERS_MEAN_DEV) ? 1.0 : spread;
+        }
 
-            analyze_bins[abi] += 1;
+        if (dev > filter->bad_threshold * scale) {
+            new_qc[ti] |= filter->bad_flag;
+        }
 
-            if (analyze >= 2) {
+        if (dev > filter->ind_threshold * scale) {
+            new_qc[ti] |= filter->ind_flag;
+        }
 
-                printf("%15.6f\t%15.6f\t%15.6f\t%15.8f",
-                    times[ti], datap[ti], mean, delta);
+        if (analyze) {
+            _add_outlier_analysis_value(filter,
+                times[ti], values[ti], center, dev, spread, new_qc[ti]);
+        }
+    }
+}
 
-                if      (new_qc[ti] & bad_flag) printf("\tBAD");
-                else if (new_qc[ti] & ind_flag) printf("\tind");
+/**
+*  Flag the outliers in one column of a variable and update the QC values.
+*
+*  @param   filter  pointer to the OutlierFilter structure
+*  @param   ov      pointer to the OutlierVar structure
+*  @param   col     index of the column
+*  @param   thread  pointer to the OutlierThread structure
+*/
+static void _flag_outliers_var_column(
+    OutlierFilter *filter,
+    OutlierVar    *ov,
+    size_t         col,
+    OutlierThread *thread)
+{
+    size_t              nsamples = filter->nsamples;
+    size_t              ncols    = ov->ncols;
+    const double       *values;
+    const unsigned int *qc;
+    size_t              ti;
+
+    if (ncols == 1) {
+        values = ov->datap;
+        qc     = ov->qcp;
+    }
+    else {
 
-                printf("\n");
-            }
+        for (ti = 0; ti < nsamples; ++ti) {
+            thread->values[ti] = ov->datap[ti * ncols + col];
+            thread->qc[ti]     = ov->qcp[ti * ncols + col];
         }
+
+        values = thread->values;
+        qc     = thread->qc;
     }
 
+    _flag_outliers_column(filter, ov,
+        values, qc, thread->new_qc, thread->window);
+
     for (ti = 0; ti < nsamples; ++ti) {
-        qcp[ti] |= new_qc[ti];
+        ov->qcp[ti * ncols + col] |= thread->new_qc[ti];
     }
+}
 
-    if (analyze) {
-
-        printf(
-            "\n"
-            " - skipped %d bad points\n"
-            " - skipped %d points that had less than %d points in window\n"
-            "\n"
-            "%-15s\t%s\n",
-            nbad, nskipped, min_npoints,
-            "dist from mean", "# of points\n");
+/**
+*  Outlier filter thread function.
+*
+*  @param   arg  pointer to the OutlierThread structure
+*
+*  @retval  NULL
+*/
+static void *_flag_outliers_thread(void *arg)
+{
+    OutlierThread *thread = (OutlierThread *)arg;
+    OutlierWork   *work   = thread->work;
+    size_t         job;
+    int            vi;
 
-        for (abi = 0; abi < nanalyze_bins; ++abi) {
+    for (;;) {
 
-            if (abi < 10) {
-                printf("%4d to %4d", abi, abi+1);
-            }
-            else if (abi < 28) {
+        pthread_mutex_lock(&work->mutex);
+        job = work->next_job++;
+        pthread_mutex_unlock(&work->mutex);
 
-                printf("%4d to %4d",
-                    ((abi-10) * 5) + 10,
-                    ((abi- 9) * 5) + 10);
-            }
-            else if (abi < nanalyze_bins-1) {
-                printf("%4d to %4d",
-                    ((abi-28) * 10) + 100,
-                    ((abi-27) * 10) + 100);
-            }
-            else {
-                printf("     >= %4d",
-                    ((abi-28) * 10) + 100);
-            }
+        if (job >= work->njobs) break;
 
-            printf("\t%8d\n", analyze_bins[abi]);
+        for (vi = 0; job >= work->vars[vi].ncols; ++vi) {
+            job -= work->vars[vi].ncols;
         }
+
+        _flag_outliers_var_column(work->filter, &work->vars[vi], job, thread);
     }
 
-    free(new_qc);
-    free(datap);
-    return(1);
+    return((void *)NULL);
 }
 
 /**
-*  Flag outliers using the Mean and Mean Absolute Deviation Method (MAD).
-*
-*  For this outlier detection method the mean of the absolute deviations
-*  from the data's mean (MAD) is calculated.  If a value is a certain number
-*  of MAD away from the mean of the residuals, that value is classified as
-*  an outlier. A typical default value for the threshold is 3.
-*
-*  The MAD is more resilient to outliers in a data set than the standard
-*  deviation. In the standard deviation, the distances from the mean are
-*  squared, so large deviations are weighted more heavily, and thus outliers
-*  can heavily influence it. In the MAD, the deviations of a small number of
-*  outliers are irrelevant.
+*  Run an outlier filter on a list of variables.
 *
-*  The 'analyze' option can be used to analyze the outlier detection results
-*  during development and help determine the best window width and threshold
-*  to use.  Remember to set this value to 0 before creating a production
-*  release.  Available options are:
-*
-*    - 1 = prints ranges of mean absolute deviations from the mean,
-*          and the number of points that fall within each range.
-*
-*    - 2 = for each point prints time offset, data value, window mean,
-*          deviation from the mean, mean absolute deviation, and number
-*          of mean absolute deviations the value is from the mean.
-*
-*  If an error occurs in this function it will be appended to the log and
-*  error mail messages, and the process status will be set appropriately.
-*
-*  @param   dataset        pointer to the dataset
-*  @param   var_name       name of the variable
-*  @param   window_width   width of window centered on data point (in seconds)
-*  @param   min_npoints    minimum number of values within window required
-*                          to perform the test (default is 2).
-*  @param   skipped_flag   QC flag value to use for values that do not have
-*                          enough points in window to perform the test.
-*  @param   bad_threshold  MAD factor used to flag outliers as bad
-*  @param   bad_flag       QC flag value to use for bad outliers
-*  @param   ind_threshold  MAD factor used to flag outliers as indeterminate
-*  @param   ind_flag       QC flag value to use for indeterminate outliers
-*  @param   analyze        Print statistics that may be helpfull during
-*                          development (see above).
+*  @param   dataset    pointer to the dataset
+*  @param   nvars      number of variables
+*  @param   var_names  names of the variables
+*  @param   filter     pointer to the OutlierFilter structure
+*  @param   nthreads   maximum number of threads to use
 *
 *  @retval   1  successful
 *  @retval   0  a fatal error occurred
 */
-int dsproc_flag_outliers_mean_mad(
-    CDSGroup     *dataset,
-    const char   *var_name,
-    double        window_width,
-    int           min_npoints,
-    unsigned int  skipped_flag,
-    double        bad_threshold,
-    unsigned int  bad_flag,
-    double        ind_threshold,
-    unsigned int  ind_flag,
-    unsigned int  analyze)
+static int _flag_outliers(
+    CDSGroup      *dataset,
+    int            nvars,
+    const char   **var_names,
+    OutlierFilter *filter,
+    int            nthreads)
 {
-    double        half_width = window_width / 2;
-    size_t        nsamples;
-    double       *times;
-    double       *datap;
-    double        missing;
-    unsigned int *qcp;
-    unsigned int  qc_bad_mask;
-    unsigned int *new_qc;
-    double        sum, sum2, mean, mad, dev;
-    size_t        ei, si, ti, wi;
-    int           n, status;
-
-    const char *method = "Mean and Mean Absolute Deviation Method (MAD)";
-    int         nanalyze_bins = 60;
-    int         analyze_bins[nanalyze_bins];
-    int         abi, nbad, nskipped;
-    double      nmads;
-
-    DEBUG_LV1( DSPROC_LIB_NAME,
-        "%s:%s: Flagging Outliers using %s\n",
-        dataset->name, var_name, method);
-
-    if (analyze) {
-
-        memset(analyze_bins, 0, nanalyze_bins * sizeof(int));
+    OutlierWork    work;
+    OutlierVar    *vars;
+    OutlierThread *threads;
+    int            nstarted;
+    int            rc;
+    size_t         nvalues;
+    size_t         ti;
+    int            status;
+    int            vi, thi;
+
+    for (vi = 0; vi < nvars; ++vi) {
+        DEBUG_LV1( DSPROC_LIB_NAME,
+            "%s:%s: Flagging Outliers using %s\n",
+            dataset->name, var_names[vi], _OutlierMethods[filter->method].name);
+    }
 
-        printf(
-            "\n"
-            "Analyzing Outlier Detection using %s\n"
-            "\n"
-            " - dataset:       %s\n"
-            " - variable:      %s\n"
-            " - window width:  %g\n",
-            method, dataset->name, var_name, window_width);
-
-        if (analyze >= 2) {
-            printf(
-            " - bad threshold: %g\t\n"
-            " - ind threshold: %g\t\n"
-            "\n"
-            "%15s\t%15s\t%15s\t%15s\t%15s\t%15s\n",
-            bad_threshold,
-            ind_threshold,
-            "time_offset", "value", "mean", "dev", "mad", "dev/mad");
-        }
+    if (filter->analyze) {
+        _print_outlier_analysis_header(filter, dataset, var_names[0]);
+        nthreads = 1;
     }
 
-    if (min_npoints < 2) {
-        min_npoints = 2;
+    if (filter->min_npoints < 2) {
+        filter->min_npoints = 2;
     }
 
-    status = _init_outlier_filter(
-        dataset,    var_name,
-        &nsamples, &times,
-        &datap,    &missing,
-        &qcp,      &qc_bad_mask);
+    if (nthreads < 1) nthreads = 1;
+    if (nthreads > MAX_OUTLIER_THREADS) nthreads = MAX_OUTLIER_THREADS;
 
-    if (status <= 0) return(0);
+    memset(&work, 0, sizeof(OutlierWork));
+    threads = (OutlierThread *)NULL;
+    status  = 0;
 
-    if (nsamples < (size_t)min_npoints) {
+    vars = calloc(nvars, sizeof(OutlierVar));
+    if (!vars) goto MEMORY_ERROR;
 
-        for (ti = 0; ti < nsamples; ++ti) {
-            qcp[ti] |= skipped_flag;
-        }
+    /* Get the data for all variables */
 
-        free(datap);
-        return(1);
+    for (vi = 0; vi < nvars; ++vi) {
+        if (!_init_outlier_filter(dataset, var_names[vi], filter, &vars[vi])) {
+            goto CLEANUP;
+        }
+        work.njobs += vars[vi].ncols;
     }
 
-    new_qc = calloc(nsamples, sizeof(unsigned int));
-    if (!new_qc) {
-
-        ERROR( DSPROC_LIB_NAME,
-            "Could not run outlier test for variable: %s:%s\n"
-            " -> memory allocation error\n",
-            dataset->name, var_name);
-            
-        dsproc_set_status(DSPROC_ENOMEM);
-
-        free(datap);
-        return(0);
+    if (work.njobs == 0) {
+        status = 1;
+        goto CLEANUP;
     }
 
-    nbad = nskipped = 0;
-    si = ei = 0;
-
-    for (ti = 0; ti < nsamples; ++ti) {
-
-        /* Skip bad and missing values */
+    if (filter->nsamples < (size_t)filter->min_npoints) {
 
-        if (qcp[ti] & qc_bad_mask || datap[ti] == missing) {
-            if (analyze) {
-                nbad += 1;
-                if (analyze >= 2) {
-                    printf("%15.6f\t%15.6f\tbad\n",
-                        times[ti], datap[ti]);
-                }
+        for (vi = 0; vi < nvars; ++vi) {
+            nvalues = filter->nsamples * vars[vi].ncols;
+            for (ti = 0; ti < nvalues; ++ti) {
+                vars[vi].qcp[ti] |= filter->skipped_flag;
             }
-            continue;
         }
 
-        /* Find start of window */
+        status = 1;
+        goto CLEANUP;
+    }
 
-        while (times[ti] - times[si] > half_width) ++si;
+    if (!_init_outlier_windows(filter)) goto MEMORY_ERROR;
 
-        /* Find end of window */
+    /* Create the buffers used by each thread */
 
-        while ((ei < nsamples) && (times[ei] - times[ti]) <= half_width) ++ei;
+    if ((size_t)nthreads > work.njobs) nthreads = (int)work.njobs;
 
-        /* Compute mean */
+    threads = calloc(nthreads, sizeof(OutlierThread));
+    if (!threads) goto MEMORY_ERROR;
 
-        n = sum = sum2 = 0;
+    for (thi = 0; thi < nthreads; ++thi) {
 
-        for (wi = si; wi < ei; ++wi) {
-            if (!(qcp[wi] & qc_bad_mask) && (datap[wi] != missing)) {
-                sum += datap[wi];
-                n   += 1;
-            }
-        }
+        threads[thi].work = &work;
 
-        if (n < min_npoints) {
-            new_qc[ti] |= skipped_flag;
-            if (analyze) {
-                nskipped += 1;
-                if (analyze >= 2) {
-                    printf("%15.6f\t%15.6f\tnot enough points (%d < %d)\n",
-                        times[ti], datap[ti], n, min_npoints);
-                }
-            }
-            continue;
+        if (!(threads[thi].values = malloc(filter->nsamples * sizeof(double))) ||
+            !(threads[thi].qc     = malloc(filter->nsamples * sizeof(unsigned int))) ||
+            !(threads[thi].new_qc = malloc(filter->nsamples * sizeof(unsigned int)))) {
+
+            goto MEMORY_ERROR;
         }
 
-        mean = sum/n;
+        if (filter->method == DSPROC_OUTLIERS_IQD ||
+            filter->method == DSPROC_OUTLIERS_MEAN_MAD ||
+            filter->method == DSPROC_OUTLIERS_MEDIAN_MAD) {
 
-        /* Compute sum of the differences from the mean */
+            threads[thi].window = dsproc_create_order_stats(
+                filter->nsamples, NULL);
 
-        for (wi = si; wi < ei; ++wi) {
-            if (!(qcp[wi] & qc_bad_mask) && (datap[wi] != missing)) {
-                sum2 += fabs(datap[wi] - mean);
-            }
+            if (!threads[thi].window) goto MEMORY_ERROR;
         }
+    }
 
-        /* Compute mean absolute deviation */
+    /* Filter all columns of all variables */
 
-        mad = sum2/n;
+    work.filter = filter;
+    work.vars   = vars;
 
-        /* Check for outlier */
+    pthread_mutex_init(&work.mutex, NULL);
 
-        dev = fabs(datap[ti] - mean);
+    for (nstarted = 1; nstarted < nthreads; ++nstarted) {
 
-        if (dev > bad_threshold * mad) {
-            new_qc[ti] |= bad_flag;
-        }
+        rc = pthread_create(&threads[nstarted].thread, NULL,
+            _flag_outliers_thread, &threads[nstarted]);
 
-        if (dev > ind_threshold * mad) {
-            new_qc[ti] |= ind_flag;
+        if (rc != 0) {
+
+            DEBUG_LV1( DSPROC_LIB_NAME,
+                "Could not create outlier filter thread: %s\n",
+                strerror(rc));
+
+            break;
         }
+    }
 
-        if (analyze) {
+    _flag_outliers_thread(&threads[0]);
 
-            if (dev == 0) {
-                abi   = 0;
-                nmads = 0;
-            }
-            else if (mad == 0) {
-                abi   = nanalyze_bins - 1;
-                nmads = 1.0 / 0.0;
-            }
-            else {
+    for (thi = 1; thi < nstarted; ++thi) {
+        pthread_join(threads[thi].thread, NULL);
+    }
 
-                nmads = dev/mad;
-                abi   = (int)(nmads * 2);
+    pthread_mutex_destroy(&work.mutex);
 
-                if ((nmads * 2) - abi == 0) abi -= 1;
+    if (filter->analyze) {
+        _print_outlier_analysis_summary(filter);
+    }
 
-                if (abi >= nanalyze_bins) {
-                    abi = nanalyze_bins - 1;
-                }
-            }
+    status = 1;
+    goto CLEANUP;
 
-            analyze_bins[abi] += 1;
+MEMORY_ERROR:
 
-            if (analyze >= 2) {
+    ERROR( DSPROC_LIB_NAME,
+        "Could not run outlier test for variable: %s:%s\n"
+        " -> memory allocation error\n",
+        dataset->name, var_names[0]);
 
-                printf("%15.6f\t%15.6f\t%15.6f\t%15.8f\t%15.8f\t%15.2f",
-                    times[ti], datap[ti], mean, dev, mad, nmads);
+    dsproc_set_status(DSPROC_ENOMEM);
 
-                if      (new_qc[ti] & bad_flag) printf("\tBAD");
-                else if (new_qc[ti] & ind_flag) printf("\tind");
+CLEANUP:
 
-                printf("\n");
-            }
+    if (threads) {
+        for (thi = 0; thi < nthreads; ++thi) {
+            if (threads[thi].values) free(threads[thi].values);
+            if (threads[thi].qc)     free(threads[thi].qc);
+            if (threads[thi].new_qc) free(threads[thi].new_qc);
+            dsproc_free_order_stats(threads[thi].window);
         }
+        free(threads);
     }
 
-    for (ti = 0; ti < nsamples; ++ti) {
-        qcp[ti] |= new_qc[ti];
+    if (vars) {
+        for (vi = 0; vi < nvars; ++vi) {
+            if (vars[vi].datap) free(vars[vi].datap);
+        }
+        free(vars);
     }
 
-    if (analyze) {
+    if (filter->win_start) free(filter->win_start);
+    if (filter->win_end)   free(filter->win_end);
 
-        printf(
-            "\n"
-            " - skipped %d bad points\n"
-            " - skipped %d points that had less than %d points in window\n"
-            "\n"
-            "%-12s\t%s\n",
-            nbad, nskipped, min_npoints,
-            "# of MADs", "# of points\n");
-
-        for (abi = 0; abi < nanalyze_bins; ++abi) {
-
-            if (abi == nanalyze_bins-1) {
-                printf("     >= %4.1f", (double)nanalyze_bins/2);
-            }
-            else {
-                printf("%4.1f to %4.1f", (float)abi/2, (float)abi/2 + 0.5);
-            }
-
-            printf("\t%8d\n", analyze_bins[abi]);
-
-        }
-    }
+    filter->win_start = (size_t *)NULL;
+    filter->win_end   = (size_t *)NULL;
 
-    free(new_qc);
-    free(datap);
-    return(1);
+    return(status);
 }
 
 /**
-*  Flag outliers using the Median and Median Absolute Deviation Method (MAD).
-*
-*  For this outlier detection method the median of the absolute deviations
-*  from the data's median (MAD) is calculated.  If a value is a certain number
-*  of MAD away from the median of the residuals, that value is classified as
-*  an outlier. A typical default value for the threshold is 3.
+*  Initialize an OutlierFilter structure.
+*/
+static void _set_outlier_filter(
+    OutlierFilter   *filter,
+    DSOutlierMethod  method,
+    double           window_width,
+    int              min_npoints,
+    unsigned int     skipped_flag,
+    double           bad_threshold,
+    unsigned int     bad_flag,
+    double           ind_threshold,
+    unsigned int     ind_flag,
+    unsigned int     analyze)
+{
+    memset(filter, 0, sizeof(OutlierFilter));
+
+    filter->method        = method;
+    filter->window_width  = window_width;
+    filter->min_npoints   = min_npoints;
+    filter->skipped_flag  = skipped_flag;
+    filter->bad_threshold = bad_threshold;
+    filter->bad_flag      = bad_flag;
+    filter->ind_threshold = ind_threshold;
+    filter->ind_flag      = ind_flag;
+    filter->analyze       = analyze;
+}
+
+/** @publicsection */
+
+/*******************************************************************************
+ *  Functions Visible To The Public
+ */
+
+/**
+*  Flag outliers using the Median and Interquartile Deviation Method (IQD).
+*
+*  For this outlier detection method, the median of the residuals is
+*  calculated, along with the 25th percentile and the 75th percentile. The
+*  difference between the 25th and 75th percentile is the interquartile
+*  deviation (IQD). Then, the difference is calculated between each
+*  value and the residual median. If the value is a certain number of IQD
+*  away from the median of the residuals, that value is classified as an
+*  outlier. A typical default value for the threshold is 3.
+*
+*  The 'analyze' option can be used to analyze the outlier detection results
+*  during development and help determine the best window width and threshold
+*  to use.  Remember to set this value to 0 before creating a production
+*  release.  Available options are:
+*
+*    - 1 = prints ranges of interquartile deviations from the median,
+*          and the number of points that fall within each range.
+*
+*    - 2 = for each point prints time offset, data value, window median,
+*          deviation from the median, interquartile deviation, and number
+*          of interquartile deviations the value is from the median.
+*
+*  If an error occurs in this function it will be appended to the log and
+*  error mail messages, and the process status will be set appropriately.
+*
+*  @param   dataset        pointer to the dataset
+*  @param   var_name       name of the variable
+*  @param   window_width   width of window centered on data point (in seconds)
+*  @param   min_npoints    minimum number of values within window required
+*                          to perform the test (default is 2).
+*  @param   skipped_flag   QC flag value to use for values that do not have
+*                          enough points in window to perform the test.
+*  @param   bad_threshold  IQD factor used to flag outliers as bad
+*  @param   bad_flag       QC flag value to use for bad outliers
+*  @param   ind_threshold  IQD factor used to flag outliers as indeterminate
+*  @param   ind_flag       QC flag value to use for indeterminate outliers
+*  @param   analyze        Print statistics that may be helpfull during
+*                          development (see above).
+*
+*  @retval   1  successful
+*  @retval   0  a fatal error occurred
+*/
+int dsproc_flag_outliers_iqd(
+    CDSGroup     *dataset,
+    const char   *var_name,
+    double        window_width,
+    int           min_npoints,
+    unsigned int  skipped_flag,
+    double        bad_threshold,
+    unsigned int  bad_flag,
+    double        ind_threshold,
+    unsigned int  ind_flag,
+    unsigned int  analyze)
+{
+    OutlierFilter filter;
+
+    _set_outlier_filter(&filter, DSPROC_OUTLIERS_IQD,
+        window_width, min_npoints, skipped_flag,
+        bad_threshold, bad_flag, ind_threshold, ind_flag, analyze);
+
+    return(_flag_outliers(dataset, 1, &var_name, &filter, 1));
+}
+
+/**
+*  Flag outliers using the Absolute Deviation from the Mean Method.
+*
+*  For this outlier detection method values are flagged based on their
+*  absolute deviation from the mean of the surrounding values.
+*
+*  The 'analyze' option can be used to analyze the outlier detection results
+*  during development and help determine the best window width and threshold
+*  to use.  Remember to set this value to 0 before creating a production
+*  release.  Available options are:
+*
+*    - 1 = prints ranges of absolute deviations from the mean,
+*          and the number of points that fall within each range.
+*
+*    - 2 = for each point prints time offset, data value, window mean,
+*          and absolute deviation from the mean.
+*
+*  If an error occurs in this function it will be appended to the log and
+*  error mail messages, and the process status will be set appropriately.
+*
+*  @param   dataset        pointer to the dataset
+*  @param   var_name       name of the variable
+*  @param   window_width   width of window centered on data point (in seconds)
+*  @param   min_npoints    minimum number of values within window required
+*                          to perform the test (default is 2).
+*  @param   skipped_flag   QC flag value to use for values that do not have
+*                          enough points in window to perform the test.
+*  @param   bad_threshold  delta from mean used to flag outliers as bad
+*  @param   bad_flag       QC flag value to use for bad outliers
+*  @param   ind_threshold  delta from mean used to flag outliers as indeterminate
+*  @param   ind_flag       QC flag value to use for indeterminate outliers
+*  @param   analyze        Print statistics that may be helpfull during
+*                          development (see above).
+*
+*  @retval   1  successful
+*  @retval   0  a fatal error occurred
+*/
+int dsproc_flag_outliers_mean_dev(
+    CDSGroup     *dataset,
+    const char   *var_name,
+    double        window_width,
+    int           min_npoints,
+    unsigned int  skipped_flag,
+    double        bad_threshold,
+    unsigned int  bad_flag,
+    double        ind_threshold,
+    unsigned int  ind_flag,
+    unsigned int  analyze)
+{
+    OutlierFilter filter;
+
+    _set_outlier_filter(&filter, DSPROC_OUTLIERS_MEAN_DEV,
+        window_width, min_npoints, skipped_flag,
+        bad_threshold, bad_flag, ind_threshold, ind_flag, analyze);
+
+    return(_flag_outliers(dataset, 1, &var_name, &filter, 1));
+}
+
+/**
+*  Flag outliers using the Mean and Mean Absolute Deviation Method (MAD).
+*
+*  For this outlier detection method the mean of the absolute deviations
+*  from the data's mean (MAD) is calculated.  If a value is a certain number
+*  of MAD away from the mean of the residuals, that value is classified as
+*  an outlier. A typical default value for the threshold is 3.
+*
+*  The MAD is more resilient to outliers in a data set than the standard
+*  deviation. In the standard deviation, the distances from the mean are
+*  squared, so large deviations are weighted more heavily, and thus outliers
+*  can heavily influence it. In the MAD, the deviations of a small number of
+*  outliers are irrelevant.
+*
+*  The 'analyze' option can be used to analyze the outlier detection results
+*  during development and help determine the best window width and threshold
+*  to use.  Remember to set this value to 0 before creating a production
+*  release.  Available options are:
+*
+*    - 1 = prints ranges of mean absolute deviations from the mean,
+*          and the number of points that fall within each range.
+*
+*    - 2 = for each point prints time offset, data value, window mean,
+*          deviation from the mean, mean absolute deviation, and number
+*          of mean absolute deviations the value is from the mean.
+*
+*  If an error occurs in this function it will be appended to the log and
+*  error mail messages, and the process status will be set appropriately.
+*
+*  @param   dataset        pointer to the dataset
+*  @param   var_name       name of the variable
+*  @param   window_width   width of window centered on data point (in seconds)
+*  @param   min_npoints    minimum number of values within window required
+*                          to perform the test (default is 2).
+*  @param   skipped_flag   QC flag value to use for values that do not have
+*                          enough points in window to perform the test.
+*  @param   bad_threshold  MAD factor used to flag outliers as bad
+*  @param   bad_flag       QC flag value to use for bad outliers
+*  @param   ind_threshold  MAD factor used to flag outliers as indeterminate
+*  @param   ind_flag       QC flag value to use for indeterminate outliers
+*  @param   analyze        Print statistics that may be helpfull during
+*                          development (see above).
+*
+*  @retval   1  successful
+*  @retval   0  a fatal error occurred
+*/
+int dsproc_flag_outliers_mean_mad(
+    CDSGroup     *dataset,
+    const char   *var_name,
+    double        window_width,
+    int           min_npoints,
+    unsigned int  skipped_flag,
+    double        bad_threshold,
+    unsigned int  bad_flag,
+    double        ind_threshold,
+    unsigned int  ind_flag,
+    unsigned int  analyze)
+{
+    OutlierFilter filter;
+
+    _set_outlier_filter(&filter, DSPROC_OUTLIERS_MEAN_MAD,
+        window_width, min_npoints, skipped_flag,
+        bad_threshold, bad_flag, ind_threshold, ind_flag, analyze);
+
+    return(_flag_outliers(dataset, 1, &var_name, &filter, 1));
+}
+
+/**
+*  Flag outliers using the Median and Median Absolute Deviation Method (MAD).
+*
+*  For this outlier detection method the median of the absolute deviations
+*  from the data's median (MAD) is calculated.  If a value is a certain number
+*  of MAD away from the median of the residuals, that value is classified as
+*  an outlier. A typical default value for the threshold is 3.
 *
 *  The MAD is more resilient to outliers in a data set than the standard
 *  deviation. In the standard deviation, the distances from the mean are
@@ -1113,244 +1451,13 @@ int dsproc_flag_outliers_median_mad(
     unsigned int  ind_flag,
     unsigned int  analyze)
 {
-    double        half_width = window_width / 2;
-    size_t        nsamples;
-    double       *times;
-    double       *datap;
-    double        missing;
-    unsigned int *qcp;
-    unsigned int  qc_bad_mask;
-    unsigned int *new_qc;
-    double       *buffer;
-    int           bi, bn;
-    double        median, mad, dev;
-    size_t        ei, si, ti, wi;
-    int           status;
-
-    const char *method = "Median and Median Absolute Deviation Method (MAD)";
-    int         nanalyze_bins = 60;
-    int         analyze_bins[nanalyze_bins];
-    int         abi, nbad, nskipped;
-    double      nmads;
-
-    DEBUG_LV1( DSPROC_LIB_NAME,
-        "%s:%s: Flagging Outliers using %s\n",
-        dataset->name, var_name, method);
-
-    if (analyze) {
-
-        memset(analyze_bins, 0, nanalyze_bins * sizeof(int));
-
-        printf(
-            "\n"
-            "Analyzing Outlier Detection using %s\n"
-            "\n"
-            " - dataset:       %s\n"
-            " - variable:      %s\n"
-            " - window width:  %g\n",
-            method, dataset->name, var_name, window_width);
-
-        if (analyze >= 2) {
-            printf(
-            " - bad threshold: %g\t\n"
-            " - ind threshold: %g\t\n"
-            "\n"
-            "%15s\t%15s\t%15s\t%15s\t%15s\t%15s\n",
-            bad_threshold,
-            ind_threshold,
-            "time_offset", "value", "median", "dev", "mad", "dev/mad");
-        }
-    }
-
-    if (min_npoints < 2) {
-        min_npoints = 2;
-    }
-
-    status = _init_outlier_filter(
-        dataset,    var_name,
-        &nsamples, &times,
-        &datap,    &missing,
-        &qcp,      &qc_bad_mask);
-
-    if (status <= 0) return(0);
-
-    if (nsamples < (size_t)min_npoints) {
-
-        for (ti = 0; ti < nsamples; ++ti) {
-            qcp[ti] |= skipped_flag;
-        }
-
-        free(datap);
-        return(1);
-    }
-
-    if (!(buffer = malloc(nsamples * sizeof(double))) ||
-        !(new_qc = calloc(nsamples, sizeof(unsigned int)))) {
-
-        ERROR( DSPROC_LIB_NAME,
-            "Could not run outlier test for variable: %s:%s\n"
-            " -> memory allocation error\n",
-            dataset->name, var_name);
-            
-        dsproc_set_status(DSPROC_ENOMEM);
-        free(datap);
-        return(0);
-    }
-
-    nbad = nskipped = 0;
-    si = ei = 0;
-
-    for (ti = 0; ti < nsamples; ++ti) {
-
-        /* Skip bad and missing values */
-
-        if (qcp[ti] & qc_bad_mask || datap[ti] == missing) {
-            if (analyze) {
-                nbad += 1;
-                if (analyze >= 2) {
-                    printf("%15.6f\t%15.6f\tbad\n",
-                        times[ti], datap[ti]);
-                }
-            }
-            continue;
-        }
-
-        /* Find start of window */
+    OutlierFilter filter;
 
-        while (times[ti] - times[si] > half_width) ++si;
-
-        /* Find end of window */
-
-        while ((ei < nsamples) && (times[ei] - times[ti]) <= half_width) ++ei;
-
-        /* Find median of window */
+    _set_outlier_filter(&filter, DSPROC_OUTLIERS_MEDIAN_MAD,
+        window_width, min_npoints, skipped_flag,
+        bad_threshold, bad_flag, ind_threshold, ind_flag, analyze);
 
-        bn = 0;
-
-        for (wi = si; wi < ei; ++wi) {
-            if (!(qcp[wi] & qc_bad_mask) && (datap[wi] != missing)) {
-                buffer[bn++] = datap[wi];
-            }
-        }
-
-        if (bn < min_npoints) {
-            new_qc[ti] |= skipped_flag;
-            if (analyze) {
-                nskipped += 1;
-                if (analyze >= 2) {
-                    printf("%15.6f\t%15.6f\tnot enough points (%d < %d)\n",
-                        times[ti], datap[ti], bn, min_npoints);
-                }
-            }
-            continue;
-        }
-
-        qsort(buffer, bn, sizeof(double), _dbl_compare);
-
-        if (bn & 0x1) { /* odd number of points */
-            median = buffer[(bn-1)/2];
-        }
-        else {
-            median = (buffer[bn/2 - 1] + buffer[bn/2])/2;
-        }
-
-        /* Find median of deltas from the median */
-
-        for (bi = 0; bi < bn; ++bi) {
-            buffer[bi] = fabs(buffer[bi] - median);
-        }
-
-        qsort(buffer, bn, sizeof(double), _dbl_compare);
-
-        if (bn & 0x1) { /* odd number of points */
-            mad = buffer[(bn-1)/2];
-        }
-        else {
-            mad = (buffer[bn/2 - 1] + buffer[bn/2])/2;
-        }
-
-        /* Check for outlier */
-
-        dev = fabs(datap[ti] - median);
-
-        if (dev > bad_threshold * mad) {
-            new_qc[ti] |= bad_flag;
-        }
-
-        if (dev > ind_threshold * mad) {
-            new_qc[ti] |= ind_flag;
-        }
-
-        if (analyze) {
-
-            if (dev == 0) {
-                abi   = 0;
-                nmads = 0;
-            }
-            else if (mad == 0) {
-                abi   = nanalyze_bins - 1;
-                nmads = 1.0 / 0.0;
-            }
-            else {
-
-                nmads = dev/mad;
-                abi   = (int)(nmads * 2);
-
-                if ((nmads * 2) - abi == 0) abi -= 1;
-
-                if (abi >= nanalyze_bins) {
-                    abi = nanalyze_bins - 1;
-                }
-            }
-
-            analyze_bins[abi] += 1;
-
-            if (analyze >= 2) {
-
-                printf("%15.6f\t%15.6f\t%15.6f\t%15.8f\t%15.8f\t%15.2f",
-                    times[ti], datap[ti], median, dev, mad, nmads);
-
-                if      (new_qc[ti] & bad_flag) printf("\tBAD");
-                else if (new_qc[ti] & ind_flag) printf("\tind");
-
-                printf("\n");
-            }
-        }
-    }
-
-    for (ti = 0; ti < nsamples; ++ti) {
-        qcp[ti] |= new_qc[ti];
-    }
-
-    if (analyze) {
-
-        printf(
-            "\n"
-            " - skipped %d bad points\n"
-            " - skipped %d points that had less than %d points in window\n"
-            "\n"
-            "%-12s\t%s\n",
-            nbad, nskipped, min_npoints,
-            "# of MADs", "# of points\n");
-
-        for (abi = 0; abi < nanalyze_bins; ++abi) {
-
-            if (abi == nanalyze_bins-1) {
-                printf("     >= %4.1f", (double)nanalyze_bins/2);
-            }
-            else {
-                printf("%4.1f to %4.1f", (float)abi/2, (float)abi/2 + 0.5);
-            }
-
-            printf("\t%8d\n", analyze_bins[abi]);
-
-        }
-    }
-
-    free(buffer);
-    free(new_qc);
-    free(datap);
-    return(1);
+    return(_flag_outliers(dataset, 1, &var_name, &filter, 1));
 }
 
 /**
@@ -1410,235 +1517,551 @@ int dsproc_flag_outliers_std(
     unsigned int  ind_flag,
     unsigned int  analyze)
 {
-    double        half_width = window_width / 2;
-    size_t        nsamples;
-    double       *times;
-    double       *datap;
-    double        missing;
-    unsigned int *qcp;
-    unsigned int  qc_bad_mask;
-    unsigned int *new_qc;
-    double        sum, sum2, diff, mean, var, std, dev;
-    size_t        ei, si, ti, wi;
-    int           n, status;
-
-    const char *method = "Mean and Standard Deviation Method";
-    int         nanalyze_bins = 60;
-    int         analyze_bins[nanalyze_bins];
-    int         abi, nbad, nskipped;
-    double      nstds;
-
-    DEBUG_LV1( DSPROC_LIB_NAME,
-        "%s:%s: Flagging Outliers using %s\n",
-        dataset->name, var_name, method);
-
-    if (analyze) {
-
-        memset(analyze_bins, 0, nanalyze_bins * sizeof(int));
+    OutlierFilter filter;
 
-        printf(
-            "\n"
-            "Analyzing Outlier Detection using %s\n"
-            "\n"
-            " - dataset:       %s\n"
-            " - variable:      %s\n"
-            " - window width:  %g\n",
-            method, dataset->name, var_name, window_width);
-
-        if (analyze >= 2) {
-            printf(
-            " - bad threshold: %g\t\n"
-            " - ind threshold: %g\t\n"
-            "\n"
-            "%15s\t%15s\t%15s\t%15s\t%15s\t%15s\n",
-            bad_threshold,
-            ind_threshold,
-            "time_offset", "value", "mean", "dev", "std", "dev/std");
-        }
-    }
+    _set_outlier_filter(&filter, DSPROC_OUTLIERS_STD,
+        window_width, min_npoints, skipped_flag,
+        bad_threshold, bad_flag, ind_threshold, ind_flag, analyze);
 
-    if (min_npoints < 2) {
-        min_npoints = 2;
+    return(_flag_outliers(dataset, 1, &var_name, &filter, 1));
+}
+
+/**
+*  Flag outliers in a list of variables.
+*
+*  This function runs the specified outlier filter on all variables in the
+*  list. The time data and the window boundaries are computed once and
+*  shared by all variables. Variables with more than one dimension must be
+*  dimensioned by time first, and the values for each index of the inner
+*  dimensions (i.e. each height of a time x height profile) are filtered
+*  as an independent time series. The single variable functions above
+*  also accept multi-dimensional variables.
+*
+*  Independent columns are filtered concurrently when more than one thread
+*  is requested, and the QC flags are set in the QC variables in place.
+*
+*  The thresholds have the same meaning as in the single variable function
+*  for the selected method (i.e. dsproc_flag_outliers_std() for the
+*  DSPROC_OUTLIERS_STD method).
+*
+*  If an error occurs in this function it will be appended to the log and
+*  error mail messages, and the process status will be set appropriately.
+*
+*  @param   dataset        pointer to the dataset
+*  @param   nvars          number of variables in the list
+*  @param   var_names      names of the variables
+*  @param   method         outlier detection method
+*  @param   window_width   width of window centered on data point (in seconds)
+*  @param   min_npoints    minimum number of values within window required
+*                          to perform the test (default is 2).
+*  @param   skipped_flag   QC flag value to use for values that do not have
+*                          enough points in window to perform the test.
+*  @param   bad_threshold  threshold used to flag outliers as bad
+*  @param   bad_flag       QC flag value to use for bad outliers
+*  @param   ind_threshold  threshold used to flag outliers as indeterminate
+*  @param   ind_flag       QC flag value to use for indeterminate outliers
+*  @param   nthreads       maximum number of threads to use
+*
+*  @retval   1  successful
+*  @retval   0  a fatal error occurred
+*/
+int dsproc_flag_outliers(
+    CDSGroup        *dataset,
+    int              nvars,
+    const char     **var_names,
+    DSOutlierMethod  method,
+    double           window_width,
+    int              min_npoints,
+    unsigned int     skipped_flag,
+    double           bad_threshold,
+    unsigned int     bad_flag,
+    double           ind_threshold,
+    unsigned int     ind_flag,
+    int              nthreads)
+{
+    OutlierFilter filter;
+
+    if (method < DSPROC_OUTLIERS_IQD || method > DSPROC_OUTLIERS_STD) {
+
+        ERROR( DSPROC_LIB_NAME,
+            "Could not run outlier test for dataset: %s\n"
+            " -> invalid outlier method: %d\n",
+            dataset->name, method);
+
+        dsproc_set_status("Could Not Run Outlier Test");
+
+        return(0);
     }
 
-    status = _init_outlier_filter(
-        dataset,    var_name,
-        &nsamples, &times,
-        &datap,    &missing,
-        &qcp,      &qc_bad_mask);
+    if (nvars <= 0) return(1);
 
-    if (status <= 0) return(0);
+    _set_outlier_filter(&filter, method,
+        window_width, min_npoints, skipped_flag,
+        bad_threshold, bad_flag, ind_threshold, ind_flag, 0);
 
-    if (nsamples < (size_t)min_npoints) {
+    return(_flag_outliers(dataset, nvars, var_names, &filter, nthreads));
+}
 
-        for (ti = 0; ti < nsamples; ++ti) {
-            qcp[ti] |= skipped_flag;
-        }
+/*******************************************************************************
+ *  Rolling Order Statistics
+ */
 
-        free(datap);
-        return(1);
+/**
+ *  Structure used to track order statistics over a sliding window.
+ */
+struct DSOrderStats {
+
+    size_t         nvalues;  /**< number of values in the series            */
+    double        *sorted;   /**< series values sorted in ascending order    */
+    size_t        *rank;     /**< position of each value in the sorted array */
+    int           *tree;     /**< Fenwick tree of window counts by rank      */
+    double        *sums;     /**< Fenwick tree of window sums by rank        */
+    unsigned char *member;   /**< flags values currently in the window       */
+    void          *pairs;    /**< buffer used to rank the values             */
+    size_t         top_bit;  /**< largest power of two <= nvalues            */
+    int            count;    /**< number of values in the window             */
+};
+
+typedef struct {
+    double value;
+    size_t index;
+} _OSPair;
+
+/**
+ *  qsort function to compare two value/index pairs.
+ */
+static int _os_pair_compare(const void *vp1, const void *vp2)
+{
+    const _OSPair *p1 = (const _OSPair *)vp1;
+    const _OSPair *p2 = (const _OSPair *)vp2;
+
+    if (p1->value < p2->value) return(-1);
+    if (p1->value > p2->value) return(1);
+    if (p1->index < p2->index) return(-1);
+    return(p1->index > p2->index);
+}
+
+/**
+ *  Get the k-th smallest deviation from the median.
+ *
+ *  The deviations of the values below the median and above the median
+ *  form two sorted sequences. The k-th smallest value of the merged
+ *  sequences is found using a binary search on the number of values
+ *  taken from the lower sequence.
+ *
+ *  @param  os      pointer to the DSOrderStats structure
+ *  @param  median  window median
+ *  @param  k       index of the deviation to get (0 = smallest)
+ *
+ *  @return  the k-th smallest absolute deviation from the median
+ */
+static double _os_kth_deviation(DSOrderStats *os, double median, int k)
+{
+    int    nlo = (os->count + 1) / 2;
+    int    nhi = os->count - nlo;
+    int    lo  = (k + 1 > nhi) ? k + 1 - nhi : 0;
+    int    hi  = (k + 1 < nlo) ? k + 1 : nlo;
+    int    i, j;
+    double a, b;
+
+    /* lower deviation i = median - value(nlo - 1 - i)
+     * upper deviation j = value(nlo + j) - median */
+
+    while (lo < hi) {
+
+        i = (lo + hi) / 2;
+        j = k + 1 - i;
+
+        a = median - dsproc_order_stats_kth(os, nlo - 1 - i);
+        b = dsproc_order_stats_kth(os, nlo + j - 1) - median;
+
+        if (j > 0 && b > a) {
+            lo = i + 1;
+        }
+        else {
+            hi = i;
+        }
     }
 
-    new_qc = calloc(nsamples, sizeof(unsigned int));
-    if (!new_qc) {
+    i = lo;
+    j = k + 1 - i;
+
+    a = (i > 0) ? median - dsproc_order_stats_kth(os, nlo - i) : -1.0;
+    b = (j > 0) ? dsproc_order_stats_kth(os, nlo + j - 1) - median : -1.0;
+
+    return((a > b) ? a : b);
+}
+
+/**
+ *  Create a structure used to track order statistics over a sliding window.
+ *
+ *  The values of the complete series are ranked once when the structure is
+ *  created. Values are then added to and removed from the window by index
+ *  as the window slides over the series, and order statistics of the values
+ *  in the window can be queried at any time. Adding, removing, and getting
+ *  the k-th smallest value in the window all take O(log n) time.
+ *
+ *  The memory used by the returned structure is dynamically allocated and
+ *  must be freed using dsproc_free_order_stats().
+ *
+ *  If an error occurs in this function it will be appended to the log and
+ *  error mail messages, and the process status will be set appropriately.
+ *
+ *  @param   nvalues  number of values in the series
+ *  @param   values   pointer to the series values, or NULL to set them
+ *                    later using dsproc_order_stats_set_values()
+ *
+ *  @retval  os    pointer to the new DSOrderStats structure
+ *  @retval  NULL  if a memory allocation error occurred
+ */
+DSOrderStats *dsproc_create_order_stats(size_t nvalues, const double *values)
+{
+    DSOrderStats *os;
+
+    os = (DSOrderStats *)calloc(1, sizeof(DSOrderStats));
+
+    if (!os ||
+        !(os->pairs  = malloc((nvalues + 1) * sizeof(_OSPair))) ||
+        !(os->sorted = (double *)malloc((nvalues + 1) * sizeof(double))) ||
+        !(os->rank   = (size_t *)malloc((nvalues + 1) * sizeof(size_t))) ||
+        !(os->tree   = (int *)calloc(nvalues + 1, sizeof(int))) ||
+        !(os->sums   = (double *)calloc(nvalues + 1, sizeof(double))) ||
+        !(os->member = (unsigned char *)calloc(nvalues + 1, sizeof(unsigned char)))) {
 
         ERROR( DSPROC_LIB_NAME,
-            "Could not run outlier test for variable: %s:%s\n"
-            " -> memory allocation error\n",
-            dataset->name, var_name);
-            
+            "Could not create order statistics structure\n"
+            " -> memory allocation error\n");
+
         dsproc_set_status(DSPROC_ENOMEM);
 
-        free(datap);
-        return(0);
+        dsproc_free_order_stats(os);
+        return((DSOrderStats *)NULL);
     }
 
-    nbad = nskipped = 0;
-    si = ei = 0;
+    os->nvalues = nvalues;
+    os->top_bit = 1;
 
-    for (ti = 0; ti < nsamples; ++ti) {
+    while (os->top_bit * 2 <= nvalues) os->top_bit *= 2;
 
-        /* Skip bad and missing values */
+    if (values) {
+        dsproc_order_stats_set_values(os, values);
+    }
 
-        if (qcp[ti] & qc_bad_mask || datap[ti] == missing) {
-            if (analyze) {
-                nbad += 1;
-                if (analyze >= 2) {
-                    printf("%15.6f\t%15.6f\tbad\n",
-                        times[ti], datap[ti]);
-                }
-            }
-            continue;
-        }
+    return(os);
+}
 
-        /* Find start of window */
+/**
+ *  Set the series values used by a DSOrderStats structure.
+ *
+ *  This function ranks a new series of values with the same length as the
+ *  one the structure was created for, and removes all values from the
+ *  window. It does not allocate memory, so it is safe to use the same
+ *  structure to process multiple series.
+ *
+ *  @param  os      pointer to the DSOrderStats structure
+ *  @param  values  pointer to the series values
+ */
+void dsproc_order_stats_set_values(DSOrderStats *os, const double *values)
+{
+    _OSPair *pairs = (_OSPair *)os->pairs;
+    size_t   i;
 
-        while (times[ti] - times[si] > half_width) ++si;
+    for (i = 0; i < os->nvalues; ++i) {
+        pairs[i].value = values[i];
+        pairs[i].index = i;
+    }
 
-        /* Find end of window */
+    qsort(pairs, os->nvalues, sizeof(_OSPair), _os_pair_compare);
 
-        while ((ei < nsamples) && (times[ei] - times[ti]) <= half_width) ++ei;
+    for (i = 0; i < os->nvalues; ++i) {
+        os->sorted[i]            = pairs[i].value;
+        os->rank[pairs[i].index] = i;
+    }
 
-        /* Using two pass method for numerical stability */
+    dsproc_order_stats_clear(os);
+}
 
-        /* Compute mean */
+/**
+ *  Free a DSOrderStats structure.
+ *
+ *  @param  os  pointer to the DSOrderStats structure
+ */
+void dsproc_free_order_stats(DSOrderStats *os)
+{
+    if (os) {
+        if (os->sorted) free(os->sorted);
+        if (os->rank)   free(os->rank);
+        if (os->tree)   free(os->tree);
+        if (os->sums)   free(os->sums);
+        if (os->member) free(os->member);
+        if (os->pairs)  free(os->pairs);
+        free(os);
+    }
+}
 
-        n = sum = sum2 = 0;
-        
-        for (wi = si; wi < ei; ++wi) {
-            if (!(qcp[wi] & qc_bad_mask) && (datap[wi] != missing)) {
-                sum += datap[wi];
-                n   += 1;
-            }
-        }
+/**
+ *  Add a value to the window.
+ *
+ *  Values that are already in the window are ignored.
+ *
+ *  @param  os     pointer to the DSOrderStats structure
+ *  @param  index  index of the value in the series
+ */
+void dsproc_order_stats_add(DSOrderStats *os, size_t index)
+{
+    double value;
+    size_t ti;
 
-        if (n < min_npoints) {
-            new_qc[ti] |= skipped_flag;
-            if (analyze) {
-                nskipped += 1;
-                if (analyze >= 2) {
-                    printf("%15.6f\t%15.6f\tnot enough points (%d < %d)\n",
-                        times[ti], datap[ti], n, min_npoints);
-                }
-            }
-            continue;
-        }
+    if (index >= os->nvalues || os->member[index]) return;
 
-        mean = sum/n;
+    value = os->sorted[os->rank[index]];
 
-        /* Compute sum of the squares of the differences from the mean */
+    for (ti = os->rank[index] + 1; ti <= os->nvalues; ti += ti & -ti) {
+        os->tree[ti] += 1;
+        os->sums[ti] += value;
+    }
 
-        for (wi = si; wi < ei; ++wi) {
-            if (!(qcp[wi] & qc_bad_mask) && (datap[wi] != missing)) {
-                diff  = datap[wi] - mean;
-                sum2 += (diff * diff);
-            }
-        }
+    os->member[index] = 1;
+    os->count += 1;
+}
 
-        /* Compute standard deviation */
+/**
+ *  Remove a value from the window.
+ *
+ *  Values that are not in the window are ignored.
+ *
+ *  @param  os     pointer to the DSOrderStats structure
+ *  @param  index  index of the value in the series
+ */
+void dsproc_order_stats_remove(DSOrderStats *os, size_t index)
+{
+    double value;
+    size_t ti;
 
-        var = sum2 / n;
-        std = sqrt(var);
+    if (index >= os->nvalues || !os->member[index]) return;
 
-        /* Check for outlier */
+    value = os->sorted[os->rank[index]];
 
-        dev = fabs(datap[ti] - mean);
+    for (ti = os->rank[index] + 1; ti <= os->nvalues; ti += ti & -ti) {
+        os->tree[ti] -= 1;
+        os->sums[ti] -= value;
+    }
 
-        if (dev > bad_threshold * std) {
-            new_qc[ti] |= bad_flag;
-        }
+    os->member[index] = 0;
+    os->count -= 1;
+}
 
-        if (dev > ind_threshold * std) {
-            new_qc[ti] |= ind_flag;
+/**
+ *  Remove all values from the window.
+ *
+ *  @param  os  pointer to the DSOrderStats structure
+ */
+void dsproc_order_stats_clear(DSOrderStats *os)
+{
+    memset(os->tree,   0, (os->nvalues + 1) * sizeof(int));
+    memset(os->sums,   0, (os->nvalues + 1) * sizeof(double));
+    memset(os->member, 0, (os->nvalues + 1) * sizeof(unsigned char));
+    os->count = 0;
+}
+
+/**
+ *  Get the number of values in the window.
+ *
+ *  @param  os  pointer to the DSOrderStats structure
+ *
+ *  @return  number of values in the window
+ */
+int dsproc_order_stats_count(DSOrderStats *os)
+{
+    return(os->count);
+}
+
+/**
+ *  Get the k-th smallest value in the window.
+ *
+ *  @param  os  pointer to the DSOrderStats structure
+ *  @param  k   index of the value in the sorted window (0 = smallest)
+ *
+ *  @return  the k-th smallest value, or NAN if k is out of range
+ */
+double dsproc_order_stats_kth(DSOrderStats *os, int k)
+{
+    size_t pos  = 0;
+    int    left = k + 1;
+    size_t step;
+
+    if (k < 0 || k >= os->count) return(NAN);
+
+    for (step = os->top_bit; step; step >>= 1) {
+        if (pos + step <= os->nvalues && os->tree[pos + step] < left) {
+            pos  += step;
+            left -= os->tree[pos];
         }
+    }
 
-        if (analyze) {
+    return(os->sorted[pos]);
+}
 
-            if (dev == 0) {
-                abi   = 0;
-                nstds = 0;
-            }
-            else if (std == 0) {
-                abi   = nanalyze_bins - 1;
-                nstds = 1.0 / 0.0;
-            }
-            else {
+/**
+ *  Get the median of the values in the window.
+ *
+ *  @param  os  pointer to the DSOrderStats structure
+ *
+ *  @return  the median value, or NAN if the window is empty
+ */
+double dsproc_order_stats_median(DSOrderStats *os)
+{
+    int n = os->count;
 
-                nstds = dev/std;
-                abi   = (int)(nstds * 2);
+    if (n == 0) return(NAN);
 
-                if ((nstds * 2) - abi == 0) abi -= 1;
+    if (n & 0x1) { /* odd number of points */
+        return(dsproc_order_stats_kth(os, (n-1)/2));
+    }
 
-                if (abi >= nanalyze_bins) {
-                    abi = nanalyze_bins - 1;
-                }
-            }
+    return((dsproc_order_stats_kth(os, n/2 - 1) +
+            dsproc_order_stats_kth(os, n/2)) / 2);
+}
 
-            analyze_bins[abi] += 1;
+/**
+ *  Get the median and median absolute deviation of the values in the window.
+ *
+ *  @param  os      pointer to the DSOrderStats structure
+ *  @param  median  output: median of the values
+ *  @param  mad     output: median of the absolute deviations from the median
+ *
+ *  @retval  1  if successful
+ *  @retval  0  if the window is empty
+ */
+int dsproc_order_stats_median_mad(
+    DSOrderStats *os,
+    double       *median,
+    double       *mad)
+{
+    int n = os->count;
 
-            if (analyze >= 2) {
+    if (n == 0) return(0);
 
-                printf("%15.6f\t%15.6f\t%15.6f\t%15.8f\t%15.8f\t%15.2f",
-                    times[ti], datap[ti], mean, dev, std, nstds);
+    *median = dsproc_order_stats_median(os);
 
-                if      (new_qc[ti] & bad_flag) printf("\tBAD");
-                else if (new_qc[ti] & ind_flag) printf("\tind");
+    if (n & 0x1) { /* odd number of points */
+        *mad = _os_kth_deviation(os, *median, (n-1)/2);
+    }
+    else {
+        *mad = (_os_kth_deviation(os, *median, n/2 - 1) +
+                _os_kth_deviation(os, *median, n/2)) / 2;
+    }
 
-                printf("\n");
-            }
-        }
+    return(1);
+}
+
+/**
+ *  Get the mean absolute deviation of the values in the window from a
+ *  center value.
+ *
+ *  The values below the center are found using a binary search on the
+ *  sorted series, and the count and sum of the window values on each side
+ *  of the center are then taken from the Fenwick trees.
+ *
+ *  @param  os      pointer to the DSOrderStats structure
+ *  @param  center  value to compute the deviations from (i.e. the mean)
+ *
+ *  @return  the mean absolute deviation, or NAN if the window is empty
+ */
+double dsproc_order_stats_mean_abs_dev(DSOrderStats *os, double center)
+{
+    size_t lo = 0;
+    size_t hi = os->nvalues;
+    size_t mid, ti;
+    int    nbelow;
+    double sum_below, sum_total, sum;
+
+    if (os->count == 0) return(NAN);
+
+    /* Find the number of series values less than the center */
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (os->sorted[mid] < center) lo = mid + 1;
+        else                          hi = mid;
     }
 
-    for (ti = 0; ti < nsamples; ++ti) {
-        qcp[ti] |= new_qc[ti];
+    /* Get the count and sum of the window values below the center */
+
+    nbelow    = 0;
+    sum_below = 0;
+
+    for (ti = lo; ti > 0; ti -= ti & -ti) {
+        nbelow    += os->tree[ti];
+        sum_below += os->sums[ti];
     }
 
-    if (analyze) {
+    sum_total = 0;
 
-        printf(
-            "\n"
-            " - skipped %d bad points\n"
-            " - skipped %d points that had less than %d points in window\n"
-            "\n"
-            "%-12s\t%s\n",
-            nbad, nskipped, min_npoints,
-            "# of STDs", "# of points\n");
-
-        for (abi = 0; abi < nanalyze_bins; ++abi) {
-
-            if (abi == nanalyze_bins-1) {
-                printf("     >= %4.1f", (double)nanalyze_bins/2);
-            }
-            else {
-                printf("%4.1f to %4.1f", (float)abi/2, (float)abi/2 + 0.5);
-            }
+    for (ti = os->nvalues; ti > 0; ti -= ti & -ti) {
+        sum_total += os->sums[ti];
+    }
 
-            printf("\t%8d\n", analyze_bins[abi]);
+    sum = (center * nbelow - sum_below)
+        + (sum_total - sum_below - center * (os->count - nbelow));
 
-        }
+    if (sum < 0) sum = 0;
+
+    return(sum / os->count);
+}
+
+/**
+ *  Get the quartiles of the values in the window.
+ *
+ *  The median is used as the second quartile, and the first and third
+ *  quartiles are the medians of the lower and upper halves of the values
+ *  (excluding the median for an odd number of values).
+ *
+ *  @param  os  pointer to the DSOrderStats structure
+ *  @param  q1  output: first quartile
+ *  @param  q2  output: second quartile (median)
+ *  @param  q3  output: third quartile
+ *
+ *  @retval  1  if successful
+ *  @retval  0  if there are less than two values in the window
+ */
+int dsproc_order_stats_quartiles(
+    DSOrderStats *os,
+    double       *q1,
+    double       *q2,
+    double       *q3)
+{
+    int n = os->count;
+    int qi, qn;
+
+    if (n < 2) return(0);
+
+    if (n & 0x1) {
+        /* odd number of points */
+        qn  = (n-1)/2;
+        *q2 = dsproc_order_stats_kth(os, qn);
+    }
+    else {
+        /* even number of points */
+        qn  = n/2;
+        *q2 = (dsproc_order_stats_kth(os, qn-1) +
+               dsproc_order_stats_kth(os, qn)) / 2;
+    }
+
+    if (qn & 0x1) {
+        /* odd number of points */
+        qi  = (qn-1)/2;
+        *q1 = dsproc_order_stats_kth(os, qi);
+        *q3 = dsproc_order_stats_kth(os, n - qi - 1);
+    }
+    else {
+        /* even number of points */
+        qi  = qn/2;
+        *q1 = (dsproc_order_stats_kth(os, qi-1) +
+               dsproc_order_stats_kth(os, qi)) / 2;
+        *q3 = (dsproc_order_stats_kth(os, n - qi - 1) +
+               dsproc_order_stats_kth(os, n - qi)) / 2;
     }
 
-    free(new_qc);
-    free(datap);
     return(1);
 }
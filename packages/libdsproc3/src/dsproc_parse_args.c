@@ -68,6 +68,7 @@ struct {
     { '\0', "max-runtime"        },
     { '\0', "max-warnings"       },
     { '\0', "output-csv"         },
+    { '\0', "prefetch"           },
     { '\0', "provenance"         },
     { '\0', "real-time"          },
     { '\0', NULL                 }
@@ -732,6 +733,10 @@ static void _dsproc_print_advanced_options(FILE *output_stream, int type)
     if (type == 2) { // vap
         fprintf(output_stream,
 "\n"
+"  --prefetch            Read the input files for the next processing interval\n"
+"                        in the background while the current interval is being\n"
+"                        processed.\n"
+"\n"
 "  --real-time   [time]  Enable real-time processing mode and set the time in\n"
 "                        hours to wait for missing input data. When this option\n"
 "                        is used the --begin and --end dates do not need to be\n"
@@ -1451,6 +1456,9 @@ void _dsproc_vap_parse_args(
             else if (strcmp(opt, "--no-quicklook") == 0) {
                 dsproc_set_quicklook_mode(QUICKLOOK_DISABLE);
             }
+            else if (strcmp(opt, "--prefetch") == 0) {
+                dsproc_set_prefetch_mode(1);
+            }
             else if (strcmp(opt, "--real-time") == 0) {
 
                 if (argc > 1 && isdigit(*(argv+1)[0])) {
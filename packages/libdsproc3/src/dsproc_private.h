@@ -256,6 +256,25 @@ void _dsproc_free_var_dqrs(VarDQR **var_dqrs);
 typedef struct DSDir DSDir; /**< Datastream Directory Structure */
 typedef struct DSFile DSFile; /**< Datastream File Structure */
 
+/** Name of the file time index file in a datastream directory. */
+#define DSDIR_INDEX_FILE ".dsproc_file_index"
+
+/**
+ *  Datastream File Time Index Entry.
+ */
+typedef struct DSFileIndexEntry {
+
+    char       *name;        /**< name of the file                          */
+    off_t       size;        /**< size of the file when it was indexed      */
+    time_t      mtime_sec;   /**< mtime of the file when it was indexed     */
+    long        mtime_nsec;  /**< nanoseconds part of the mtime             */
+    int         ntimes;      /**< number of times in the file               */
+    timeval_t   begin;       /**< first time in the file                    */
+    timeval_t   end;         /**< last time in the file                     */
+    char       *dod_version; /**< DOD version of the file, or NULL          */
+
+} DSFileIndexEntry;
+
 /**
  *  Datastream File Structure.
  */
@@ -278,6 +297,9 @@ struct DSFile {
     timeval_t   *timevals;   /**< array of time values                        */
 
     CDSGroup    *dod;        /**< CDSGroup containing the DOD for this file   */
+
+    DSFile      *lru_prev;   /**< more recently used file in the open pool    */
+    DSFile      *lru_next;   /**< less recently used file in the open pool    */
 };
 
 /**
@@ -312,8 +334,31 @@ struct DSDir {
 
     /** List of compiled regex file name time patterns */
     RETimeList *file_name_time_patterns;
+
+    /** flag used to enable the persistent file time index */
+    int use_file_index;
+
+    int               nindex;        /**< number of file index entries     */
+    int               max_index;     /**< allocated length of the index    */
+    DSFileIndexEntry *index;         /**< entries sorted by file name      */
+    int               index_loaded;  /**< the index file has been read     */
+    int               index_changed; /**< the index needs to be saved      */
+
+    /** flag indicating versioned files were found in the directory */
+    int found_versions;
+
+    /** flag indicating the file list needs to be resorted */
+    int resort;
+
+    int nlisted;    /**< number of names read from the directory         */
+    int nevaluated; /**< number of new names matched against the patterns */
+
+    int watch_fd;     /**< inotify descriptor used in real time mode, or -1 */
+    int watch_failed; /**< the directory could not be watched               */
 };
 
+int     _dsproc_add_dsdir_file(DSDir *dir, const char *name);
+
 int     _dsproc_add_dsdir_patterns(
             DSDir       *dir,
             int          npatterns,
@@ -325,6 +370,12 @@ char  **_dsproc_clone_file_list(int nfiles, char **file_list);
 DSDir  *_dsproc_create_dsdir(const char *path);
 void    _dsproc_free_dsdir(DSDir *dir);
 
+int     _dsproc_find_cached_dsdir_files(
+            DSDir    *dir,
+            time_t    begin_time,
+            time_t    end_time,
+            char   ***file_list);
+
 int     _dsproc_find_dsdir_files(
             DSDir    *dir,
             time_t    begin_time,
@@ -344,6 +395,16 @@ int     _dsproc_find_next_dsfile(
 
 int     _dsproc_get_dsdir_files(DSDir *dir, char ***files);
 
+int     _dsproc_save_dsdir_index(DSDir *dir);
+
+int     _dsproc_update_dsdir_index(
+            DSDir      *dir,
+            const char *name,
+            int         ntimes,
+            timeval_t  *begin,
+            timeval_t  *end,
+            const char *dod_version);
+
 DSFile *_dsproc_get_dsfile(DSDir *dir, const char *name);
 
 time_t  _dsproc_get_file_name_time(
@@ -388,6 +449,20 @@ typedef struct {
                                  in this file. */
 } RetDsFile;
 
+/**
+ *  Retriever Dimension Subset Structure.
+ */
+typedef struct {
+
+    char     *dim_name;     /**< name of the dimension in the input files     */
+    int       by_value;     /**< flag indicating a coordinate value range     */
+    size_t    start;        /**< index of the first value to retrieve         */
+    size_t    count;        /**< number of values to retrieve (0 = all)       */
+    double    min_value;    /**< minimum coordinate value to retrieve         */
+    double    max_value;    /**< maximum coordinate value to retrieve         */
+
+} RetDimSubset;
+
 /**
  *  Retriever DataStream Cache Structure.
  */
@@ -408,6 +483,10 @@ typedef struct {
     int         nfiles;         /**< number of files in the list           */
     RetDsFile **files;          /**< list of files found within the
                                      current processing interval           */
+
+    int           nsubsets;     /**< number of dimension subsets           */
+    RetDimSubset *subsets;      /**< dimension subsets to retrieve         */
+
 } RetDsCache;
 
 void            _dsproc_free_ret_ds_cache(RetDsCache *cache);
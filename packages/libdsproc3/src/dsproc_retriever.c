@@ -20,6 +20,9 @@
  *  Retriever Functions.
  */
 
+#include <pthread.h>
+#include <fcntl.h>
+
 #include "dsproc3.h"
 #include "dsproc_private.h"
 
@@ -36,6 +39,287 @@ static timeval_t _RetData_EndTime;
 static char      _RetData_TimeDesc[64];
 static char      _RetData_TimeUnits[64];
 
+/** Flag indicating if input files should be prefetched. */
+static int       _PrefetchMode = 0;
+
+/** Maximum number of threads used to prefetch input files. */
+#define MAX_READ_THREADS 32
+
+/** Background threads reading the input files. */
+static pthread_t _PrefetchThreads[MAX_READ_THREADS];
+
+/** Mutex protecting the next file index and the byte count. */
+static pthread_mutex_t _PrefetchMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int          _PrefetchNThreads = 0;    /**< number of threads started */
+static volatile int _PrefetchCancel   = 0;    /**< stop reading files        */
+static int          _PrefetchNPaths   = 0;    /**< number of files to read   */
+static char       **_PrefetchPaths    = NULL; /**< full paths of the files   */
+static int          _PrefetchNext     = 0;    /**< next file to read         */
+static size_t       _PrefetchBytes    = 0;    /**< number of bytes read      */
+
+/**
+ *  Static: Prefetch thread function.
+ *
+ *  Reads the files in the prefetch list so they are in the page cache when
+ *  they are opened by the retriever. When more than one thread is running
+ *  each thread takes the next unread file from the list. This function only
+ *  uses system calls, it must not call any library functions that use the
+ *  internal DSProc structure or the message logs.
+ *
+ *  @param  arg - not used
+ *
+ *  @return  NULL
+ */
+static void *_dsproc_prefetch_files(void *arg)
+{
+    size_t   buflen = 1024 * 1024;
+    char    *buffer;
+    size_t   nbytes;
+    ssize_t  nread;
+    int      fd;
+    int      pi;
+
+    buffer = (char *)malloc(buflen);
+    if (!buffer) return(NULL);
+
+    while (!_PrefetchCancel) {
+
+        pthread_mutex_lock(&_PrefetchMutex);
+        pi = _PrefetchNext++;
+        pthread_mutex_unlock(&_PrefetchMutex);
+
+        if (pi >= _PrefetchNPaths) break;
+
+        fd = open(_PrefetchPaths[pi], O_RDONLY);
+        if (fd < 0) continue;
+
+#ifdef POSIX_FADV_WILLNEED
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+
+        nbytes = 0;
+
+        while (!_PrefetchCancel &&
+               (nread = read(fd, buffer, buflen)) > 0) {
+
+            nbytes += nread;
+        }
+
+        close(fd);
+
+        pthread_mutex_lock(&_PrefetchMutex);
+        _PrefetchBytes += nbytes;
+        pthread_mutex_unlock(&_PrefetchMutex);
+    }
+
+    free(buffer);
+
+    return(NULL);
+}
+
+/**
+ *  Static: Wait for the prefetch threads to finish and free the file list.
+ *
+ *  @param  cancel - stop reading files that have not been read yet
+ */
+static void _dsproc_finish_prefetch(int cancel)
+{
+    int pi;
+    int ti;
+
+    if (_PrefetchNThreads) {
+
+        _PrefetchCancel = cancel;
+
+        for (ti = 0; ti < _PrefetchNThreads; ti++) {
+            pthread_join(_PrefetchThreads[ti], NULL);
+        }
+
+        DEBUG_LV1( DSPROC_LIB_NAME,
+            "Prefetched %lu bytes from %d input files using %d threads\n",
+            (unsigned long)_PrefetchBytes,
+            (_PrefetchNext < _PrefetchNPaths) ? _PrefetchNext : _PrefetchNPaths,
+            _PrefetchNThreads);
+
+        _PrefetchNThreads = 0;
+        _PrefetchCancel   = 0;
+    }
+
+    if (_PrefetchPaths) {
+
+        for (pi = 0; pi < _PrefetchNPaths; ++pi) {
+            free(_PrefetchPaths[pi]);
+        }
+
+        free(_PrefetchPaths);
+    }
+
+    _PrefetchPaths  = (char **)NULL;
+    _PrefetchNPaths = 0;
+    _PrefetchNext   = 0;
+    _PrefetchBytes  = 0;
+}
+
+/**
+ *  Static: Start reading the input files for a processing interval.
+ *
+ *  The files are located on the calling thread using the cached file lists
+ *  of the datastream directories and the retriever time offsets, only the
+ *  reading of the files is done in the background. The directories are not
+ *  read again here, so files that arrive after the last listing are not
+ *  prefetched, and failing to list a directory can not change the process
+ *  status. One read thread is started for
+ *  each input datastream with files to read (up to MAX_READ_THREADS), and
+ *  the files are ordered round robin across the datastreams, so the first
+ *  files of all datastreams are read first and datastreams on different
+ *  storage are read concurrently. Prefetching is best effort, so errors are
+ *  only reported as debug messages.
+ *
+ *  @param  begin_time - begin time of the processing interval
+ *  @param  end_time   - end time of the processing interval
+ */
+static void _dsproc_start_prefetch(time_t begin_time, time_t end_time)
+{
+    DataStream  *in_ds;
+    RetDsCache  *cache;
+    char      ***ds_files  = (char ***)NULL;
+    int         *ds_nfiles = (int *)NULL;
+    int          max_nfiles;
+    int          max_paths;
+    int          nreaders;
+    int          in_dsid;
+    int          fi;
+    int          ti;
+    int          rc;
+    size_t       length;
+    char         ts1[32], ts2[32];
+
+    _dsproc_finish_prefetch(1);
+
+    if (_DSProc->ndatastreams == 0) {
+        return;
+    }
+
+    /* Get the number of files needed from each input datastream */
+
+    ds_files  = (char ***)calloc(_DSProc->ndatastreams, sizeof(char **));
+    ds_nfiles = (int *)calloc(_DSProc->ndatastreams, sizeof(int));
+    if (!ds_files || !ds_nfiles) goto MEMORY_ERROR;
+
+    max_nfiles = 0;
+    max_paths  = 0;
+    nreaders   = 0;
+
+    for (in_dsid = 0; in_dsid < _DSProc->ndatastreams; in_dsid++) {
+
+        in_ds = _DSProc->datastreams[in_dsid];
+        cache = in_ds->ret_cache;
+
+        if (!cache || !in_ds->dir) {
+            continue;
+        }
+
+        ds_nfiles[in_dsid] = _dsproc_find_cached_dsdir_files(in_ds->dir,
+            begin_time - cache->begin_offset,
+            end_time   + cache->end_offset,
+            &ds_files[in_dsid]);
+
+        if (ds_nfiles[in_dsid] <= 0) {
+            ds_nfiles[in_dsid] = 0;
+            continue;
+        }
+
+        if (ds_nfiles[in_dsid] > max_nfiles) {
+            max_nfiles = ds_nfiles[in_dsid];
+        }
+
+        max_paths += ds_nfiles[in_dsid];
+        nreaders++;
+    }
+
+    if (max_paths == 0) {
+        free(ds_files);
+        free(ds_nfiles);
+        return;
+    }
+
+    _PrefetchPaths = (char **)calloc(max_paths, sizeof(char *));
+    if (!_PrefetchPaths) goto MEMORY_ERROR;
+
+    /* Create the round robin list of file paths */
+
+    for (fi = 0; fi < max_nfiles; fi++) {
+
+        for (in_dsid = 0; in_dsid < _DSProc->ndatastreams; in_dsid++) {
+
+            if (fi >= ds_nfiles[in_dsid]) {
+                continue;
+            }
+
+            in_ds  = _DSProc->datastreams[in_dsid];
+            length = strlen(in_ds->dir->path) + strlen(ds_files[in_dsid][fi]) + 2;
+
+            _PrefetchPaths[_PrefetchNPaths] = (char *)malloc(length);
+            if (!_PrefetchPaths[_PrefetchNPaths]) goto MEMORY_ERROR;
+
+            sprintf(_PrefetchPaths[_PrefetchNPaths],
+                "%s/%s", in_ds->dir->path, ds_files[in_dsid][fi]);
+
+            _PrefetchNPaths++;
+        }
+    }
+
+    free(ds_files);
+    free(ds_nfiles);
+    ds_files  = (char ***)NULL;
+    ds_nfiles = (int *)NULL;
+
+    DEBUG_LV1( DSPROC_LIB_NAME,
+        "Prefetching %d input files for processing interval:\n"
+        " - begin time: %s\n"
+        " - end time:   %s\n",
+        _PrefetchNPaths,
+        format_secs1970(begin_time, ts1),
+        format_secs1970(end_time,   ts2));
+
+    if (nreaders > MAX_READ_THREADS) {
+        nreaders = MAX_READ_THREADS;
+    }
+
+    for (ti = 0; ti < nreaders; ti++) {
+
+        rc = pthread_create(&_PrefetchThreads[ti], NULL,
+            _dsproc_prefetch_files, NULL);
+
+        if (rc != 0) {
+
+            DEBUG_LV1( DSPROC_LIB_NAME,
+                "Could not start prefetch thread: %s\n", strerror(rc));
+
+            break;
+        }
+
+        _PrefetchNThreads++;
+    }
+
+    if (_PrefetchNThreads == 0) {
+        _dsproc_finish_prefetch(1);
+    }
+
+    return;
+
+MEMORY_ERROR:
+
+    DEBUG_LV1( DSPROC_LIB_NAME,
+        "Could not prefetch input files: memory allocation error\n");
+
+    if (ds_files)  free(ds_files);
+    if (ds_nfiles) free(ds_nfiles);
+
+    _dsproc_finish_prefetch(1);
+}
+
 /**
  *  Static: Add a CDS variable to a CDS variable group.
  *
@@ -304,22 +588,16 @@ static int _dsproc_init_ret_dsfile(
     CDSAtt      *units_att;
     time_t       bt_status;
     char         units_string[64];
-    double      *time_offsets;
     int          start_index;
     int          end_index;
     int          count;
 
-    CDSVar      *time_bounds_var;
-    int          tb_start;
-    int          tb_count;
-    double      *time_bounds;
-
 //    int          qc_varid;
 //    CDSVar      *qc_var;
 
     CDSAtt      *att;
     int          status;
-    int          ai, t1, t2;
+    int          ai;
 
     int          skip_file;
     char         ts1[32], ts2[32];
@@ -474,13 +752,20 @@ static int _dsproc_init_ret_dsfile(
 
     ret_file->obs_group = obs_group;
 
-    /* Read in the time variable */
+    /* Read in the time variable. Only the samples within the current
+     * processing interval are read unless complete observations are
+     * being retrieved. */
+
+    if (in_ds->flags & DS_PRESERVE_OBS) {
+        start_index = 0;
+        count       = dsfile->ntimes;
+    }
 
-    nsamples = 0;
+    nsamples = (size_t)count;
     time_var = ncds_get_var_by_id(
         dsfile->ncid,
         dsfile->time_varid,
-        0,
+        (size_t)start_index,
         &nsamples,
         obs_group,
         "time",
@@ -497,13 +782,13 @@ static int _dsproc_init_ret_dsfile(
         return(-1);
     }
 
-    if (nsamples != (size_t)dsfile->ntimes) {
+    if (nsamples != (size_t)count) {
 
         ERROR( DSPROC_LIB_NAME,
             "Could not read time variable from input file: %s\n"
-            " -> number of times in DSFile struct: %d\n"
-            " -> sample_count of time variable:    %d\n",
-            dsfile->name, dsfile->ntimes, (int)nsamples);
+            " -> number of times expected:      %d\n"
+            " -> sample_count of time variable: %d\n",
+            dsfile->name, count, (int)nsamples);
 
         dsproc_set_status(DSPROC_ENCREAD);
         return(-1);
@@ -585,46 +870,16 @@ static int _dsproc_init_ret_dsfile(
         }
     }
 
-    /* Get the start and end indexes of the time_offsets
+    /* Set the start and count of the samples
      * within the current processing interval. */
 
-    if (in_ds->flags & DS_PRESERVE_OBS) {
-        ret_file->sample_start = 0;
-        ret_file->sample_count = nsamples;
-    }
-    else {
-
-        /* Shift time offsets */
-
-        time_offsets = time_var->data.dp;
-
-        for (t1 = 0, t2 = start_index; t1 < count; t1++, t2++) {
-            time_offsets[t1] = time_offsets[t2];
-        }
-
-        /* Shift time_bounds offsets if they exists */
-
-        time_bounds_var = cds_get_bounds_var(time_var);
-        if (time_bounds_var) {
-
-            tb_start = start_index * 2;
-            tb_count = count * 2;
-
-            time_bounds = time_bounds_var->data.dp;
-
-            for (t1 = 0, t2 = tb_start; t1 < tb_count; t1++, t2++) {
-                time_bounds[t1] = time_bounds[t2];
-            }
-
-            time_bounds_var->sample_count = (size_t)count;
-        }
-
+    if (!(in_ds->flags & DS_PRESERVE_OBS)) {
         time_var->dims[0]->length = (size_t)count;
-        time_var->sample_count    = (size_t)count;
-        ret_file->sample_start    = (size_t)start_index;
-        ret_file->sample_count    = (size_t)count;
     }
 
+    ret_file->sample_start = (size_t)start_index;
+    ret_file->sample_count = (size_t)count;
+
     /* Adjust the base time to be consistent with all retrieved data. */
 
     if (dsfile->base_time != _RetData_BaseTime) {
@@ -1057,6 +1312,242 @@ static int _dsproc_get_ret_file_var_info(
     return(1);
 }
 
+/**
+ *  Static: Add a dimension subset to a retriever datastream cache.
+ *
+ *  If an error occurs in this function it will be appended to the log and
+ *  error mail messages, and the process status will be set appropriately.
+ *
+ *  @param  ds_id    - input datastream ID
+ *  @param  dim_name - name of the dimension in the input files
+ *
+ *  @return
+ *    - pointer to the RetDimSubset structure
+ *    - NULL if an error occurred
+ */
+static RetDimSubset *_dsproc_add_ret_dim_subset(
+    int         ds_id,
+    const char *dim_name)
+{
+    DataStream   *ds    = _DSProc->datastreams[ds_id];
+    RetDsCache   *cache = ds->ret_cache;
+    RetDimSubset *subsets;
+    RetDimSubset *subset;
+    int           si;
+
+    if (!cache) {
+
+        ERROR( DSPROC_LIB_NAME,
+            "Could not set retriever dimension subset for: %s\n"
+            " -> not a valid input datastream\n",
+            ds->name);
+
+        dsproc_set_status(DSPROC_EBADRETRIEVER);
+        return((RetDimSubset *)NULL);
+    }
+
+    if (strcmp(dim_name, "time") == 0) {
+
+        ERROR( DSPROC_LIB_NAME,
+            "Could not set retriever dimension subset for: %s\n"
+            " -> the time dimension can not be subset\n",
+            ds->name);
+
+        dsproc_set_status(DSPROC_EBADRETRIEVER);
+        return((RetDimSubset *)NULL);
+    }
+
+    /* Replace an existing subset for this dimension */
+
+    for (si = 0; si < cache->nsubsets; si++) {
+        if (strcmp(cache->subsets[si].dim_name, dim_name) == 0) {
+            return(&(cache->subsets[si]));
+        }
+    }
+
+    subsets = (RetDimSubset *)realloc(cache->subsets,
+        (cache->nsubsets + 1) * sizeof(RetDimSubset));
+
+    if (!subsets) goto MEMORY_ERROR;
+
+    cache->subsets = subsets;
+    subset = &(subsets[cache->nsubsets]);
+
+    memset(subset, 0, sizeof(RetDimSubset));
+
+    subset->dim_name = strdup(dim_name);
+    if (!subset->dim_name) goto MEMORY_ERROR;
+
+    cache->nsubsets += 1;
+
+    return(subset);
+
+MEMORY_ERROR:
+
+    ERROR( DSPROC_LIB_NAME,
+        "Could not set retriever dimension subset for: %s\n"
+        " -> memory allocation error\n",
+        ds->name);
+
+    dsproc_set_status(DSPROC_ENOMEM);
+    return((RetDimSubset *)NULL);
+}
+
+/**
+ *  Static: Get the dimension subset for a dimension in the input files.
+ *
+ *  @param  cache    - pointer to the RetDsCache structure
+ *  @param  dim_name - name of the dimension in the input files
+ *
+ *  @return
+ *    - pointer to the RetDimSubset structure
+ *    - NULL if the full dimension should be retrieved
+ */
+static RetDimSubset *_dsproc_get_ret_dim_subset(
+    RetDsCache *cache,
+    const char *dim_name)
+{
+    int si;
+
+    for (si = 0; si < cache->nsubsets; si++) {
+        if (strcmp(cache->subsets[si].dim_name, dim_name) == 0) {
+            return(&(cache->subsets[si]));
+        }
+    }
+
+    return((RetDimSubset *)NULL);
+}
+
+/**
+ *  Static: Define the subset dimensions used by a variable.
+ *
+ *  This function defines the dimensions of a variable that have a subset
+ *  specified for the input datastream in the observation group, so only
+ *  the requested part of the dimension will be read from the input file.
+ *  Dimensions that have already been defined in the observation group
+ *  are not changed.
+ *
+ *  If an error occurs in this function it will be appended to the log and
+ *  error mail messages, and the process status will be set appropriately.
+ *
+ *  @param  in_ds         - pointer to the input datastream in _DSProc
+ *  @param  ret_file      - pointer to the RetDsFile
+ *  @param  var_ndims     - number of variable dimensions
+ *  @param  var_dim_names - names of the dimensions in the input file
+ *  @param  ret_dim_names - names of the dimensions in the observation group
+ *
+ *  @return
+ *    - 1 if successful
+ *    - 0 if an error occurred
+ */
+static int _dsproc_define_ret_dim_subsets(
+    DataStream   *in_ds,
+    RetDsFile    *ret_file,
+    int           var_ndims,
+    const char  **var_dim_names,
+    const char  **ret_dim_names)
+{
+    RetDsCache   *cache  = in_ds->ret_cache;
+    DSFile       *dsfile = ret_file->dsfile;
+    RetDimSubset *subset;
+    size_t        length;
+    size_t        start;
+    size_t        count;
+    int           status;
+    int           di, fdi;
+
+    if (!cache->nsubsets) {
+        return(1);
+    }
+
+    for (di = 0; di < var_ndims; di++) {
+
+        subset = _dsproc_get_ret_dim_subset(cache, var_dim_names[di]);
+        if (!subset) continue;
+
+        if (cds_get_dim(ret_file->obs_group, ret_dim_names[di])) {
+            continue;
+        }
+
+        for (fdi = 0; fdi < ret_file->ndims; fdi++) {
+            if (strcmp(ret_file->dim_names[fdi], var_dim_names[di]) == 0) {
+                break;
+            }
+        }
+
+        if (fdi == ret_file->ndims ||
+            ret_file->is_unlimdim[fdi]) {
+
+            continue;
+        }
+
+        length = ret_file->dim_lengths[fdi];
+
+        /* Get the index range to retrieve */
+
+        if (subset->by_value) {
+
+            status = ncds_find_coord_range(
+                dsfile->ncid, var_dim_names[di],
+                subset->min_value, subset->max_value,
+                &start, &count);
+
+            if (status < 0) {
+                dsproc_set_status(DSPROC_ENCREAD);
+                return(0);
+            }
+
+            if (status == 0) {
+
+                ERROR( DSPROC_LIB_NAME,
+                    "Could not find %s coordinate values between %g and %g in: %s\n",
+                    var_dim_names[di], subset->min_value, subset->max_value,
+                    dsfile->full_path);
+
+                dsproc_set_status(DSPROC_ERETRIEVER);
+                return(0);
+            }
+        }
+        else {
+
+            start = subset->start;
+            count = subset->count;
+
+            if (start >= length) {
+
+                ERROR( DSPROC_LIB_NAME,
+                    "Could not retrieve %s dimension subset from: %s\n"
+                    " -> start index (%lu) >= dimension length (%lu)\n",
+                    var_dim_names[di], dsfile->full_path,
+                    (unsigned long)start, (unsigned long)length);
+
+                dsproc_set_status(DSPROC_ERETRIEVER);
+                return(0);
+            }
+
+            if (count == 0 || count > length - start) {
+                count = length - start;
+            }
+        }
+
+        DEBUG_LV1( DSPROC_LIB_NAME,
+            "%s: Retrieving %s[%lu:%lu] from: %s\n",
+            in_ds->name, var_dim_names[di],
+            (unsigned long)start, (unsigned long)(start + count - 1),
+            dsfile->name);
+
+        if (!ncds_read_dim_subset(
+            dsfile->ncid, ret_file->dimids[fdi],
+            ret_file->obs_group, ret_dim_names[di], start, count)) {
+
+            dsproc_set_status(DSPROC_ERETRIEVER);
+            return(0);
+        }
+    }
+
+    return(1);
+}
+
 /**
  *  Static: Retrieve variable data from a NetCDF file.
  *
@@ -1314,7 +1805,8 @@ static int _dsproc_retrieve_variable(
 
         for (di = 0; di < var_ndims; di++) {
 
-            if (var_dim_lengths[di] != obs_var->dims[di]->length) {
+            if (var_dim_lengths[di] != obs_var->dims[di]->length &&
+                !_dsproc_get_ret_dim_subset(in_ds->ret_cache, var_dim_names[di])) {
 
                 ERROR( DSPROC_LIB_NAME,
                     "Dimension name conflicts with variable name in retriever definition\n"
@@ -1439,6 +1931,14 @@ static int _dsproc_retrieve_variable(
         ret_var_type = CDS_NAT;
     }
 
+    /* Define the dimensions that only a subset should be read for */
+
+    if (!_dsproc_define_ret_dim_subsets(
+        in_ds, ret_file, var_ndims, var_dim_names, ret_dim_names)) {
+
+        return(-1);
+    }
+
     /* Read in the data from the input file */
 
     obs_var = ncds_get_var_by_id(
@@ -2034,7 +2534,7 @@ static int _dsproc_retrieve_group(
  */
 void _dsproc_free_ret_ds_cache(RetDsCache *cache)
 {
-    int fi;
+    int fi, si;
 
     if (cache) {
 
@@ -2044,6 +2544,15 @@ void _dsproc_free_ret_ds_cache(RetDsCache *cache)
 
         if (cache->files) free(cache->files);
 
+        if (cache->subsets) {
+
+            for (si = 0; si < cache->nsubsets; si++) {
+                free(cache->subsets[si].dim_name);
+            }
+
+            free(cache->subsets);
+        }
+
         free(cache);
     }
 }
@@ -2056,6 +2565,8 @@ void _dsproc_free_retriever()
     DataStream *in_ds;
     int         in_dsid;
 
+    _dsproc_finish_prefetch(1);
+
     /* Free old retriever data and references in the input datastreams */
 
     for (in_dsid = 0; in_dsid < _DSProc->ndatastreams; in_dsid++) {
@@ -2343,6 +2854,8 @@ int dsproc_retrieve_data(
     int            int_end_time;
     int            status;
     int            rgi, rdsi, fi;
+    size_t         inplace_bytes;
+    size_t         copied_bytes;
     int            scan_mode;
 
     char           ts1[32], ts2[32];
@@ -2364,10 +2877,17 @@ int dsproc_retrieve_data(
             format_secs1970(end_time,   ts2));
     }
 
+    /* Stop reading any files prefetched for this interval that have not
+     * been read yet, the retriever will read them directly. */
+
+    _dsproc_finish_prefetch(1);
+
     /* Clean up any previous input data loaded by the retriever */
 
     _dsproc_cleanup_retrieved_data();
 
+    ncds_reset_read_stats();
+
     /* Define the parent CDSGroup used to store the retrieved data */
 
     _DSProc->ret_data = cds_define_group(NULL, "retrieved_data");
@@ -2376,6 +2896,14 @@ int dsproc_retrieve_data(
         return(-1);
     }
 
+    /* The retrieved data is deleted as a whole before the next
+     * processing interval, so its objects can come from an arena */
+
+    if (!cds_enable_arena(_DSProc->ret_data, 0)) {
+        dsproc_set_status(DSPROC_ENOMEM);
+        return(-1);
+    }
+
     *ret_data = _DSProc->ret_data;
 
     /* Set the base_time, and time units and long_name
@@ -2659,6 +3187,24 @@ int dsproc_retrieve_data(
         }
     }
 
+    _dsproc_finish_prefetch(1);
+
+    ncds_get_read_stats(&inplace_bytes, &copied_bytes);
+
+    DEBUG_LV1( DSPROC_LIB_NAME,
+        "Retrieved variable data: %lu bytes read in place, %lu bytes copied\n",
+        (unsigned long)inplace_bytes, (unsigned long)copied_bytes);
+
+    /* Start reading the input files for the next processing interval
+     * while this one is being processed. */
+
+    if (_PrefetchMode &&
+        !_DSProc->use_obs_loop &&
+        end_time < _DSProc->period_end) {
+
+        _dsproc_start_prefetch(end_time, end_time + _DSProc->proc_interval);
+    }
+
     /* Check if we found any data to process */
 
     if ((*ret_data)->ngroups == 0) {
@@ -2724,3 +3270,141 @@ void dsproc_set_retriever_time_offsets(
             ds->name);
     }
 }
+
+/**
+ *  Retrieve a range of dimension indexes from an input datastream.
+ *
+ *  By default the full length of all non-time dimensions is retrieved. This
+ *  function can be used to only read part of a dimension from the input
+ *  files, for example a subset of heights or wavelengths. The subset is
+ *  applied to all variables using the dimension, including its coordinate
+ *  and boundary variables, and only the requested hyperslab is read from
+ *  the files. It should be called from the init_process or pre-retrieval
+ *  hook function.
+ *
+ *  If an error occurs in this function it will be appended to the log and
+ *  error mail messages, and the process status will be set appropriately.
+ *
+ *  @param  ds_id    - input datastream ID
+ *  @param  dim_name - name of the dimension in the input files
+ *  @param  start    - index of the first value to retrieve
+ *  @param  count    - number of values to retrieve, or 0 to retrieve
+ *                     all values after the start index
+ *
+ *  @return
+ *    - 1 if successful
+ *    - 0 if an error occurred
+ */
+int dsproc_set_retriever_dim_subset(
+    int         ds_id,
+    const char *dim_name,
+    size_t      start,
+    size_t      count)
+{
+    RetDimSubset *subset = _dsproc_add_ret_dim_subset(ds_id, dim_name);
+
+    if (!subset) {
+        return(0);
+    }
+
+    DEBUG_LV1( DSPROC_LIB_NAME,
+        "%s: Setting retrieval subset for dimension %s\n"
+        " - start: %lu\n"
+        " - count: %lu\n",
+        _DSProc->datastreams[ds_id]->name, dim_name,
+        (unsigned long)start, (unsigned long)count);
+
+    subset->by_value = 0;
+    subset->start    = start;
+    subset->count    = count;
+
+    return(1);
+}
+
+/**
+ *  Retrieve a range of coordinate values from an input datastream.
+ *
+ *  This is the same as dsproc_set_retriever_dim_subset() except that the
+ *  subset is specified using coordinate values. The index range is found
+ *  in each input file using the values of the coordinate variable in that
+ *  file, so the number of values retrieved can change between files.
+ *
+ *  If an error occurs in this function it will be appended to the log and
+ *  error mail messages, and the process status will be set appropriately.
+ *
+ *  @param  ds_id     - input datastream ID
+ *  @param  dim_name  - name of the dimension in the input files
+ *  @param  min_value - minimum coordinate value to retrieve
+ *  @param  max_value - maximum coordinate value to retrieve
+ *
+ *  @return
+ *    - 1 if successful
+ *    - 0 if an error occurred
+ */
+int dsproc_set_retriever_dim_range(
+    int         ds_id,
+    const char *dim_name,
+    double      min_value,
+    double      max_value)
+{
+    RetDimSubset *subset = _dsproc_add_ret_dim_subset(ds_id, dim_name);
+
+    if (!subset) {
+        return(0);
+    }
+
+    DEBUG_LV1( DSPROC_LIB_NAME,
+        "%s: Setting retrieval range for dimension %s\n"
+        " - min value: %g\n"
+        " - max value: %g\n",
+        _DSProc->datastreams[ds_id]->name, dim_name,
+        min_value, max_value);
+
+    subset->by_value  = 1;
+    subset->min_value = min_value;
+    subset->max_value = max_value;
+
+    return(1);
+}
+
+/**
+ *  Get the input file prefetch mode.
+ *
+ *  @return
+ *    - 1 if prefetching is enabled
+ *    - 0 if prefetching is disabled
+ *
+ *  @see dsproc_set_prefetch_mode()
+ */
+int dsproc_get_prefetch_mode(void)
+{
+    return(_PrefetchMode);
+}
+
+/**
+ *  Set the input file prefetch mode.
+ *
+ *  If prefetching is enabled, background threads will start reading the
+ *  input files needed for the next processing interval as soon as the data
+ *  for the current processing interval has been retrieved. This allows the
+ *  file I/O for the next interval to overlap the transformation, processing,
+ *  and storage of the current interval. The files are still opened and read
+ *  by the retriever in the next call to dsproc_retrieve_data(), but from
+ *  the file system cache. One thread is used for each input datastream, so
+ *  datastreams on different storage systems are read concurrently.
+ *
+ *  @param  mode - prefetch mode (0 = disabled, 1 = enabled)
+ *
+ *  @see dsproc_get_prefetch_mode()
+ */
+void dsproc_set_prefetch_mode(int mode)
+{
+    DEBUG_LV1( DSPROC_LIB_NAME,
+        "Setting input file prefetch mode to: %d\n", mode);
+
+    _PrefetchMode = mode;
+
+    if (!mode) {
+        _dsproc_finish_prefetch(1);
+    }
+}
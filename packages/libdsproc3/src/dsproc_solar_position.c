@@ -20,6 +20,10 @@
 #define DEG_RAD 0.017453292519943295
 #define RAD_DEG 57.295779513082323
 
+/* Length of the blocks used by dsproc_solar_positions_from_offsets(). */
+
+#define SOLAR_BLOCK_SECS 3600
+
 /** @privatesection */
 /*******************************************************************************
  *  Static Data and Functions Visible Only To This Module
@@ -65,6 +69,203 @@ static int _daynum(int year, int month, int day)
   return (dnum);
 }
 
+/* Compute the number of whole days from 2000 January 0 to a daynumber of a
+ * year (the 1900's are negative).
+ */
+static int _solar_delta_days(int year, int daynumber)
+{
+  int delta_years = year - 2000,
+      delta_days;
+
+  delta_days = delta_years * 365 + delta_years / 4 + daynumber;
+  if (year > 2000)
+    delta_days += 1;
+
+  return (delta_days);
+}
+
+/* Compute the Sun's apparent right ascension, apparent declination, and
+ * distance from Earth for a number of days.fraction since epoch J2000.0.
+ * A. A. 1990, C24.
+ *
+ * Right ascension is returned in hours (0 -> 24), declination in radians,
+ * and distance in astronomical units.
+ */
+static void _solar_ephemeris(
+        double  days_J2000,
+        double *ap_ra,
+        double *ap_dec,
+        double *distance)
+{
+  double ecliptic_long,   /* Solar ecliptic longitude. */
+         integral,        /* Integral portion of double precision number. */
+         mean_anomaly,    /* Earth mean anomaly. */
+         mean_longitude,  /* Solar mean longitude. */
+         mean_obliquity;  /* Mean obliquity of the ecliptic. */
+
+  mean_anomaly = (357.528 + 0.9856003 * days_J2000);
+  mean_longitude = (280.460 + 0.9856474 * days_J2000);
+
+  /* Put mean_anomaly and mean_longitude in the range 0 -> 2 pi. */
+  mean_anomaly = modf(mean_anomaly / 360.0, &integral) * TWOPI;
+  mean_longitude = modf(mean_longitude / 360.0, &integral) * TWOPI;
+
+  mean_obliquity = (23.439 - 4.0e-7 * days_J2000) * DEG_RAD;
+  ecliptic_long = ((1.915 * sin(mean_anomaly)) +
+                   (0.020 * sin(2.0 * mean_anomaly))) * DEG_RAD +
+                  mean_longitude;
+
+  *distance = 1.00014 - 0.01671 * cos(mean_anomaly) -
+              0.00014 * cos(2.0 * mean_anomaly);
+
+  /* Tangent of ecliptic_long separated into sine and cosine parts for ap_ra. */
+  *ap_ra = atan2(cos(mean_obliquity) * sin(ecliptic_long), cos(ecliptic_long));
+
+  /* Change range of ap_ra from -pi -> pi to 0 -> 2 pi. */
+  if (*ap_ra < 0.0)
+    *ap_ra += TWOPI;
+  /* Put ap_ra in the range 0 -> 24 hours. */
+  *ap_ra = modf(*ap_ra / TWOPI, &integral) * 24.0;
+
+  *ap_dec = asin(sin(mean_obliquity) * sin(ecliptic_long));
+}
+
+/* Compute the Greenwich mean sidereal time at 0 hours UT, in hours, for a
+ * number of Julian centuries since epoch J2000.0 at 0 hours UT.
+ * A. A. 1990, B6-B7.
+ */
+static double _solar_gmst0h(double cent_J2000)
+{
+  double gmst0h,          /* Greenwich mean sidereal time at 0 hours UT. */
+         integral;        /* Integral portion of double precision number. */
+
+  /* Horner's method of polynomial exponent expansion used for gmst0h. */
+  gmst0h = 24110.54841 + cent_J2000 * (8640184.812866 + cent_J2000 *
+            (0.093104 - cent_J2000 * 6.2e-6));
+  /* Convert gmst0h from seconds to hours and put in the range 0 -> 24. */
+  gmst0h = modf(gmst0h / 3600.0 / 24.0, &integral) * 24.0;
+  if (gmst0h < 0.0)
+    gmst0h += 24.0;
+
+  return (gmst0h);
+}
+
+/* Compute the Sun's altitude, refraction correction, and azimuth from the
+ * local mean sidereal time (hours), apparent right ascension (hours),
+ * apparent declination (radians), and the sine and cosine of the site
+ * latitude. The outputs are in degrees.
+ * A. A. 1990, B61-B62.
+ *
+ * This function is also used in the inner loop of dsproc_solar_positions(),
+ * so it is kept free of calls other than to the math library.
+ */
+static inline void _solar_horizon(
+        double  lmst,
+        double  ap_ra,
+        double  ap_dec,
+        double  sin_lat,
+        double  cos_lat,
+        double *altitude,
+        double *refraction,
+        double *azimuth)
+{
+  double cos_alt,         /* Cosine of the altitude of Sun. */
+         cos_apdec,       /* Cosine of the apparent declination of Sun. */
+         cos_az,          /* Cosine of the azimuth of Sun. */
+         cos_lha,         /* Cosine of the local apparent hour angle of Sun. */
+         local_ha,        /* Local mean hour angle of Sun. */
+         integral,        /* Integral portion of double precision number. */
+         pressure =       /* Earth mean atmospheric pressure at sea level */
+           1013.25,       /*   in millibars. */
+         sin_apdec,       /* Sine of the apparent declination of Sun. */
+         sin_az,          /* Sine of the azimuth of Sun. */
+         tan_alt,         /* Tangent of the altitude of Sun. */
+         temp =           /* Earth mean atmospheric temperature at sea level */
+           15.0;          /*   in degrees Celsius. */
+
+  /* Put lmst in the range 0 -> 24 hours. */
+  lmst = modf(lmst / 24.0, &integral) * 24.0;
+  if (lmst < 0.0)
+    lmst += 24.0;
+
+  local_ha = lmst - ap_ra;
+  /* Put hour angle in the range -12 to 12 hours. */
+  if (local_ha < -12.0)
+    local_ha += 24.0;
+  else if (local_ha > 12.0)
+    local_ha -= 24.0;
+
+  /* Convert local_ha to radians. */
+  local_ha = local_ha / 24.0 * TWOPI;
+
+  cos_apdec = cos(ap_dec);
+  sin_apdec = sin(ap_dec);
+  cos_lha = cos(local_ha);
+
+  *altitude = asin(sin_apdec * sin_lat + cos_apdec * cos_lha * cos_lat);
+
+  cos_alt = cos(*altitude);
+  /* Avoid tangent overflow at altitudes of +-90 degrees.
+   * 1.57079615 radians is equal to 89.99999 degrees.
+   */
+  if (fabs(*altitude) < 1.57079615)
+    tan_alt = tan(*altitude);
+  else
+    tan_alt = 6.0e6;
+
+  cos_az = (sin_apdec * cos_lat - cos_apdec * cos_lha * sin_lat) / cos_alt;
+  sin_az = -(cos_apdec * sin(local_ha) / cos_alt);
+  *azimuth = acos(cos_az);
+
+  /* Change range of azimuth from 0 -> pi to 0 -> 2 pi. */
+  if (atan2(sin_az, cos_az) < 0.0)
+    *azimuth = TWOPI - *azimuth;
+
+  /* Convert altitude and azimuth to degrees. */
+  *altitude *= RAD_DEG;
+  *azimuth *= RAD_DEG;
+
+  /* Compute refraction correction to be added to altitude to obtain actual
+   * position.
+   * Refraction calculated for altitudes of -1 degree or more allows for a
+   * pressure of 1040 mb and temperature of -22 C. Lower pressure and higher
+   * temperature combinations yield less than 1 degree refraction.
+   * NOTE:
+   * The two equations listed in the A. A. have a crossover altitude of
+   * 19.225 degrees at standard temperature and pressure. This crossover point
+   * is used instead of 15 degrees altitude so that refraction is smooth over
+   * the entire range of altitudes. The maximum residual error introduced by
+   * this smoothing is 3.6 arc seconds at 15 degrees. Temperature or pressure
+   * other than standard will shift the crossover altitude and change the error.
+   */
+
+  /* We want to smooth out the transition for the refraction, rather */
+  /* than having a discontinuity at zenith = 91 degrees.  Thus, we   */
+  /* relax the refraction from it's value at alt == -1 to zero at   */
+  /* alt == -2.  trs 3/4/03   */ 
+  if (*altitude < -2 || tan_alt == 6.0e6)
+    *refraction = 0.0;
+  else if (*altitude < -1) 
+  {
+    /* 0.241277 * Pres/Temp is refraction at alt == -1 */
+    /* (alt+2) goes linearly from 1 at alt == -1 to zero */
+    /* at alt == -2  */
+    *refraction = 0.241277 * (*altitude + 2) * pressure/(273.0 + temp);
+  }
+  else
+  {
+    if (*altitude < 19.225)
+    {
+      *refraction = (0.1594 + (*altitude) * (0.0196 + 0.00002 * (*altitude))) *
+                    pressure;
+      *refraction /= (1.0 + (*altitude) * (0.505 + 0.0845 * (*altitude))) *
+                     (273.0 + temp);
+    }
+    else
+      *refraction = 0.00452 * (pressure / (273.0 + temp)) / tan_alt;
+  }
+}
+
 /**
  *  Calculate solar position.
  *
@@ -174,31 +375,11 @@ static int solarposition(
         double *distance)
 {
   int    daynumber,       /* Sequential daynumber during a year. */
-         delta_days,      /* Whole days since 2000 January 0. */
-         delta_years;     /* Whole years since 2000. */
+         delta_days;      /* Whole days since 2000 January 0. */
   double cent_J2000,      /* Julian centuries since epoch J2000.0 at 0h UT. */
-         cos_alt,         /* Cosine of the altitude of Sun. */
-         cos_apdec,       /* Cosine of the apparent declination of Sun. */
-         cos_az,          /* Cosine of the azimuth of Sun. */
-         cos_lat,         /* Cosine of the site latitude. */
-         cos_lha,         /* Cosine of the local apparent hour angle of Sun. */
          days_J2000,      /* Days since epoch J2000.0. */
-         ecliptic_long,   /* Solar ecliptic longitude. */
          lmst,            /* Local mean sidereal time. */
-         local_ha,        /* Local mean hour angle of Sun. */
-         gmst0h,          /* Greenwich mean sidereal time at 0 hours UT. */
          integral,        /* Integral portion of double precision number. */
-         mean_anomaly,    /* Earth mean anomaly. */
-         mean_longitude,  /* Solar mean longitude. */
-         mean_obliquity,  /* Mean obliquity of the ecliptic. */
-         pressure =       /* Earth mean atmospheric pressure at sea level */
-           1013.25,       /*   in millibars. */
-         sin_apdec,       /* Sine of the apparent declination of Sun. */
-         sin_az,          /* Sine of the azimuth of Sun. */
-         sin_lat,         /* Sine of the site latitude. */
-         tan_alt,         /* Tangent of the altitude of Sun. */
-         temp =           /* Earth mean atmospheric temperature at sea level */
-           15.0,          /*   in degrees Celsius. */
          ut;              /* UT hours since midnight. */
 
 
@@ -234,11 +415,8 @@ static int solarposition(
     /* Construct Julian centuries since J2000 at 0 hours UT of date,
      * days.fraction since J2000, and UT hours.
      */
-    delta_years = year - 2000;
     /* delta_days is days from 2000/01/00 (1900's are negative). */
-    delta_days = delta_years * 365 + delta_years / 4 + daynumber;
-    if (year > 2000)
-      delta_days += 1;
+    delta_days = _solar_delta_days(year, daynumber);
     /* J2000 is 2000/01/01.5 */
     days_J2000 = delta_days - 1.5;
 
@@ -268,142 +446,23 @@ static int solarposition(
   }
 
 
-  /* Compute solar position parameters.
-   * A. A. 1990, C24.
-   */
-
-  mean_anomaly = (357.528 + 0.9856003 * days_J2000);
-  mean_longitude = (280.460 + 0.9856474 * days_J2000);
-
-  /* Put mean_anomaly and mean_longitude in the range 0 -> 2 pi. */
-  mean_anomaly = modf(mean_anomaly / 360.0, &integral) * TWOPI;
-  mean_longitude = modf(mean_longitude / 360.0, &integral) * TWOPI;
-
-  mean_obliquity = (23.439 - 4.0e-7 * days_J2000) * DEG_RAD;
-  ecliptic_long = ((1.915 * sin(mean_anomaly)) +
-                   (0.020 * sin(2.0 * mean_anomaly))) * DEG_RAD +
-                  mean_longitude;
-
-  *distance = 1.00014 - 0.01671 * cos(mean_anomaly) -
-              0.00014 * cos(2.0 * mean_anomaly);
+  /* Compute the apparent coordinates and distance of the Sun. */
 
-  /* Tangent of ecliptic_long separated into sine and cosine parts for ap_ra. */
-  *ap_ra = atan2(cos(mean_obliquity) * sin(ecliptic_long), cos(ecliptic_long));
+  _solar_ephemeris(days_J2000, ap_ra, ap_dec, distance);
 
-  /* Change range of ap_ra from -pi -> pi to 0 -> 2 pi. */
-  if (*ap_ra < 0.0)
-    *ap_ra += TWOPI;
-  /* Put ap_ra in the range 0 -> 24 hours. */
-  *ap_ra = modf(*ap_ra / TWOPI, &integral) * 24.0;
+  /* Local mean sidereal time. */
 
-  *ap_dec = asin(sin(mean_obliquity) * sin(ecliptic_long));
+  lmst = _solar_gmst0h(cent_J2000) + (ut * 1.00273790934) + longitude / 15.0;
 
-  /* Calculate local mean sidereal time.
-   * A. A. 1990, B6-B7.
-   */
+  /* Local hour angle, altitude, azimuth, and refraction correction. */
 
-  /* Horner's method of polynomial exponent expansion used for gmst0h. */
-  gmst0h = 24110.54841 + cent_J2000 * (8640184.812866 + cent_J2000 *
-            (0.093104 - cent_J2000 * 6.2e-6));
-  /* Convert gmst0h from seconds to hours and put in the range 0 -> 24. */
-  gmst0h = modf(gmst0h / 3600.0 / 24.0, &integral) * 24.0;
-  if (gmst0h < 0.0)
-    gmst0h += 24.0;
-
-  /* Ratio of lengths of mean solar day to mean sidereal day is 1.00273790934
-   * in 1990. Change in sidereal day length is < 0.001 second over a century.
-   * A. A. 1990, B6.
-   */
-  lmst = gmst0h + (ut * 1.00273790934) + longitude / 15.0;
-  /* Put lmst in the range 0 -> 24 hours. */
-  lmst = modf(lmst / 24.0, &integral) * 24.0;
-  if (lmst < 0.0)
-    lmst += 24.0;
-
-  /* Calculate local hour angle, altitude, azimuth, and refraction correction.
-   * A. A. 1990, B61-B62.
-   */
-
-  local_ha = lmst - *ap_ra;
-  /* Put hour angle in the range -12 to 12 hours. */
-  if (local_ha < -12.0)
-    local_ha += 24.0;
-  else if (local_ha > 12.0)
-    local_ha -= 24.0;
-
-  /* Convert latitude and local_ha to radians. */
   latitude *= DEG_RAD;
-  local_ha = local_ha / 24.0 * TWOPI;
 
-  cos_apdec = cos(*ap_dec);
-  sin_apdec = sin(*ap_dec);
-  cos_lat = cos(latitude);
-  sin_lat = sin(latitude);
-  cos_lha = cos(local_ha);
-
-  *altitude = asin(sin_apdec * sin_lat + cos_apdec * cos_lha * cos_lat);
+  _solar_horizon(lmst, *ap_ra, *ap_dec, sin(latitude), cos(latitude),
+                 altitude, refraction, azimuth);
 
-  cos_alt = cos(*altitude);
-  /* Avoid tangent overflow at altitudes of +-90 degrees.
-   * 1.57079615 radians is equal to 89.99999 degrees.
-   */
-  if (fabs(*altitude) < 1.57079615)
-    tan_alt = tan(*altitude);
-  else
-    tan_alt = 6.0e6;
-
-  cos_az = (sin_apdec * cos_lat - cos_apdec * cos_lha * sin_lat) / cos_alt;
-  sin_az = -(cos_apdec * sin(local_ha) / cos_alt);
-  *azimuth = acos(cos_az);
-
-  /* Change range of azimuth from 0 -> pi to 0 -> 2 pi. */
-  if (atan2(sin_az, cos_az) < 0.0)
-    *azimuth = TWOPI - *azimuth;
-
-  /* Convert ap_dec, altitude, and azimuth to degrees. */
+  /* Convert ap_dec to degrees. */
   *ap_dec *= RAD_DEG;
-  *altitude *= RAD_DEG;
-  *azimuth *= RAD_DEG;
-
-  /* Compute refraction correction to be added to altitude to obtain actual
-   * position.
-   * Refraction calculated for altitudes of -1 degree or more allows for a
-   * pressure of 1040 mb and temperature of -22 C. Lower pressure and higher
-   * temperature combinations yield less than 1 degree refraction.
-   * NOTE:
-   * The two equations listed in the A. A. have a crossover altitude of
-   * 19.225 degrees at standard temperature and pressure. This crossover point
-   * is used instead of 15 degrees altitude so that refraction is smooth over
-   * the entire range of altitudes. The maximum residual error introduced by
-   * this smoothing is 3.6 arc seconds at 15 degrees. Temperature or pressure
-   * other than standard will shift the crossover altitude and change the error.
-   */
-
-  /* We want to smooth out the transition for the refraction, rather */
-  /* than having a discontinuity at zenith = 91 degrees.  Thus, we   */
-  /* relax the refraction from it's value at alt == -1 to zero at   */
-  /* alt == -2.  trs 3/4/03   */ 
-  if (*altitude < -2 || tan_alt == 6.0e6)
-    *refraction = 0.0;
-  else if (*altitude < -1) 
-  {
-    /* 0.241277 * Pres/Temp is refraction at alt == -1 */
-    /* (alt+2) goes linearly from 1 at alt == -1 to zero */
-    /* at alt == -2  */
-    *refraction = 0.241277 * (*altitude + 2) * pressure/(273.0 + temp);
-  }
-  else
-  {
-    if (*altitude < 19.225)
-    {
-      *refraction = (0.1594 + (*altitude) * (0.0196 + 0.00002 * (*altitude))) *
-                    pressure;
-      *refraction /= (1.0 + (*altitude) * (0.505 + 0.0845 * (*altitude))) *
-                     (273.0 + temp);
-    }
-    else
-      *refraction = 0.00452 * (pressure / (273.0 + temp)) / tan_alt;
-  }
 
   return 0;
 }
@@ -560,10 +619,166 @@ int dsproc_solar_position(
 }
 
 /**
-*  Calculate solar positions for an array of times.
+*  Calculate solar positions for an array of time offsets.
 *
 *  See dsproc_solar_position() for description of outputs.
 *
+*  This function gives the same results as calling dsproc_solar_position()
+*  for every time, but is much faster for long time series. The terms that
+*  only depend on the date are computed once per day, and the apparent right
+*  ascension, declination, and distance of the Sun are computed at the start
+*  and end of every hour and linearly interpolated to the sample times. The
+*  interpolation error is less than 1.0e-5 degrees, which is well below the
+*  0.01 degree precision of the formulas. The altitude, refraction, and
+*  azimuth are then computed for all samples within an hour in a tight loop.
+*
+*  The times do not need to be in order, but the hourly values are only
+*  reused for consecutive samples that fall within the same hour.
+*
+*  The output arrays must be allocated by the calling process and have
+*  room for at least ntimes values. All output arguments can be NULL if
+*  the values are not needed.
+*
+*  @param  base_time  - Base time in seconds since 1970 UTC
+*  @param  ntimes     - Number of time offsets
+*  @param  offsets    - Array of time offsets from the base time in seconds
+*  @param  latitude   - Observation site geographic latitude.
+*                       [degrees.fraction, North positive]
+*  @param  longitude  - Observation site geographic longitude.
+*                       [degrees.fraction, East positive]
+*  @param  ap_ra      - output: array of apparent solar right ascensions.
+*  @param  ap_dec     - output: array of apparent solar declinations.
+*  @param  altitude   - output: array of solar altitudes.
+*  @param  refraction - output: array of refraction corrections.
+*  @param  azimuth    - output: array of solar azimuths.
+*  @param  distance   - output: array of distances of Sun from Earth.
+*
+*  @return
+*    -  1 if successful
+*    -  0 if an input parameter is out of bounds
+*/
+int dsproc_solar_positions_from_offsets(
+        time_t        base_time,
+        size_t        ntimes,
+        const double *offsets,
+        double        latitude,
+        double        longitude,
+        double       *ap_ra,
+        double       *ap_dec,
+        double       *altitude,
+        double       *refraction,
+        double       *azimuth,
+        double       *distance)
+{
+    double    sin_lat, cos_lat, lon_hours;
+    double    day_J2000, gmst0h, day_offset;
+    double    ra[2], dec[2], dist[2];
+    double    block_start, block_end;
+    double    t, secs, w, _ra, _dec, lmst;
+    double    _altitude, _refraction, _azimuth;
+    time_t    day_start, prev_day;
+    struct tm gmt;
+    int       year, daynumber, hour;
+    size_t    bi, be, ti;
+
+    if (latitude < -90.0 || latitude > 90.0 ||
+        longitude < -180.0 || longitude > 180.0) {
+
+        return(0);
+    }
+
+    sin_lat   = sin(latitude * DEG_RAD);
+    cos_lat   = cos(latitude * DEG_RAD);
+    lon_hours = longitude / 15.0;
+
+    day_J2000  = 0.0;
+    gmst0h     = 0.0;
+    day_offset = 0.0;
+    prev_day   = 0;
+
+    for (bi = 0; bi < ntimes; bi = ti) {
+
+        /* Get the UTC day and hour of the first sample in the block */
+
+        t         = (double)base_time + offsets[bi];
+        day_start = (time_t)floor(t / 86400.0) * 86400;
+        secs      = (double)(base_time - day_start) + offsets[bi];
+        hour      = (int)(secs / SOLAR_BLOCK_SECS);
+
+        if (bi == 0 || day_start != prev_day) {
+
+            /* Compute the terms that only depend on the date */
+
+            gmtime_r(&day_start, &gmt);
+            year = gmt.tm_year + 1900;
+
+            if (year < 1950 || year > 2049) {
+                return(0);
+            }
+
+            daynumber  = _daynum(year, gmt.tm_mon + 1, gmt.tm_mday);
+            day_J2000  = _solar_delta_days(year, daynumber) - 1.5;
+            gmst0h     = _solar_gmst0h(day_J2000 / 36525.0);
+            day_offset = (double)(base_time - day_start);
+            prev_day   = day_start;
+        }
+
+        /* Compute the apparent coordinates at the start and end of the hour */
+
+        _solar_ephemeris(day_J2000 + hour / 24.0,
+            &ra[0], &dec[0], &dist[0]);
+
+        _solar_ephemeris(day_J2000 + (hour + 1) / 24.0,
+            &ra[1], &dec[1], &dist[1]);
+
+        if (ra[1] < ra[0] - 12.0) {
+            ra[1] += 24.0;
+        }
+
+        /* Find all consecutive samples within the same hour */
+
+        block_start = (double)(hour * SOLAR_BLOCK_SECS);
+        block_end   = block_start + SOLAR_BLOCK_SECS;
+
+        for (be = bi + 1; be < ntimes; ++be) {
+            secs = day_offset + offsets[be];
+            if (secs < block_start || secs >= block_end) break;
+        }
+
+        /* Compute the solar positions for all samples in the block */
+
+        for (ti = bi; ti < be; ++ti) {
+
+            secs = day_offset + offsets[ti];
+            w    = (secs - block_start) / SOLAR_BLOCK_SECS;
+            _ra  = ra[0]  + w * (ra[1]  - ra[0]);
+            _dec = dec[0] + w * (dec[1] - dec[0]);
+
+            if (_ra >= 24.0) _ra -= 24.0;
+
+            lmst = gmst0h + (secs / 3600.0 * 1.00273790934) + lon_hours;
+
+            _solar_horizon(lmst, _ra, _dec, sin_lat, cos_lat,
+                &_altitude, &_refraction, &_azimuth);
+
+            if (ap_ra)      ap_ra[ti]      = _ra;
+            if (ap_dec)     ap_dec[ti]     = _dec * RAD_DEG;
+            if (altitude)   altitude[ti]   = _altitude;
+            if (refraction) refraction[ti] = _refraction;
+            if (azimuth)    azimuth[ti]    = _azimuth;
+            if (distance)   distance[ti]   = dist[0] + w * (dist[1] - dist[0]);
+        }
+    }
+
+    return(1);
+}
+
+/**
+*  Calculate solar positions for an array of times.
+*
+*  See dsproc_solar_position() for description of outputs, and
+*  dsproc_solar_positions_from_offsets() for how they are computed.
+*
 *  All output arguments can be NULL if the values are not needed.
 *
 *  The memory used by the output arrays are dynamically allocated
@@ -602,10 +817,7 @@ int dsproc_solar_positions(
         double **azimuth,
         double **distance)
 {
-    double    day, day_fraction;
-    int       year, month, hour, min, sec;
-    struct tm gmt;
-    double    _ap_ra, _ap_dec, _altitude, _refraction, _azimuth, _distance;
+    double   *offsets = (double *)NULL;
     size_t    alloc_size;
     int       status;
     size_t    oi, ti;
@@ -635,51 +847,42 @@ int dsproc_solar_positions(
         }
     }
 
-    for (ti = 0; ti < ntimes; ++ti) {
-
-        /* Convert secs1970 into appropriate year, month, day */
-
-        gmtime_r(&times[ti], &gmt);
-        year  = gmt.tm_year + 1900;
-        month = gmt.tm_mon + 1;
-        day   = (double)gmt.tm_mday;
-        hour  = gmt.tm_hour;
-        min   = gmt.tm_min;
-        sec   = gmt.tm_sec;
-
-        /* Convert hour, minute, seconds into fraction of day */
-        day_fraction = (double)hour/24.0
-                     + (double)min/1440.0
-                     + (double)sec/86400.0; 
+    if (ntimes == 0) {
+        return(1);
+    }
 
-        day = day + day_fraction;
+    /* Convert the times to offsets from the first time */
 
-        /* Calculate solar position */
+    offsets = (double *)malloc(alloc_size);
+    if (!offsets) goto ERROR_EXIT;
 
-        _ap_ra    = _ap_dec     = 0.0;
-        _altitude = _refraction = 0.0;
-        _azimuth  = _distance   = 0.0;
+    for (ti = 0; ti < ntimes; ++ti) {
+        offsets[ti] = (double)(times[ti] - times[0]);
+    }
 
-        status = solarposition(
-            year, month, day, 0.0, latitude, longitude,
-            &_ap_ra, &_ap_dec, &_altitude, &_refraction, &_azimuth, &_distance);
+    /* Calculate solar positions */
 
-        if (status != 0) {
-            goto ERROR_EXIT;
-        }
+    status = dsproc_solar_positions_from_offsets(
+        times[0], ntimes, offsets, latitude, longitude,
+        (ap_ra)      ? *ap_ra      : NULL,
+        (ap_dec)     ? *ap_dec     : NULL,
+        (altitude)   ? *altitude   : NULL,
+        (refraction) ? *refraction : NULL,
+        (azimuth)    ? *azimuth    : NULL,
+        (distance)   ? *distance   : NULL);
 
-        if (ap_ra)      (*ap_ra)[ti]      = _ap_ra;
-        if (ap_dec)     (*ap_dec)[ti]     = _ap_dec;
-        if (altitude)   (*altitude)[ti]   = _altitude;
-        if (refraction) (*refraction)[ti] = _refraction;
-        if (azimuth)    (*azimuth)[ti]    = _azimuth;
-        if (distance)   (*distance)[ti]   = _distance;
+    if (status == 0) {
+        goto ERROR_EXIT;
     }
 
+    free(offsets);
+
     return(1);
 
 ERROR_EXIT:
 
+    if (offsets) free(offsets);
+
     for (oi = 0; oi < 6; ++oi) {
         outpp = outputs[oi];
         if (outpp && *outpp) {
@@ -2986,6 +2986,11 @@ int dsproc_transform_data(
         return(-1);
     }
 
+    if (!cds_enable_arena(_DSProc->trans_data, 0)) {
+        dsproc_set_status(DSPROC_ENOMEM);
+        return(-1);
+    }
+
     *trans_data = _DSProc->trans_data;
 
     /* Loop over each datastream group in the retrieved data  */
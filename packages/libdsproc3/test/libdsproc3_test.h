@@ -0,0 +1,26 @@
+/*******************************************************************************
+*
+*  Copyright © 2014, Battelle Memorial Institute
+*  All rights reserved.
+*
+*******************************************************************************/
+
+#ifndef _LIBDSPROC3_TEST_H
+#define _LIBDSPROC3_TEST_H
+
+#include "dsproc3.h"
+
+/* Run test function */
+
+int  run_test(
+        const char *test_name,
+        int       (*test_func)(void));
+
+/* Test functions */
+
+void libdsproc3_test_csv(void);
+void libdsproc3_test_order_stats(void);
+void libdsproc3_test_outliers(void);
+void libdsproc3_test_solar(void);
+
+#endif
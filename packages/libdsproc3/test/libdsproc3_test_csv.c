@@ -0,0 +1,320 @@
+/*******************************************************************************
+*
+*  Copyright © 2014, Battelle Memorial Institute
+*  All rights reserved.
+*
+*******************************************************************************/
+
+#include <string.h>
+
+#include "libdsproc3_test.h"
+
+/*******************************************************************************
+ *  Test Files
+ */
+
+/**
+ *  Write a CSV file with a header line and nrecs records.
+ *
+ *  Record i is "i,2*i". If terminate is 0 the last record does not have
+ *  a newline character.
+ */
+static int write_csv_file(const char *name, int nrecs, int terminate)
+{
+    char  path[PATH_MAX];
+    FILE *fp;
+    int   ri;
+
+    snprintf(path, PATH_MAX, "out/%s", name);
+
+    if (!(fp = fopen(path, "w"))) {
+        fprintf(stderr, "Could not create test file: %s\n", path);
+        return(0);
+    }
+
+    fprintf(fp, "index,value\n");
+
+    for (ri = 0; ri < nrecs; ++ri) {
+        fprintf(fp, "%d,%d", ri, 2 * ri);
+        if (terminate || ri < nrecs - 1) fprintf(fp, "\n");
+    }
+
+    fclose(fp);
+    return(1);
+}
+
+/**
+ *  Check the line pointers set for a file created by write_csv_file().
+ */
+static int check_csv_lines(CSVParser *csv, int nlines, int nrecs)
+{
+    char expected[64];
+    int  ri;
+
+    if (nlines != nrecs + 1 || csv->nlines != nrecs + 1) {
+        fprintf(stderr, "\nexpected %d lines, found %d (nlines = %d)\n",
+            nrecs + 1, nlines, csv->nlines);
+        return(0);
+    }
+
+    if (strcmp(csv->lines[0], "index,value") != 0) {
+        fprintf(stderr, "\nbad header line: '%s'\n", csv->lines[0]);
+        return(0);
+    }
+
+    for (ri = 0; ri < nrecs; ++ri) {
+
+        snprintf(expected, 64, "%d,%d", ri, 2 * ri);
+
+        if (strcmp(csv->lines[ri + 1], expected) != 0) {
+            fprintf(stderr, "\nline %d: expected '%s', found '%s'\n",
+                ri + 1, expected, csv->lines[ri + 1]);
+            return(0);
+        }
+    }
+
+    return(1);
+}
+
+/*******************************************************************************
+ *  Unterminated Last Line Tests
+ */
+
+/* The line pointer array starts out nlines_guess long, so these land the
+ * last line of the file right on, and just past, the end of it. */
+
+static int load_file_test(int extra, int terminate, int chunked)
+{
+    const char *name = "line_pointers.csv";
+    CSVParser  *csv;
+    int         nrecs;
+    int         nlines;
+    int         status;
+
+    if (!(csv = dsproc_init_csv_parser(NULL))) {
+        return(0);
+    }
+
+    nrecs = csv->nlines_guess - 1 + extra;
+
+    if (!write_csv_file(name, nrecs, terminate)) {
+        dsproc_free_csv_parser(csv);
+        return(0);
+    }
+
+    if (chunked) {
+        nlines = dsproc_load_csv_chunk(csv, "out", name, 0);
+    }
+    else {
+        nlines = dsproc_load_csv_file(csv, "out", name);
+    }
+
+    status = check_csv_lines(csv, nlines, nrecs);
+
+    if (chunked && status) {
+        if (dsproc_load_csv_chunk(csv, "out", name, 0) != 0) {
+            fprintf(stderr, "\nexpected end of file after the first chunk\n");
+            status = 0;
+        }
+    }
+
+    dsproc_free_csv_parser(csv);
+
+    return(status);
+}
+
+static int unterminated_at_guess_test(void)
+{
+    return(load_file_test(1, 0, 0));
+}
+
+static int unterminated_before_guess_test(void)
+{
+    return(load_file_test(0, 0, 0));
+}
+
+static int unterminated_after_guess_test(void)
+{
+    return(load_file_test(2, 0, 0));
+}
+
+static int terminated_at_guess_test(void)
+{
+    return(load_file_test(1, 1, 0));
+}
+
+static int unterminated_chunk_test(void)
+{
+    return(load_file_test(1, 0, 1));
+}
+
+/*******************************************************************************
+ *  Small Chunk Tests
+ */
+
+/**
+ *  Load a file in chunks of chunk_size bytes and compare the lines with
+ *  the lines found when the whole file is loaded at once.
+ *
+ *  The chunks are much smaller than most lines, so lines are split across
+ *  chunks and the buffer must be expanded to hold them.
+ */
+static int compare_chunked_lines(
+    const char *name,
+    int         nexpected,
+    char      **expected,
+    size_t      chunk_size)
+{
+    CSVParser *csv;
+    int        nfound;
+    int        nlines;
+    int        li;
+    int        status;
+
+    if (!(csv = dsproc_init_csv_parser(NULL))) {
+        return(0);
+    }
+
+    nfound = 0;
+    status = 1;
+
+    while ((nlines = dsproc_load_csv_chunk(csv, "out", name, chunk_size)) > 0) {
+
+        for (li = 0; li < nlines; ++li, ++nfound) {
+
+            if (nfound >= nexpected ||
+                strcmp(csv->lines[li], expected[nfound]) != 0) {
+
+                fprintf(stderr,
+                    "\nchunk size %d: line %d: expected '%s', found '%s'\n",
+                    (int)chunk_size, nfound + 1,
+                    (nfound < nexpected) ? expected[nfound] : "end of file",
+                    csv->lines[li]);
+
+                status = 0;
+                break;
+            }
+        }
+
+        if (!status) break;
+    }
+
+    if (status) {
+
+        if (nlines < 0) {
+            fprintf(stderr, "\nchunk size %d: load failed\n", (int)chunk_size);
+            status = 0;
+        }
+        else if (nfound != nexpected) {
+            fprintf(stderr, "\nchunk size %d: expected %d lines, found %d\n",
+                (int)chunk_size, nexpected, nfound);
+            status = 0;
+        }
+    }
+
+    dsproc_free_csv_parser(csv);
+
+    return(status);
+}
+
+static int small_chunk_file_test(int terminate)
+{
+    const char *name = "small_chunks.csv";
+    size_t      chunk_sizes[] = { 7, 1, 3, 13, 64, 0 };
+    CSVParser  *csv;
+    char      **lines;
+    int         nrecs;
+    int         nlines;
+    int         status;
+    int         ci, li;
+
+    nrecs = 50;
+
+    if (!write_csv_file(name, nrecs, terminate)) {
+        return(0);
+    }
+
+    /* Load the whole file at once */
+
+    if (!(csv = dsproc_init_csv_parser(NULL))) {
+        return(0);
+    }
+
+    nlines = dsproc_load_csv_file(csv, "out", name);
+
+    if (!check_csv_lines(csv, nlines, nrecs)) {
+        dsproc_free_csv_parser(csv);
+        return(0);
+    }
+
+    lines = (char **)calloc(nlines, sizeof(char *));
+    if (!lines) {
+        dsproc_free_csv_parser(csv);
+        return(0);
+    }
+
+    status = 1;
+
+    for (li = 0; li < nlines; ++li) {
+        if (!(lines[li] = strdup(csv->lines[li]))) {
+            status = 0;
+            break;
+        }
+    }
+
+    dsproc_free_csv_parser(csv);
+
+    /* Compare with the lines loaded in small chunks */
+
+    for (ci = 0; chunk_sizes[ci] && status; ++ci) {
+        status = compare_chunked_lines(name, nlines, lines, chunk_sizes[ci]);
+    }
+
+    for (li = 0; li < nlines; ++li) {
+        if (lines[li]) free(lines[li]);
+    }
+
+    free(lines);
+
+    return(status);
+}
+
+static int small_chunk_unterminated_test(void)
+{
+    return(small_chunk_file_test(0));
+}
+
+static int small_chunk_terminated_test(void)
+{
+    return(small_chunk_file_test(1));
+}
+
+/*******************************************************************************
+ *  Run CSV Parser Tests
+ */
+
+void libdsproc3_test_csv(void)
+{
+    fprintf(stdout, "\nCSV Parser Tests:\n");
+
+    run_test(" - unterminated_at_guess_test",
+        unterminated_at_guess_test);
+
+    run_test(" - unterminated_before_guess_test",
+        unterminated_before_guess_test);
+
+    run_test(" - unterminated_after_guess_test",
+        unterminated_after_guess_test);
+
+    run_test(" - terminated_at_guess_test",
+        terminated_at_guess_test);
+
+    run_test(" - unterminated_chunk_test",
+        unterminated_chunk_test);
+
+    run_test(" - small_chunk_unterminated_test",
+        small_chunk_unterminated_test);
+
+    run_test(" - small_chunk_terminated_test",
+        small_chunk_terminated_test);
+}
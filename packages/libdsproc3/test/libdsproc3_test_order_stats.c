@@ -0,0 +1,405 @@
+/*******************************************************************************
+*
+*  Copyright © 2014, Battelle Memorial Institute
+*  All rights reserved.
+*
+*******************************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "libdsproc3_test.h"
+
+#define NVALUES 200
+
+/*******************************************************************************
+ *  Reference Statistics
+ */
+
+/* The reference statistics are computed from a sorted copy of the window
+ * values using the same definitions documented for the DSOrderStats
+ * functions. */
+
+static int compare_doubles(const void *vp1, const void *vp2)
+{
+    double d1 = *(const double *)vp1;
+    double d2 = *(const double *)vp2;
+
+    if (d1 < d2) return(-1);
+    if (d1 > d2) return(1);
+    return(0);
+}
+
+static double sorted_median(const double *sorted, int n)
+{
+    if (n & 0x1) {
+        return(sorted[(n-1)/2]);
+    }
+
+    return((sorted[n/2 - 1] + sorted[n/2]) / 2);
+}
+
+typedef struct {
+    double median;
+    double mad;
+    double mean;
+    double mean_abs_dev;
+    double q1;
+    double q3;
+} RefStats;
+
+static void get_ref_stats(
+    const double *window,
+    int           n,
+    double       *sorted,
+    RefStats     *ref)
+{
+    double *devs = sorted + n;
+    double  sum;
+    int     qn, i;
+
+    memcpy(sorted, window, n * sizeof(double));
+    qsort(sorted, n, sizeof(double), compare_doubles);
+
+    ref->median = sorted_median(sorted, n);
+
+    for (i = 0; i < n; ++i) {
+        devs[i] = fabs(sorted[i] - ref->median);
+    }
+
+    qsort(devs, n, sizeof(double), compare_doubles);
+    ref->mad = sorted_median(devs, n);
+
+    sum = 0;
+    for (i = 0; i < n; ++i) sum += sorted[i];
+    ref->mean = sum / n;
+
+    sum = 0;
+    for (i = 0; i < n; ++i) sum += fabs(sorted[i] - ref->mean);
+    ref->mean_abs_dev = sum / n;
+
+    /* First and third quartiles are the medians of the lower and upper
+     * halves, excluding the median for an odd number of values. */
+
+    qn = n / 2;
+    if (qn) {
+        ref->q1 = sorted_median(sorted, qn);
+        ref->q3 = sorted_median(sorted + n - qn, qn);
+    }
+}
+
+static int values_equal(double v1, double v2)
+{
+    return(fabs(v1 - v2) <= 1e-9 * (1.0 + fabs(v2)));
+}
+
+/*******************************************************************************
+ *  Check Window
+ */
+
+/**
+ *  Compare the DSOrderStats results for the current window with the
+ *  reference statistics.
+ */
+static int check_window(
+    DSOrderStats *os,
+    const double *values,
+    const int    *in_window,
+    const char   *label,
+    int           width,
+    int           start)
+{
+    double   window[NVALUES];
+    double   sorted[2 * NVALUES];
+    RefStats ref;
+    double   median, mad, q1, q2, q3;
+    int      n, i, k;
+
+    n = 0;
+    for (i = 0; i < NVALUES; ++i) {
+        if (in_window[i]) window[n++] = values[i];
+    }
+
+    if (dsproc_order_stats_count(os) != n) {
+        fprintf(stderr, "\n%s: width %d start %d: count %d != %d\n",
+            label, width, start, dsproc_order_stats_count(os), n);
+        return(0);
+    }
+
+    if (n == 0) {
+
+        if (!isnan(dsproc_order_stats_median(os)) ||
+            !isnan(dsproc_order_stats_mean_abs_dev(os, 0)) ||
+            dsproc_order_stats_median_mad(os, &median, &mad) ||
+            dsproc_order_stats_quartiles(os, &q1, &q2, &q3)) {
+
+            fprintf(stderr, "\n%s: width %d start %d: empty window\n",
+                label, width, start);
+            return(0);
+        }
+
+        return(1);
+    }
+
+    get_ref_stats(window, n, sorted, &ref);
+
+    for (k = 0; k < n; ++k) {
+        if (dsproc_order_stats_kth(os, k) != sorted[k]) {
+            fprintf(stderr, "\n%s: width %d start %d: kth(%d) %g != %g\n",
+                label, width, start, k, dsproc_order_stats_kth(os, k),
+                sorted[k]);
+            return(0);
+        }
+    }
+
+    if (!isnan(dsproc_order_stats_kth(os, -1)) ||
+        !isnan(dsproc_order_stats_kth(os, n))) {
+
+        fprintf(stderr, "\n%s: width %d start %d: kth out of range\n",
+            label, width, start);
+        return(0);
+    }
+
+    median = dsproc_order_stats_median(os);
+
+    if (!values_equal(median, ref.median)) {
+        fprintf(stderr, "\n%s: width %d start %d: median %g != %g\n",
+            label, width, start, median, ref.median);
+        return(0);
+    }
+
+    if (!dsproc_order_stats_median_mad(os, &median, &mad) ||
+        !values_equal(median, ref.median) ||
+        !values_equal(mad, ref.mad)) {
+
+        fprintf(stderr,
+            "\n%s: width %d start %d: median/mad %g/%g != %g/%g\n",
+            label, width, start, median, mad, ref.median, ref.mad);
+        return(0);
+    }
+
+    if (!values_equal(
+        dsproc_order_stats_mean_abs_dev(os, ref.mean), ref.mean_abs_dev)) {
+
+        fprintf(stderr, "\n%s: width %d start %d: mean abs dev %g != %g\n",
+            label, width, start,
+            dsproc_order_stats_mean_abs_dev(os, ref.mean), ref.mean_abs_dev);
+        return(0);
+    }
+
+    if (n < 2) {
+        if (dsproc_order_stats_quartiles(os, &q1, &q2, &q3)) {
+            fprintf(stderr, "\n%s: width %d start %d: quartiles of 1 value\n",
+                label, width, start);
+            return(0);
+        }
+        return(1);
+    }
+
+    if (!dsproc_order_stats_quartiles(os, &q1, &q2, &q3) ||
+        !values_equal(q1, ref.q1) ||
+        !values_equal(q2, ref.median) ||
+        !values_equal(q3, ref.q3)) {
+
+        fprintf(stderr,
+            "\n%s: width %d start %d: quartiles %g/%g/%g != %g/%g/%g\n",
+            label, width, start, q1, q2, q3, ref.q1, ref.median, ref.q3);
+        return(0);
+    }
+
+    return(1);
+}
+
+/*******************************************************************************
+ *  Test Series
+ */
+
+/**
+ *  Create a test series.
+ *
+ *  Values are rounded to a coarse step so the series contains many ties,
+ *  and every 23rd value is a large spike.
+ */
+static void create_series(double *values, unsigned int seed)
+{
+    int i;
+
+    for (i = 0; i < NVALUES; ++i) {
+
+        seed = seed * 1103515245 + 12345;
+
+        values[i] = (double)((seed >> 16) % 64) * 0.5 - 8.0;
+
+        if (i % 23 == 7) values[i] += 1000.0;
+    }
+}
+
+/**
+ *  Slide windows of the specified width over the series.
+ *
+ *  If skip is not zero every skip-th value is never added to the window,
+ *  like missing values are by the outlier filters.
+ */
+static int slide_windows(
+    DSOrderStats *os,
+    const double *values,
+    const char   *label,
+    int           width,
+    int           skip)
+{
+    int in_window[NVALUES];
+    int i;
+
+    memset(in_window, 0, NVALUES * sizeof(int));
+
+    for (i = 0; i < NVALUES + width; ++i) {
+
+        if (i < NVALUES && (!skip || i % skip != 0)) {
+            dsproc_order_stats_add(os, i);
+            in_window[i] = 1;
+        }
+
+        if (i >= width) {
+            dsproc_order_stats_remove(os, i - width);
+            in_window[i - width] = 0;
+        }
+
+        if (!check_window(os, values, in_window, label, width, i - width + 1)) {
+            return(0);
+        }
+    }
+
+    return(1);
+}
+
+static int run_window_widths(int skip)
+{
+    double        values[NVALUES];
+    DSOrderStats *os;
+    int           widths[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 20, 21, 0 };
+    int           status;
+    int           wi;
+
+    create_series(values, 1);
+
+    os = dsproc_create_order_stats(NVALUES, values);
+    if (!os) return(0);
+
+    status = 1;
+
+    for (wi = 0; widths[wi]; ++wi) {
+        if (!slide_windows(os, values, "slide", widths[wi], skip)) {
+            status = 0;
+            break;
+        }
+    }
+
+    dsproc_free_order_stats(os);
+
+    return(status);
+}
+
+/*******************************************************************************
+ *  Order Statistics Tests
+ */
+
+static int sliding_window_test(void)
+{
+    return(run_window_widths(0));
+}
+
+static int missing_values_test(void)
+{
+    return(run_window_widths(3));
+}
+
+static int add_remove_test(void)
+{
+    double        values[NVALUES];
+    int           in_window[NVALUES];
+    DSOrderStats *os;
+    int           status;
+    int           i;
+
+    create_series(values, 7);
+
+    os = dsproc_create_order_stats(NVALUES, values);
+    if (!os) return(0);
+
+    memset(in_window, 0, NVALUES * sizeof(int));
+
+    /* Adding a value twice or removing one that is not in the window
+     * must not change the window */
+
+    status = 1;
+
+    for (i = 0; i < 30 && status; ++i) {
+        dsproc_order_stats_add(os, i);
+        dsproc_order_stats_add(os, i);
+        in_window[i] = 1;
+        status = check_window(os, values, in_window, "add", 30, i);
+    }
+
+    for (i = 0; i < 30 && status; i += 2) {
+        dsproc_order_stats_remove(os, i);
+        dsproc_order_stats_remove(os, i);
+        dsproc_order_stats_remove(os, NVALUES + i);
+        in_window[i] = 0;
+        status = check_window(os, values, in_window, "remove", 30, i);
+    }
+
+    if (status) {
+        dsproc_order_stats_clear(os);
+        memset(in_window, 0, NVALUES * sizeof(int));
+        status = check_window(os, values, in_window, "clear", 30, 0);
+    }
+
+    dsproc_free_order_stats(os);
+
+    return(status);
+}
+
+static int set_values_test(void)
+{
+    double        values[NVALUES];
+    DSOrderStats *os;
+    int           status;
+    unsigned int  seed;
+
+    os = dsproc_create_order_stats(NVALUES, NULL);
+    if (!os) return(0);
+
+    status = 1;
+
+    for (seed = 11; seed < 15 && status; ++seed) {
+
+        create_series(values, seed);
+
+        dsproc_order_stats_set_values(os, values);
+
+        /* Leave values in the window to make sure they are cleared */
+
+        status = slide_windows(os, values, "set_values", 5 + seed % 2, 0);
+
+        dsproc_order_stats_add(os, 0);
+        dsproc_order_stats_add(os, NVALUES - 1);
+    }
+
+    dsproc_free_order_stats(os);
+
+    return(status);
+}
+
+/*******************************************************************************
+ *  Run Order Statistics Tests
+ */
+
+void libdsproc3_test_order_stats(void)
+{
+    fprintf(stdout, "\nOrder Statistics Tests:\n");
+
+    run_test(" - sliding_window_test", sliding_window_test);
+    run_test(" - missing_values_test", missing_values_test);
+    run_test(" - add_remove_test",     add_remove_test);
+    run_test(" - set_values_test",     set_values_test);
+}
@@ -0,0 +1,719 @@
+/*******************************************************************************
+*
+*  Copyright © 2014, Battelle Memorial Institute
+*  All rights reserved.
+*
+*******************************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "libdsproc3_test.h"
+
+#define NSAMPLES      500
+#define NCOLS         3
+#define MISSING_VALUE -9999.0
+
+#define SKIPPED_FLAG  0x1
+#define BAD_FLAG      0x2
+#define IND_FLAG      0x4
+
+#define WINDOW_WIDTH  900.0
+#define MIN_NPOINTS   5
+
+/**
+ *  Single variable outlier filter function.
+ */
+typedef int (*SingleVarFilter)(
+    CDSGroup     *dataset,
+    const char   *var_name,
+    double        window_width,
+    int           min_npoints,
+    unsigned int  skipped_flag,
+    double        bad_threshold,
+    unsigned int  bad_flag,
+    double        ind_threshold,
+    unsigned int  ind_flag,
+    unsigned int  analyze);
+
+/**
+ *  Outlier filter methods and the thresholds used to test them.
+ */
+static struct {
+    DSOutlierMethod  method;
+    const char      *name;
+    SingleVarFilter  filter;
+    double           bad_threshold;
+    double           ind_threshold;
+} _Methods[] = {
+    { DSPROC_OUTLIERS_IQD,        "iqd",        dsproc_flag_outliers_iqd,        2.22, 1.5 },
+    { DSPROC_OUTLIERS_MEAN_DEV,   "mean_dev",   dsproc_flag_outliers_mean_dev,   6.0,  3.0 },
+    { DSPROC_OUTLIERS_MEAN_MAD,   "mean_mad",   dsproc_flag_outliers_mean_mad,   3.0,  2.0 },
+    { DSPROC_OUTLIERS_MEDIAN_MAD, "median_mad", dsproc_flag_outliers_median_mad, 3.0,  2.0 },
+    { DSPROC_OUTLIERS_STD,        "std",        dsproc_flag_outliers_std,        3.0,  2.0 }
+};
+
+static int _NumMethods = sizeof(_Methods) / sizeof(_Methods[0]);
+
+/*******************************************************************************
+ *  Test Dataset
+ */
+
+/**
+ *  Create a noisy test series.
+ *
+ *  The values are noise around a slow trend, with large spikes and
+ *  missing values at intervals that depend on the seed.
+ */
+static void create_series(double *values, size_t nvalues, unsigned int seed)
+{
+    double noise;
+    size_t i;
+
+    for (i = 0; i < nvalues; ++i) {
+
+        seed  = seed * 1103515245 + 12345;
+        noise = (double)((seed >> 8) % 100000) / 10000.0 - 5.0;
+
+        values[i] = 1000.0 + 20.0 * sin(i / 40.0) + noise;
+
+        if (i % (17 + seed % 3) == 5) values[i] += 60.0;
+        if (i % 29 == 11)             values[i]  = MISSING_VALUE;
+    }
+}
+
+/**
+ *  Define a variable and its QC variable in the test dataset.
+ */
+static CDSVar *define_test_var(
+    CDSGroup     *dataset,
+    const char   *name,
+    int           ndims,
+    const double *values)
+{
+    const char *dim_names[] = { "time", "height" };
+    char        qc_name[64];
+    double      missing = MISSING_VALUE;
+    size_t      nvalues;
+    CDSVar     *var;
+    CDSVar     *qc_var;
+
+    snprintf(qc_name, 64, "qc_%s", name);
+
+    var    = cds_define_var(dataset, name,    CDS_DOUBLE, ndims, dim_names);
+    qc_var = cds_define_var(dataset, qc_name, CDS_INT,    ndims, dim_names);
+
+    if (!var || !qc_var ||
+        !cds_define_att(var, "missing_value", CDS_DOUBLE, 1, &missing) ||
+        !cds_set_var_data(var, CDS_DOUBLE, 0, NSAMPLES, NULL, (void *)values) ||
+        !cds_init_var_data(qc_var, 0, NSAMPLES, 0)) {
+
+        fprintf(stderr, "\ncould not define test variable: %s\n", name);
+        return((CDSVar *)NULL);
+    }
+
+    nvalues = NSAMPLES * cds_var_sample_size(qc_var);
+    memset(qc_var->data.ip, 0, nvalues * sizeof(int));
+
+    return(var);
+}
+
+/**
+ *  Create the test dataset with the time variable.
+ *
+ *  The samples are one minute apart, with a few gaps longer than the
+ *  window width so some values are skipped.
+ */
+static CDSGroup *create_dataset(void)
+{
+    const char *dim_names[] = { "time" };
+    double      times[NSAMPLES];
+    CDSGroup   *dataset;
+    CDSVar     *time_var;
+    double      time;
+    int         ti;
+
+    dataset = cds_define_group(NULL, "outlier_tests");
+    if (!dataset) return((CDSGroup *)NULL);
+
+    time = 0;
+    for (ti = 0; ti < NSAMPLES; ++ti) {
+        times[ti] = time;
+        time += (ti % 150 == 149) ? 3600.0 : 60.0;
+    }
+
+    if (!cds_define_dim(dataset, "time",   0,     1) ||
+        !cds_define_dim(dataset, "height", NCOLS, 0) ||
+        !(time_var = cds_define_var(dataset, "time", CDS_DOUBLE, 1, dim_names)) ||
+        !cds_set_var_data(time_var, CDS_DOUBLE, 0, NSAMPLES, NULL, times)) {
+
+        cds_delete_group(dataset);
+        return((CDSGroup *)NULL);
+    }
+
+    return(dataset);
+}
+
+/**
+ *  Clear the QC values for a variable.
+ */
+static void clear_qc(CDSGroup *dataset, const char *name)
+{
+    char    qc_name[64];
+    CDSVar *qc_var;
+
+    snprintf(qc_name, 64, "qc_%s", name);
+
+    qc_var = cds_get_var(dataset, qc_name);
+
+    memset(qc_var->data.ip, 0,
+        NSAMPLES * cds_var_sample_size(qc_var) * sizeof(int));
+}
+
+/**
+ *  Get the QC values for a variable.
+ */
+static int *get_qc(CDSGroup *dataset, const char *name)
+{
+    char qc_name[64];
+
+    snprintf(qc_name, 64, "qc_%s", name);
+
+    return(cds_get_var(dataset, qc_name)->data.ip);
+}
+
+/**
+ *  Run the single variable filter for a method on a list of 1-D variables.
+ */
+static int run_single_var_filters(
+    CDSGroup    *dataset,
+    int          mi,
+    int          nvars,
+    const char **names)
+{
+    int vi;
+
+    for (vi = 0; vi < nvars; ++vi) {
+
+        clear_qc(dataset, names[vi]);
+
+        if (!_Methods[mi].filter(dataset, names[vi],
+            WINDOW_WIDTH, MIN_NPOINTS, SKIPPED_FLAG,
+            _Methods[mi].bad_threshold, BAD_FLAG,
+            _Methods[mi].ind_threshold, IND_FLAG, 0)) {
+
+            fprintf(stderr, "\n%s: %s: single variable filter failed\n",
+                _Methods[mi].name, names[vi]);
+            return(0);
+        }
+    }
+
+    return(1);
+}
+
+/**
+ *  Run dsproc_flag_outliers() for a method on a list of variables.
+ */
+static int run_batch_filter(
+    CDSGroup    *dataset,
+    int          mi,
+    int          nvars,
+    const char **names,
+    int          nthreads)
+{
+    int vi;
+
+    for (vi = 0; vi < nvars; ++vi) {
+        clear_qc(dataset, names[vi]);
+    }
+
+    if (!dsproc_flag_outliers(dataset, nvars, names,
+        _Methods[mi].method, WINDOW_WIDTH, MIN_NPOINTS, SKIPPED_FLAG,
+        _Methods[mi].bad_threshold, BAD_FLAG,
+        _Methods[mi].ind_threshold, IND_FLAG, nthreads)) {
+
+        fprintf(stderr, "\n%s: dsproc_flag_outliers failed\n",
+            _Methods[mi].name);
+        return(0);
+    }
+
+    return(1);
+}
+
+/**
+ *  Compare a column of the QC values for a variable with the QC values
+ *  for a 1-D variable.
+ */
+static int compare_qc_column(
+    CDSGroup   *dataset,
+    int         mi,
+    int         nthreads,
+    const char *name,
+    int         ncols,
+    int         col,
+    const char *ref_name)
+{
+    int *qc     = get_qc(dataset, name);
+    int *ref_qc = get_qc(dataset, ref_name);
+    int  nflags = 0;
+    int  ti;
+
+    for (ti = 0; ti < NSAMPLES; ++ti) {
+
+        if (qc[ti * ncols + col] != ref_qc[ti]) {
+            fprintf(stderr,
+                "\n%s: %d threads: %s column %d sample %d: qc %d, expected %d\n",
+                _Methods[mi].name, nthreads, name, col, ti,
+                qc[ti * ncols + col], ref_qc[ti]);
+            return(0);
+        }
+
+        if (ref_qc[ti] & BAD_FLAG) nflags++;
+    }
+
+    /* Make sure the test data actually has outliers */
+
+    if (nflags == 0) {
+        fprintf(stderr, "\n%s: %s: no outliers were flagged\n",
+            _Methods[mi].name, ref_name);
+        return(0);
+    }
+
+    return(1);
+}
+
+/*******************************************************************************
+ *  Reference Flags
+ */
+
+/* The reference statistics are computed directly from the values in each
+ * window, the same way the single variable functions did before the window
+ * statistics were updated incrementally. */
+
+static int compare_doubles(const void *vp1, const void *vp2)
+{
+    double d1 = *(const double *)vp1;
+    double d2 = *(const double *)vp2;
+
+    if (d1 < d2) return(-1);
+    if (d1 > d2) return(1);
+    return(0);
+}
+
+static double sorted_median(const double *sorted, int n)
+{
+    if (n & 0x1) {
+        return(sorted[(n-1)/2]);
+    }
+
+    return((sorted[n/2 - 1] + sorted[n/2]) / 2);
+}
+
+/**
+ *  Compute the reference deviation and scale for every sample.
+ *
+ *  The scale is the value the threshold is multiplied by, and the count
+ *  is the number of values in the window, or 0 for missing values.
+ */
+static void get_reference_stats(
+    DSOutlierMethod  method,
+    const double    *times,
+    const double    *values,
+    double          *devs,
+    double          *scales,
+    int             *counts)
+{
+    double  buffer[NSAMPLES];
+    double  half_width = WINDOW_WIDTH / 2;
+    double  sum, sum2, diff, center, Q1, Q3;
+    int     ti, wi, n, qn;
+
+    for (ti = 0; ti < NSAMPLES; ++ti) {
+
+        devs[ti] = scales[ti] = 0;
+        counts[ti] = 0;
+
+        if (values[ti] == MISSING_VALUE) continue;
+
+        n = 0;
+
+        for (wi = 0; wi < NSAMPLES; ++wi) {
+            if (values[wi] != MISSING_VALUE &&
+                times[ti] - times[wi] <= half_width &&
+                times[wi] - times[ti] <= half_width) {
+
+                buffer[n++] = values[wi];
+            }
+        }
+
+        counts[ti] = n;
+
+        if (n < MIN_NPOINTS) continue;
+
+        if (method == DSPROC_OUTLIERS_IQD ||
+            method == DSPROC_OUTLIERS_MEDIAN_MAD) {
+
+            qsort(buffer, n, sizeof(double), compare_doubles);
+
+            center = sorted_median(buffer, n);
+
+            if (method == DSPROC_OUTLIERS_IQD) {
+                qn = n / 2;
+                Q1 = sorted_median(buffer, qn);
+                Q3 = sorted_median(buffer + n - qn, qn);
+                scales[ti] = Q3 - Q1;
+            }
+            else {
+                for (wi = 0; wi < n; ++wi) {
+                    buffer[wi] = fabs(buffer[wi] - center);
+                }
+                qsort(buffer, n, sizeof(double), compare_doubles);
+                scales[ti] = sorted_median(buffer, n);
+            }
+        }
+        else {
+
+            sum = 0;
+            for (wi = 0; wi < n; ++wi) sum += buffer[wi];
+            center = sum / n;
+
+            sum2 = 0;
+            for (wi = 0; wi < n; ++wi) {
+                diff  = buffer[wi] - center;
+                sum2 += (method == DSPROC_OUTLIERS_STD)
+                      ? diff * diff : fabs(diff);
+            }
+
+            switch (method) {
+                case DSPROC_OUTLIERS_MEAN_MAD: scales[ti] = sum2 / n;       break;
+                case DSPROC_OUTLIERS_STD:      scales[ti] = sqrt(sum2 / n); break;
+                default:                       scales[ti] = 1.0;            break;
+            }
+        }
+
+        devs[ti] = fabs(values[ti] - center);
+    }
+}
+
+/**
+ *  Get the reference QC flags for a pair of thresholds.
+ */
+static void get_reference_flags(
+    const double *devs,
+    const double *scales,
+    const int    *counts,
+    double        bad_threshold,
+    double        ind_threshold,
+    int          *flags)
+{
+    int ti;
+
+    for (ti = 0; ti < NSAMPLES; ++ti) {
+
+        flags[ti] = 0;
+
+        if (counts[ti] == 0) continue;
+
+        if (counts[ti] < MIN_NPOINTS) {
+            flags[ti] = SKIPPED_FLAG;
+            continue;
+        }
+
+        if (devs[ti] > bad_threshold * scales[ti]) flags[ti] |= BAD_FLAG;
+        if (devs[ti] > ind_threshold * scales[ti]) flags[ti] |= IND_FLAG;
+    }
+}
+
+/*******************************************************************************
+ *  Outlier Filter Tests
+ */
+
+static int two_dim_var_test(void)
+{
+    const char *col_names[] = { "x_0", "x_1", "x_2" };
+    const char *name        = "x";
+    int         nthreads[]  = { 1, 2, 4, 0 };
+    double      column[NSAMPLES];
+    double      values[NSAMPLES * NCOLS];
+    CDSGroup   *dataset;
+    int         status;
+    int         col, ti, mi, thi;
+
+    if (!(dataset = create_dataset())) {
+        return(0);
+    }
+
+    /* Each column of the 2-D variable is also stored as a 1-D variable */
+
+    for (col = 0; col < NCOLS; ++col) {
+
+        create_series(column, NSAMPLES, 100 + col);
+
+        for (ti = 0; ti < NSAMPLES; ++ti) {
+            values[ti * NCOLS + col] = column[ti];
+        }
+
+        if (!define_test_var(dataset, col_names[col], 1, column)) {
+            cds_delete_group(dataset);
+            return(0);
+        }
+    }
+
+    if (!define_test_var(dataset, name, 2, values)) {
+        cds_delete_group(dataset);
+        return(0);
+    }
+
+    status = 1;
+
+    for (mi = 0; mi < _NumMethods && status; ++mi) {
+
+        /* Single variable function with the 2-D variable */
+
+        status = run_single_var_filters(dataset, mi, 1, &name) &&
+                 run_single_var_filters(dataset, mi, NCOLS, col_names);
+
+        for (col = 0; col < NCOLS && status; ++col) {
+            status = compare_qc_column(
+                dataset, mi, 1, name, NCOLS, col, col_names[col]);
+        }
+
+        /* dsproc_flag_outliers() with the 2-D variable */
+
+        for (thi = 0; nthreads[thi] && status; ++thi) {
+
+            status = run_batch_filter(dataset, mi, 1, &name, nthreads[thi]);
+
+            for (col = 0; col < NCOLS && status; ++col) {
+                status = compare_qc_column(
+                    dataset, mi, nthreads[thi], name, NCOLS, col,
+                    col_names[col]);
+            }
+        }
+    }
+
+    cds_delete_group(dataset);
+
+    return(status);
+}
+
+static int batch_vars_test(void)
+{
+    const char *names[]     = { "a", "b" };
+    const char *ref_names[] = { "a_ref", "b_ref" };
+    int         nthreads[]  = { 1, 2, 3, 0 };
+    double      values[NSAMPLES];
+    CDSGroup   *dataset;
+    int         status;
+    int         vi, mi, thi;
+
+    if (!(dataset = create_dataset())) {
+        return(0);
+    }
+
+    for (vi = 0; vi < 2; ++vi) {
+
+        create_series(values, NSAMPLES, 200 + vi);
+
+        if (!define_test_var(dataset, names[vi],     1, values) ||
+            !define_test_var(dataset, ref_names[vi], 1, values)) {
+
+            cds_delete_group(dataset);
+            return(0);
+        }
+    }
+
+    status = 1;
+
+    for (mi = 0; mi < _NumMethods && status; ++mi) {
+
+        status = run_single_var_filters(dataset, mi, 2, ref_names);
+
+        for (thi = 0; nthreads[thi] && status; ++thi) {
+
+            status = run_batch_filter(dataset, mi, 2, names, nthreads[thi]);
+
+            for (vi = 0; vi < 2 && status; ++vi) {
+                status = compare_qc_column(
+                    dataset, mi, nthreads[thi], names[vi], 1, 0,
+                    ref_names[vi]);
+            }
+        }
+    }
+
+    cds_delete_group(dataset);
+
+    return(status);
+}
+
+/**
+ *  Compare the flags set by dsproc_flag_outliers() with the reference
+ *  flags for values right at the thresholds.
+ *
+ *  The values have a large offset compared to the noise, so the running
+ *  window statistics differ from the reference statistics in the last few
+ *  digits. The thresholds are set to the number of spreads some values are
+ *  from the window center, computed the same way as the reference, so the
+ *  flags for these values depend on those last few digits.
+ */
+static int noisy_data_test(void)
+{
+    const char *name = "noisy";
+    double      values[NSAMPLES];
+    double      devs[NSAMPLES];
+    double      scales[NSAMPLES];
+    int         counts[NSAMPLES];
+    int         ref_qc[NSAMPLES];
+    double      thresholds[2];
+    CDSGroup   *dataset;
+    int        *qc;
+    int         status;
+    int         ntested;
+    int         ti, mi, ki;
+
+    if (!(dataset = create_dataset())) {
+        return(0);
+    }
+
+    create_series(values, NSAMPLES, 300);
+
+    for (ti = 0; ti < NSAMPLES; ++ti) {
+        if (values[ti] != MISSING_VALUE) values[ti] += 123456.789;
+    }
+
+    if (!define_test_var(dataset, name, 1, values)) {
+        cds_delete_group(dataset);
+        return(0);
+    }
+
+    qc     = get_qc(dataset, name);
+    status = 1;
+
+    for (mi = 0; mi < _NumMethods && status; ++mi) {
+
+        get_reference_stats(_Methods[mi].method,
+            cds_get_var(dataset, "time")->data.dp, values,
+            devs, scales, counts);
+
+        ntested = 0;
+
+        for (ki = 7; ki < NSAMPLES && status; ki += 13) {
+
+            if (counts[ki] < MIN_NPOINTS || scales[ki] == 0) continue;
+
+            thresholds[0] = devs[ki] / scales[ki];
+            thresholds[1] = devs[(ki + 13) % NSAMPLES] / scales[ki];
+
+            clear_qc(dataset, name);
+
+            if (!dsproc_flag_outliers(dataset, 1, &name,
+                _Methods[mi].method, WINDOW_WIDTH, MIN_NPOINTS, SKIPPED_FLAG,
+                thresholds[0], BAD_FLAG, thresholds[1], IND_FLAG, 1)) {
+
+                status = 0;
+                break;
+            }
+
+            get_reference_flags(devs, scales, counts,
+                thresholds[0], thresholds[1], ref_qc);
+
+            for (ti = 0; ti < NSAMPLES; ++ti) {
+                if (qc[ti] != ref_qc[ti]) {
+                    fprintf(stderr,
+                        "\n%s: thresholds %.17g, %.17g: sample %d: qc %d,"
+                        " expected %d\n",
+                        _Methods[mi].name, thresholds[0], thresholds[1], ti,
+                        qc[ti], ref_qc[ti]);
+                    status = 0;
+                    break;
+                }
+            }
+
+            ntested++;
+        }
+
+        if (status && ntested == 0) {
+            fprintf(stderr, "\n%s: no values were tested\n",
+                _Methods[mi].name);
+            status = 0;
+        }
+    }
+
+    cds_delete_group(dataset);
+
+    return(status);
+}
+
+/**
+ *  Compare the flags set by the single variable functions with the
+ *  reference flags using the default thresholds.
+ */
+static int reference_flags_test(void)
+{
+    const char *name = "ref";
+    double      values[NSAMPLES];
+    double      devs[NSAMPLES];
+    double      scales[NSAMPLES];
+    int         counts[NSAMPLES];
+    int         ref_qc[NSAMPLES];
+    CDSGroup   *dataset;
+    int        *qc;
+    int         status;
+    int         ti, mi;
+
+    if (!(dataset = create_dataset())) {
+        return(0);
+    }
+
+    create_series(values, NSAMPLES, 400);
+
+    if (!define_test_var(dataset, name, 1, values)) {
+        cds_delete_group(dataset);
+        return(0);
+    }
+
+    qc     = get_qc(dataset, name);
+    status = 1;
+
+    for (mi = 0; mi < _NumMethods && status; ++mi) {
+
+        if (!run_single_var_filters(dataset, mi, 1, &name)) {
+            status = 0;
+            break;
+        }
+
+        get_reference_stats(_Methods[mi].method,
+            cds_get_var(dataset, "time")->data.dp, values,
+            devs, scales, counts);
+
+        get_reference_flags(devs, scales, counts,
+            _Methods[mi].bad_threshold, _Methods[mi].ind_threshold, ref_qc);
+
+        for (ti = 0; ti < NSAMPLES; ++ti) {
+            if (qc[ti] != ref_qc[ti]) {
+                fprintf(stderr, "\n%s: sample %d: qc %d, expected %d\n",
+                    _Methods[mi].name, ti, qc[ti], ref_qc[ti]);
+                status = 0;
+                break;
+            }
+        }
+    }
+
+    cds_delete_group(dataset);
+
+    return(status);
+}
+
+/*******************************************************************************
+ *  Run Outlier Filter Tests
+ */
+
+void libdsproc3_test_outliers(void)
+{
+    fprintf(stdout, "\nOutlier Filter Tests:\n");
+
+    run_test(" - two_dim_var_test", two_dim_var_test);
+    run_test(" - batch_vars_test",  batch_vars_test);
+    run_test(" - reference_flags_test", reference_flags_test);
+    run_test(" - noisy_data_test",      noisy_data_test);
+}
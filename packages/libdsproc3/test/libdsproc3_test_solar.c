@@ -0,0 +1,323 @@
+/*******************************************************************************
+*
+*  Copyright © 2014, Battelle Memorial Institute
+*  All rights reserved.
+*
+*******************************************************************************/
+
+#include <math.h>
+#include <string.h>
+
+#include "libdsproc3_test.h"
+
+/* dsproc_solar_positions_from_offsets() interpolates the apparent right
+ * ascension, declination and distance within each hour, so the results
+ * are compared with dsproc_solar_position() using these tolerances. */
+
+#define RA_TOLERANCE    1.0e-6  /* hours */
+#define DEG_TOLERANCE   1.0e-5  /* degrees */
+#define DIST_TOLERANCE  1.0e-8  /* astronomical units */
+
+/* Seconds since 1970 for the limits of the supported date range */
+
+#define TIME_1950  ((time_t)-631152000)  /* 1950-01-01 00:00:00 */
+#define TIME_2050  ((time_t)2524608000)  /* 2050-01-01 00:00:00 */
+
+typedef struct {
+    double latitude;
+    double longitude;
+} TestSite;
+
+static TestSite _Sites[] = {
+    {  36.605, -97.485  }, /* sgp */
+    {  71.323, -156.609 }, /* nsa */
+    { -89.990,    0.0   }, /* near the south pole */
+    {  89.990,   12.0   }, /* near the north pole */
+    {   0.0,    180.0   }, /* date line */
+    { -45.0,   -180.0   }, /* date line */
+};
+
+static int _NumSites = sizeof(_Sites) / sizeof(TestSite);
+
+/*******************************************************************************
+ *  Compare Solar Positions
+ */
+
+static double angle_diff(double v1, double v2, double period)
+{
+    double diff = fabs(v1 - v2);
+
+    if (diff > period / 2) diff = fabs(diff - period);
+
+    return(diff);
+}
+
+/**
+ *  Compare dsproc_solar_positions_from_offsets() with dsproc_solar_position()
+ *  for every sample.
+ *
+ *  The batched function must fail if the reference fails for any sample,
+ *  and the right ascension must always be in the range 0 -> 24 hours.
+ */
+static int compare_solar_positions(
+    const char   *label,
+    time_t        base_time,
+    size_t        ntimes,
+    const double *offsets,
+    double        latitude,
+    double        longitude)
+{
+    double *out;
+    double *ra, *dec, *alt, *refr, *az, *dist;
+    double  r_ra, r_dec, r_alt, r_refr, r_az, r_dist;
+    double  az_tolerance;
+    time_t  secs1970;
+    int     expected;
+    int     status;
+    int     retval;
+    size_t  ti;
+
+    out = (double *)calloc(6 * ntimes, sizeof(double));
+    if (!out) return(0);
+
+    ra   = out;
+    dec  = out + ntimes;
+    alt  = out + ntimes * 2;
+    refr = out + ntimes * 3;
+    az   = out + ntimes * 4;
+    dist = out + ntimes * 5;
+
+    status = dsproc_solar_positions_from_offsets(
+        base_time, ntimes, offsets, latitude, longitude,
+        ra, dec, alt, refr, az, dist);
+
+    expected = 1;
+
+    for (ti = 0; ti < ntimes; ++ti) {
+        secs1970 = base_time + (time_t)offsets[ti];
+        if (!dsproc_solar_position(secs1970, latitude, longitude,
+            &r_ra, &r_dec, &r_alt, &r_refr, &r_az, &r_dist)) {
+
+            expected = 0;
+            break;
+        }
+    }
+
+    if (status != expected) {
+        fprintf(stderr, "\n%s: (%g, %g): returned %d, expected %d\n",
+            label, latitude, longitude, status, expected);
+        free(out);
+        return(0);
+    }
+
+    if (!status) {
+        free(out);
+        return(1);
+    }
+
+    retval = 1;
+
+    for (ti = 0; ti < ntimes && retval; ++ti) {
+
+        secs1970 = base_time + (time_t)offsets[ti];
+
+        dsproc_solar_position(secs1970, latitude, longitude,
+            &r_ra, &r_dec, &r_alt, &r_refr, &r_az, &r_dist);
+
+        /* The azimuth is ill-conditioned near the zenith and nadir,
+         * and undefined at them */
+
+        az_tolerance = DEG_TOLERANCE / cos(r_alt * M_PI / 180.0);
+
+        if (ra[ti] < 0.0 || ra[ti] >= 24.0) {
+            fprintf(stderr, "\n%s: (%g, %g): time %ld: ra %.9f out of range\n",
+                label, latitude, longitude, (long)secs1970, ra[ti]);
+            retval = 0;
+        }
+
+        if (angle_diff(ra[ti],   r_ra,  24.0)  > RA_TOLERANCE   ||
+            fabs(dec[ti]  - r_dec)            > DEG_TOLERANCE  ||
+            fabs(alt[ti]  - r_alt)            > DEG_TOLERANCE  ||
+            fabs(refr[ti] - r_refr)           > DEG_TOLERANCE  ||
+            fabs(dist[ti] - r_dist)           > DIST_TOLERANCE ||
+            (fabs(r_alt) < 89.9 &&
+             angle_diff(az[ti], r_az, 360.0) > az_tolerance)) {
+
+            fprintf(stderr,
+                "\n%s: (%g, %g): time %ld:\n"
+                " -> ra %.9f dec %.9f alt %.9f refr %.9f az %.9f dist %.9f\n"
+                " -> expected\n"
+                " -> ra %.9f dec %.9f alt %.9f refr %.9f az %.9f dist %.9f\n",
+                label, latitude, longitude, (long)secs1970,
+                ra[ti], dec[ti], alt[ti], refr[ti], az[ti], dist[ti],
+                r_ra, r_dec, r_alt, r_refr, r_az, r_dist);
+
+            retval = 0;
+        }
+    }
+
+    free(out);
+
+    return(retval);
+}
+
+/**
+ *  Compare the solar positions for evenly spaced offsets at all test sites.
+ */
+static int compare_series(
+    const char *label,
+    time_t      base_time,
+    double      start,
+    double      step,
+    size_t      ntimes)
+{
+    double *offsets;
+    int     status;
+    size_t  ti;
+    int     si;
+
+    offsets = (double *)malloc(ntimes * sizeof(double));
+    if (!offsets) return(0);
+
+    for (ti = 0; ti < ntimes; ++ti) {
+        offsets[ti] = start + ti * step;
+    }
+
+    status = 1;
+
+    for (si = 0; si < _NumSites && status; ++si) {
+        status = compare_solar_positions(label, base_time, ntimes, offsets,
+            _Sites[si].latitude, _Sites[si].longitude);
+    }
+
+    free(offsets);
+
+    return(status);
+}
+
+/*******************************************************************************
+ *  Solar Position Tests
+ */
+
+static int hour_boundary_test(void)
+{
+    /* 1 Hz samples from 10 seconds before to 10 seconds after the
+     * 2015-06-30 23:00:00 hour, from a base time in the middle of the hour */
+
+    if (!compare_series("hour_boundary", 1435703400, 1790, 1, 21)) {
+        return(0);
+    }
+
+    /* 7 second samples over six hours with negative offsets */
+
+    return(compare_series("hour_offsets", 1435703400, -3 * 3600, 7,
+        6 * 3600 / 7));
+}
+
+static int day_boundary_test(void)
+{
+    /* 1 minute samples for a day either side of midnight, in a leap year
+     * and across a year boundary */
+
+    if (!compare_series("day_boundary", 1456790400, -86400, 60, 2 * 1440) ||
+        !compare_series("year_boundary", 1483228800, -86400, 60, 2 * 1440)) {
+
+        return(0);
+    }
+
+    /* Decreasing offsets across midnight */
+
+    return(compare_series("decreasing", 1456790400, 7200, -13,
+        4 * 3600 / 13));
+}
+
+static int ra_wrap_test(void)
+{
+    /* The right ascension wraps from 24 to 0 hours at the March equinox,
+     * 2021-03-20 09:37 UTC */
+
+    if (!compare_series("ra_wrap", 1616232000, -12 * 3600, 1, 24 * 3600)) {
+        return(0);
+    }
+
+    return(compare_series("ra_wrap", 1616232000, -2 * 86400, 30,
+        4 * 2880));
+}
+
+static int range_limits_test(void)
+{
+    /* The first and last days of the supported range */
+
+    if (!compare_series("1950_start", TIME_1950, 0, 60, 1440) ||
+        !compare_series("2049_end", TIME_2050, -86400, 60, 1440)) {
+
+        return(0);
+    }
+
+    /* Series extending outside the supported range must fail */
+
+    if (!compare_series("1949_end", TIME_1950, -3600, 60, 120) ||
+        !compare_series("2050_start", TIME_2050, -3600, 60, 120)) {
+
+        return(0);
+    }
+
+    return(1);
+}
+
+static int solar_positions_test(void)
+{
+    time_t  times[] = {
+        1435706399, 1435706400, 1456790399, 1456790400, 1616232000,
+        TIME_1950, TIME_2050 - 1 };
+    size_t  ntimes = sizeof(times) / sizeof(time_t);
+    double *ra, *alt;
+    double  r_ra, r_alt;
+    int     status;
+    size_t  ti;
+
+    if (!dsproc_solar_positions(ntimes, times, _Sites[0].latitude,
+        _Sites[0].longitude, &ra, NULL, &alt, NULL, NULL, NULL)) {
+
+        return(0);
+    }
+
+    status = 1;
+
+    for (ti = 0; ti < ntimes && status; ++ti) {
+
+        dsproc_solar_position(times[ti],
+            _Sites[0].latitude, _Sites[0].longitude,
+            &r_ra, NULL, &r_alt, NULL, NULL, NULL);
+
+        if (angle_diff(ra[ti], r_ra, 24.0) > RA_TOLERANCE ||
+            fabs(alt[ti] - r_alt)          > DEG_TOLERANCE) {
+
+            fprintf(stderr, "\nsolar_positions: time %ld: ra %.9f alt %.9f,"
+                " expected ra %.9f alt %.9f\n",
+                (long)times[ti], ra[ti], alt[ti], r_ra, r_alt);
+
+            status = 0;
+        }
+    }
+
+    free(ra);
+    free(alt);
+
+    return(status);
+}
+
+/*******************************************************************************
+ *  Run Solar Position Tests
+ */
+
+void libdsproc3_test_solar(void)
+{
+    fprintf(stdout, "\nSolar Position Tests:\n");
+
+    run_test(" - hour_boundary_test",   hour_boundary_test);
+    run_test(" - day_boundary_test",    day_boundary_test);
+    run_test(" - ra_wrap_test",         ra_wrap_test);
+    run_test(" - range_limits_test",    range_limits_test);
+    run_test(" - solar_positions_test", solar_positions_test);
+}
@@ -71,6 +71,19 @@ int     ncds_read_dims(
             int       nc_grpid,
             CDSGroup *cds_group);
 
+/** CDS dimension user data key used to store the NetCDF start index. */
+#define NCDS_DIM_START_KEY "ncds_dim_start"
+
+CDSDim *ncds_read_dim_subset(
+            int         nc_grpid,
+            int         nc_dimid,
+            CDSGroup   *cds_group,
+            const char *cds_dim_name,
+            size_t      start,
+            size_t      count);
+
+size_t  ncds_get_dim_start(CDSDim *dim);
+
 CDSAtt *ncds_read_att(
             int         nc_grpid,
             int         nc_attid,
@@ -133,6 +146,9 @@ int     ncds_read_group_data(
             int       recursive,
             CDSGroup *cds_group,
             size_t    cds_record_start);
+
+void    ncds_get_read_stats(size_t *inplace_bytes, size_t *copied_bytes);
+void    ncds_reset_read_stats(void);
 /*@}*/
 
 /******************************************************************************/
@@ -309,6 +325,14 @@ int     ncds_find_files(
 #define NCDS_LTEQ CDS_LTEQ  /**< less than or equal to flags     */
 #define NCDS_GTEQ CDS_GTEQ  /**< greater than or equal to  flags */
 
+int     ncds_find_coord_range(
+            int         nc_grpid,
+            const char *dim_name,
+            double      min_value,
+            double      max_value,
+            size_t     *start,
+            size_t     *count);
+
 int     ncds_find_time_index(
             size_t   ntimes,
             time_t   base_time,
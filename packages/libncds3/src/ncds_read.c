@@ -21,10 +21,50 @@
 #include "ncds_private.h"
 
 /*******************************************************************************
- *  Private Functions
+ *  Private Data and Functions
  */
 /** @privatesection */
 
+/** Number of bytes of variable data read directly into the CDS variables. */
+static size_t _ReadInPlaceBytes = 0;
+
+/** Number of bytes of variable data copied from a temporary read buffer. */
+static size_t _ReadCopiedBytes  = 0;
+
+/**
+ *  PRIVATE: Check if the NetCDF library can convert data on read.
+ *
+ *  The NetCDF library can convert numeric data to a larger type as it
+ *  is read, so we do not need a temporary buffer for it. This is only
+ *  used for conversions to float and double where every input value can
+ *  be represented exactly, so the results match cds_copy_array().
+ *
+ *  @param  in_type  - CDS data type of the NetCDF variable
+ *  @param  cds_type - CDS data type of the CDS variable
+ *
+ *  @return
+ *    - 1 if the data can be read directly into the CDS data type
+ *    - 0 if a temporary buffer is needed
+ */
+static int _ncds_can_read_as(CDSDataType in_type, CDSDataType cds_type)
+{
+    switch (in_type) {
+        case CDS_BYTE:
+        case CDS_SHORT:
+        case CDS_UBYTE:
+        case CDS_USHORT:
+            return(cds_type == CDS_FLOAT || cds_type == CDS_DOUBLE);
+        case CDS_INT:
+        case CDS_FLOAT:
+        case CDS_UINT:
+            return(cds_type == CDS_DOUBLE);
+        default:
+            break;
+    }
+
+    return(0);
+}
+
 /**
  *  PRIVATE: Read an attribute definition from a NetCDF group or variable.
  *
@@ -353,6 +393,149 @@ int ncds_read_dims(
     return(ndims);
 }
 
+/**
+ *  Read a subset of a NetCDF dimension into a CDS group.
+ *
+ *  The dimension is defined in the CDS group with a length equal to the
+ *  number of values in the subset, and the start index is attached to the
+ *  CDS dimension so ncds_read_var_samples() will only read the specified
+ *  index range along this dimension for all variables that use it.
+ *
+ *  Error messages from this function are sent to the message handler
+ *  (see msngr_init_log() and msngr_init_mail()).
+ *
+ *  @param  nc_grpid     - NetCDF group id
+ *  @param  nc_dimid     - NetCDF dimension id
+ *  @param  cds_group    - pointer to the CDS group
+ *  @param  cds_dim_name - dimension name to use in the CDS group,
+ *                         or NULL to use the name of the NetCDF dimension.
+ *  @param  start        - index of the first value in the subset
+ *  @param  count        - number of values in the subset
+ *
+ *  @return
+ *    - pointer to the CDS dimension defined in the CDS group
+ *    - NULL if a NetCDF or CDS error occurred
+ */
+CDSDim *ncds_read_dim_subset(
+    int         nc_grpid,
+    int         nc_dimid,
+    CDSGroup   *cds_group,
+    const char *cds_dim_name,
+    size_t      start,
+    size_t      count)
+{
+    CDSDim *dim;
+    int     nunlim_dimids;
+    int     unlim_dimids[NC_MAX_DIMS];
+    char    dim_name[NC_MAX_NAME + 1];
+    size_t  dim_length;
+    size_t *startp;
+    int     ud_index;
+
+    /* Get the ids of the unlimited dimensions */
+
+    if (!ncds_inq_unlimdims(nc_grpid, &nunlim_dimids, unlim_dimids)) {
+        return((CDSDim *)NULL);
+    }
+
+    /* Get the dimension name and length */
+
+    if (!ncds_inq_dim(nc_grpid, nc_dimid, dim_name, &dim_length)) {
+        return((CDSDim *)NULL);
+    }
+
+    /* Make sure this is a valid subset of a static dimension */
+
+    for (ud_index = 0; ud_index < nunlim_dimids; ud_index++) {
+
+        if (nc_dimid == unlim_dimids[ud_index]) {
+
+            ERROR( NCDS_LIB_NAME,
+                "Could not read dimension subset\n"
+                " -> nc_grpid = %d, dim_name = '%s'\n"
+                " -> subsets of unlimited dimensions are not supported\n",
+                nc_grpid, dim_name);
+
+            return((CDSDim *)NULL);
+        }
+    }
+
+    if (count == 0 || start + count > dim_length) {
+
+        ERROR( NCDS_LIB_NAME,
+            "Could not read dimension subset\n"
+            " -> nc_grpid = %d, dim_name = '%s'\n"
+            " -> invalid subset: start = %lu, count = %lu, length = %lu\n",
+            nc_grpid, dim_name,
+            (unsigned long)start, (unsigned long)count,
+            (unsigned long)dim_length);
+
+        return((CDSDim *)NULL);
+    }
+
+    /* Define the dimension in the CDS group */
+
+    if (!cds_dim_name) {
+        cds_dim_name = dim_name;
+    }
+
+    dim = cds_define_dim(cds_group, cds_dim_name, count, 0);
+    if (!dim) {
+        return((CDSDim *)NULL);
+    }
+
+    if (start == 0) {
+        return(dim);
+    }
+
+    /* Attach the start index to the CDS dimension */
+
+    startp = (size_t *)malloc(sizeof(size_t));
+    if (!startp) {
+
+        ERROR( NCDS_LIB_NAME,
+            "Could not read dimension subset\n"
+            " -> nc_grpid = %d, dim_name = '%s'\n"
+            " -> memory allocation error\n",
+            nc_grpid, dim_name);
+
+        cds_delete_dim(dim);
+        return((CDSDim *)NULL);
+    }
+
+    *startp = start;
+
+    if (!cds_set_user_data(dim, NCDS_DIM_START_KEY, startp, free)) {
+        free(startp);
+        cds_delete_dim(dim);
+        return((CDSDim *)NULL);
+    }
+
+    return(dim);
+}
+
+/**
+ *  Get the NetCDF start index of a CDS dimension.
+ *
+ *  @param  dim - pointer to the CDS dimension
+ *
+ *  @return
+ *    - the index of the first NetCDF value read into the dimension
+ *      (see ncds_read_dim_subset()), or 0 if the full dimension is read.
+ */
+size_t ncds_get_dim_start(CDSDim *dim)
+{
+    size_t *startp;
+
+    if (!dim->user_data) {
+        return(0);
+    }
+
+    startp = (size_t *)cds_get_user_data(dim, NCDS_DIM_START_KEY);
+
+    return((startp) ? *startp : 0);
+}
+
 /**
  *  Read an attribute definition from a NetCDF group into a CDS group.
  *
@@ -723,6 +906,10 @@ int ncds_read_group(
  *  This function will also do the necessary type, units, and missing
  *  value conversions,
  *
+ *  The data is read directly into the variable's data array unless it
+ *  needs to be converted to a smaller data type, or a data type the
+ *  NetCDF library can not convert to exactly. See ncds_get_read_stats().
+ *
  *  Error messages from this function are sent to the message handler
  *  (see msngr_init_log() and msngr_init_mail()).
  *
@@ -768,6 +955,9 @@ void *ncds_read_var_data(
     void             *nc_datap;
     size_t            length;
 
+    CDSDataType       read_type;
+    void             *read_mv;
+
     int               status;
 
     /* Get the netcdf variable data type */
@@ -914,9 +1104,15 @@ void *ncds_read_var_data(
 
     /* Check if we need a temporary buffer for a type conversion */
 
-    nc_datap = cds_datap;
+    nc_datap  = cds_datap;
+    read_type = nc_cds_type;
 
-    if (nc_type_size != cds_type_size) {
+    if (nc_type_size != cds_type_size &&
+        _ncds_can_read_as(nc_cds_type, cds_var->type)) {
+
+        read_type = cds_var->type;
+    }
+    else if (nc_type_size != cds_type_size) {
 
         length   = cds_sample_count * cds_var_sample_size(cds_var);
         nc_datap = malloc(length * nc_type_size);
@@ -940,7 +1136,17 @@ void *ncds_read_var_data(
 
     /* Read the data from the NetCDF group */
 
-    status = nc_get_vara(nc_grpid, nc_varid, nc_start, nc_count, nc_datap);
+    if (read_type == CDS_FLOAT && nc_cds_type != CDS_FLOAT) {
+        status = nc_get_vara_float(
+            nc_grpid, nc_varid, nc_start, nc_count, (float *)nc_datap);
+    }
+    else if (read_type == CDS_DOUBLE && nc_cds_type != CDS_DOUBLE) {
+        status = nc_get_vara_double(
+            nc_grpid, nc_varid, nc_start, nc_count, (double *)nc_datap);
+    }
+    else {
+        status = nc_get_vara(nc_grpid, nc_varid, nc_start, nc_count, nc_datap);
+    }
 
     if (status != NC_NOERR) {
 
@@ -957,26 +1163,70 @@ void *ncds_read_var_data(
         return((void *)NULL);
     }
 
-    /* Check if we need to do any conversions */
+    length = cds_sample_count * cds_var_sample_size(cds_var);
 
-    if (converter || map_missing || (nc_cds_type != cds_var->type)) {
+    if (nc_datap == cds_datap) {
+        _ReadInPlaceBytes += length * cds_type_size;
+    }
+    else {
+        _ReadCopiedBytes  += length * cds_type_size;
+    }
 
-        length = cds_sample_count * cds_var_sample_size(cds_var);
+    /* If the NetCDF library converted the data type for us,
+     * the missing values we map from must be converted too. */
+
+    read_mv = nc_mv;
+
+    if (read_type != nc_cds_type && nc_nmv) {
+
+        read_mv = cds_copy_array(
+            nc_cds_type, nc_nmv, nc_mv, read_type, NULL,
+            0, NULL, NULL, NULL, NULL, NULL, NULL);
+
+        if (!read_mv) {
+
+            ERROR( NCDS_LIB_NAME,
+                "Could not read variable data\n"
+                " -> nc_grpid = %d, nc_varid = %d, cds_var = '%s'\n"
+                " -> memory allocation error\n",
+                nc_grpid, nc_varid, cds_var->name);
+
+            if (converter) cds_free_unit_converter(converter);
+            if (nc_nmv) cds_free_array(nc_cds_type, nc_nmv, nc_mv);
+            if (cds_nmv) cds_free_array(cds_var->type, cds_nmv, cds_mv);
+            return((void *)NULL);
+        }
+
+        /* The data is already in the CDS data type, so we only need
+         * another pass over it if the missing values are different. */
+
+        if (read_type == cds_var->type &&
+            memcmp(read_mv, cds_mv, nc_nmv * cds_type_size) != 0) {
+
+            map_missing = 1;
+        }
+    }
+
+    /* Check if we need to do any conversions */
+
+    if (converter || map_missing || (read_type != cds_var->type)) {
 
         if (converter) {
             cds_convert_units(converter,
-                nc_cds_type, length, nc_datap, cds_var->type, cds_datap,
-                nc_nmv, nc_mv, cds_mv,
+                read_type, length, nc_datap, cds_var->type, cds_datap,
+                nc_nmv, read_mv, cds_mv,
                 NULL, cds_mv, NULL, cds_mv);
         }
         else {
             cds_copy_array(
-                nc_cds_type, length, nc_datap, cds_var->type, cds_datap,
-                nc_nmv, nc_mv, cds_mv,
+                read_type, length, nc_datap, cds_var->type, cds_datap,
+                nc_nmv, read_mv, cds_mv,
                 NULL, cds_mv, NULL, cds_mv);
         }
     }
 
+    if (read_mv != nc_mv) free(read_mv);
+
     /* Cleanup and return */
 
     if (converter) cds_free_unit_converter(converter);
@@ -1030,6 +1280,7 @@ void *ncds_read_var_samples(
     int     dimid;
     CDSDim *dim;
     size_t  dim_length;
+    size_t  dim_start;
     size_t  start[NC_MAX_DIMS];
     size_t  count[NC_MAX_DIMS];
     void   *datap;
@@ -1089,22 +1340,27 @@ void *ncds_read_var_samples(
             return((void *)NULL);
         }
 
+        /* Get the start index if only a subset of the
+         * dimension is being read (see ncds_read_dim_subset) */
+
+        dim_start = (dim->is_unlimited) ? 0 : ncds_get_dim_start(dim);
+
         if (dim_index == 0) {
 
-            if (nc_sample_start >= dim_length) {
+            if (nc_sample_start + dim_start >= dim_length) {
 
                 ERROR( NCDS_LIB_NAME,
                     "Invalid netcdf variable start sample\n"
                     " -> nc_grpid = %d, nc_varid = %d, nc_dimid = %d\n"
                     " -> start sample (%d) >= dimension length (%d)\n",
                     nc_grpid, nc_varid, dimid,
-                    nc_sample_start, dim_length);
+                    nc_sample_start + dim_start, dim_length);
 
                 return((void *)NULL);
             }
 
-            start[dim_index] = nc_sample_start;
-            count[dim_index] = dim_length - nc_sample_start;
+            start[dim_index] = nc_sample_start + dim_start;
+            count[dim_index] = dim_length - start[dim_index];
 
             if (dim->is_unlimited == 0) {
 
@@ -1127,19 +1383,19 @@ void *ncds_read_var_samples(
         }
         else {
 
-            if (dim->length > dim_length) {
+            if (dim_start + dim->length > dim_length) {
 
                 ERROR( NCDS_LIB_NAME,
                     "Incompatible variable shapes\n"
                     " -> nc_grpid = %d, nc_varid = %d, cds_var = '%s', dim_index = %d\n"
                     " -> length of CDS dim (%d) > length of netcdf dim (%d)\n",
                     nc_grpid, nc_varid, cds_var->name, dim_index,
-                    dim->length, dim_length);
+                    dim_start + dim->length, dim_length);
 
                 return((void *)NULL);
             }
 
-            start[dim_index] = 0;
+            start[dim_index] = dim_start;
             count[dim_index] = dim->length;
         }
     }
@@ -1359,3 +1615,32 @@ int ncds_read_group_data(
 
     return(1);
 }
+
+/**
+ *  Get the number of bytes of variable data read since the last reset.
+ *
+ *  Data that could be read directly into the CDS variable's data array,
+ *  including data the NetCDF library converted to the variable's data
+ *  type as it was read, is counted as read in place. Data that had to be
+ *  read into a temporary buffer first and then copied into the variable
+ *  is counted as copied.
+ *
+ *  @param  inplace_bytes - output: number of bytes read in place
+ *  @param  copied_bytes  - output: number of bytes copied
+ */
+void ncds_get_read_stats(size_t *inplace_bytes, size_t *copied_bytes)
+{
+    if (inplace_bytes) *inplace_bytes = _ReadInPlaceBytes;
+    if (copied_bytes)  *copied_bytes  = _ReadCopiedBytes;
+}
+
+/**
+ *  Reset the variable data read statistics.
+ *
+ *  See ncds_get_read_stats().
+ */
+void ncds_reset_read_stats(void)
+{
+    _ReadInPlaceBytes = 0;
+    _ReadCopiedBytes  = 0;
+}
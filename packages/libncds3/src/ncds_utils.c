@@ -163,6 +163,118 @@ NETCDF_ERROR:
  */
 /** @publicsection */
 
+/**
+ *  Find the index range of coordinate values within a value range.
+ *
+ *  This function reads the coordinate variable for the specified dimension
+ *  and returns the smallest contiguous index range containing all values
+ *  that are between min_value and max_value (inclusive). The coordinate
+ *  values do not need to be sorted, but for non-monotonic coordinates the
+ *  range can contain values that are outside the requested limits.
+ *
+ *  Error messages from this function are sent to the message handler
+ *  (see msngr_init_log() and msngr_init_mail()).
+ *
+ *  @param  nc_grpid  - NetCDF group id
+ *  @param  dim_name  - name of the dimension
+ *  @param  min_value - minimum coordinate value
+ *  @param  max_value - maximum coordinate value
+ *  @param  start     - output: index of the first value in the range
+ *  @param  count     - output: number of values in the range
+ *
+ *  @return
+ *    -  1 if successful
+ *    -  0 if the coordinate variable was not found,
+ *         or no values were found in the specified range
+ *    - -1 if an error occurred
+ */
+int ncds_find_coord_range(
+    int         nc_grpid,
+    const char *dim_name,
+    double      min_value,
+    double      max_value,
+    size_t     *start,
+    size_t     *count)
+{
+    int     varid;
+    int     ndims;
+    int     dimid;
+    size_t  length;
+    double *values;
+    size_t  first;
+    size_t  last;
+    size_t  index;
+    int     status;
+
+    *start = 0;
+    *count = 0;
+
+    /* Make sure the coordinate variable exists */
+
+    status = ncds_inq_varid(nc_grpid, dim_name, &varid);
+    if (status <= 0) return(status);
+
+    if (!ncds_inq_varndims(nc_grpid, varid, &ndims)) return(-1);
+    if (ndims != 1) return(0);
+
+    if (!ncds_inq_vardimids(nc_grpid, varid, &dimid)) return(-1);
+    if (!ncds_inq_dimlen(nc_grpid, dimid, &length))   return(-1);
+    if (length == 0) return(0);
+
+    /* Read in the coordinate values */
+
+    values = (double *)malloc(length * sizeof(double));
+    if (!values) {
+
+        ERROR( NCDS_LIB_NAME,
+            "Could not get coordinate range for dimension: %s\n"
+            " -> nc_grpid = %d\n"
+            " -> memory allocation error\n", dim_name, nc_grpid);
+
+        return(-1);
+    }
+
+    status = nc_get_var_double(nc_grpid, varid, values);
+
+    if (status != NC_NOERR) {
+
+        ERROR( NCDS_LIB_NAME,
+            "Could not get coordinate range for dimension: %s\n"
+            " -> nc_grpid = %d\n"
+            " -> %s\n",
+            dim_name, nc_grpid, nc_strerror(status));
+
+        free(values);
+        return(-1);
+    }
+
+    /* Find the first and last values within the range */
+
+    first = length;
+    last  = 0;
+
+    for (index = 0; index < length; ++index) {
+
+        if (values[index] >= min_value &&
+            values[index] <= max_value) {
+
+            if (first == length) first = index;
+            last = index;
+        }
+    }
+
+    free(values);
+
+    if (first == length) {
+        return(0);
+    }
+
+    *start = first;
+    *count = last - first + 1;
+
+    return(1);
+}
+
 /**
  *  Find an index in an array of time offsets.
  *
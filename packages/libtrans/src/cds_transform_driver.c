@@ -34,6 +34,8 @@
 # include <getopt.h>
 # include <regex.h>
 # include <ctype.h>
+# include <stdlib.h>
+# include <pthread.h>
 # include "trans.h"
 # include "trans_private.h"
 # include "timing.h" 
@@ -240,6 +242,482 @@ TRANSfunc *get_transform(char *name) {
 }
 
 
+// Only our own transforms are known to be safe to run on several slices
+// at once; user defined ones always get the serial loop.
+static int is_default_transform(TRANSfunc *trans) {
+  return(trans >= DefaultTransFuncs &&
+	 trans < DefaultTransFuncs+NumDefaultTransFuncs);
+}
+
+// Transforms that would rather do a whole block of slices in one call, see
+// nslices in interface_s.  Caracena can share one set of matrix products
+// between all the slices in a block that have the same good stations.
+static int takes_slice_blocks(TRANSfunc *trans) {
+  return(trans->func == trans_caracena_interface);
+}
+
+// Find how many threads we should use to transform the slices of outvar.
+// The "num_threads" transform param wins, then the TRANS_NUM_THREADS
+// environment variable; by default we stay serial.
+static int get_num_threads(CDSVar *outvar) {
+  int nthreads=1;
+  char *env;
+
+  if (cds_get_transform_param(outvar, "num_threads", CDS_INT,
+			      &_one, &nthreads) == NULL) {
+    if ((env=getenv("TRANS_NUM_THREADS")) != NULL) {
+      nthreads=atoi(env);
+    }
+  }
+
+  if (nthreads < 1) nthreads=1;
+  return(nthreads);
+}
+
+// Everything we need to transform a run of 1D slices along one dimension
+// group.  The input arrays are only read, and the output arrays are
+// written at disjoint offsets for each slice, so several of these can be
+// working on the same transformation at once.
+struct slice_job {
+  TRANSfunc *trans;
+  CDSVar *invar;
+  CDSVar *outvar;
+  int d;                       // input dimension index
+  int od;                      // output dimension index
+  int g;                       // group we are transforming
+  double *tdata;               // input of this transformation
+  int *qc_tdata;
+  double *odata;               // output of this transformation
+  int *qc_odata;
+  int *tD, *tlen;              // input strides and lengths
+  int *oD, *olen;              // output strides and lengths
+  int oNtot;
+  double input_missing_value;
+  double output_missing_value;
+  TRANSmetric **metNd;         // allocated by whoever does slice 0
+  TRANSplan *plan;             // filled in by whoever does slice 0
+  int nslice;                  // total number of slices
+  int s_begin;                 // first slice to do
+  int s_end;                   // one past the last slice to do
+  int quiet;                   // running alongside other threads, so no
+			       // messages (msngr is not thread safe)
+  int failed_slice;            // slice that failed, reported by the caller
+  int status;                  // result, for the worker threads
+};
+
+// Flattened offset of the first element of slice s, when slicing along
+// group g with strides D.  This is just the closed form of the stepping
+// rule at the bottom of the slice loop, so that we can start anywhere.
+static int slice_origin(int s, int *D, int g) {
+  if (g == 0) return(s);
+  return((s/D[g])*D[g-1] + s%D[g]);
+}
+
+// How many adjacent slices we gather up and transform together, when the
+// slices are strided through memory.
+#define SLICE_BLOCK 16
+
+// One past the last slice of the block that slice s belongs to.  Blocks
+// are laid out on a fixed grid over all the slices of the job - runs of
+// SLICE_BLOCK, that never cross a jump to the next run of adjacent
+// slices - so the same slices always go to the transform together, no
+// matter how the slices are split between threads.  That matters for
+// transforms that take blocks, whose results can depend on which slices
+// they get together.
+static int slice_block_end(struct slice_job *job, int s) {
+  int g=job->g;
+  int r, end;
+
+  if (! is_default_transform(job->trans)) return(s+1);
+
+  if (job->tD[g] == 1 && job->oD[g] == 1) {
+    // In place, only transforms that take blocks get more than one
+    if (! takes_slice_blocks(job->trans) || g == 0) return(s+1);
+    end=(s/SLICE_BLOCK+1)*SLICE_BLOCK;
+  } else {
+    r=s%job->tD[g];
+    end=s-r+(r/SLICE_BLOCK+1)*SLICE_BLOCK;
+    if (end > s-r+job->tD[g]) end=s-r+job->tD[g];
+  }
+
+  if (end > job->nslice) end=job->nslice;
+  return(end);
+}
+
+// Step a slice origin on to the next slice.  The math behind this is
+// non-trivial, but sound.  Qualitatively, the idea is that when we
+// increment our faster indeces than d, we increment z0 by just 1 (since
+// the stride of our fastest dimension is always 1).  We can do that D[g]
+// times, until we have to increment the slower dimensions than d; to do
+// that, we stride in d-1, i.e. increment z0 by D[g-1].  We then subtract
+// D[g]-1 to reset our faster indeces to 0, and begin the cycle again.
+// Hence, if z0+1 is a multiple of D[g], we set z0 += D[g-1] - (D[g] - 1);
+// otherwise, z0 += 1.  (Note the hidden +1 by doing ++z0 first).
+static int next_slice_origin(int z0, int *D, int g) {
+  if ((++z0 % D[g]) == 0 && g > 0) {
+    z0 +=  D[g-1] - D[g];  
+  }
+  return(z0);
+}
+
+// Transform slice s, which lives wherever in and out point, with the given
+// strides.  This takes a mixture of 1D data arrays and CDS pointers; the
+// latter are used to track down the various parameters used in the
+// transformation, including such basic information as the size of the
+// arrays and what not.  Transforms that take blocks can be given n slices
+// at once, islice and oslice apart; everyone else always gets n=1.
+static int transform_one_slice(struct slice_job *job, int s, int n,
+			       double *in, int *qc_in, int istride, int islice,
+			       double *out, int *qc_out, int ostride, int oslice,
+			       TRANSmetric **met1d) {
+  int status;
+
+  if (! job->quiet) {
+    DEBUG_LV4("libtrans",
+	      "Analyzing slice %d (of %d) for %s, dim %d...",
+	      s, n, job->invar->name, job->d);
+  }
+  status = do_transform(job->trans,
+			.input_data=in,
+			.input_qc=qc_in,
+			.input_stride=istride,
+			.input_slice_stride=islice,
+			.input_missing_value=job->input_missing_value,
+			.output_data=out,
+			.output_qc=qc_out,
+			.output_stride=ostride,
+			.output_slice_stride=oslice,
+			.nslices=n,
+			.output_missing_value=job->output_missing_value,
+			.invar=job->invar,
+			.outvar=job->outvar,
+			.d=job->d,  // input and output ds may be different
+			.od=job->od,
+			.met=met1d,
+			.plan=job->plan); 
+
+  // Bomb out if status is bad - the driver exits the whole problem if
+  // this happens.  The error is reported by transform_slices(), after
+  // any other threads are done.
+  if (status < 0) {
+    job->failed_slice=s;
+    return(status);
+  }
+
+  // We don't know how many metrics to fill until right here, so:
+  // Make sure to trap out met1==NULL, because that means this
+  // transform doesn't make metrics.  Only slice 0 gets to do this, so
+  // it's always done before any worker threads are started.
+  if (s==0 && *met1d) {
+    allocate_metric(job->metNd, (*met1d)->metricnames, (*met1d)->metricunits,
+		    (*met1d)->nmetrics, job->oNtot);
+  }
+
+  return(status);
+}
+
+// Fill in our metrics for the slice whose output starts at oz0, using the
+// same output strides as the data.  b is which slice of the block met1d
+// came from.
+static void store_slice_metrics(struct slice_job *job, TRANSmetric *met1d,
+				int oz0, int b) {
+  int k, m, z;
+  int g=job->g;
+  TRANSmetric *metNd=*(job->metNd);
+
+  if (! metNd || ! met1d || ! met1d->metrics) return;
+
+  for (k=0;k<job->olen[g];k++) {
+    z=oz0+k*job->oD[g];
+    for (m=0;m<met1d->nmetrics;m++) {
+      metNd->metrics[m][z]=met1d->metrics[m][b*job->olen[g]+k];
+    }
+  }
+}
+
+// Transform slices [s_begin, s_end) of a job.  Each call gets its own
+// slice buffers and 1D metrics, so this is safe to call from several
+// threads at once as long as the slice ranges don't overlap.
+//
+// How we get at the slices depends on how they lie in memory.  If we are
+// transforming the fastest varying group, each slice is contiguous, so
+// our own transforms just work on it in place, with no copying at all.
+// Otherwise, adjacent slices are interleaved, element by element, with a
+// stride of D[g], so we pull in SLICE_BLOCK of them at once - that way
+// every read of the big array is a contiguous run of SLICE_BLOCK values,
+// rather than one value per cache line - and let our transforms work on
+// them with a stride of SLICE_BLOCK.  User transforms don't know about
+// strides, so they get each slice copied out into its own array, the way
+// it's always been done.  Transforms that take blocks get the whole block
+// in one call, in either case.
+static int transform_slice_range(struct slice_job *job) {
+  int b, k, n, s, z;
+  int g=job->g;
+  int *tD=job->tD, *oD=job->oD;
+  int tlen=job->tlen[g], olen=job->olen[g];
+  int status=0;
+
+  int in_place = (tD[g] == 1 && oD[g] == 1);
+  int strided = is_default_transform(job->trans);
+  int blocks = strided && takes_slice_blocks(job->trans);
+  int nblock = (strided && (blocks || ! in_place)) ? SLICE_BLOCK : 1;
+
+  // Allocate space to hold our input and output slices, for when we
+  // can't use the N-dimensional flattened array directly.
+  double *data1d=CALLOC(nblock*tlen, double);  
+  int *qc1d=CALLOC(nblock*tlen, int);   // If no qc_invar, this will stay
+					// 0s, so it's cool.
+  double *odata1d=CALLOC(nblock*olen, double);
+  int *oqc1d=CALLOC(nblock*olen, int);  
+
+  // Metric holder for a single slice
+  TRANSmetric *met1d=NULL;
+
+  int z0=slice_origin(job->s_begin, tD, g);
+  int oz0=slice_origin(job->s_begin, oD, g);
+
+  for (s=job->s_begin;s<job->s_end;s+=n) {
+
+    if (! strided) {
+
+      n=1;
+
+      // (re)initialize our output fields for this slice
+      for (k=0;k<olen;k++) {
+	oqc1d[k]=0;
+	odata1d[k]=job->output_missing_value;
+      }
+
+      // Now build up our input slice, which is k strides up from z0
+      for (k=0;k<tlen;k++) {
+	z=z0+k*tD[g];  // striding
+	data1d[k]=job->tdata[z];
+	if (job->qc_tdata) qc1d[k]=job->qc_tdata[z];
+      }
+
+      if ((status=transform_one_slice(job, s, 1, data1d, qc1d, 1, 0,
+				      odata1d, oqc1d, 1, 0, &met1d)) < 0) {
+	break;
+      }
+
+      // Now that we've filled odata1d with our transformed data, fill in
+      // our output slice, using the exact process above.  Make sure
+      // we use output strides, z0s, and lens.
+      for (k=0;k<olen;k++) {
+	z=oz0+k*oD[g];
+	job->odata[z]=odata1d[k];
+	job->qc_odata[z]=oqc1d[k];
+      }
+      store_slice_metrics(job, met1d, oz0, 0);
+
+    } else if (in_place) {
+
+      // Slices in place follow right on from each other, D[g-1] (which
+      // is just tlen or olen) apart, so a block of them is no trouble.
+      n=slice_block_end(job, s)-s;
+      if (n > job->s_end-s) n=job->s_end-s;
+
+      for (b=0;b<n;b++) {
+	for (k=0;k<olen;k++) {
+	  job->qc_odata[oz0+b*olen+k]=0;
+	  job->odata[oz0+b*olen+k]=job->output_missing_value;
+	}
+      }
+
+      if ((status=transform_one_slice(job, s, n,
+				      job->tdata+z0,
+				      job->qc_tdata ? job->qc_tdata+z0 : qc1d,
+				      1, tlen,
+				      job->odata+oz0, job->qc_odata+oz0,
+				      1, olen, &met1d)) < 0) {
+	break;
+      }
+      for (b=0;b<n;b++) {
+	store_slice_metrics(job, met1d, oz0+b*olen, b);
+      }
+
+    } else {
+
+      // The rest of this block, which never goes past the jump to the
+      // next run of adjacent slices
+      n=slice_block_end(job, s)-s;
+      if (n > job->s_end-s) n=job->s_end-s;
+
+      // Gather the block, with element k of slice b at [k*n+b]
+      for (k=0;k<tlen;k++) {
+	z=z0+k*tD[g];
+	memcpy(&data1d[k*n], &job->tdata[z], n*sizeof(double));
+	if (job->qc_tdata) memcpy(&qc1d[k*n], &job->qc_tdata[z], n*sizeof(int));
+      }
+
+      for (k=0;k<n*olen;k++) {
+	oqc1d[k]=0;
+	odata1d[k]=job->output_missing_value;
+      }
+
+      if (blocks) {
+	if ((status=transform_one_slice(job, s, n, data1d, qc1d, n, 1,
+					odata1d, oqc1d, n, 1, &met1d)) < 0) {
+	  break;
+	}
+	for (b=0;b<n;b++) {
+	  store_slice_metrics(job, met1d, oz0+b, b);
+	}
+      } else {
+	for (b=0;b<n;b++) {
+	  if ((status=transform_one_slice(job, s+b, 1, data1d+b, qc1d+b, n, 0,
+					  odata1d+b, oqc1d+b, n, 0,
+					  &met1d)) < 0) {
+	    break;
+	  }
+	  store_slice_metrics(job, met1d, oz0+b, 0);
+	  free_metric(&met1d);
+	}
+	if (status < 0) break;
+      }
+
+      // And scatter it back out the same way
+      for (k=0;k<olen;k++) {
+	z=oz0+k*oD[g];
+	memcpy(&job->odata[z], &odata1d[k*n], n*sizeof(double));
+	memcpy(&job->qc_odata[z], &oqc1d[k*n], n*sizeof(int));
+      }
+    }
+
+    // We need to free up met1d and point it back to null, so it will get
+    // properly allocated and not leave hangers.
+    free_metric(&met1d);
+
+    // Now, find our next slice, and reset our pointers.  I don't know if
+    // oz0 will always be a multiple of oD whenever z0 is a multiple of
+    // D, so step them separately just to be sure.
+    for (b=0;b<n;b++) {
+      z0=next_slice_origin(z0, tD, g);
+      oz0=next_slice_origin(oz0, oD, g);
+    }
+
+    // That's it - ready for the next stride.  Our s index just counts,
+    // nothing else.
+  }
+
+  free_metric(&met1d);
+  free(data1d);free(qc1d);free(odata1d);free(oqc1d);
+
+  return(status < 0 ? status : 0);
+}
+
+static void *slice_worker(void *arg) {
+  struct slice_job *job=(struct slice_job *) arg;
+  job->status=transform_slice_range(job);
+  return(NULL);
+}
+
+// Report the slice a job failed on.  This is only ever called once all
+// the threads are done, since msngr is not thread safe.
+static int report_slice_failure(struct slice_job *job, int status) {
+  if (status < 0) {
+    ERROR(TRANS_LIB_NAME,
+	  "Problem transforming variable %s, dimension %d, slice %d; exiting...",
+	  job->invar->name, job->d, job->failed_slice);
+  }
+  return(status);
+}
+
+// Transform all the slices of a job, using up to nthreads threads.  Every
+// slice is transformed by exactly the same code as in the serial case,
+// in the same blocks (see slice_block_end()), and written to its own place
+// in the output, so the results are identical no matter how many threads
+// we use.
+static int transform_slices(struct slice_job *job, int nslice, int nthreads) {
+  int t, s, first, nblocks, nb, per, extra, status;
+
+  job->nslice=nslice;
+  job->quiet=0;
+  job->failed_slice=-1;
+
+  // Serial, the way it's always been
+  if (nthreads <= 1 || ! is_default_transform(job->trans)) {
+    job->s_begin=0;
+    job->s_end=nslice;
+    return(report_slice_failure(job, transform_slice_range(job)));
+  }
+
+  // The block with slice 0 is always done first and by us alone.  Slice 0
+  // is the one that looks up and stores the transform params and tags
+  // estimated bin edges in the user data, and it's where we allocate
+  // metNd and the interface fills in the plan, and none of that should be
+  // done by more than one thread.
+  first=slice_block_end(job, 0);
+
+  job->s_begin=0;
+  job->s_end=first;
+  if ((status=transform_slice_range(job)) < 0) {
+    return(report_slice_failure(job, status));
+  }
+
+  // Now split the rest into contiguous runs of whole blocks, one per
+  // thread
+  nblocks=0;
+  for (s=first;s<nslice;s=slice_block_end(job, s)) nblocks++;
+
+  if (nblocks < 2) {
+    job->s_begin=first;
+    job->s_end=nslice;
+    return(report_slice_failure(job, transform_slice_range(job)));
+  }
+
+  if (nthreads > nblocks) nthreads=nblocks;
+
+  struct slice_job *jobs=CALLOC(nthreads, struct slice_job);
+  pthread_t *threads=CALLOC(nthreads, pthread_t);
+  int *started=CALLOC(nthreads, int);
+
+  per=nblocks/nthreads;
+  extra=nblocks%nthreads;
+  s=first;
+  for (t=0;t<nthreads;t++) {
+    jobs[t]=*job;
+    jobs[t].quiet=1;
+    jobs[t].s_begin=s;
+    for (nb=per+(t < extra ? 1 : 0);nb>0;nb--) {
+      s=slice_block_end(job, s);
+    }
+    jobs[t].s_end=s;
+  }
+
+  DEBUG_LV4("libtrans", "Transforming %d slices of %s with %d threads",
+	    nslice, job->invar->name, nthreads);
+
+  // Run 0 is ours, so only start threads for the others
+  for (t=1;t<nthreads;t++) {
+    started[t]=(pthread_create(&threads[t], NULL, slice_worker, &jobs[t]) == 0);
+  }
+
+  slice_worker(&jobs[0]);
+
+  for (t=1;t<nthreads;t++) {
+    if (started[t]) {
+      pthread_join(threads[t], NULL);
+    } else {
+      // Couldn't get a thread, so do this run ourselves
+      slice_worker(&jobs[t]);
+    }
+  }
+
+  // Report the first failure in slice order, which is what the serial
+  // loop would have stopped on.
+  status=0;
+  for (t=0;t<nthreads;t++) {
+    if (jobs[t].status < 0) {
+      status=report_slice_failure(&jobs[t], jobs[t].status);
+      break;
+    }
+  }
+
+  free(jobs);free(threads);free(started);
+  return(status);
+}
+
 /**
 *  Run the transform engine on an input variable, given input QC and an
 *  allocated and dimensioned output variable (and QC) structure.
@@ -259,10 +737,16 @@ TRANSfunc *get_transform(char *name) {
 *
 *  Upon successful output, outvar and qc_outvar will contain the
 *  transformed data and QC. 
+*
+*  The slices of each dimension are transformed one at a time, unless the
+*  "num_threads" transform parameter of outvar (or, failing that, the
+*  TRANS_NUM_THREADS environment variable) is greater than one, in which
+*  case the default transforms spread the slices over that many threads.
+*  The output is identical either way.
 */
 
 int cds_transform_driver(CDSVar *invar, CDSVar *qc_invar, CDSVar *outvar, CDSVar *qc_outvar) {
-  int i, d, k, z, s, z0, m, Ndims, oNdims;
+  int i, d, k, m, Ndims, oNdims;
   TRANSfunc *trans=NULL;
   double *data, *odata=NULL,*tdata;
   int *qc_data, *qc_odata=NULL, *qc_tdata, *qc_temp;
@@ -312,6 +796,9 @@ int cds_transform_driver(CDSVar *invar, CDSVar *qc_invar, CDSVar *outvar, CDSVar
     trans_store_param_text(qc_invar, "qc_bad", "NODIM", outvar->name);
   }
 
+  // Number of threads to use for the slice loops below; 1 is serial
+  int nthreads=get_num_threads(outvar);
+
   // Okay, proceed with serial 1D transform.  This means looping over dims
   // and building strides and stuff.  This will be fun.
   Ndims=invar->ndims;
@@ -841,128 +1328,48 @@ int cds_transform_driver(CDSVar *invar, CDSVar *qc_invar, CDSVar *outvar, CDSVar
     // Now store the transform name
     trans_store_param("transform", transform_name, odim->name, outvar->name);
     
-    // Allocate space to hold our input and output slices.  We have to have
-    // holding arrays, because our N-dimensional flattened array won't map
-    // pointers or anything.
-
-    // These will get overwritten with each iteration, which means the
-    // following loop is not thread safe.  We'll have to allocate inside
-    // the loop to make it that way.
-    double *data1d=CALLOC(tlen[g], double);  
-    int *qc1d=CALLOC(tlen[g], int);   // If no qc_invar, this will stay 0s,
-				     // so it's cool.
-    double *odata1d=CALLOC(olen[g], double);
-    int *oqc1d=CALLOC(olen[g], int);  
-
-    // Now, loop over all the slices, and pull out the input data and qc
-    // for that slice.  This is fun.
+    // Now, loop over all the slices, transforming each one.  The loop
+    // itself lives in transform_slice_range(), so that we can hand runs of
+    // slices off to worker threads.
     int nslice=tNtot/tlen[g];  
-    int oz0=z0=0;  // First slice *always* starts at origin in our
-		   // flattened array
-
-    // Metric holders
-    TRANSmetric *met1d=NULL, *metNd=NULL;
-
-    for (s=0;s<nslice;s++) {
 
-      // (re)initialize our output fields for this slice
-      for (k=0;k<olen[g];k++) {
-	oqc1d[k]=0;
-	odata1d[k]=output_missing_value;
-      }
-
-      // Now build up our input slice, which is k strides up from z0
-      for (k=0;k<tlen[g];k++) {
-	z=z0+k*tD[g];  // striding
-	data1d[k]=tdata[z];
-	if (qc_tdata) qc1d[k]=qc_tdata[z];
-
-      }
-      // Great.  We now have our input and output arrays, so it's just a
-      // matter of calling the transform interface function.  This takes a
-      // mixture of 1D data arrays and CDS pointers; the latter are used to
-      // track down the various parameters used in the transformation,
-      // including such basic information as the size of the arrays and
-      // what not.
-      //int status =
-      // (*(trans->func))(data1d,qc1d,odata1d,oqc1d,invar,outvar,d,
-      // &met1d);
-      DEBUG_LV4("libtrans",
-		"Analyzing slice %d for %s, dim %d...", s, invar->name, d);
-      //printf(	"Analyzing slice %d for %s, dim %d...", s, invar->name, d);
-      int status = do_transform(trans,
-				.input_data=data1d,
-				.input_qc=qc1d,
-				.input_missing_value=input_missing_value,
-				.output_data=odata1d,
-				.output_qc=oqc1d,
-				.output_missing_value=output_missing_value,
-				.invar=invar,
-				.outvar=outvar,
-				//.d=g,  ! Wrong, I think
-				.d=d,  // input and output ds may be different
-				.od=od,
-				.met=&met1d); 
-
-      // Bomb out if status is bad - I think we exit the whole problem if
-      // this happens, so we don't have to worry about memory allocation or anything.
-      if (status < 0) {
-	ERROR(TRANS_LIB_NAME,
-	      "Problem transforming variable %s, dimension %d, slice %d; exiting...", invar->name, d,s);
-	return(status);
-      }
-
-      // We don't know how many metrics to fill until right here, so:
-      // Make sure to trap out met1==NULL, because that means this
-      // transform doesn't make metrics.
-      if (s==0 && met1d) { // again, not thread safe 
-	allocate_metric(&metNd, met1d->metricnames,met1d->metricunits,met1d->nmetrics, oNtot);
-      }
-
-      // Now that we've filled odata1d with our transformed data, fill in
-      // our output slice, using the exact process above.  Make sure
-      // we use output strides, z0s, and lens.
-      for (k=0;k<olen[g];k++) {
-	z=oz0+k*oD[g];
-	odata[z]=odata1d[k];
-	qc_odata[z]=oqc1d[k];
-
-	// Fill our metrics array, if we've got one
-	if (met1d && met1d->metrics) {
-	  for (m=0;m<met1d->nmetrics;m++) {
-	    metNd->metrics[m][z]=met1d->metrics[m][k];
-	  }
-	}
-      }
-
-      // We need to free up met1d and point it back to null, so it will get
-      // properly allocated and not leave hangers.
-      free_metric(&met1d);
-
-      // Now, find our next slice, and reset our pointers.  The math behind
-      // this is non-trivial, but sound.  Qualitatively, the idea is that
-      // when we increment our faster indeces than d, we 
-      // increment z0 by just 1 (since the stride of our fastest dimension
-      // is always 1).  We can do that D[g] times, until we have to
-      // increment the slower dimensions than d; to do that, we stride in
-      // d-1, i.e. increment z0 by D[g-1].  We then subtract D[g]-1 to
-      // reset our faster indeces to 0, and begin the cycle again.  Hence,
-      // if z0+1 is a multiple of D[g], we set z0 += D[g-1] - (D[g] - 1);
-      // otherwise, z0 += 1.
-
-      // (Note the hidden +1 by doing ++z0 first).
-      if ((++z0 % tD[g]) == 0 && g > 0) {
-	z0 +=  tD[g-1] - tD[g];  
-      }
-
-      // I don't know if oz0 will always be a multiple of oD whenever z0 is
-      // a multiple of D, so repeat the check just to be sure.
-      if ((++oz0 % oD[g]) == 0 && g > 0) {
-	oz0 +=  oD[g-1] - oD[g];  
-      }
-
-      // That's it - ready for the next stride.  Our s index just counts,
-      // nothing else.
+    // Metric holder for this whole transformation
+    TRANSmetric *metNd=NULL;
+
+    // The plan holds whatever the interface works out for this dimension
+    // that doesn't change from slice to slice, so it only gets done once.
+    // User transforms don't know about plans, so they don't get one.
+    TRANSplan *plan=NULL;
+    if (is_default_transform(trans)) plan=trans_create_plan();
+
+    struct slice_job job = {
+      .trans=trans,
+      .invar=invar,
+      .outvar=outvar,
+      .d=d,
+      .od=od,
+      .g=g,
+      .tdata=tdata,
+      .qc_tdata=qc_tdata,
+      .odata=odata,
+      .qc_odata=qc_odata,
+      .tD=tD,
+      .tlen=tlen,
+      .oD=oD,
+      .olen=olen,
+      .oNtot=oNtot,
+      .input_missing_value=input_missing_value,
+      .output_missing_value=output_missing_value,
+      .metNd=&metNd,
+      .plan=plan,
+    };
+
+    int status = transform_slices(&job, nslice, nthreads);
+    trans_free_plan(&plan);
+
+    // Bomb out if status is bad, just like we always have
+    if (status < 0) {
+      return(status);
     }
 
     // Hokay.  At this point we've gone through all the slices in this
@@ -1210,9 +1617,6 @@ int cds_transform_driver(CDSVar *invar, CDSVar *qc_invar, CDSVar *outvar, CDSVar
     memmove(tlen,olen,Ndims*sizeof(int));
     tNtot=oNtot;
 
-    // do some freeing of our working arrays
-    free(data1d);free(qc1d);free(odata1d);free(oqc1d);
-
     if (transform_name) free(transform_name);
   }
 
@@ -103,6 +103,78 @@ typedef struct _TRANSmetric {
   double *ind_min;
 } TRANSmetric;
 
+// A compiled transform, as a sparse (CSR) matrix from the nindex inputs
+// to the ntarget outputs.  This depends only on the index and target
+// grids (and weights), so it's the same for every slice of a variable,
+// and for every variable on the same grids.  Row j holds the inputs that
+// go into output j, in entries row_start[j] to row_start[j+1]-1.  The
+// per-entry and per-row extras are whatever the transform needs to do
+// its QC exactly the way it would walking the grids itself, and can be
+// NULL if it doesn't need them.
+typedef struct _TRANSmatrix {
+  int nrows;  // ntarget
+  int ncols;  // nindex
+  int nnz;
+  int *row_start;  // [nrows+1]
+  int *col;  // [nnz] input index
+  double *weight;  // [nnz] weight applied to the input value
+  double *frac;  // [nnz] fraction of the input bin used
+  double *span;  // [nnz] contribution to coverage
+  int *row_flags;  // [nrows]
+  int *row_index;  // [nrows]
+  double *row_span;  // [nrows]
+  double *row_max_weight;  // [nrows]
+} TRANSmatrix;
+
+TRANSmatrix *trans_create_matrix(int nrows, int ncols, int nnz);
+void trans_free_matrix(TRANSmatrix *);
+
+// Compiled matrices are kept in a cache keyed by the grids they were made
+// from, so other variables on the same grids can just pick them up.
+TRANSmatrix *trans_get_cached_matrix(const char *kind, double *key, int nkey);
+TRANSmatrix *trans_cache_matrix(const char *kind, double *key, int nkey,
+				TRANSmatrix *matrix);
+void trans_release_matrix(void *matrix);
+void trans_clear_matrix_cache(void);
+
+// A transform plan holds everything an interface function works out from
+// the transform params and the coordinate variables for one (invar, d) ->
+// (outvar, od) transformation.  None of that changes from slice to slice,
+// so the driver makes an empty plan for each dimension group, the
+// interface fills it in on the first slice (ready=1), and every slice
+// after that just uses it.  The first slice is always done alone, so
+// after that the plan is only ever read, even with several threads.
+typedef struct _TRANSplan {
+  int ready;  // 0 until the interface has filled it in
+
+  int ni;  // input and output lengths along the transformed dimension
+  int nt;
+  double input_missing_value;  // after any transform param overrides
+  double output_missing_value;
+  unsigned int qc_mask;
+  double range;
+
+  // Coordinates - whichever of these the transform needs
+  double *index;  // for single value indeces (i.e. bin midpoints)
+  double *target;
+  double *index_boundary_1;  // for bins
+  double *index_boundary_2;
+  double *target_boundary_1;
+  double *target_boundary_2;
+  double *weights;
+
+  double limits[4];  // metric QC limits, for bin averaging
+
+  int estimated_bin_qc;  // qc bits to or into every output value
+
+  // Anything else a transform wants to keep, and how to free it
+  void *aux;
+  void (*free_aux)(void *);
+} TRANSplan;
+
+TRANSplan *trans_create_plan(void);
+void trans_free_plan(TRANSplan **);
+
 // The designated argument struct for the interface functions.  This lets
 // me easily modify the inputs and add stuff to or even modify them without
 // having to rewrite everything in all the interface functions.  It even
@@ -121,6 +193,23 @@ typedef struct {
   int d;
   int od;  // Output dim index - may be different than input
   TRANSmetric **met;
+  TRANSplan *plan;  // NULL means work everything out on each call
+
+  // Element k of the slice is at input_data[k*input_stride] (and the same
+  // for input_qc), and likewise for the output.  0 means 1, i.e. the
+  // slice is contiguous, which is what you get if you don't set them.
+  int input_stride;
+  int output_stride;
+
+  // Transforms that can do several slices in one go (see
+  // takes_slice_blocks() in the driver) may be handed nslices of them at
+  // once, with slice b starting at input_data[b*input_slice_stride], and
+  // likewise for the output.  Their metrics for slice b then go at
+  // metrics[m][b*n+k], where n is the length of one output slice.  0 means
+  // a single slice, which is all any other transform ever gets.
+  int nslices;
+  int input_slice_stride;
+  int output_slice_stride;
 } interface_s;
 
 // This is a structure that links an trans interface function to a
@@ -189,6 +278,7 @@ typedef struct {
   double **index_n;  // for multiple input coordinate dims
   double input_missing_value;
   int nindex;
+  int input_stride;  // step between input elements, for data and qc (0 = 1)
 
   // output, or transformed, elements
   double *output_data;
@@ -199,6 +289,7 @@ typedef struct {
   int ntarget;
   double output_missing_value;
   double **target_n;  // for multiple output coordinate dims
+  int output_stride;  // step between output elements (0 = 1)
 
   double ***metrics;
 
@@ -207,6 +298,9 @@ typedef struct {
   double *weights;
   double range;
   
+  // A compiled version of the transform, if we have one
+  TRANSmatrix *matrix;
+
   // And an auxilliary pointer, just in case
   void *aux;
 } core_s;
@@ -253,6 +347,7 @@ int get_bin_edges(double **, double **, double *, int, CDSVar *, int);
 double *get_bin_midpoints(double *index, int nbins, CDSVar *var, int d);
 int set_estimated_bin_qc(int *qc_odata, CDSVar *invar, int d,
 			 CDSVar *outvar, int od, int nt);
+int get_estimated_bin_qc(CDSVar *invar, int d, CDSVar *outvar, int od);
 CDSVar *get_qc_var(CDSVar *);
 
 void trans_turn_off_default_edges();
@@ -40,7 +40,8 @@
 // tired of figurin it out, so here we go
 # define HUGE		3.40282347e+38F
 
-static size_t _one=1;
+// Per thread; see the note in trans_utils.c
+static __thread size_t _one=1;
 
 #define NUM_METRICS 2
 static const char *metnames[] = {
@@ -57,6 +58,10 @@ static const char *metunits[] = {
 # define CALLOC(n,t)  (t*)calloc(n, sizeof(t))
 # define REALLOC(p,n,t)  (t*) realloc((char *) p, (n)*sizeof(t));
 
+// The compiled versions, down below bin_average()
+static int compile_bin_average(TRANSplan *);
+static int bin_average_matrix(core_s *, double *, double *);
+
 // Average values into our bins - this is why we need the exact
 // specification of our edge, so we can properly weight everything that
 // goes into the average.
@@ -80,50 +85,53 @@ int trans_bin_average(float *array,
 		float missing_value) { 
 */
 
-//int trans_bin_average_interface
-//(double *data, int *qc_data, double *odata, int *qc_odata,
-// CDSVar *invar, CDSVar *outvar, int d, TRANSmetric **met) 
-
-int trans_bin_average_interface(interface_s is)
+// Free everything build_bin_average_plan() has made, for when it has to
+// give up before handing it all over to the plan.
+static void free_bin_average_work(double *index, double *target,
+				  double *weights,
+				  double *index_start, double *index_end,
+				  double *target_start, double *target_end)
 {
+  if (index) free(index);
+  if (target) free(target);
+  if (weights) free(weights);
+  if (index_start) free(index_start);
+  if (index_end) free(index_end);
+  if (target_start) free(target_start);
+  if (target_end) free(target_end);
+}
 
-  int ni, nt, i, status,m;
+// Work out everything about this transformation that doesn't depend on the
+// data in the slice - params, weights, bin edges and so on - and put it
+// into the plan.  This is done once, for the first slice.
+static int build_bin_average_plan(interface_s *is, TRANSplan *plan)
+{
+  int ni, nt, i, status;
   double *index_start=NULL, *index_end=NULL, *target_start=NULL,
     *target_end=NULL, *weights=NULL;
   double missing_value;
-  double **metrics=NULL;
   unsigned int qc_mask=0;
   size_t len;
   CDSVar *incoord, *outcoord;
-  TRANSmetric *met1d;
 
   // Unlike other interfaces, these are just markers for the dimensions,
   // which we'll use to infer the bin edges.  
   double *index=NULL, *target=NULL;
 
-  // Assign from interface struct - if I had written it this way to begin
-  // with I would just use the is elements, but I didn't.
-  double *data=is.input_data;
-  int *qc_data=is.input_qc;
-  double input_missing_value=is.input_missing_value;
-  double *odata=is.output_data;
-  int *qc_odata=is.output_qc;
-  double output_missing_value=is.output_missing_value;
-  CDSVar *invar=is.invar;
-  CDSVar *outvar=is.outvar;
-  int d=is.d;   // input and output dimensions may be different.
-  int od=is.od;
-  TRANSmetric **met=is.met;
-  
+  CDSVar *invar=is->invar;
+  CDSVar *outvar=is->outvar;
+  int d=is->d;   // input and output dimensions may be different.
+  int od=is->od;
+
+  // Start with the missing values we were given by the driver
+  plan->input_missing_value=is->input_missing_value;
+  plan->output_missing_value=is->output_missing_value;
+
   // Pull out the stuff we need from invar, outvar, the dimension index d,
   // and the right calls to the transfrom parameter functions
   ni=invar->dims[d]->length;
   nt=outvar->dims[od]->length;
 
-  // Define and allocate our metric
-  allocate_metric(met,metnames, metunits, NUM_METRICS, nt);
-  met1d = (*met);
-
   // These mostly work straight up because coord vars are always 1D, so we
   // don't have to worry about indexing or casting correctly
   incoord = cds_get_coord_var(invar, d);
@@ -142,7 +150,7 @@ int trans_bin_average_interface(interface_s is)
   if (cds_get_transform_param_by_dim(invar, invar->dims[d],
 				     "missing_value", CDS_DOUBLE,
 				     &_one, &missing_value) != NULL) {
-    input_missing_value=missing_value;
+    plan->input_missing_value=missing_value;
 
     // Need to save anything that modifies input data: note, we are still
     // tagging with output dim and varname, because we store it in the
@@ -156,7 +164,7 @@ int trans_bin_average_interface(interface_s is)
   if (cds_get_transform_param_by_dim(outvar, outvar->dims[od],
 				     "missing_value", CDS_DOUBLE,
 				     &_one, &missing_value) != NULL) {
-    output_missing_value=missing_value;
+    plan->output_missing_value=missing_value;
   }
 
   CDSVar *qc_invar=get_qc_var(invar);
@@ -241,6 +249,8 @@ int trans_bin_average_interface(interface_s is)
     ERROR(TRANS_LIB_NAME,
 	  "Bin widths for input variable %s required but not provided.  Exiting...",
 	  invar->name);
+    free_bin_average_work(index, target, weights, index_start, index_end,
+			  target_start, target_end);
     return(-1);
   }
 
@@ -248,6 +258,8 @@ int trans_bin_average_interface(interface_s is)
     ERROR(TRANS_LIB_NAME,
 	  "Bin widths for output variable %s required but not provided.  Exiting...",
 	  outvar->name);
+    free_bin_average_work(index, target, weights, index_start, index_end,
+			  target_start, target_end);
     return(-1);
   }
 
@@ -258,10 +270,77 @@ int trans_bin_average_interface(interface_s is)
     if (target_start[i]-target_end[i] == 0) {
       ERROR(TRANS_LIB_NAME, "Output bin %d for field %s dimension %s has zero width (%f) - must provide valid averaging interval",
 	    i, outvar->name, outvar->dims[od]->name, target_start[i]);
+      free_bin_average_work(index, target, weights, index_start, index_end,
+			    target_start, target_end);
       return(-1);
     }
   }
 
+  // We only needed the markers to get the edges
+  if (index) free(index);
+  if (target) free(target);
+
+  // Everything checks out, so hand it all over to the plan, which owns it
+  // from here on
+  plan->ni=ni;
+  plan->nt=nt;
+  plan->qc_mask=qc_mask;
+  plan->weights=weights;
+  plan->index_boundary_1=index_start;
+  plan->index_boundary_2=index_end;
+  plan->target_boundary_1=target_start;
+  plan->target_boundary_2=target_end;
+  memcpy(plan->limits, limits, sizeof(limits));
+
+  // The qc bits to set if we estimated the bin boundaries
+  plan->estimated_bin_qc=get_estimated_bin_qc(invar, d, outvar, od);
+
+  // And now that we know all the bins, compile the averaging itself, so
+  // each slice is just a sparse matrix times the data
+  if ((status=compile_bin_average(plan)) < 0) {
+    return(status);
+  }
+
+  plan->ready=1;
+  return(0);
+}
+
+//int trans_bin_average_interface
+//(double *data, int *qc_data, double *odata, int *qc_odata,
+// CDSVar *invar, CDSVar *outvar, int d, TRANSmetric **met) 
+
+int trans_bin_average_interface(interface_s is)
+{
+
+  int nt, i, status,m;
+  double **metrics=NULL;
+  TRANSmetric *met1d;
+
+  // Assign from interface struct - if I had written it this way to begin
+  // with I would just use the is elements, but I didn't.
+  double *data=is.input_data;
+  int *qc_data=is.input_qc;
+  double *odata=is.output_data;
+  int *qc_odata=is.output_qc;
+  TRANSmetric **met=is.met;
+  int ostride=is.output_stride > 0 ? is.output_stride : 1;
+
+  // If the driver didn't give us a plan, make a throwaway one for just
+  // this call
+  TRANSplan *plan=is.plan;
+  if (plan == NULL) plan=trans_create_plan();
+
+  if (! plan->ready && (status=build_bin_average_plan(&is, plan)) < 0) {
+    if (plan != is.plan) trans_free_plan(&plan);
+    return(status);
+  }
+
+  nt=plan->nt;
+
+  // Define and allocate our metric
+  allocate_metric(met,metnames, metunits, NUM_METRICS, nt);
+  met1d = (*met);
+
   // Now just call our core function
 
   //  status=bin_average(data, qc_data, qc_mask, index_start, index_end, weights, ni,
@@ -271,31 +350,32 @@ int trans_bin_average_interface(interface_s is)
   status = call_core_function(bin_average, 
 			      .input_data=data,
 			      .input_qc=qc_data,
-			      .qc_mask=qc_mask,
-			      .index_boundary_1=index_start,
-			      .index_boundary_2=index_end,
-			      .weights=weights,
-			      .nindex=ni,
+			      .input_stride=is.input_stride,
+			      .qc_mask=plan->qc_mask,
+			      .index_boundary_1=plan->index_boundary_1,
+			      .index_boundary_2=plan->index_boundary_2,
+			      .weights=plan->weights,
+			      .nindex=plan->ni,
 			      .output_data=odata,
 			      .output_qc=qc_odata,
-			      .target_boundary_1=target_start,
-			      .target_boundary_2=target_end,
+			      .output_stride=is.output_stride,
+			      .target_boundary_1=plan->target_boundary_1,
+			      .target_boundary_2=plan->target_boundary_2,
 			      .ntarget=nt,
-			      .input_missing_value=input_missing_value,
-			      .output_missing_value=output_missing_value,
+			      .input_missing_value=plan->input_missing_value,
+			      .output_missing_value=plan->output_missing_value,
 			      .metrics=&metrics,
-			      .aux=limits);
+			      .matrix=(TRANSmatrix *) plan->aux,
+			      .aux=plan->limits);
 
   // Set the qc bits if we estimated the bin boundaries
-  set_estimated_bin_qc(qc_odata, invar, d, outvar, od, nt); 
+  if (plan->estimated_bin_qc) {
+    for (i=0;i<nt;i++) {
+      qc_odata[i*ostride] |= plan->estimated_bin_qc;
+    }
+  }
 
-  if (index) free(index);
-  if (target) free(target);
-  if (weights) free(weights);
-  if (index_start) free(index_start);
-  if (index_end) free(index_end);
-  if (target_start) free(target_start);
-  if (target_end) free(target_end);
+  if (plan != is.plan) trans_free_plan(&plan);
 
   // Pass our metrics back to the driver.
   for (m=0; m < NUM_METRICS ; m++) {
@@ -311,6 +391,318 @@ int trans_bin_average_interface(interface_s is)
   return(status);
 }
 
+// Set output j, its metrics, and its qc, from the sums we've run up over
+// the input bins that overlap it.  scanned tells us that at least one
+// input bin got looked at, whether or not we could use it.
+static void set_bin_output(int j, double sum_array, double sum_weight,
+			   double sum_array2, double max_weight, int scanned,
+			   double total_span, double good_span, int qco,
+			   core_s *cs, double *stdev, double *coverage)
+{
+  double *output = cs->output_data;
+  int *qc_output = cs->output_qc;
+  unsigned int qc_mask = cs->qc_mask;
+  int ostride = cs->output_stride > 0 ? cs->output_stride : 1;
+  double output_missing_value = cs->output_missing_value;
+
+  double *limits = (double *) cs->aux;
+
+  double std_bad_max = limits[0];
+  double std_ind_max = limits[1];
+  double goodfrac_bad_min = limits[2];
+  double goodfrac_ind_min = limits[3];
+
+  // So our average value is what it is
+  if (max_weight==0 && scanned) {
+    // This means that (a) we had one or more overlapping points and (b)
+    // all the weights were zero.  In this case we prescribe an output
+    // value of zero.
+    output[j*ostride]=0;
+    stdev[j]=0;
+    coverage[j]=0;
+    qc_set(qc_output[j*ostride], QC_ZERO_WEIGHT);
+  } else if (! scanned) {
+    // This means that none of our inputs overlapped our output bin;
+    // either the dimensions are wonky or the data is missing (NOT bad,
+    // but actually missing).  Most likely this will happen when we have
+    // a half-day of data in the file or something.  Anyway, set the
+    // output to missing and set QC_OUTSIDE_RANGE
+    output[j*ostride]=output_missing_value;
+    stdev[j]=output_missing_value;
+    coverage[j]=0;
+    qc_set(qc_output[j*ostride], QC_OUTSIDE_RANGE);
+    qc_set(qc_output[j*ostride], QC_BAD);
+  } else if (sum_weight == 0) {
+    // Now we know we had a positive weight, so this means all the data
+    // failed QC, and should be crunched.
+    //fprintf(stderr, "bin_average: target bin [%f,%f] has no good values to average\n",
+    //target_start[j],target_end[j]);
+    output[j*ostride]=output_missing_value;
+    stdev[j]=output_missing_value;
+    coverage[j]=0;
+    qc_set(qc_output[j*ostride], QC_ALL_BAD_INPUTS);
+    qc_set(qc_output[j*ostride], QC_BAD);
+  } else {
+
+    output[j*ostride]=sum_array/sum_weight;
+
+    // Calculate our metrics
+
+    // Check: 
+    // s0 = sum(w)
+    // s1 = sum(wx)
+    // s2 = sum(wx^2)
+    // sample stdev = x = sqrt((s0*s2 - s1*s1)/(s0*(s0-1)))
+
+    stdev[j] = sum_weight*sum_array2 - sum_array*sum_array;
+
+    // stdev[j] /= (sum_weight*sum_weight) - sum_weight;
+    // This is a problem - the sample stdev divides by s0(s0-1).  But, if
+    // s0 = sum_weight < 1, that goes negative, and we can get a nan when
+    // we take the sqrt.  I'm seeing this with only two points, so it
+    // might be only a problem when you have too few points to take a
+    // proper sample stdev - with more points, perhaps s1*s1 will always
+    // be > s0*s2 when s0 < 1.  I dunno, I'll have to read up on the
+    // whole sample stdev issue.  But for now, I'm going to go to a
+    // regular stdev instead.  I always have trouble getting my head
+    // around this, but the sample stdev may not be what we want, anyway.
+
+    stdev[j] /= sum_weight*sum_weight;  // s0*s0
+
+    if (fabs(stdev[j]) < 1e-12) {
+      stdev[j] = 0.0;  // roundoff error, so just set to zero
+    } else if (stdev[j] < 0) {
+      // This should no longer happen, unless the roundoff has gotten
+      // really huge or something.
+      LOG(TRANS_LIB_NAME,
+	  "Standard deviation cannot be calculated: s0s2-s1s1 = %g (%e) \n",
+	  stdev[j],stdev[j]);
+      stdev[j] = output_missing_value;
+    } else {
+      stdev[j] = sqrt(stdev[j]);
+    }
+    coverage[j] = good_span/total_span;
+
+    // If any of the input points were yellow (i.e. if they intersect
+    // with the non-qc_masked bits), set output to indeterminate
+    // We  used to just pass through the bits like this:
+    // qc_output[j] |= qco
+    if ((qco & ~qc_mask) != 0) {
+      qc_set(qc_output[j*ostride], QC_INDETERMINATE);
+    }
+  }
+
+  // After all this, set the the metric-based QC limits, assuming we have
+  // a real data point - check for missing, first
+  if (stdev[j] != output_missing_value) {
+    if (stdev[j] > std_bad_max) {
+      qc_set(qc_output[j*ostride], QC_BAD_STD);
+    } else if (stdev[j] > std_ind_max) {
+      qc_set(qc_output[j*ostride], QC_INDETERMINATE_STD);
+    }
+  }
+
+  if (coverage[j] != output_missing_value) {
+    if (coverage[j] < goodfrac_bad_min) {
+      qc_set(qc_output[j*ostride], QC_BAD_GOODFRAC);
+    } else if (coverage[j] < goodfrac_ind_min) {
+      qc_set(qc_output[j*ostride], QC_INDETERMINATE_GOODFRAC);
+    }
+  }
+}
+
+// Walk the input and target bins exactly the way bin_average() does, but
+// instead of averaging, record which inputs overlap each output, and with
+// what weight, in matrix m.  With m NULL we just count the entries (and
+// do all the checking and logging), so this is called twice.
+static int walk_bins(double *index_start, double *index_end, double *weights,
+		     int ni, double *target_start, double *target_end, int nt,
+		     TRANSmatrix *m, int *nnz)
+{
+  int i, i0, j, sign, e=0;
+  double u, v, w, bin, total_span, max_weight;
+
+  // Same checks as bin_average()
+  if ((ni == 1 || index_start[0] < index_start[1]) &&
+      (nt == 1 || target_start[0] < target_start[1])) {
+    sign = 1;
+  } else if ((ni == 1 || index_start[0] > index_start[1]) &&
+	     (nt == 1 || target_start[0] > target_start[1])) { 
+    sign = -1;
+  } else {
+    ERROR(TRANS_LIB_NAME, "Target and index are not monotonically aligned");
+    return(-5);
+  }
+
+  i0=0;
+  for (j=0; j<nt; j++) {
+    total_span=max_weight=0.0;
+    i=i0;
+
+    while (i < ni && sign*index_end[i] < sign*target_start[j]) { i++;}
+    i0=i;
+
+    if (m) m->row_start[j]=e;
+
+    while (i < ni && sign*index_start[i] < sign*target_end[j]) {
+
+      if (sign*index_end[i] < sign*target_start[j]) {
+	// Only log on the counting pass, so we don't say it twice
+	if (! m) {
+	  LOG(TRANS_LIB_NAME,
+	      "Input bin %d [%f,%f] does not overlap output bin %d [%f,%f]; skipping...",
+	      i, index_start[i], index_end[i], j, target_start[j], target_end[j]);
+	}
+	i++;
+	continue;
+      }
+
+      w=1.0;
+      bin=index_end[i]-index_start[i];
+
+      if (bin == 0.0) {  
+	u=v=0;
+      } else {
+	if ((u=(target_start[j]-index_start[i])/bin) > 0) w-=u;
+	if ((v=(index_end[i]-target_end[j])/bin) > 0) w-=v;
+      }
+
+      if (u>1.0 || v>1.0 || u+v>1.0 || w < 0.0) {
+	ERROR(TRANS_LIB_NAME,
+	      "Problem with bin average: input bin %d [%f,%f], output bin %d [%f,%f]",
+		 i, index_start[i], index_end[i], j, target_start[j], target_end[j]);
+	return(-1);
+      }
+
+      if (m) {
+	m->col[e]=i;
+	m->frac[e]=w;
+	if (fabs(bin) > 0) { 
+	  m->span[e] = w*sign*bin;
+	} else {
+	  m->span[e] = 1;
+	}
+	total_span += m->span[e];
+	m->weight[e]=w*weights[i];
+      }
+
+      if (w>0 && weights[i] > max_weight) {max_weight=weights[i];}
+
+      e++;
+      i++;
+    }
+
+    if (m) {
+      m->row_span[j]=total_span;
+      m->row_max_weight[j]=max_weight;
+      m->row_flags[j]=(i > i0);
+    }
+  }
+
+  if (m) m->row_start[nt]=e;
+  if (nnz) *nnz=e;
+  return(0);
+}
+
+// Compile the bin average for our plan into a sparse matrix, or pick up
+// one we already made for the same bins and weights.
+static int compile_bin_average(TRANSplan *plan)
+{
+  int ni=plan->ni, nt=plan->nt;
+  int nnz, status, k;
+  TRANSmatrix *m;
+
+  // The key is everything the matrix depends on
+  int nkey=3*ni+2*nt;
+  double *key=CALLOC(nkey, double);
+  k=0;
+  memcpy(&key[k], plan->index_boundary_1, ni*sizeof(double)); k+=ni;
+  memcpy(&key[k], plan->index_boundary_2, ni*sizeof(double)); k+=ni;
+  memcpy(&key[k], plan->weights, ni*sizeof(double)); k+=ni;
+  memcpy(&key[k], plan->target_boundary_1, nt*sizeof(double)); k+=nt;
+  memcpy(&key[k], plan->target_boundary_2, nt*sizeof(double));
+
+  if ((m=trans_get_cached_matrix("bin_average", key, nkey)) == NULL) {
+
+    if ((status=walk_bins(plan->index_boundary_1, plan->index_boundary_2,
+			  plan->weights, ni,
+			  plan->target_boundary_1, plan->target_boundary_2, nt,
+			  NULL, &nnz)) < 0) {
+      free(key);
+      return(status);
+    }
+
+    m=trans_create_matrix(nt, ni, nnz);
+    walk_bins(plan->index_boundary_1, plan->index_boundary_2,
+	      plan->weights, ni,
+	      plan->target_boundary_1, plan->target_boundary_2, nt,
+	      m, NULL);
+
+    DEBUG_LV4("libtrans", "Compiled bin average matrix: %d x %d, %d entries",
+	      nt, ni, nnz);
+
+    m=trans_cache_matrix("bin_average", key, nkey, m);
+  }
+
+  free(key);
+
+  plan->aux=m;
+  plan->free_aux=trans_release_matrix;
+  return(0);
+}
+
+// The compiled version of the bin averaging loop in bin_average().  The
+// grids have already been walked, so all that's left is to run over the
+// inputs in each row, skip the bad ones, and sum up the good ones - in
+// the same order and with the same arithmetic, so we get exactly the same
+// answer.
+static int bin_average_matrix(core_s *cs, double *stdev, double *coverage)
+{
+  TRANSmatrix *mat=cs->matrix;
+  double *array = cs->input_data;
+  int *qc_array = cs->input_qc;
+  unsigned int qc_mask = cs->qc_mask;
+  double input_missing_value = cs->input_missing_value;
+  int *qc_output = cs->output_qc;
+  int istride = cs->input_stride > 0 ? cs->input_stride : 1;
+  int ostride = cs->output_stride > 0 ? cs->output_stride : 1;
+
+  int i, j, e, qco;
+  double w, sum_array, sum_weight, sum_array2, good_span;
+
+  for (j=0; j<mat->nrows; j++) {
+    sum_array=sum_weight=0.0;
+    sum_array2=0.0;
+    good_span=0.0;
+    qc_output[j*ostride]=qco=0;
+
+    for (e=mat->row_start[j]; e<mat->row_start[j+1]; e++) {
+      i=mat->col[e];
+
+      if (mat->frac[e]>0 &&
+	  (array[i*istride] == input_missing_value || (qc_array[i*istride] & qc_mask) || ! isfinite(array[i*istride]))) {
+	qc_set(qc_output[j*ostride], QC_SOME_BAD_INPUTS);
+	continue;
+      }
+      good_span += mat->span[e];
+
+      w=mat->weight[e];
+      sum_array += w*array[i*istride];
+      sum_weight += w;
+      sum_array2 += w*array[i*istride]*array[i*istride];
+
+      if (w > 0) {
+	qco |= qc_array[i*istride];
+      }
+    }
+
+    set_bin_output(j, sum_array, sum_weight, sum_array2,
+		   mat->row_max_weight[j], mat->row_flags[j],
+		   mat->row_span[j], good_span, qco, cs, stdev, coverage);
+  }
+
+  return(0);
+}
 
 //int bin_average(double *array,
 //                int *qc_array,
@@ -348,22 +740,15 @@ int bin_average(core_s cs) {
   double *index_end = cs.index_boundary_2;
   double *weights = cs.weights;
   int ni = cs.nindex;
-  double *output = cs.output_data;
   int *qc_output = cs.output_qc;
+  int istride = cs.input_stride > 0 ? cs.input_stride : 1;
+  int ostride = cs.output_stride > 0 ? cs.output_stride : 1;
   double *target_start = cs.target_boundary_1;
   double *target_end = cs.target_boundary_2;
   int nt = cs.ntarget;
   double input_missing_value = cs.input_missing_value;
-  double output_missing_value = cs.output_missing_value;
   double ***rmet = cs.metrics;
 
-  double *limits = (double *) cs.aux;
-
-  double std_bad_max = limits[0];
-  double std_ind_max = limits[1];
-  double goodfrac_bad_min = limits[2];
-  double goodfrac_ind_min = limits[3];
-
   // Just to keep things clear; rmet is the pointer to the 2D metrics
   // structure, and I prefer to work with that.
   metrics=*rmet;
@@ -407,6 +792,11 @@ int bin_average(core_s cs) {
     return(-5);
   }
 
+  // If we've been compiled, all the walking of the grids is already done
+  if (cs.matrix) {
+    return(bin_average_matrix(&cs, stdev, coverage));
+  }
+
   // Set our weights=1.0 if not given
   if (weights == NULL) {
     weights=CALLOC(ni,double);
@@ -422,7 +812,7 @@ int bin_average(core_s cs) {
     sum_array=sum_weight=max_weight=0.0;
     sum_array2=sum_weight2=0.0;
     total_span=good_span=0.0;
-    qc_output[j]=qco=0;
+    qc_output[j*ostride]=qco=0;
     i=i0;  // start with previous first input bin
 
     // run up i until we find an input bin that overlaps our target bin;
@@ -511,12 +901,12 @@ int bin_average(core_s cs) {
       // Don't qc zero weighted points, because they don't matter.  They
       // are probably the result of a <= or >= and have zero bin overlap
       if (w>0 &&
-	  (array[i] == input_missing_value || (qc_array[i] & qc_mask) || ! isfinite(array[i]))) {
-	qc_set(qc_output[j], QC_SOME_BAD_INPUTS);
+	  (array[i*istride] == input_missing_value || (qc_array[i*istride] & qc_mask) || ! isfinite(array[i*istride]))) {
+	qc_set(qc_output[j*ostride], QC_SOME_BAD_INPUTS);
 	i++;
 	continue;
 #ifdef notdef
-      } else if (qc_array[i] != 0) {
+      } else if (qc_array[i*istride] != 0) {
 	if (fabs(bin) > 0) { 
 	  //yellow_span += w*sign*(index_end[i]-index_start[i]);
 	  yellow_span += w*sign*bin;
@@ -549,10 +939,10 @@ int bin_average(core_s cs) {
       // now mult by the actual weight of this bin
       w *= weights[i];
 	
-      sum_array += w*array[i];
+      sum_array += w*array[i*istride];
       sum_weight += w;
 
-      sum_array2 += w*array[i]*array[i];
+      sum_array2 += w*array[i*istride]*array[i*istride];
       sum_weight2 += w*w;
 
       // Down here is where we might calculate the reduction metrics
@@ -567,7 +957,7 @@ int bin_average(core_s cs) {
       // If we are actually weighting by this value, then we need to pass
       // through the qc as well.
       if (w > 0) {
-	qco |= qc_array[i];
+	qco |= qc_array[i*istride];
       }
 	
       // Finally, don't forget to increment
@@ -575,104 +965,9 @@ int bin_average(core_s cs) {
 
     }
 
-
     // So our average value is what it is
-    if (max_weight==0 && i > i0) {
-      // This means that (a) we had one or more overlapping points and (b)
-      // all the weights were zero.  In this case we prescribe an output
-      // value of zero.
-      output[j]=0;
-      stdev[j]=0;
-      coverage[j]=0;
-      qc_set(qc_output[j], QC_ZERO_WEIGHT);
-    } else if (i == i0) {
-      // This means that none of our inputs overlapped our output bin;
-      // either the dimensions are wonky or the data is missing (NOT bad,
-      // but actually missing).  Most likely this will happen when we have
-      // a half-day of data in the file or something.  Anyway, set the
-      // output to missing and set QC_OUTSIDE_RANGE
-      output[j]=output_missing_value;
-      stdev[j]=output_missing_value;
-      coverage[j]=0;
-      qc_set(qc_output[j], QC_OUTSIDE_RANGE);
-      qc_set(qc_output[j], QC_BAD);
-    } else if (sum_weight == 0) {
-      // Now we know we had a positive weight, so this means all the data
-      // failed QC, and should be crunched.
-      //fprintf(stderr, "bin_average: target bin [%f,%f] has no good values to average\n",
-      //target_start[j],target_end[j]);
-      output[j]=output_missing_value;
-      stdev[j]=output_missing_value;
-      coverage[j]=0;
-      qc_set(qc_output[j], QC_ALL_BAD_INPUTS);
-      qc_set(qc_output[j], QC_BAD);
-    } else {
-
-      output[j]=sum_array/sum_weight;
-
-      // Calculate our metrics
-
-      // Check: 
-      // s0 = sum(w)
-      // s1 = sum(wx)
-      // s2 = sum(wx^2)
-      // sample stdev = x = sqrt((s0*s2 - s1*s1)/(s0*(s0-1)))
-
-      stdev[j] = sum_weight*sum_array2 - sum_array*sum_array;
-
-      // stdev[j] /= (sum_weight*sum_weight) - sum_weight;
-      // This is a problem - the sample stdev divides by s0(s0-1).  But, if
-      // s0 = sum_weight < 1, that goes negative, and we can get a nan when
-      // we take the sqrt.  I'm seeing this with only two points, so it
-      // might be only a problem when you have too few points to take a
-      // proper sample stdev - with more points, perhaps s1*s1 will always
-      // be > s0*s2 when s0 < 1.  I dunno, I'll have to read up on the
-      // whole sample stdev issue.  But for now, I'm going to go to a
-      // regular stdev instead.  I always have trouble getting my head
-      // around this, but the sample stdev may not be what we want, anyway.
-
-      stdev[j] /= sum_weight*sum_weight;  // s0*s0
-
-      if (fabs(stdev[j]) < 1e-12) {
-	stdev[j] = 0.0;  // roundoff error, so just set to zero
-      } else if (stdev[j] < 0) {
-	// This should no longer happen, unless the roundoff has gotten
-	// really huge or something.
-	LOG(TRANS_LIB_NAME,
-	    "Standard deviation cannot be calculated: s0s2-s1s1 = %g (%e) \n",
-	    stdev[j],stdev[j]);
-	stdev[j] = output_missing_value;
-      } else {
-	stdev[j] = sqrt(stdev[j]);
-      }
-      coverage[j] = good_span/total_span;
-
-      // If any of the input points were yellow (i.e. if they intersect
-      // with the non-qc_masked bits), set output to indeterminate
-      // We  used to just pass through the bits like this:
-      // qc_output[j] |= qco
-      if ((qco & ~qc_mask) != 0) {
-	qc_set(qc_output[j], QC_INDETERMINATE);
-      }
-    }
-
-    // After all this, set the the metric-based QC limits, assuming we have
-    // a real data point - check for missing, first
-    if (stdev[j] != output_missing_value) {
-      if (stdev[j] > std_bad_max) {
-	qc_set(qc_output[j], QC_BAD_STD);
-      } else if (stdev[j] > std_ind_max) {
-	qc_set(qc_output[j], QC_INDETERMINATE_STD);
-      }
-    }
-
-    if (coverage[j] != output_missing_value) {
-      if (coverage[j] < goodfrac_bad_min) {
-	qc_set(qc_output[j], QC_BAD_GOODFRAC);
-      } else if (coverage[j] < goodfrac_ind_min) {
-	qc_set(qc_output[j], QC_INDETERMINATE_GOODFRAC);
-      }
-    }
+    set_bin_output(j, sum_array, sum_weight, sum_array2, max_weight,
+		   i > i0, total_span, good_span, qco, &cs, stdev, coverage);
   } // output samples: j
 
   return(0);
@@ -40,6 +40,7 @@
 # include <stdlib.h>
 # include <stdint.h>
 # include <cblas.h>
+# include <pthread.h>
 
 #include "../config.h"
 #ifdef HAVE_LAPACKE_H
@@ -59,7 +60,17 @@ int caracena(double *data, double *deriv_lat, double *deriv_lon,
 	     double *out_data, int no, double *olat, double *olon,
 	     int npass, double scale_factor);
 
-static size_t _one=1;
+// The station dependent part of the analysis, and what we do with it;
+// see below.
+struct caracena_op;
+static struct caracena_op *build_caracena_op(int, double *, double *, int,
+					     double *, double *, int, double);
+static int apply_caracena_op(struct caracena_op *, int, double *, double *,
+			     double *, double *);
+static void free_caracena_op(struct caracena_op *);
+
+// Per thread; see the note in trans_utils.c
+static __thread size_t _one=1;
 
 /* We'll be doing a lot of dynamic allocation, so let's make it easier */
 # define CALLOC(n,t)  (t*)calloc(n, sizeof(t))
@@ -81,28 +92,150 @@ static const char *metunits[] = {
 };
 
 
-int trans_caracena_interface(interface_s is)
-{
-  //CDSVar *incoord, *outcoord;
-  TRANSmetric *met1d;
+// Stations drop in and out as their data goes bad, but most of the time
+// the same few sets of stations come up over and over, so we keep the
+// operators for the ones we've seen recently, keyed by which stations were
+// good.  This is the most we keep for each transformation; they can be
+// big (number of stations times number of grid points).
+#define _MAX_CACHED_CARACENA_OPS 8
 
-  // Unlike other interfaces, these are just markers for the dimensions,
-  // which we'll use to infer the bin edges.  
-  ///double *index=NULL, *target=NULL;
+struct caracena_node {
+  unsigned char *mask;  // 1 for each station we used
+  struct caracena_op *op;
+  int refs;  // number of slices using it right now
+  unsigned long last_used;
+  struct caracena_node *next;
+};
 
-  // Assign from interface struct - if I had written it this way to begin
-  // with I would just use the is elements, but I didn't.
-  double *data=is.input_data;
-  int *qc_data=is.input_qc;
-  double input_missing_value=is.input_missing_value;
-  double *odata=is.output_data;
-  int *qc_odata=is.output_qc;
-  double output_missing_value=is.output_missing_value;
-  CDSVar *invar=is.invar;
-  CDSVar *outvar=is.outvar;
-  int d=is.d;
-  int od=is.od;
-  TRANSmetric **met=is.met;
+// The caracena specific part of our plan, which we hang off of the aux
+// pointer: the output grid as virtual "stations", the input station
+// locations, the params of the fit, and the operators we've built so far.
+// Slices on different threads share the plan, so the operator list has
+// its own lock.
+typedef struct {
+  int no;
+  double *olat;
+  double *olon;
+  double *ilat;
+  double *ilon;
+  int npass;
+  double scale_factor;
+  int min_stations;
+
+  struct caracena_node *ops;
+  unsigned long clock;
+  pthread_mutex_t lock;
+} caracena_plan;
+
+static void free_caracena_plan(void *aux) {
+  caracena_plan *cp=(caracena_plan *) aux;
+  struct caracena_node *n, *next;
+
+  for (n=cp->ops;n;n=next) {
+    next=n->next;
+    free_caracena_op(n->op);
+    free(n->mask);
+    free(n);
+  }
+  pthread_mutex_destroy(&cp->lock);
+
+  if (cp->olat) free(cp->olat);
+  if (cp->olon) free(cp->olon);
+  if (cp->ilat) free(cp->ilat);
+  if (cp->ilon) free(cp->ilon);
+  free(cp);
+}
+
+static struct caracena_node *find_caracena_node(caracena_plan *cp,
+						unsigned char *mask, int ni) {
+  struct caracena_node *n;
+
+  for (n=cp->ops;n;n=n->next) {
+    if (memcmp(n->mask, mask, ni) == 0) return(n);
+  }
+  return(NULL);
+}
+
+// Get the operator for the nk good stations flagged in mask, whose
+// locations are klat, klon.  We build it if we haven't seen this set of
+// stations before.  That is done holding the lock, even though it's the
+// slow part, because building one can log messages and msngr is not
+// thread safe; the cache means it is rare anyway.  Hand it back with
+// release_caracena_op() when done.
+static struct caracena_node *get_caracena_op(caracena_plan *cp,
+					     unsigned char *mask, int ni,
+					     int nk, double *klat,
+					     double *klon) {
+  struct caracena_node *n, *c, *oldest;
+  struct caracena_op *op;
+  int count;
+
+  pthread_mutex_lock(&cp->lock);
+  if ((n=find_caracena_node(cp, mask, ni))) {
+    n->refs++;
+    n->last_used=++cp->clock;
+    pthread_mutex_unlock(&cp->lock);
+    return(n);
+  }
+
+  DEBUG_LV4("libtrans", "Building caracena operator for %d of %d stations",
+	    nk, ni);
+  op=build_caracena_op(nk, klat, klon, cp->no, cp->olat, cp->olon,
+		       cp->npass, cp->scale_factor);
+
+  n=CALLOC(1, struct caracena_node);
+  n->mask=CALLOC(ni, unsigned char);
+  memcpy(n->mask, mask, ni);
+  n->op=op;
+  n->next=cp->ops;
+  cp->ops=n;
+  n->refs++;
+  n->last_used=++cp->clock;
+
+  // Keep the list bounded, by throwing out the least recently used
+  // operators that nobody is using right now.
+  while (1) {
+    count=0;
+    oldest=NULL;
+    for (c=cp->ops;c;c=c->next) {
+      count++;
+      if (c->refs == 0 && (! oldest || c->last_used < oldest->last_used)) {
+	oldest=c;
+      }
+    }
+    if (count <= _MAX_CACHED_CARACENA_OPS || ! oldest) break;
+
+    struct caracena_node **p=&cp->ops;
+    while (*p != oldest) p=&((*p)->next);
+    *p=oldest->next;
+    free_caracena_op(oldest->op);
+    free(oldest->mask);
+    free(oldest);
+  }
+
+  pthread_mutex_unlock(&cp->lock);
+  return(n);
+}
+
+static void release_caracena_op(caracena_plan *cp, struct caracena_node *n) {
+  pthread_mutex_lock(&cp->lock);
+  n->refs--;
+  pthread_mutex_unlock(&cp->lock);
+}
+
+// Work out everything about this transformation that doesn't depend on the
+// data in the slice, and put it into the plan.  This is done once, for the
+// first slice.
+static int build_caracena_plan(interface_s *is, TRANSplan *plan)
+{
+  CDSVar *invar=is->invar;
+  CDSVar *outvar=is->outvar;
+  int d=is->d;
+  int od=is->od;
+
+  // Start with the missing values we were given by the driver
+  plan->input_missing_value=is->input_missing_value;
+  plan->output_missing_value=is->output_missing_value;
 
   // Length of input data
   int ni=invar->dims[d]->length;
@@ -129,12 +262,6 @@ int trans_caracena_interface(interface_s is)
   int nolon = outvar->dims[od+1]->length;
   int no = nolat * nolon;
 
-  // Define and allocate our metric - in this case the derivative
-  // Note - this is for returning the output
-  int nmetrics = (sizeof metnames)/(sizeof metnames[0]);
-  allocate_metric(met,metnames, metunits, nmetrics, no);
-  met1d = (*met);
-
   // The input coordinate is just the station index - still, we need to
   // make it, so:
   //index=CALLOC(ni,double);
@@ -175,6 +302,9 @@ int trans_caracena_interface(interface_s is)
     }
   }
 
+  free(olat_1D);
+  free(olon_1D);
+
   // Okay, now we need station-based location information, which means
   // finding sibling variables to invar.  We will use transform parameters
   // to find them, and use a default name of "glat" and "glon"
@@ -195,15 +325,19 @@ int trans_caracena_interface(interface_s is)
   CDSVar *lat_var=cds_get_var((CDSGroup *)(invar->parent), lat_field_name);
   CDSVar *lon_var=cds_get_var((CDSGroup *)(invar->parent), lon_field_name);
 
-  free(lat_field_name);
-  free(lon_field_name);
-  
   if (! lat_var || ! lon_var) {
     ERROR(TRANS_LIB_NAME,"Missing lat and/or lon field in input dataset: %s, %s\n",
 	  lat_field_name, lon_field_name);
+    free(lat_field_name);
+    free(lon_field_name);
+    free(olat);
+    free(olon);
     return(-1);
   }
 
+  free(lat_field_name);
+  free(lon_field_name);
+  
   // Now extract ilat and ilon, the station based arrays of location
   size_t nilat, nilon;
   double dummy_missing_value;
@@ -217,16 +351,32 @@ int trans_caracena_interface(interface_s is)
     ERROR(TRANS_LIB_NAME,
 	  "Input lat and lon are not dimensioned correctly by station: %d %d %d\n",
 	  ni, nilat,nilon);
+    free(olat);
+    free(olon);
+    if (ilat) free(ilat);
+    if (ilon) free(ilon);
     return(-1);
   }
 
+  // Hand the geometry over to the plan now, so it gets freed along with
+  // the plan no matter what happens below.
+  caracena_plan *cp=CALLOC(1, caracena_plan);
+  pthread_mutex_init(&cp->lock, NULL);
+  cp->no=no;
+  cp->olat=olat;
+  cp->olon=olon;
+  cp->ilat=ilat;
+  cp->ilon=ilon;
+  plan->aux=cp;
+  plan->free_aux=free_caracena_plan;
+
   /////////////////////////////////////////////////////////////////////////
   // The easy lookups - override missing_Value by transform params.
   double missing_value;
   if (cds_get_transform_param_by_dim(invar, invar->dims[d],
 				     "missing_value", CDS_DOUBLE,
 				     &_one, &missing_value) != NULL) {
-    input_missing_value=missing_value;
+    plan->input_missing_value=missing_value;
 
     // Need to save anything that modifies input data: note, we are still
     // tagging with output dim and varname, because we store it in the
@@ -240,7 +390,7 @@ int trans_caracena_interface(interface_s is)
   if (cds_get_transform_param_by_dim(outvar, outvar->dims[od],
 				     "missing_value", CDS_DOUBLE,
 				     &_one, &missing_value) != NULL) {
-    output_missing_value=missing_value;
+    plan->output_missing_value=missing_value;
   }
 
   unsigned int qc_mask=0;
@@ -298,109 +448,199 @@ int trans_caracena_interface(interface_s is)
   trans_store_param_val("min_stations", "%d", min_stations, 
 			outvar->dims[od]->name, outvar->name);
 
+  plan->ni=ni;
+  plan->nt=no;
+  plan->qc_mask=qc_mask;
+  cp->npass=npass;
+  cp->scale_factor=scale_factor;
+  cp->min_stations=min_stations;
 
-  //////////////////////////////////////////////////////////////////////////////////
-  // Develop data to handle QC and missing values and the like.
-  // We eliminate stations that have bad or missing data, so this means we
-  // need to copy our data and location information into new arrays.
-  double *kdata=CALLOC(ni,double);
-  double *klat=CALLOC(ni,double);
-  double *klon=CALLOC(ni,double);
-  int nk=0;
-
-  for (int i=0;i<ni;i++) {
-    if (data[i] == input_missing_value ||
-	data[i] >= CDS_MAX_FLOAT-1 ||
-	(qc_data[i] & qc_mask) != 0) {
-      // This is bad data, so just continue on with the loop without
-      // copying into idata or anything
-      continue;
-    }
+  plan->ready=1;
+  return(0);
+}
 
-    // Okay, now just copy stuff over
-    kdata[nk]=data[i];
-    klat[nk]=ilat[i];
-    klon[nk]=ilon[i];
-    nk++;
+int trans_caracena_interface(interface_s is)
+{
+  TRANSmetric *met1d;
+  int status;
+
+  // Assign from interface struct - if I had written it this way to begin
+  // with I would just use the is elements, but I didn't.
+  double *data=is.input_data;
+  int *qc_data=is.input_qc;
+  double *odata=is.output_data;
+  int *qc_odata=is.output_qc;
+  TRANSmetric **met=is.met;
+  int istride=is.input_stride > 0 ? is.input_stride : 1;
+  int ostride=is.output_stride > 0 ? is.output_stride : 1;
+
+  // The driver may give us a block of slices at once; see trans.h.
+  int nslices=is.nslices > 0 ? is.nslices : 1;
+  int islice=is.input_slice_stride;
+  int oslice=is.output_slice_stride;
+
+  // If the driver didn't give us a plan, make a throwaway one for just
+  // this call
+  TRANSplan *plan=is.plan;
+  if (plan == NULL) plan=trans_create_plan();
+
+  if (! plan->ready && (status=build_caracena_plan(&is, plan)) < 0) {
+    if (plan != is.plan) trans_free_plan(&plan);
+    return(status);
   }
 
-  //////////////////////////////////////////////////////////////////
-  // Allocate derivative arrays
-  //////////////////////////////////////////////////////////////////
-  double *deriv_lat = CALLOC(no, double);
-  double *deriv_lon = CALLOC(no, double);
+  caracena_plan *cp=(caracena_plan *) plan->aux;
+  int ni=plan->ni;
+  int no=cp->no;
+  double input_missing_value=plan->input_missing_value;
+  double output_missing_value=plan->output_missing_value;
+  unsigned int qc_mask=plan->qc_mask;
 
-  //////////////////////////////////////////////////////////////////
-  // Set everything to missing if not enough stations
-  int status;
-  if (nk < min_stations) {
-    for (int o=0;o<no;o++) {
-      odata[o]=deriv_lat[o]=deriv_lon[o]=output_missing_value;
-      // I should set a QC flag here, too.  Some bad inputs?  I think that
-      // makes it yellow, but all bad inputs isn't necessarily accurate.
-      // So, set some but also set bad.  Maybe I need some new flags just
-      // for caracena?
-      qc_set(qc_odata[o], QC_BAD);
-
-      if (nk == 0) {
-	qc_set(qc_odata[o], QC_ALL_BAD_INPUTS);
-      } else {
-	qc_set(qc_odata[o], QC_SOME_BAD_INPUTS);
+  // Define and allocate our metric - in this case the derivative
+  // Note - this is for returning the output.  Slice b of the block goes
+  // at [b*no].
+  int nmetrics = (sizeof metnames)/(sizeof metnames[0]);
+  allocate_metric(met,metnames, metunits, nmetrics, nslices*no);
+  met1d = (*met);
+
+  //////////////////////////////////////////////////////////////////////////////////
+  // Develop data to handle QC and missing values and the like.
+  // We eliminate stations that have bad or missing data, so each slice
+  // gets a mask of the stations it can use.
+  unsigned char *kmask=CALLOC(nslices*ni,unsigned char);
+  int *nk=CALLOC(nslices,int);
+
+  for (int b=0;b<nslices;b++) {
+    double *bdata=data+b*islice;
+    int *bqc=qc_data+b*islice;
+    for (int i=0;i<ni;i++) {
+      if (bdata[i*istride] == input_missing_value ||
+	  bdata[i*istride] >= CDS_MAX_FLOAT-1 ||
+	  (bqc[i*istride] & qc_mask) != 0) {
+	// This is bad data, so just continue on with the loop
+	continue;
       }
+      kmask[b*ni+i]=1;
+      nk[b]++;
     }
-    // Also, the status
-    status=0;
-  } else {
-    //////////////////////////////////////////////////////////////////////////////////
-    // call core function
-    status = caracena(kdata, deriv_lat, deriv_lon,
-		      nk, klat, klon,
-		      odata, no, olat, olon,
-		      npass, scale_factor);
-
-    // I should also set qc_odata to "some bad" without setting bad if we don't
-    // have all the stations but do have enough to run.
-    if (nk < ni) {
+  }
+
+  double *klat=CALLOC(ni,double);
+  double *klon=CALLOC(ni,double);
+  double *kdata=CALLOC(ni*nslices,double);
+  double *kout=CALLOC(3*no*nslices,double);
+  int *group=CALLOC(nslices,int);
+  int *done=CALLOC(nslices,int);
+
+  status=0;
+  for (int b=0;b<nslices;b++) {
+    if (done[b]) continue;
+
+    unsigned char *mask=kmask+b*ni;
+    double *bodata=odata+b*oslice;
+    int *bqc_odata=qc_odata+b*oslice;
+    double *nstat=met1d->metrics[0]+b*no;
+    double *deriv_lat=met1d->metrics[1]+b*no;
+    double *deriv_lon=met1d->metrics[2]+b*no;
+
+    //////////////////////////////////////////////////////////////////
+    // Set everything to missing if not enough stations
+    if (nk[b] < cp->min_stations) {
       for (int o=0;o<no;o++) {
-	qc_set(qc_odata[o], QC_SOME_BAD_INPUTS);
+	bodata[o*ostride]=deriv_lat[o]=deriv_lon[o]=output_missing_value;
+	nstat[o]=nk[b];
+	// I should set a QC flag here, too.  Some bad inputs?  I think that
+	// makes it yellow, but all bad inputs isn't necessarily accurate.
+	// So, set some but also set bad.  Maybe I need some new flags just
+	// for caracena?
+	qc_set(bqc_odata[o*ostride], QC_BAD);
+
+	if (nk[b] == 0) {
+	  qc_set(bqc_odata[o*ostride], QC_ALL_BAD_INPUTS);
+	} else {
+	  qc_set(bqc_odata[o*ostride], QC_SOME_BAD_INPUTS);
+	}
       }
+      done[b]=1;
+      continue;
     }
 
-    // Check the status - negative status means we had a linear algebra
-    // problem and couldn't do the transformation
-    if (status < 0) {
-      for (int o=0;o<no;o++) {
-	odata[o]=deriv_lat[o]=deriv_lon[o]=output_missing_value;
-	qc_set(qc_odata[o], QC_BAD);
+    //////////////////////////////////////////////////////////////////////////////////
+    // All the slices in the block with the same good stations share an
+    // operator, so gather them up and do them together: station s of
+    // group member j goes at kdata[s*ng+j], and output o at kout[o*ng+j].
+    int ng=0;
+    for (int b2=b;b2<nslices;b2++) {
+      if (! done[b2] && memcmp(kmask+b2*ni, mask, ni) == 0) {
+	group[ng++]=b2;
+	done[b2]=1;
+      }
+    }
 
-	// I probably need another QC flag to indicate a failure from the
-	// blas libraries.  But I don't have one yet.
-	//qc_set(qc_odata[o], QC_BLAS);
+    int nks=0;
+    for (int i=0;i<ni;i++) {
+      if (! mask[i]) continue;
+      klat[nks]=cp->ilat[i];
+      klon[nks]=cp->ilon[i];
+      for (int j=0;j<ng;j++) {
+	kdata[nks*ng+j]=data[group[j]*islice+i*istride];
       }
+      nks++;
     }
-  }
 
-  // Pass our metrics (derivs) back to the driver.
-  memcpy(met1d->metrics[1], deriv_lat, no*sizeof(double));
-  memcpy(met1d->metrics[2], deriv_lon, no*sizeof(double));
+    // Find the operator for this set of stations, and apply it.
+    struct caracena_node *node=get_caracena_op(cp, mask, ni, nks, klat, klon);
+    int rval=apply_caracena_op(node->op, ng, kdata, kout, kout+no*ng,
+			       kout+2*no*ng);
+    release_caracena_op(cp, node);
+
+    for (int j=0;j<ng;j++) {
+      int g=group[j];
+      bodata=odata+g*oslice;
+      bqc_odata=qc_odata+g*oslice;
+      nstat=met1d->metrics[0]+g*no;
+      deriv_lat=met1d->metrics[1]+g*no;
+      deriv_lon=met1d->metrics[2]+g*no;
 
-  // And our number of stations.  I need to think about collapsing down
-  // metrics, since we don't need the lat/lon dimensions for nstat.  But
-  // right now metrics have the same dimensions as the data, so we just
-  // keep repeating everything.
-  for (int o=0;o<no;o++) {
-    met1d->metrics[0][o] = nk;
+      for (int o=0;o<no;o++) {
+	nstat[o]=nk[g];
+
+	// An op that couldn't be built has no output for us.  We still
+	// return 0 so the next sample gets transformed (see the note in
+	// build_caracena_op), but fill in missings and qc here.
+	if (rval < 0) {
+	  bodata[o*ostride]=deriv_lat[o]=deriv_lon[o]=output_missing_value;
+	  qc_set(bqc_odata[o*ostride], QC_BAD);
+
+	  // I probably need another QC flag to indicate a failure from the
+	  // blas libraries.  But I don't have one yet.
+	  //qc_set(qc_odata[o], QC_BLAS);
+	  continue;
+	}
+
+	bodata[o*ostride]=kout[o*ng+j];
+	deriv_lat[o]=kout[(no+o)*ng+j];
+	deriv_lon[o]=kout[(2*no+o)*ng+j];
+
+	// I should also set qc_odata to "some bad" without setting bad if we
+	// don't have all the stations but do have enough to run.
+	if (nk[g] < ni) {
+	  qc_set(bqc_odata[o*ostride], QC_SOME_BAD_INPUTS);
+	}
+      }
+    }
   }
 
   // Free stuff up
-  free(deriv_lat);
-  free(deriv_lon);
-  free(olat_1D);
-  free(olon_1D);
-  free(olat);
-  free(olon);
-  free(ilat);
-  free(ilon);
+  free(kdata);
+  free(kout);
+  free(klat);
+  free(klon);
+  free(kmask);
+  free(nk);
+  free(group);
+  free(done);
+  if (plan != is.plan) trans_free_plan(&plan);
   return(status);
 }
 
@@ -466,14 +706,49 @@ double mdist(double lat1, double lat2, double lon1, double lon2,
   return(dist);
 }
 
-int caracena(double *data, double *deriv_lat, double *deriv_lon,
-	     int ns, double *ilat, double *ilon,
-	     double *out_data, int no, double *olat, double *olon,
-	     int npass, double scale_factor) {
+// Everything about a caracena analysis that depends only on which stations
+// we are using, and not on their data: the correction matrix C, which
+// turns station data into "corrected" data after npass passes, and the
+// distance weights Wr from each station to each output point, along with
+// their row sums Nr.  Building these is nearly all of the work, and it's
+// the same for every sample that has the same stations, so we keep them.
+struct caracena_op {
+  int ns;
+  int no;
+  int ok;  // 0 if the weight matrix couldn't be inverted
+  double L2;
+  double *C;  // [ns][ns]
+  double *Wr;  // [no][ns]
+  double *Nr;  // [no]
+  double *rlat;  // station position vectors, for the derivatives
+  double *rlon;
+};
+
+static void free_caracena_op(struct caracena_op *op) {
+  if (op == NULL) return;
+  if (op->C) free(op->C);
+  if (op->Wr) free(op->Wr);
+  if (op->Nr) free(op->Nr);
+  if (op->rlat) free(op->rlat);
+  if (op->rlon) free(op->rlon);
+  free(op);
+}
+
+// Build the operator for stations at ilat, ilon and outputs at olat,
+// olon.  If the weight matrix is singular, we still hand back an operator,
+// but with ok=0, so that whoever is caching it knows not to try again.
+static struct caracena_op *build_caracena_op(int ns, double *ilat,
+					     double *ilon, int no,
+					     double *olat, double *olon,
+					     int npass, double scale_factor) {
 
   int i,j,o;
   double dlat_m, dlon_m;
 
+  struct caracena_op *op=CALLOC(1, struct caracena_op);
+  op->ns=ns;
+  op->no=no;
+
   // First, set up our weight array
   double *W=CALLOC(ns*ns,double);
   double *I_W=CALLOC(ns*ns,double);
@@ -517,6 +792,10 @@ int caracena(double *data, double *deriv_lat, double *deriv_lon,
     // double dist = mdist(ilat[i], lat_mean, ilon[i], lon_mean, &rlat[i], &rlon[i]);
   }
 
+  op->L2=L2;
+  op->rlat=rlat;
+  op->rlon=rlon;
+
   // Now, we gotta create I_W, so we do the loops again
   for (i=0;i<ns;i++) {
     for(j=0;j<ns;j++) {
@@ -535,15 +814,16 @@ int caracena(double *data, double *deriv_lat, double *deriv_lon,
   if (rval < 0) {
     // Already had an error message inside of the invert
 
-    // Note that a negative return value percolates up to
-    // cds_transform_driver, which then causes an early exit of the code.
-    // I think it might be best to instead return(0), which (with the
-    // latest changes concurrent with this comment) will fill this
-    // particular transformation with missings and set some qc bits, but
+    // Note that we don't return an error here.  A negative return value
+    // percolates up to cds_transform_driver, which then causes an early
+    // exit of the code.  Instead, we leave this particular transformation
+    // alone, which will fill it with missings and set some qc bits, but
     // allow the next sample time to be transformed, rather than dumping
     // out before we write a netCDF file or antyhing.
-    //return(-1);
-    return(0);
+    free(W);
+    free(I_W);
+    free(W_1);
+    return(op);
   }
 
   // Now, build our correction 
@@ -578,84 +858,127 @@ int caracena(double *data, double *deriv_lat, double *deriv_lon,
   // Finally, mult by the inverse
   M_mult(W_1,Mwork,Mout,ns);
 
-  //...and Mout is our correction matrix C.  So, now we apply C to our
-  // station data fs to get a corrected data array fcorr = C*fs
-  double *c_data=CALLOC(ns,double);
+  //...and Mout is our correction matrix C.
+  op->C=Mout;
 
-  // i is the index of the row, j is the index of the column, so 
-  // c_data[i] = sum over j (C[i][j]*fs[j])
-  for (i=0;i<ns;i++) {
-    for (j=0;j<ns;j++) {
-      c_data[i] += M_val(Mout,ns,i,j)*data[j];
-    }
-  }
-
-  // Yay!  Now, to get the value at a given lat, lon, we need to build a
-  // weight array of distances from that lat and lon to each station point,
-  // and then take the dot product from that weight array and our corrected
-  // data.
-
-  //double *out_data=CALLOC(no,double);
+  // Now, to get the value at a given lat, lon, we need to build a weight
+  // array of distances from that lat and lon to each station point.
 
   // Okay, to get the matrix the right way, we want: odata = Wr*data
   // data = data[s], odata=odata[o], so Wr = Wr[o][s]
   // i.e. o is the index of the row, s is the index of the column
 
   double *Wr=CALLOC(no*ns,double);
+  double *Nr=CALLOC(no,double);
 
   // This is the right order of things - Nr is designed to normalize over
   // all stations, so each row (i.e. each value of o) is a normal vector.
   // Thus, for each [o], we sum Nr over s, and *then* we can calculate
   // odata[o] += Wr[o][s]*c_data[s]/Nr for each value of s.
-
-  // Thus, we need two loops over s for each value of o.
-  for (int o=0;o<no;o++) {
-    double Nr=0.0;
-    out_data[o]=0.0;  // init to zero, just in case
-
-    double fRlat=0, fRlon=0, Rlat=0, Rlon=0;
-    
+  for (o=0;o<no;o++) {
     for (int s=0;s<ns;s++) {
       double dist=mdist(ilat[s], olat[o], ilon[s], olon[o], &dlat_m, &dlon_m);
       M_val(Wr,ns,o,s)=exp(-dist*dist/L2);
-      Nr+=M_val(Wr,ns,o,s);
-    }
-
-    for (int s=0;s<ns;s++) {
-      // This simultaneously normalizes Wr and multiples Wr*idata
-      out_data[o] += M_val(Wr,ns,o,s) * c_data[s] / Nr;
-
-      // Now generate our <FR> and <R> elements for the derivatives.  Here
-      // are how the terms in eqns (9) and (10) in the Caracena map to what
-      // we got:
-      // fk = c_data[k]  (the "corrected" data from multiple passes
-      // rk = r{lat,lon}[k]
-      // wk(r) = Wr[o][k]/Nr
-      fRlat += c_data[s]*rlat[s]*M_val(Wr,ns,o,s)*c_data[s]/Nr;
-      fRlon += c_data[s]*rlon[s]*M_val(Wr,ns,o,s)*c_data[s]/Nr;
-
-      Rlat += rlat[s]*M_val(Wr,ns,o,s)*c_data[s]/Nr;
-      Rlon += rlon[s]*M_val(Wr,ns,o,s)*c_data[s]/Nr;
-
-      // So now we have all the elements we need to calcuate the
-      // derivatives
-      deriv_lat[o] = 2*(fRlat - out_data[o]*Rlat)/L2;
-      deriv_lon[o] = 2*(fRlon - out_data[o]*Rlon)/L2;
-
+      Nr[o]+=M_val(Wr,ns,o,s);
     }
   }
 
-  // Yay.  We've calculated all our outputs, so we just need to free
-  // everything up(!) and exit happily.
+  op->Wr=Wr;
+  op->Nr=Nr;
+  op->ok=1;
+
   free(W);
   free(I_W);
   free(W_1);
-  free(rlat);
-  free(rlon);
   free(Mwork);
-  free(Mout);
+
+  return(op);
+}
+
+// Apply an operator to the data of m samples at once, with station s of
+// sample j at data[s*m+j], and output o at out_data[o*m+j] (and the same
+// for the derivatives).  This is all that's left to do per sample once we
+// have the operator, and it's just a couple of matrix products, so a whole
+// block of samples with the same stations costs little more than one.
+// Returns -1 without touching the output if the operator couldn't be
+// built.
+static int apply_caracena_op(struct caracena_op *op, int m, double *data,
+			     double *out_data, double *deriv_lat,
+			     double *deriv_lon) {
+  int j,o,s;
+  int ns=op->ns;
+  int no=op->no;
+  double *rlat=op->rlat;
+  double *rlon=op->rlon;
+  double L2=op->L2;
+
+  // If we couldn't invert, we leave the output alone, so it gets the
+  // missing values and qc that the interface sets up.
+  if (! op->ok) return(-1);
+
+  // So, now we apply C to our station data fs to get a corrected data
+  // array fcorr = C*fs, one column per sample
+  double *c_data=CALLOC(ns*m,double);
+  cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans,
+	      ns, m, ns, 1, op->C, ns, data, m, 0, c_data, m);
+
+  // Each output point is the dot product of its row of Wr with the
+  // corrected data, normalized by Nr.  The derivatives need the same
+  // weighted sums of rk*fk and rk*fk*fk as well, which in terms of eqns
+  // (9) and (10) in the Caracena are:
+  // fk = c_data[k]  (the "corrected" data from multiple passes
+  // rk = r{lat,lon}[k]
+  // wk(r) = Wr[o][k]/Nr
+  // So lay all five out side by side, and do them in one product.
+  int m5=5*m;
+  double *terms=CALLOC(ns*m5,double);
+  for (s=0;s<ns;s++) {
+    double *t=&terms[s*m5];
+    for (j=0;j<m;j++) {
+      double f=c_data[s*m+j];
+      t[j]=f;
+      t[m+j]=rlat[s]*f;
+      t[2*m+j]=rlon[s]*f;
+      t[3*m+j]=rlat[s]*f*f;
+      t[4*m+j]=rlon[s]*f*f;
+    }
+  }
+
+  double *sums=CALLOC(no*m5,double);
+  cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans,
+	      no, m5, ns, 1, op->Wr, ns, terms, m5, 0, sums, m5);
+
+  // So now we have all the elements we need to calcuate the derivatives
+  for (o=0;o<no;o++) {
+    double Nr=op->Nr[o];
+    double *w=&sums[o*m5];
+    for (j=0;j<m;j++) {
+      double out=w[j]/Nr;
+      double Rlat=w[m+j]/Nr, Rlon=w[2*m+j]/Nr;
+      double fRlat=w[3*m+j]/Nr, fRlon=w[4*m+j]/Nr;
+
+      out_data[o*m+j]=out;
+      deriv_lat[o*m+j] = 2*(fRlat - out*Rlat)/L2;
+      deriv_lon[o*m+j] = 2*(fRlon - out*Rlon)/L2;
+    }
+  }
+
   free(c_data);
-  free(Wr);
+  free(terms);
+  free(sums);
+  return(0);
+}
+
+// The whole thing, for a single sample with nothing cached.
+int caracena(double *data, double *deriv_lat, double *deriv_lon,
+	     int ns, double *ilat, double *ilon,
+	     double *out_data, int no, double *olat, double *olon,
+	     int npass, double scale_factor) {
+
+  struct caracena_op *op=build_caracena_op(ns, ilat, ilon, no, olat, olon,
+					   npass, scale_factor);
+  apply_caracena_op(op, 1, data, out_data, deriv_lat, deriv_lon);
+  free_caracena_op(op);
 
   return(0);
 }
@@ -36,7 +36,8 @@
 # include "trans.h"
 # include "trans_private.h"
 
-static size_t _one=1;
+// Per thread; see the note in trans_utils.c
+static __thread size_t _one=1;
 
 /* We'll be doing a lot of dynamic allocation, so let's make it easier */
 # define CALLOC(n,t)  (t*)calloc(n, sizeof(t))
@@ -53,44 +54,126 @@ static const char *metunits[] = {
   "SAME"
 };
 
-int trans_interpolate_interface(interface_s is)
-//(double *data, int *qc_data, double *odata, int *qc_odata,
-// CDSVar *invar, CDSVar *outvar, int d, TRANSmetric **met) 
+// Row flags for the compiled interpolation stencil
+#define STENCIL_OUTSIDE 1  // target is off the end of the input grid
+#define STENCIL_OUT_OF_RANGE 2  // bracketing inputs are further than range
+
+// Compile the interpolation for our plan.  Which two inputs bracket each
+// target, and how far up between them it is, depend only on the grids,
+// so we work them out once into a sparse matrix with (up to) two entries
+// per row: n1 with weight 1-u and n2 with weight u.  We also keep where
+// the run up the index stopped for each target.  This is exactly the walk
+// bilinear_interpolate() does, for when none of the data is missing;
+// when some is, it still has to go looking for good points itself.
+static int compile_interpolate(TRANSplan *plan)
 {
+  double *index=plan->index, *target=plan->target, range=plan->range;
+  int ni=plan->ni, nt=plan->nt;
+  int i, j, e, n1, n2, sign=1;
+  double x, x1, x2;
+  TRANSmatrix *m;
+
+  // bilinear_interpolate() deals with these on its own, so don't bother
+  if (ni < 2) return(0);
+  if (nt > 1) {
+    if (index[0] < index[1] && target[0] < target[1]) {
+      sign = 1;
+    } else if (index[0] > index[1] && target[0] > target[1]) {
+      sign = -1;
+    } else {
+      return(0);
+    }
+  }
+
+  // The key is everything the stencil depends on
+  int nkey=1+ni+nt;
+  double *key=CALLOC(nkey, double);
+  key[0]=range;
+  memcpy(&key[1], index, ni*sizeof(double));
+  memcpy(&key[1+ni], target, nt*sizeof(double));
+
+  if ((m=trans_get_cached_matrix("interpolate", key, nkey)) == NULL) {
+    m=trans_create_matrix(nt, ni, 2*nt);
+
+    i=0;
+    e=0;
+    for (j=0; j<nt; j++) {
+      m->row_start[j]=e;
+      m->row_index[j]=i;
+
+      if (sign*target[j] < sign*(index[0]-((index[1]-index[0])/2.0)) ||
+	  sign*target[j] > sign*(index[ni-1]+((index[ni-1]-index[ni-2])/2.0))) {
+	m->row_flags[j]=STENCIL_OUTSIDE;
+	continue;
+      }
+
+      while (i < ni && sign*index[i] < sign*target[j]) { i++;}
+      m->row_index[j]=i;
+
+      if (i == ni) {
+	n1=ni-2;
+	n2=ni-1;
+      } else if (i == 0) {
+	n1=0;
+	n2=1;
+      } else {
+	n1=i-1;
+	n2=i;
+      }
+
+      x=target[j];
+      x1=index[n1];
+      x2=index[n2];
+
+      if (fabs(x-x1) > range || fabs(x-x2) > range) {
+	m->row_flags[j]=STENCIL_OUT_OF_RANGE;
+      }
+
+      m->col[e]=n1;
+      m->col[e+1]=n2;
+      m->weight[e+1]=(x-x1)/(x2-x1);
+      m->weight[e]=1-m->weight[e+1];
+      e+=2;
+    }
+    m->row_start[nt]=e;
+    m->nnz=e;
+
+    DEBUG_LV4("libtrans", "Compiled interpolation stencil: %d x %d", nt, ni);
+
+    m=trans_cache_matrix("interpolate", key, nkey, m);
+  }
+
+  free(key);
+
+  plan->aux=m;
+  plan->free_aux=trans_release_matrix;
+  return(0);
+}
 
-  int ni, nt, status, m;
+// Work out everything about this transformation that doesn't depend on the
+// data in the slice, and put it into the plan.  This is done once, for the
+// first slice.
+static int build_interpolate_plan(interface_s *is, TRANSplan *plan)
+{
+  int ni, nt;
   double *index=NULL, *target=NULL, range, missing_value;
   unsigned int qc_mask=0;
   CDSVar *incoord, *outcoord;
-  double **metrics=NULL;
-  TRANSmetric *met1d;
 
-  // Assign from interface struct - if I had written it this way to begin
-  // with I would just is the is elements, but I didn't.
-  double *data=is.input_data;
-  int *qc_data=is.input_qc;
-  double input_missing_value=is.input_missing_value;
-  double *odata=is.output_data;
-  int *qc_odata=is.output_qc;
-  double output_missing_value=is.output_missing_value;
-  CDSVar *invar=is.invar;
-  CDSVar *outvar=is.outvar;
-  int d=is.d;
-  int od=is.od;
-  TRANSmetric **met=is.met;
+  CDSVar *invar=is->invar;
+  CDSVar *outvar=is->outvar;
+  int d=is->d;
+  int od=is->od;
 
-  // Right now, just null out our metrics, until we have some to set
-  //free_metric(met);
+  // Start with the missing values we were given by the driver
+  plan->input_missing_value=is->input_missing_value;
+  plan->output_missing_value=is->output_missing_value;
 
   // Pull out the stuff we need from invar, outvar, the dimension index d,
   // and the right calls to the transfrom parameter functions
   ni=invar->dims[d]->length;
   nt=outvar->dims[od]->length;
 
-  // Define and allocate our metric
-  allocate_metric(met,metnames, metunits, NUM_METRICS, nt);
-  met1d = (*met);
-
   // These mostly work straight up because coord vars are always 1D, so we
   // don't have to worry about indexing or casting correctly
   incoord = cds_get_coord_var(invar, d);
@@ -124,7 +207,7 @@ int trans_interpolate_interface(interface_s is)
   if (cds_get_transform_param_by_dim(invar, invar->dims[d],
 				     "missing_value", CDS_DOUBLE,
 				     &_one, &missing_value) != NULL) {
-    input_missing_value=missing_value;
+    plan->input_missing_value=missing_value;
 
     //trans_store_param_text_by_dim(invar, invar->dims[d], "input_missing_value",
     //outvar->dims[od]->name, outvar->name);
@@ -135,7 +218,7 @@ int trans_interpolate_interface(interface_s is)
   if (cds_get_transform_param_by_dim(outvar, outvar->dims[od],
 				     "missing_value", CDS_DOUBLE,
 				     &_one, &missing_value) != NULL) {
-    output_missing_value=missing_value;
+    plan->output_missing_value=missing_value;
   }
 
   CDSVar *qc_invar=get_qc_var(invar);
@@ -154,11 +237,15 @@ int trans_interpolate_interface(interface_s is)
   double *index_mid = get_bin_midpoints(index, ni, invar, d);
   double *target_mid = get_bin_midpoints(target, nt, outvar, od);
 
+  if (index) free(index);
+  if (target) free(target);
+
   // Trap out if we failed to find any bin widths
   if (! index_mid) {
     ERROR(TRANS_LIB_NAME,
 	  "Bin widths for input variable %s required but not provided.  Exiting...",
 	  invar->name);
+    if (target_mid) free(target_mid);
     return(-1);
   }
 
@@ -166,9 +253,63 @@ int trans_interpolate_interface(interface_s is)
     ERROR(TRANS_LIB_NAME,
 	  "Bin widths for output variable %s required but not provided.  Exiting...",
 	  outvar->name);
+    free(index_mid);
     return(-1);
   }
 
+  plan->ni=ni;
+  plan->nt=nt;
+  plan->range=range;
+  plan->qc_mask=qc_mask;
+  plan->index=index_mid;
+  plan->target=target_mid;
+
+  // The qc bits to set if we estimated the bin boundaries
+  plan->estimated_bin_qc=get_estimated_bin_qc(invar, d, outvar, od);
+
+  compile_interpolate(plan);
+
+  plan->ready=1;
+  return(0);
+}
+
+int trans_interpolate_interface(interface_s is)
+//(double *data, int *qc_data, double *odata, int *qc_odata,
+// CDSVar *invar, CDSVar *outvar, int d, TRANSmetric **met) 
+{
+
+  int nt, status, m, i;
+  double **metrics=NULL;
+  TRANSmetric *met1d;
+
+  // Assign from interface struct - if I had written it this way to begin
+  // with I would just is the is elements, but I didn't.
+  double *data=is.input_data;
+  int *qc_data=is.input_qc;
+  double *odata=is.output_data;
+  int *qc_odata=is.output_qc;
+  TRANSmetric **met=is.met;
+  int ostride=is.output_stride > 0 ? is.output_stride : 1;
+
+  // Right now, just null out our metrics, until we have some to set
+  //free_metric(met);
+
+  // If the driver didn't give us a plan, make a throwaway one for just
+  // this call
+  TRANSplan *plan=is.plan;
+  if (plan == NULL) plan=trans_create_plan();
+
+  if (! plan->ready && (status=build_interpolate_plan(&is, plan)) < 0) {
+    if (plan != is.plan) trans_free_plan(&plan);
+    return(status);
+  }
+
+  nt=plan->nt;
+
+  // Define and allocate our metric
+  allocate_metric(met,metnames, metunits, NUM_METRICS, nt);
+  met1d = (*met);
+
   // Now just call our core function
   //status=bilinear_interpolate(data, qc_data, qc_mask, index_mid, ni, range,
   //odata, qc_odata, target_mid, nt, missing_value,
@@ -177,20 +318,27 @@ int trans_interpolate_interface(interface_s is)
   status=call_core_function(bilinear_interpolate,
 			    .input_data=data,
 			    .input_qc=qc_data,
-			    .qc_mask=qc_mask,
-			    .index=index_mid,
-			    .nindex=ni,
-			    .range=range,
+			    .input_stride=is.input_stride,
+			    .qc_mask=plan->qc_mask,
+			    .index=plan->index,
+			    .nindex=plan->ni,
+			    .range=plan->range,
 			    .output_data=odata,
 			    .output_qc=qc_odata,
-			    .target=target_mid,
+			    .output_stride=is.output_stride,
+			    .target=plan->target,
 			    .ntarget=nt,
-			    .input_missing_value=input_missing_value,
-			    .output_missing_value=output_missing_value,
-			    .metrics=&metrics);
+			    .input_missing_value=plan->input_missing_value,
+			    .output_missing_value=plan->output_missing_value,
+			    .metrics=&metrics,
+			    .matrix=(TRANSmatrix *) plan->aux);
 
   // Set the qc bits if we estimated the bin boundaries
-  set_estimated_bin_qc(qc_odata, invar, d, outvar, od, nt); 
+  if (plan->estimated_bin_qc) {
+    for (i=0;i<nt;i++) {
+      qc_odata[i*ostride] |= plan->estimated_bin_qc;
+    }
+  }
 
   // Pass our metrics back to the driver.
   for (m=0; m < NUM_METRICS ; m++) {
@@ -204,11 +352,7 @@ int trans_interpolate_interface(interface_s is)
   free(metrics);
 
   // Whew! we've run the transform, so we are done.
-  if (index) free(index);
-  if (target) free(target);
-  if (index_mid) free(index_mid);
-  if (target_mid) free(target_mid);
-
+  if (plan != is.plan) trans_free_plan(&plan);
 
   return(status);
 }
@@ -244,6 +388,8 @@ int bilinear_interpolate(core_s cs) {
   int ni = cs.nindex;
   double *output = cs.output_data;
   int *qc_output = cs.output_qc;
+  int istride = cs.input_stride > 0 ? cs.input_stride : 1;
+  int ostride = cs.output_stride > 0 ? cs.output_stride : 1;
   double *target = cs.target;
   int nt = cs.ntarget;
   double input_missing_value = cs.input_missing_value;
@@ -252,6 +398,10 @@ int bilinear_interpolate(core_s cs) {
 
   double range = cs.range;
 
+  // Our compiled stencil, if we have one
+  TRANSmatrix *stencil = cs.matrix;
+  int compiled;
+
   // Just to keep things clear; rmet is the pointer to the 2D metrics
   // structure, and I prefer to work with that.
   metrics=*rmet;
@@ -286,11 +436,11 @@ int bilinear_interpolate(core_s cs) {
     WARNING(TRANS_LIB_NAME,
 	    "Only %d input values: must have >= 2 input values to interpolate. Continuing...", ni);
     for (j=0;j<nt;j++) {
-      output[j]=output_missing_value; 
+      output[j*ostride]=output_missing_value; 
       dist_1[j]=output_missing_value;
       dist_2[j]=output_missing_value;
-      qc_set(qc_output[j], QC_OUTSIDE_RANGE);
-      qc_set(qc_output[j], QC_BAD);
+      qc_set(qc_output[j*ostride], QC_OUTSIDE_RANGE);
+      qc_set(qc_output[j*ostride], QC_BAD);
     }
     // Not fatal
     return(0);
@@ -322,27 +472,33 @@ int bilinear_interpolate(core_s cs) {
   for (j=0; j<nt; j++) {
 
     // we will modify this as conditions warrant
-    qc_output[j]=0;
+    qc_output[j*ostride]=0;
 
     // First, do not extrapolate beyond the actual range of inputs - that's
     // just silly.
     // ACtually, we are going to be fuzzy about this - extrapolate no more
     // than half an input bin beyond our input range.  This will allow us
     // to extrapolate from 318m to 316m, for example.
-    if (sign*target[j] < sign*(index[0]-((index[1]-index[0])/2.0)) ||
-	sign*target[j] > sign*(index[ni-1]+((index[ni-1]-index[ni-2])/2.0))) {
-      output[j]=output_missing_value; // we used to set it to 0, but that was
+    if ((stencil && (stencil->row_flags[j] & STENCIL_OUTSIDE)) ||
+	(! stencil &&
+	 (sign*target[j] < sign*(index[0]-((index[1]-index[0])/2.0)) ||
+	  sign*target[j] > sign*(index[ni-1]+((index[ni-1]-index[ni-2])/2.0))))) {
+      output[j*ostride]=output_missing_value; // we used to set it to 0, but that was
 			       // RIPBE specific
       dist_1[j]=dist_2[j]=output_missing_value;
-      qc_set(qc_output[j], QC_OUTSIDE_RANGE);
-      qc_set(qc_output[j], QC_BAD); // 11/26/12
+      qc_set(qc_output[j*ostride], QC_OUTSIDE_RANGE);
+      qc_set(qc_output[j*ostride], QC_BAD); // 11/26/12
       continue;
     }
 
     // run up until we find the next index that's just above this target
     // Note that this requires target values that are monotonically
     // increasing. 
-    while (i < ni && sign*index[i] < sign*target[j]) { i++;}
+    if (stencil) {
+      i=stencil->row_index[j];
+    } else {
+      while (i < ni && sign*index[i] < sign*target[j]) { i++;}
+    }
 
     // This shortcircuits all the bracketting nonsense below for the case
     // where our coordinate target matches our coordinate index exactly.
@@ -353,11 +509,11 @@ int bilinear_interpolate(core_s cs) {
     // itself is good.
     // Need i<ni because we mmight run up to i=ni above
     if (i<ni && fabs(target[j]-index[i]) < 1e-8 &&
-        fabs(array[i]-input_missing_value) > 1e-8 &&
-        !(qc_array[i] & qc_mask) &&
-        isfinite(array[i])) {
+        fabs(array[i*istride]-input_missing_value) > 1e-8 &&
+        !(qc_array[i*istride] & qc_mask) &&
+        isfinite(array[i*istride])) {
  
-      output[j] = array[i];
+      output[j*ostride] = array[i*istride];
       dist_1[j]=dist_2[j]=0;
       continue;
     }
@@ -403,29 +559,29 @@ int bilinear_interpolate(core_s cs) {
     // first, and then check all the ways that could indicate something is
     // wrong, such as n1==n2 or n1 < 0, as well as missing values or qc checks
     while ((n1 >= 0) &&
-	   (fabs(array[n1]-input_missing_value) < 1e-8 ||
-	    (qc_array[n1] & qc_mask) ||
-	    ! isfinite(array[n1]))){
-      qc_set(qc_output[j], QC_INTERPOLATE);
+	   (fabs(array[n1*istride]-input_missing_value) < 1e-8 ||
+	    (qc_array[n1*istride] & qc_mask) ||
+	    ! isfinite(array[n1*istride]))){
+      qc_set(qc_output[j*ostride], QC_INTERPOLATE);
       n1--;
     }
 
     while ((n1 < ni) &&
 	   (n1 < 0 || n1 == n2 ||
-	    fabs(array[n1]-input_missing_value) < 1e-8 ||
-	    (qc_array[n1] & qc_mask) ||
-	    ! isfinite(array[n1]))) {
-      qc_set(qc_output[j], QC_INTERPOLATE);
+	    fabs(array[n1*istride]-input_missing_value) < 1e-8 ||
+	    (qc_array[n1*istride] & qc_mask) ||
+	    ! isfinite(array[n1*istride]))) {
+      qc_set(qc_output[j*ostride], QC_INTERPOLATE);
       n1++;
     }
 
     if (n1 >= ni) { 
       //msg_ELog(EF_PROBLEM, "bilinear_interpolate: All missing values in array");
       for (k=0;k<nt;k++) {
-	output[k]=output_missing_value;
+	output[k*ostride]=output_missing_value;
 	dist_1[j]=dist_2[j]=output_missing_value;
-	qc_set(qc_output[k], QC_ALL_BAD_INPUTS);
-	qc_set(qc_output[k], QC_BAD);
+	qc_set(qc_output[k*ostride], QC_ALL_BAD_INPUTS);
+	qc_set(qc_output[k*ostride], QC_BAD);
       }
       return(2);
     }
@@ -436,28 +592,28 @@ int bilinear_interpolate(core_s cs) {
     // the QC indicators "or'd" together
     while ((n2 < ni) &&
 	   (n2 == n1 ||
-	    fabs(array[n2]-input_missing_value) < 1e-8 ||
-	    (qc_array[n2] & qc_mask) ||
-	    ! isfinite(array[n2]))) {
-      qc_set(qc_output[j], QC_INTERPOLATE);
+	    fabs(array[n2*istride]-input_missing_value) < 1e-8 ||
+	    (qc_array[n2*istride] & qc_mask) ||
+	    ! isfinite(array[n2*istride]))) {
+      qc_set(qc_output[j*ostride], QC_INTERPOLATE);
       n2++;
     }
     while ((n2 > 0) &&
 	   (n2 == n1 || n2 >= ni ||
-	    fabs(array[n2]-input_missing_value) < 1e-8 ||
-	    (qc_array[n2] & qc_mask) ||
-	    ! isfinite(array[n2]))) {
-      qc_set(qc_output[j], QC_INTERPOLATE);
+	    fabs(array[n2*istride]-input_missing_value) < 1e-8 ||
+	    (qc_array[n2*istride] & qc_mask) ||
+	    ! isfinite(array[n2*istride]))) {
+      qc_set(qc_output[j*ostride], QC_INTERPOLATE);
       n2--;
     }
 
     if (n2 >= ni || n2 <= 0 || n2 == n1) { 
       //msg_ELog(EF_PROBLEM, "bilinear_interpolate: At most one good value in array");
       for (k=0;k<nt;k++) {
-	output[k]=output_missing_value;
+	output[k*ostride]=output_missing_value;
 	dist_1[j]=dist_2[j]=output_missing_value;
-	qc_set(qc_output[k], QC_ALL_BAD_INPUTS);
-	qc_set(qc_output[k], QC_BAD);
+	qc_set(qc_output[k*ostride], QC_ALL_BAD_INPUTS);
+	qc_set(qc_output[k*ostride], QC_BAD);
       }
       return(2);
     }
@@ -468,16 +624,23 @@ int bilinear_interpolate(core_s cs) {
     x1=index[n1];
     x2=index[n2];
 
-    y1=array[n1];
-    y2=array[n2];
+    y1=array[n1*istride];
+    y2=array[n2*istride];
+
+    // If we didn't have to go looking for good points, these are the ones
+    // we compiled, and we already know the rest.
+    compiled = (stencil &&
+		n1 == stencil->col[stencil->row_start[j]] &&
+		n2 == stencil->col[stencil->row_start[j]+1]);
 
     // Final qc on range
 
     // First, do not extrapolate beyond the range of the actual input
-    if (fabs(x-x1) > range || fabs(x-x2) > range) {
-      output[j]=output_missing_value;
-      qc_set(qc_output[j], QC_OUTSIDE_RANGE);
-      qc_set(qc_output[j], QC_BAD); // 11/26/12
+    if (compiled ? (stencil->row_flags[j] & STENCIL_OUT_OF_RANGE) :
+	(fabs(x-x1) > range || fabs(x-x2) > range)) {
+      output[j*ostride]=output_missing_value;
+      qc_set(qc_output[j*ostride], QC_OUTSIDE_RANGE);
+      qc_set(qc_output[j*ostride], QC_BAD); // 11/26/12
       continue;
     }
 
@@ -485,10 +648,10 @@ int bilinear_interpolate(core_s cs) {
     // with the appropriate qc flagging.
 
     // u is the fraction of the way up the bin to where our target value is
-    u=(x-x1)/(x2-x1);
+    u = compiled ? stencil->weight[stencil->row_start[j]+1] : (x-x1)/(x2-x1);
 
     // Now just do the weighted average
-    output[j]=u*y2 + (1-u)*y1;
+    output[j*ostride]=u*y2 + (1-u)*y1;
 
     // Keep signs and everything
     //dist_1[j]=index[n1]-target[j];
@@ -499,19 +662,19 @@ int bilinear_interpolate(core_s cs) {
     // This is how we tell if we extrapolated or not; if u is not in the
     // range [0,1], then it lies outside the bin of [x1,x2], and thus is an
     // extrapolation 
-    if (u < 0 || u > 1) qc_set(qc_output[j], QC_EXTRAPOLATE);
+    if (u < 0 || u > 1) qc_set(qc_output[j*ostride], QC_EXTRAPOLATE);
 
 
     // Finally, merge in the input QC from the two points we use.  However,
     // if u == 1, don't use n1 and if u = 0 don't use n2, because our
     // weights on those two points will be 0 in those cases.
 
-    if (fabs(u-1) > 1e-5 && (qc_array[n1] & ~qc_mask) != 0) {
-      qc_set(qc_output[j],QC_INDETERMINATE);
+    if (fabs(u-1) > 1e-5 && (qc_array[n1*istride] & ~qc_mask) != 0) {
+      qc_set(qc_output[j*ostride],QC_INDETERMINATE);
     }
 
-    if (fabs(u) > 1e-5 && (qc_array[n2] & ~qc_mask) != 0) {
-      qc_set(qc_output[j],QC_INDETERMINATE);
+    if (fabs(u) > 1e-5 && (qc_array[n2*istride] & ~qc_mask) != 0) {
+      qc_set(qc_output[j*ostride],QC_INDETERMINATE);
     }
 
   }
@@ -29,6 +29,7 @@
  */
 
 # include <string.h>
+# include <pthread.h>
 # include "trans.h"
 # include "trans_private.h"
 
@@ -47,6 +48,11 @@ static struct param_node *_Param_List=NULL;
 static struct param_node *_Last_Param=NULL;
 static int _Nparams=0;
 
+// The slice loop in the driver can run on several threads, and user
+// transforms may store their params on every slice, so the list has to be
+// locked.
+static pthread_mutex_t _Param_Lock=PTHREAD_MUTEX_INITIALIZER;
+
 // This is kludgy, but static allocations are just easier
 #define _MAXDIMS 20
 #define _MAXBUF 4096
@@ -56,12 +62,15 @@ int trans_store_param(char *name, char *val, char *dim, char *field) {
   // First, scan down entire list and see if we have an identical attribute
   // already.  IF so, then dump out, because we don't need to store it.
 
+  pthread_mutex_lock(&_Param_Lock);
+
   struct param_node *n=_Param_List;
   while (n) {
     if (strcmp(n->name, name) == 0 &&
 	strcmp(n->val, val) == 0 &&
 	strcmp(n->dim, dim) == 0 &&
 	strcmp(n->field, field) == 0) {
+      pthread_mutex_unlock(&_Param_Lock);
       return(0);
     }
     n=n->next;
@@ -88,11 +97,15 @@ int trans_store_param(char *name, char *val, char *dim, char *field) {
 
   _Last_Param=current;
   _Nparams++;
+
+  pthread_mutex_unlock(&_Param_Lock);
     
   return(0);
 }
 
 int trans_destroy_param_list() {
+  pthread_mutex_lock(&_Param_Lock);
+
   struct param_node *n=_Param_List, *m;
   
   while(n) {
@@ -112,6 +125,8 @@ int trans_destroy_param_list() {
   _Last_Param=NULL;
   _Nparams=0;
 
+  pthread_mutex_unlock(&_Param_Lock);
+
   return(0);
 }
 
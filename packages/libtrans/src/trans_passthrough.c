@@ -62,8 +62,18 @@ int trans_passthrough_interface(interface_s is)
   //memcpy(odata,data,ni*sizeof(double));
   //memcpy(qc_odata,qc_data,ni*sizeof(int));
 
-  memcpy(is.output_data,is.input_data,ni*sizeof(double));
-  memcpy(is.output_qc, is.input_qc,ni*sizeof(int));
+  int istride=is.input_stride > 0 ? is.input_stride : 1;
+  int ostride=is.output_stride > 0 ? is.output_stride : 1;
+
+  if (istride == 1 && ostride == 1) {
+    memcpy(is.output_data,is.input_data,ni*sizeof(double));
+    memcpy(is.output_qc, is.input_qc,ni*sizeof(int));
+  } else {
+    for (int k=0;k<ni;k++) {
+      is.output_data[k*ostride]=is.input_data[k*istride];
+      is.output_qc[k*ostride]=is.input_qc[k*istride];
+    }
+  }
 
   return(0);
 }
@@ -37,7 +37,8 @@
 # include "trans_private.h"
 # include "timing.h"
 
-static size_t _one=1;
+// Per thread; see the note in trans_utils.c
+static __thread size_t _one=1;
 
 /* We'll be doing a lot of dynamic allocation, so let's make it easier */
 # define CALLOC(n,t)  (t*)calloc(n, sizeof(t))
@@ -52,44 +53,30 @@ static const char *metunits[] = {
   "SAME"
 };
 
-int trans_subsample_interface(interface_s is)
-//(double *data, int *qc_data, double *odata, int *qc_odata,
-// CDSVar *invar, CDSVar *outvar, int d, TRANSmetric **met) 
+// Work out everything about this transformation that doesn't depend on the
+// data in the slice, and put it into the plan.  This is done once, for the
+// first slice.
+static int build_subsample_plan(interface_s *is, TRANSplan *plan)
 {
-
   double *index=NULL, range, *target=NULL, missing_value;
   unsigned int qc_mask=0;
-  int ni, nt, status, m;
+  int ni, nt;
   CDSVar *incoord, *outcoord;
-  double **metrics=NULL;
-  TRANSmetric *met1d;
 
-  // Assign from interface struct - if I had written it this way to begin
-  // with I would just is the is elements, but I didn't.
-  double *data=is.input_data;
-  int *qc_data=is.input_qc;
-  double input_missing_value=is.input_missing_value;
-  double *odata=is.output_data;
-  int *qc_odata=is.output_qc;
-  double output_missing_value=is.output_missing_value;
-  CDSVar *invar=is.invar;
-  CDSVar *outvar=is.outvar;
-  int d=is.d;
-  int od=is.od;
-  TRANSmetric **met=is.met;
+  CDSVar *invar=is->invar;
+  CDSVar *outvar=is->outvar;
+  int d=is->d;
+  int od=is->od;
 
-  // Right now, just null out our metrics, until we have some to set
-  //free_metric(met);
+  // Start with the missing values we were given by the driver
+  plan->input_missing_value=is->input_missing_value;
+  plan->output_missing_value=is->output_missing_value;
 
   // Pull out the stuff we need from invar, outvar, the dimension index d,
   // and the right calls to the transfrom parameter functions
   ni=invar->dims[d]->length;
   nt=outvar->dims[od]->length;
 
-  // Define and allocate our metric
-  allocate_metric(met,metnames, metunits, NUM_METRICS, nt);
-  met1d = (*met);
-
   // These mostly work straight up because coord vars are always 1D, so we
   // don't have to worry about indexing or casting correctly
   incoord = cds_get_coord_var(invar, d);
@@ -122,7 +109,7 @@ int trans_subsample_interface(interface_s is)
   if (cds_get_transform_param_by_dim(invar, invar->dims[d],
 				     "missing_value", CDS_DOUBLE,
 				     &_one, &missing_value) != NULL) {
-    input_missing_value=missing_value;
+    plan->input_missing_value=missing_value;
 
     //trans_store_param_text_by_dim(invar, invar->dims[d], "input_missing_value",
     //outvar->dims[od]->name, outvar->name);
@@ -133,7 +120,7 @@ int trans_subsample_interface(interface_s is)
   if (cds_get_transform_param_by_dim(outvar, invar->dims[d],
 				     "missing_value", CDS_DOUBLE,
 				     &_one, &missing_value) != NULL) {
-    output_missing_value=missing_value;
+    plan->output_missing_value=missing_value;
   } 
 
   CDSVar *qc_invar=get_qc_var(invar);
@@ -158,11 +145,15 @@ int trans_subsample_interface(interface_s is)
   double *index_mid = get_bin_midpoints(index, ni, invar, d);
   double *target_mid = get_bin_midpoints(target, nt, outvar, od);
 
+  if (index) free(index);
+  if (target) free(target);
+
   // Trap out if we failed to find any bin widths
   if (! index_mid) {
     ERROR(TRANS_LIB_NAME,
 	  "Bin widths for input variable %s required but not provided.  Exiting...",
 	  invar->name);
+    if (target_mid) free(target_mid);
     return(-1);
   }
 
@@ -170,9 +161,61 @@ int trans_subsample_interface(interface_s is)
     ERROR(TRANS_LIB_NAME,
 	  "Bin widths for output variable %s required but not provided.  Exiting...",
 	  outvar->name);
+    free(index_mid);
     return(-1);
   }
 
+  plan->ni=ni;
+  plan->nt=nt;
+  plan->range=range;
+  plan->qc_mask=qc_mask;
+  plan->index=index_mid;
+  plan->target=target_mid;
+
+  // The qc bits to set if we estimated the bin boundaries
+  plan->estimated_bin_qc=get_estimated_bin_qc(invar, d, outvar, od);
+
+  plan->ready=1;
+  return(0);
+}
+
+int trans_subsample_interface(interface_s is)
+//(double *data, int *qc_data, double *odata, int *qc_odata,
+// CDSVar *invar, CDSVar *outvar, int d, TRANSmetric **met) 
+{
+
+  int nt, status, m, i;
+  double **metrics=NULL;
+  TRANSmetric *met1d;
+
+  // Assign from interface struct - if I had written it this way to begin
+  // with I would just is the is elements, but I didn't.
+  double *data=is.input_data;
+  int *qc_data=is.input_qc;
+  double *odata=is.output_data;
+  int *qc_odata=is.output_qc;
+  TRANSmetric **met=is.met;
+  int ostride=is.output_stride > 0 ? is.output_stride : 1;
+
+  // Right now, just null out our metrics, until we have some to set
+  //free_metric(met);
+
+  // If the driver didn't give us a plan, make a throwaway one for just
+  // this call
+  TRANSplan *plan=is.plan;
+  if (plan == NULL) plan=trans_create_plan();
+
+  if (! plan->ready && (status=build_subsample_plan(&is, plan)) < 0) {
+    if (plan != is.plan) trans_free_plan(&plan);
+    return(status);
+  }
+
+  nt=plan->nt;
+
+  // Define and allocate our metric
+  allocate_metric(met,metnames, metunits, NUM_METRICS, nt);
+  met1d = (*met);
+
   //status=subsample(data, qc_data, qc_mask, index_mid, ni, range,
   //		   odata, qc_odata, target_mid, nt, missing_value,
   //		   &metrics);
@@ -181,21 +224,27 @@ int trans_subsample_interface(interface_s is)
 	    status=call_core_function(subsample,
 				      .input_data=data,
 				      .input_qc=qc_data,
-				      .qc_mask=qc_mask,
-				      .index=index_mid,
-				      .nindex=ni,
-				      .range=range,
+				      .input_stride=is.input_stride,
+				      .qc_mask=plan->qc_mask,
+				      .index=plan->index,
+				      .nindex=plan->ni,
+				      .range=plan->range,
 				      .output_data=odata,
 				      .output_qc=qc_odata,
-				      .target=target_mid,
+				      .output_stride=is.output_stride,
+				      .target=plan->target,
 				      .ntarget=nt,
-				      .input_missing_value=input_missing_value,
-				      .output_missing_value=output_missing_value,
+				      .input_missing_value=plan->input_missing_value,
+				      .output_missing_value=plan->output_missing_value,
 				      .metrics=&metrics);
 	    );
 
   // Set the qc bits if we estimated the bin boundaries
-  set_estimated_bin_qc(qc_odata, invar, d, outvar, od, nt);
+  if (plan->estimated_bin_qc) {
+    for (i=0;i<nt;i++) {
+      qc_odata[i*ostride] |= plan->estimated_bin_qc;
+    }
+  }
 
   // Pass our metrics back to the driver.
   for (m=0; m < NUM_METRICS ; m++) {
@@ -208,10 +257,7 @@ int trans_subsample_interface(interface_s is)
   }
   free(metrics);
 
-  if (index) free(index);
-  if (target) free(target);
-  if (index_mid) free(index_mid);
-  if (target_mid) free(target_mid);
+  if (plan != is.plan) trans_free_plan(&plan);
 
   return(status);
 }
@@ -246,6 +292,8 @@ int subsample (core_s cs) {
   int ni = cs.nindex;
   double *output = cs.output_data;
   int *qc_output = cs.output_qc;
+  int istride = cs.input_stride > 0 ? cs.input_stride : 1;
+  int ostride = cs.output_stride > 0 ? cs.output_stride : 1;
   double *target = cs.target;
   int nt = cs.ntarget;
   double input_missing_value = cs.input_missing_value;
@@ -287,7 +335,7 @@ int subsample (core_s cs) {
   iold=0;
   smallest_d_last_good_value = 0;
   for (j=0; j<nt; j++) {
-    qc_output[j]=0;
+    qc_output[j*ostride]=0;
 
     // Set our scanning input value to the edge of the last window
     i=iold;
@@ -322,10 +370,10 @@ int subsample (core_s cs) {
 
       while (j < nt) {
 	// Need to zero this out, because we are jumping the j loop
-	qc_output[j]=0;
-	qc_set(qc_output[j], QC_OUTSIDE_RANGE);
-	qc_set(qc_output[j], QC_BAD); // 11/26/12
-	output[j]=output_missing_value;
+	qc_output[j*ostride]=0;
+	qc_set(qc_output[j*ostride], QC_OUTSIDE_RANGE);
+	qc_set(qc_output[j*ostride], QC_BAD); // 11/26/12
+	output[j*ostride]=output_missing_value;
 	distance[j]=output_missing_value;
 	j++;
       }
@@ -360,9 +408,9 @@ int subsample (core_s cs) {
 
       // ...but we only want to set this as our target distance if it
       // passes qc and whatnot
-      if (d < dist && array[i] != input_missing_value
-	  && (! (qc_array[i] & qc_mask))
-	  && isfinite(array[i])) {
+      if (d < dist && array[i*istride] != input_missing_value
+	  && (! (qc_array[i*istride] & qc_mask))
+	  && isfinite(array[i*istride])) {
 	dist=d; it=i;
       }
 
@@ -385,30 +433,30 @@ int subsample (core_s cs) {
 		"No good input values for output bin %d, index value %f",
 		j, target[j]);
 
-      output[j]=output_missing_value;
+      output[j*ostride]=output_missing_value;
       distance[j]=output_missing_value;
       status=1;
-      qc_set(qc_output[j], QC_ALL_BAD_INPUTS);
-      qc_set(qc_output[j], QC_BAD);
+      qc_set(qc_output[j*ostride], QC_ALL_BAD_INPUTS);
+      qc_set(qc_output[j*ostride], QC_BAD);
 
       // If we are at the top of our input array, then we know all the
       // remaining output points also have either bad input or are outside
       // our range.  So, do that now:
       if (i == ni) {
 	while (++j < nt) {
-	  output[j]=output_missing_value;
+	  output[j*ostride]=output_missing_value;
 	  distance[j]=output_missing_value;
 
 	  // Need to zero this out, because we are jumping the j loop
-	  qc_output[j]=0;
-	  qc_set(qc_output[j], QC_BAD);
+	  qc_output[j*ostride]=0;
+	  qc_set(qc_output[j*ostride], QC_BAD);
 	  
 	  // If our target is beyond the range of the final index point, set
 	  // QC_OUTSIDE_RANGE.  Otherwise, QC_ALL_BAD_INPUTS
 	  if (target[j] < index[ni-1]+range) {
-	    qc_set(qc_output[j], QC_ALL_BAD_INPUTS);
+	    qc_set(qc_output[j*ostride], QC_ALL_BAD_INPUTS);
 	  } else {
-	    qc_set(qc_output[j], QC_OUTSIDE_RANGE);
+	    qc_set(qc_output[j*ostride], QC_OUTSIDE_RANGE);
 	  }
 	}
 	break;  // out of the j loop
@@ -424,7 +472,7 @@ int subsample (core_s cs) {
     } // end logic if no good points within range
 
     // Otherwise, use our stored it
-    output[j]=array[it];
+    output[j*ostride]=array[it*istride];
 
     //KLG new logic saving smallest_d of last good value
     smallest_d_last_good_value = smallest_d;
@@ -444,13 +492,13 @@ int subsample (core_s cs) {
     distance[j]=index[it]-target[j];
 
     // If the input point is yellow, set QC_INDETERMINATE on output 
-    if ((qc_array[it] & ~qc_mask) != 0) {
-      	qc_set(qc_output[j], QC_INDETERMINATE);
+    if ((qc_array[it*istride] & ~qc_mask) != 0) {
+      	qc_set(qc_output[j*ostride], QC_INDETERMINATE);
     }
 
     // Set qc=1 if we skipped over the actual nearest point, though
     if (dist > smallest_d) {
-      qc_set(qc_output[j], QC_NOT_USING_CLOSEST);
+      qc_set(qc_output[j*ostride], QC_NOT_USING_CLOSEST);
     }
   }
    
@@ -1,6 +1,8 @@
 # include <stdio.h>
+# include <stdlib.h>
 # include <math.h>
 # include <string.h>
+# include <pthread.h>
 # include <time.h>
 # include <getopt.h>
 # include <regex.h>
@@ -10,7 +12,9 @@
 // # include "netcdf.h"
 #define NC_MAX_NAME 256
 
-static size_t _one=1;
+// Thread local, since the param lookups write the length back through it
+// and the driver may be running slices on several threads at once
+static __thread size_t _one=1;
 
 // This is infrastructure to tell us not to try and figure out default bin
 // sizes but instead to crash.  That's the right behavior for output bins
@@ -349,10 +353,14 @@ int get_bin_edges(double **front_edge, double **back_edge, double *index,
     (*back_edge)[i] = index[i] + (1.0-alignment)*wi;
   }
 
-  // Set a user tag so we know we had to fake the bin information
+  // Set a user tag so we know we had to fake the bin information.  Only
+  // set it the first time, so that later slices (possibly on other
+  // threads) just read it.
   char key[30];
   sprintf(key,"estimated_boundaries_%d",d);
-  cds_set_user_data(var, key,"true",NULL);
+  if (! cds_get_user_data(var, key)) {
+    cds_set_user_data(var, key,"true",NULL);
+  }
 
   // Return a different status to indicate we had to guess our bin edges
   return(1);
@@ -387,15 +395,13 @@ double *get_bin_midpoints(double *index, int nbins, CDSVar *var, int d) {
 }
 
 
-// This function will scan the user data of invar and outvar, and set the
-// qc_odata bits if we had to estimate the bin boundaries from the data
-// itself, rather than read it from metadata or trans params.
-int set_estimated_bin_qc(int *qc_odata, CDSVar *invar, int d,
-			 CDSVar *outvar, int od, int nt) {
+// This function will scan the user data of invar and outvar, and return
+// the qc bits to set if we had to estimate the bin boundaries from the
+// data itself, rather than read it from metadata or trans params.
+int get_estimated_bin_qc(CDSVar *invar, int d, CDSVar *outvar, int od) {
   char *val;
   char key[30];
   int qc_bin=0;
-  int i;
 
   sprintf(key,"estimated_boundaries_%d",d);
 
@@ -411,6 +417,15 @@ int set_estimated_bin_qc(int *qc_odata, CDSVar *invar, int d,
     qc_set(qc_bin,QC_ESTIMATED_OUTPUT_BIN);
   }
 
+  return(qc_bin);
+}
+
+// And this one sets those bits in qc_odata
+int set_estimated_bin_qc(int *qc_odata, CDSVar *invar, int d,
+			 CDSVar *outvar, int od, int nt) {
+  int qc_bin=get_estimated_bin_qc(invar, d, outvar, od);
+  int i;
+
   if (qc_bin) {
     for (i=0;i<nt;i++) {
       qc_odata[i] |= qc_bin;
@@ -418,3 +433,224 @@ int set_estimated_bin_qc(int *qc_odata, CDSVar *invar, int d,
   }
   return(0);
 }
+
+// Transform plans.  The driver makes an empty one for each dimension
+// group, and the interface functions fill it in the first time they are
+// called with it.
+TRANSplan *trans_create_plan(void) {
+  return(CALLOC(1, TRANSplan));
+}
+
+void trans_free_plan(TRANSplan **plan) {
+  TRANSplan *p;
+
+  if (plan == NULL || (p = *plan) == NULL) return;
+
+  if (p->index) free(p->index);
+  if (p->target) free(p->target);
+  if (p->index_boundary_1) free(p->index_boundary_1);
+  if (p->index_boundary_2) free(p->index_boundary_2);
+  if (p->target_boundary_1) free(p->target_boundary_1);
+  if (p->target_boundary_2) free(p->target_boundary_2);
+  if (p->weights) free(p->weights);
+  if (p->aux && p->free_aux) p->free_aux(p->aux);
+
+  free(p);
+  *plan=NULL;
+}
+
+// Compiled transform matrices.  Everything is allocated up front, the
+// per-entry and per-row extras included; a transform that doesn't use
+// some of them just ignores them.
+TRANSmatrix *trans_create_matrix(int nrows, int ncols, int nnz) {
+  TRANSmatrix *m=CALLOC(1, TRANSmatrix);
+
+  m->nrows=nrows;
+  m->ncols=ncols;
+  m->nnz=nnz;
+  m->row_start=CALLOC(nrows+1, int);
+
+  // calloc(0) may give us NULL, so always ask for at least one
+  m->col=CALLOC(nnz > 0 ? nnz : 1, int);
+  m->weight=CALLOC(nnz > 0 ? nnz : 1, double);
+  m->frac=CALLOC(nnz > 0 ? nnz : 1, double);
+  m->span=CALLOC(nnz > 0 ? nnz : 1, double);
+
+  m->row_flags=CALLOC(nrows, int);
+  m->row_index=CALLOC(nrows, int);
+  m->row_span=CALLOC(nrows, double);
+  m->row_max_weight=CALLOC(nrows, double);
+
+  return(m);
+}
+
+void trans_free_matrix(TRANSmatrix *m) {
+  if (m == NULL) return;
+
+  free(m->row_start);
+  free(m->col);
+  free(m->weight);
+  free(m->frac);
+  free(m->span);
+  free(m->row_flags);
+  free(m->row_index);
+  free(m->row_span);
+  free(m->row_max_weight);
+  free(m);
+}
+
+// The cache itself is just a list, with the grids that each matrix was
+// compiled from as the key.  We compare the keys exactly, so there's no
+// chance of picking up a matrix for a grid that's only close.  Entries
+// that are in use by a plan are never thrown out from under it; if the
+// cache is cleared while they are in use, they are marked stale and freed
+// when the last plan lets go.
+#define _MAX_CACHED_MATRICES 16
+
+struct matrix_node {
+  char *kind;  // which transform made it
+  double *key;  // grids it was made from
+  int nkey;
+  TRANSmatrix *matrix;
+  int refs;  // number of plans using it
+  int stale;  // cleared, but still in use
+  unsigned long last_used;
+  struct matrix_node *next;
+};
+
+static struct matrix_node *_Matrix_List=NULL;
+static unsigned long _Matrix_Clock=0;
+static pthread_mutex_t _Matrix_Lock=PTHREAD_MUTEX_INITIALIZER;
+
+static void free_matrix_node(struct matrix_node *n) {
+  trans_free_matrix(n->matrix);
+  free(n->kind);
+  free(n->key);
+  free(n);
+}
+
+// Unlink and free a node - must be called with the lock held
+static void remove_matrix_node(struct matrix_node *n) {
+  struct matrix_node **p=&_Matrix_List;
+
+  while (*p && *p != n) p=&((*p)->next);
+  if (*p) *p=n->next;
+  free_matrix_node(n);
+}
+
+static struct matrix_node *find_matrix_node(const char *kind, double *key,
+					     int nkey) {
+  struct matrix_node *n;
+
+  for (n=_Matrix_List;n;n=n->next) {
+    if (! n->stale && n->nkey == nkey && strcmp(n->kind, kind) == 0 &&
+	memcmp(n->key, key, nkey*sizeof(double)) == 0) {
+      return(n);
+    }
+  }
+  return(NULL);
+}
+
+// Look up a matrix compiled from the same grids.  If we find one, it's
+// ours until we hand it back with trans_release_matrix().
+TRANSmatrix *trans_get_cached_matrix(const char *kind, double *key, int nkey) {
+  struct matrix_node *n;
+  TRANSmatrix *m=NULL;
+
+  pthread_mutex_lock(&_Matrix_Lock);
+  if ((n=find_matrix_node(kind, key, nkey))) {
+    n->refs++;
+    n->last_used=++_Matrix_Clock;
+    m=n->matrix;
+    DEBUG_LV4("libtrans", "Reusing compiled %s matrix (%d x %d)",
+	      kind, m->nrows, m->ncols);
+  }
+  pthread_mutex_unlock(&_Matrix_Lock);
+
+  return(m);
+}
+
+// Put a newly compiled matrix into the cache, which takes it over.  We
+// return the one to use, which is normally the same matrix, but if
+// someone beat us to it we free ours and return theirs.  Either way, it
+// has to be handed back with trans_release_matrix().
+TRANSmatrix *trans_cache_matrix(const char *kind, double *key, int nkey,
+				TRANSmatrix *matrix) {
+  struct matrix_node *n, *oldest;
+  int count;
+
+  pthread_mutex_lock(&_Matrix_Lock);
+
+  if ((n=find_matrix_node(kind, key, nkey))) {
+    trans_free_matrix(matrix);
+  } else {
+    n=CALLOC(1, struct matrix_node);
+    n->kind=strdup(kind);
+    n->key=CALLOC(nkey > 0 ? nkey : 1, double);
+    memcpy(n->key, key, nkey*sizeof(double));
+    n->nkey=nkey;
+    n->matrix=matrix;
+    n->next=_Matrix_List;
+    _Matrix_List=n;
+  }
+  n->refs++;
+  n->last_used=++_Matrix_Clock;
+
+  // Keep the cache bounded, by throwing out the least recently used
+  // matrices that nobody is using right now.
+  while (1) {
+    struct matrix_node *c;
+    count=0;
+    oldest=NULL;
+    for (c=_Matrix_List;c;c=c->next) {
+      if (c->stale) continue;
+      count++;
+      if (c->refs == 0 && (! oldest || c->last_used < oldest->last_used)) {
+	oldest=c;
+      }
+    }
+    if (count <= _MAX_CACHED_MATRICES || ! oldest) break;
+    remove_matrix_node(oldest);
+  }
+
+  pthread_mutex_unlock(&_Matrix_Lock);
+
+  return(n->matrix);
+}
+
+// Hand back a matrix we got from the cache.  It's a void * so that it can
+// be used as the free_aux of a plan.
+void trans_release_matrix(void *matrix) {
+  struct matrix_node *n;
+
+  if (matrix == NULL) return;
+
+  pthread_mutex_lock(&_Matrix_Lock);
+  for (n=_Matrix_List;n;n=n->next) {
+    if (n->matrix == (TRANSmatrix *) matrix) {
+      if (--(n->refs) <= 0) {
+	n->refs=0;
+	if (n->stale) remove_matrix_node(n);
+      }
+      break;
+    }
+  }
+  pthread_mutex_unlock(&_Matrix_Lock);
+}
+
+// Throw out all the compiled matrices, say when the grids have changed or
+// we just want the memory back.
+void trans_clear_matrix_cache(void) {
+  struct matrix_node *n, *next;
+
+  pthread_mutex_lock(&_Matrix_Lock);
+  for (n=_Matrix_List;n;n=next) {
+    next=n->next;
+    if (n->refs > 0) {
+      n->stale=1;
+    } else {
+      remove_matrix_node(n);
+    }
+  }
+  pthread_mutex_unlock(&_Matrix_Lock);
+}